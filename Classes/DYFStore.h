@@ -27,42 +27,34 @@
 #import <CommonCrypto/CommonCrypto.h>
 #import <StoreKit/StoreKit.h>
 #import "DYFStoreKeychainPersistence.h"
-
-/** Custom method to calculate the SHA-256 hash using Common Crypto.
+#import "DYFStorePaymentBackend.h"
+#import "DYFStoreMetrics.h"
+#import "DYFStoreLogger.h"
+#import "DYFStoreDigest.h"
+#import "DYFStoreFieldTable.h"
+#import "DYFStoreVerificationCache.h"
+#import "DYFStoreEntitlements.h"
+#import "DYFStoreCatalog.h"
+#import "DYFStoreReceiptHandle.h"
+#import "DYFStoreWarmUp.h"
+#import "DYFStoreFuture.h"
+#import "DYFStorePaymentAdmission.h"
+#import "DYFStoreRestoreSession.h"
+#import "DYFStoreJournal.h"
+#import "DYFStoreTransactionStateMachine.h"
+
+/** Custom method to calculate the SHA-256 hash using Common Crypto, see `DYFStoreDigestSHA256`.
  */
 CG_INLINE NSString *DYFCryptoSHA256(NSString *string)
 {
-    const int digestLength = CC_SHA256_DIGEST_LENGTH; // 32
-    unsigned char md[digestLength];
-    const char *cStr = [string UTF8String];
-    size_t cStrLen = strlen(cStr);
-    
-    // Confirm that the length of C string is small enough
-    // to be recast when calling the hash function.
-    if (cStrLen > UINT32_MAX) {
-        NSLog(@"C string too long to hash: %@", string);
-        return nil;
-    }
-    
-    CC_SHA256(cStr, (CC_LONG)cStrLen, md);
-    // Convert the array of bytes into a string showing its hex represention.
-    NSMutableString *hash = [NSMutableString string];
-    for (int i = 0; i < digestLength; i++) {
-        // Add a dash every four bytes, for readability.
-        if (i != 0 && i%4 == 0) {
-            //[hash appendString:@"-"];
-        }
-        [hash appendFormat:@"%02x", md[i]];
-    }
-    
-    return hash;
+    return DYFStoreDigestSHA256(string);
 }
 
-/** Outputs log to the console in the process of purchasing the `SKProduct` product.
+/** Outputs log in the process of purchasing the `SKProduct` product. The entry is recorded into a per-thread ring buffer and formatted later on a background queue, see `DYFStoreLogger`.
  */
 #ifndef DYFStoreLog
-#if DEBUG
-    #define DYFStoreLog(format, ...) NSLog((@"%s [Line: %d] [DYFStore] " format), __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__)
+#if DYFSTORE_LOGGER_ENABLED
+    #define DYFStoreLog(format, ...) DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, (@"" format), ##__VA_ARGS__)
 #else
     #define DYFStoreLog(format, ...) while(0){}
 #endif
@@ -92,20 +84,42 @@ FOUNDATION_EXPORT NSString *const DYFStorePurchasedNotification;
  */
 FOUNDATION_EXPORT NSString *const DYFStoreDownloadedNotification;
 
+/** Provides notification about the changes of the catalog. The object of the notification is a `DYFStoreCatalogChangeset` object.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreCatalogChangedNotification;
+
+/** Provides notification about the end of a restore, once the payment queue has sent all the restored transactions or has failed to restore them. The object of the notification is the finished `DYFStoreRestoreSession` object.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreRestoreCompletedNotification;
+
+/** Provides notification about the transactions updated by one callback of the payment queue, once they all have been processed. The object of the notification is the `DYFStoreTransactionBatch` object of the accepted transitions.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreTransactionsChangedNotification;
+
+/** The key of the `DYFStoreNotificationInfo` objects in the user info of a `DYFStoreTransactionsChangedNotification` notification, in the order they were created.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreNotificationInfosKey;
+
 /** Declares the protocol processes the purchase which was initiated by user from the App Store.
  */
 @protocol DYFStoreAppStorePaymentDelegate;
 
+@class DYFStoreNotificationInfo, DYFStoreProductsResult;
+
 @interface DYFStore : NSObject <SKProductsRequestDelegate, SKPaymentTransactionObserver>
 
-/** The valid products that were available for sale in the App Store.
+/** The valid products that were available for sale in the App Store. It mirrors the current snapshot of the catalog, and is updated with the catalog locked, in the order of its versions. Read it on the main queue after `DYFStoreCatalogChangedNotification`, or use the snapshot of `catalog` from other threads.
  */
 @property (nonatomic, strong) NSMutableArray *availableProducts;
 
-/** The product identifiers were invalid.
+/** The product identifiers were invalid. It mirrors the current snapshot of the catalog.
  */
 @property (nonatomic, strong) NSMutableArray *invalidIdentifiers;
 
+/** The versioned catalog. Every products response is applied to it as a diff, so that the stale prices are replaced and the products no longer sold are removed.
+ */
+@property (nonatomic, strong, readonly) DYFStoreCatalog *catalog;
+
 /** Records those transcations that have been purchased.
  */
 @property (nonatomic, strong) NSMutableArray *purchasedTranscations;
@@ -114,6 +128,22 @@ FOUNDATION_EXPORT NSString *const DYFStoreDownloadedNotification;
  */
 @property (nonatomic, strong) NSMutableArray *restoredTranscations;
 
+/** The session of the restore in progress, nil if there is none.
+ */
+@property (nonatomic, strong, readonly) DYFStoreRestoreSession *restoreSession;
+
+/** Whether the restored transactions of a restore session are only reported by the `DYFStoreRestoreCompletedNotification` notification, instead of a `DYFStorePurchasedNotification` notification each. The default value is NO.
+ */
+@property (nonatomic, assign) BOOL aggregatesRestoredTransactions;
+
+/** The state machine that every updated transaction passes through. The updates it rejects as illegal or duplicate are not processed, and the transactions it rejects to finish are not finished.
+ */
+@property (nonatomic, strong, readonly) DYFStoreTransactionStateMachine *stateMachine;
+
+/** Whether the `DYFStorePurchasedNotification` notifications of the updated transactions are only reported by the `DYFStoreTransactionsChangedNotification` notification of their callback, instead of being posted each. The default value is NO.
+ */
+@property (nonatomic, assign) BOOL batchesTransactionNotifications;
+
 /** The delegate processes the purchase which was initiated by user from the App Store.
  */
 @property (nonatomic, weak) id<DYFStoreAppStorePaymentDelegate> delegate;
@@ -124,10 +154,34 @@ FOUNDATION_EXPORT NSString *const DYFStoreDownloadedNotification;
 @property (nonatomic, strong) DYFStoreKeychainPersistence *keychainPersister;
 #endif
 
+/** The cache of receipt verification outcomes. When set, its entries of older receipts are dropped after `refreshReceiptOnSuccess:failure:` produces a new receipt. The default is nil.
+ */
+@property (nonatomic, strong) DYFStoreVerificationCache *verificationCache;
+
+/** The entitlement engine. When set, the product of every purchased or restored transaction is granted to its user before the transaction finishes. The products of one callback of the payment queue are granted in one update, and the snapshot is written once per callback. The default is nil.
+ */
+@property (nonatomic, strong) DYFStoreEntitlements *entitlements;
+
+/** The warm-up started by `addPaymentTransactionObserver`. When set, the products, the receipt and the persistence index are prepared in the background before the first purchase. The default is nil.
+ */
+@property (nonatomic, strong) DYFStoreWarmUp *warmUp;
+
 /** Whether hosted content is supported.
  */
 @property (nonatomic, assign) BOOL hostedContentSupported;
 
+/** The backend that provides the payment queue, the products request and the receipt refresh request. The default is a `DYFStoreDefaultPaymentBackend` object. Set it before adding the payment transaction observer.
+ */
+@property (nonatomic, strong) id<DYFStorePaymentBackend> paymentBackend;
+
+/** The admission of the payments, which joins a payment to the pending payment of the same product, user and quantity, and can limit the rate of the payments. The default coalesces the payments without a rate limit. If nil, every payment is added, and the futures of the purchases are nil.
+ */
+@property (nonatomic, strong) DYFStorePaymentAdmission *paymentAdmission;
+
+/** The path of the journal of the transaction lifecycle, or nil if it is not started. See `startJournalAtPath:capacity:`.
+ */
+@property (atomic, copy, readonly) NSString *journalPath;
+
 /** Constructs a store singleton with class method.
  
  @return A store singleton.
@@ -180,6 +234,14 @@ FOUNDATION_EXPORT NSString *const DYFStoreDownloadedNotification;
                               success:(DYFStoreProductsRequestDidFinish)success
                               failure:(DYFStoreProductsRequestDidFail)failure;
 
+/** Requests localized information about a set of products into the catalog, without calling the blocks of `requestProductWithIdentifiers:success:failure:`. It can run along with a products request.
+ 
+ @param identifiers The array of product identifiers.
+ @param completion The block to be called on the main queue when the request completes. Can be `nil`. It takes the changes of the catalog, or an error.
+ */
+- (void)prefetchProductsWithIdentifiers:(NSArray<NSString *> *)identifiers
+                             completion:(void (^)(DYFStoreCatalogChangeset *changeset, NSError *error))completion;
+
 /** Requests payment of the product with the given product identifier.
  
  @param productIdentifier The identifier of the product whose payment will be requested.
@@ -194,7 +256,7 @@ FOUNDATION_EXPORT NSString *const DYFStoreDownloadedNotification;
 - (void)purchaseProduct:(NSString *)productIdentifier
          userIdentifier:(NSString *)userIdentifier;
 
-/** Requests payment of the product with the given product identifier, an opaque identifier for the user’s account on your system and the number of items the user wants to purchase.
+/** Requests payment of the product with the given product identifier, an opaque identifier for the user’s account on your system and the number of items the user wants to purchase. A payment for the product and the user of a pending payment is not added again, see `paymentAdmission`.
  
  @param productIdentifier The identifier of the product whose payment will be requested.
  @param userIdentifier An opaque identifier for the user’s account on your system. The recommended implementation is to use a one-way hash of the user’s account name to calculate the value for this property.
@@ -271,6 +333,20 @@ FOUNDATION_EXPORT NSString *const DYFStoreDownloadedNotification;
  */
 - (void)finishTransaction:(SKPaymentTransaction *)transaction;
 
+/** Completes the purchased and restored transactions with the given transaction identifiers, looking them up once, and stops recording them.
+ 
+ @param transactionIdentifiers The identifiers of the transactions to finish.
+ */
+- (void)finishTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
+/** Starts appending the lifecycle events of the transactions to a journal that survives crashes and is kept in release builds: the updates of the payment queue, the downloads, the finishes, the payments added and the restores. The journal stays open for the life of the store. Read it with `DYFStoreJournalCopyEvents`, or with Tools/DYFStoreJournalReplay.c after copying it from the device.
+ 
+ @param path The path of the journal file, e.g. in the application support directory. An existing journal is appended to.
+ @param capacity The number of the latest events the journal keeps, e.g. 65536, which take 40 bytes each.
+ @return True if the journal was started or was already started, otherwise false.
+ */
+- (BOOL)startJournalAtPath:(NSString *)path capacity:(NSUInteger)capacity;
+
 /** Fetches the url of the bundle’s App Store receipt, or nil if the receipt is missing.
  If this method returns `nil` you should refresh the receipt by calling `refreshReceipt`.
  
@@ -286,6 +362,30 @@ FOUNDATION_EXPORT NSString *const DYFStoreDownloadedNotification;
 - (void)refreshReceiptOnSuccess:(DYFStoreRefreshReceiptSuccessBlock)successBlock
                         failure:(DYFStoreRefreshReceiptFailureBlock)failureBlock;
 
+/** Requests localized information about a set of products from the Apple App Store. Unlike `requestProductWithIdentifiers:success:failure:`, every call gets its own request, so that several of them can run at once. The products are applied to the catalog.
+ 
+ @param identifiers The array of product identifiers for the products you wish to retrieve information of.
+ @return A future of a `DYFStoreProductsResult` object. Cancelling it cancels the request.
+ */
+- (DYFStoreFuture<DYFStoreProductsResult *> *)futureForProductsWithIdentifiers:(NSArray<NSString *> *)identifiers;
+
+/** Requests to refresh the App Store receipt. The calls made while a refresh is pending join it.
+ 
+ @return A future of `NSNull`. Cancelling it cancels the refresh when nothing else waits for it.
+ */
+- (DYFStoreFuture<NSNull *> *)futureForReceiptRefresh;
+
+/** Requests payment of the product with the given product identifier, and waits for the transaction to finish. The progress is still posted with `DYFStorePurchasedNotification`. A request for the product and the user of a pending payment joins it, see `paymentAdmission`.
+ 
+ @param productIdentifier The identifier of the product whose payment will be requested.
+ @param userIdentifier An opaque identifier for the user’s account on your system. Can be `nil`.
+ @param quantity The number of items the user wants to purchase.
+ @return A future of the `DYFStoreNotificationInfo` object of the succeeded transaction, which fails with the error of a failed or cancelled one, with a `DYFStoreErrorCodePaymentDeferred` error if the transaction is deferred, and with a `DYFStoreErrorCodeTimedOut` error if the payment expires. Cancelling it stops waiting, but cannot take the payment out of the payment queue.
+ */
+- (DYFStoreFuture<DYFStoreNotificationInfo *> *)futureForPurchaseOfProduct:(NSString *)productIdentifier
+                                                             userIdentifier:(NSString *)userIdentifier
+                                                                   quantity:(NSInteger)quantity;
+
 @end
 
 @interface NSDate (DYFStore)
@@ -417,6 +517,14 @@ typedef NS_ENUM(NSUInteger, DYFStoreErrorCode)
     DYFStoreErrorCodeUnknownProductIdentifier = 100,
     /** Invalid parameter indicates that the received value is nil or empty. */
     DYFStoreErrorCodeInvalidParameter = 136,
+    /** Indicates that your app cancelled the operation of a `DYFStoreFuture`. */
+    DYFStoreErrorCodeOperationCancelled = 137,
+    /** Indicates that the operation of a `DYFStoreFuture` timed out. */
+    DYFStoreErrorCodeTimedOut = 138,
+    /** Indicates that the payment was refused by the rate limit of the payment admission. */
+    DYFStoreErrorCodePaymentRateLimited = 139,
+    /** Indicates that the payment is waiting for approval, e.g. by Ask to Buy. Its outcome is posted with `DYFStorePurchasedNotification` once it is approved or declined. */
+    DYFStoreErrorCodePaymentDeferred = 140,
     /** Indicates that your app cancelled the download. */
     DYFStoreErrorCodeDownloadCancelled = 300
 };
@@ -424,7 +532,7 @@ typedef NS_ENUM(NSUInteger, DYFStoreErrorCode)
 // The error domain for store.
 FOUNDATION_EXPORT NSString *const DYFStoreErrorDomain;
 
-@interface DYFStoreNotificationInfo : NSObject
+@interface DYFStoreNotificationInfo : NSObject <NSCoding, DYFStoreFieldMapping>
 
 /** The state of purchase.
  */
@@ -468,6 +576,28 @@ FOUNDATION_EXPORT NSString *const DYFStoreErrorDomain;
 
 @end
 
+/** The result of a products request.
+ */
+@interface DYFStoreProductsResult : NSObject
+
+/** The products whose identifiers have been recognized by the App Store, in the order they were requested.
+ */
+@property (nonatomic, copy, readonly) NSArray<SKProduct *> *products;
+
+/** The product identifiers that have not been recognized by the App Store.
+ */
+@property (nonatomic, copy, readonly) NSArray<NSString *> *invalidIdentifiers;
+
+/** Creates a result with the products and the invalid product identifiers.
+ 
+ @param products An array of `SKProduct` objects.
+ @param invalidIdentifiers An array of product identifiers.
+ @return A `DYFStoreProductsResult` object.
+ */
+- (instancetype)initWithProducts:(NSArray<SKProduct *> *)products invalidIdentifiers:(NSArray<NSString *> *)invalidIdentifiers;
+
+@end
+
 /** Processes the purchase which was initiated by user from the App Store.
  */
 @protocol DYFStoreAppStorePaymentDelegate <NSObject>
@@ -35,6 +35,18 @@ NSString *const DYFStorePurchasedNotification = @"DYFStorePurchasedNotification"
 // Provides notification about the download.
 NSString *const DYFStoreDownloadedNotification = @"DYFStoreDownloadedNotification";
 
+// Provides notification about the changes of the catalog.
+NSString *const DYFStoreCatalogChangedNotification = @"DYFStoreCatalogChangedNotification";
+
+// Provides notification about the end of a restore.
+NSString *const DYFStoreRestoreCompletedNotification = @"DYFStoreRestoreCompletedNotification";
+
+// Provides notification about the transactions updated by one callback.
+NSString *const DYFStoreTransactionsChangedNotification = @"DYFStoreTransactionsChangedNotification";
+
+// The key of the notification infos of the updated transactions.
+NSString *const DYFStoreNotificationInfosKey = @"DYFStoreNotificationInfosKey";
+
 // The error domain for store.
 NSString *const DYFStoreErrorDomain = @"SKErrorDomain.dyfstore";
 
@@ -44,6 +56,22 @@ NSString *const DYFStoreErrorDomain = @"SKErrorDomain.dyfstore";
  */
 @property (nonatomic, strong) SKProductsRequest *productsRequest;
 
+/** The product identifiers of the pending products request.
+ */
+@property (nonatomic, copy) NSSet<NSString *> *requestedIdentifiers;
+
+/** The versioned catalog.
+ */
+@property (nonatomic, strong) DYFStoreCatalog *catalog;
+
+/** The version of the catalog that `availableProducts` mirrors.
+ */
+@property (nonatomic, assign) NSUInteger availableProductsVersion;
+
+/** The pending prefetch requests, which map to their product identifiers and completion blocks.
+ */
+@property (nonatomic, strong) NSMapTable<SKRequest *, NSArray *> *prefetchRequests;
+
 /** Accepts the response from the App Store that contains the requested product information.
  */
 @property (nonatomic, copy) DYFStoreProductsRequestDidFinish productsRequestDidFinish;
@@ -52,10 +80,6 @@ NSString *const DYFStoreErrorDomain = @"SKErrorDomain.dyfstore";
  */
 @property (nonatomic, copy) DYFStoreProductsRequestDidFail productsRequestDidFail;
 
-/** The number of items the user wants to purchase. It must be greater than 0, the default value is 1.
- */
-@property (nonatomic, assign) NSInteger quantity;
-
 /** A request to refresh the receipt, which represents the user's transactions with your app.
  */
 @property (nonatomic, strong) SKReceiptRefreshRequest *refreshReceiptRequest;
@@ -68,8 +92,52 @@ NSString *const DYFStoreErrorDomain = @"SKErrorDomain.dyfstore";
  */
 @property (nonatomic, copy) DYFStoreRefreshReceiptFailureBlock refreshReceiptFailureBlock;
 
+/** The promises of the futures waiting for the pending refresh receipt request.
+ */
+@property (nonatomic, strong) NSMutableArray<DYFStorePromise *> *refreshReceiptPromises;
+
+/** The session of the restore in progress.
+ */
+@property (nonatomic, strong) DYFStoreRestoreSession *restoreSession;
+
+/** The state machine of the transactions.
+ */
+@property (nonatomic, strong) DYFStoreTransactionStateMachine *stateMachine;
+
+/** The notification infos created while the updated transactions of a callback are processed, nil outside of it.
+ */
+@property (nonatomic, strong) NSMutableArray<DYFStoreNotificationInfo *> *batchInfos;
+
+/** The journal of the transaction lifecycle, which is never closed once it is started.
+ */
+@property (atomic, assign) DYFStoreJournal *journal;
+
+/** The path of the journal.
+ */
+@property (atomic, copy) NSString *journalPath;
+
 @end
 
+/** Returns the hash of an identifier for the journal, or 0 if there is none.
+ */
+static uint64_t DYFStoreJournalHashString(NSString *string)
+{
+    const char *chars = string.UTF8String;
+    if (!chars || chars[0] == '\0') { return 0; }
+    return DYFStoreJournalHash(chars, strlen(chars));
+}
+
+/** Appends an event of a transaction to the journal, if it is started.
+ */
+static void DYFStoreJournalTransaction(DYFStoreJournal *journal, DYFStoreJournalEventKind kind, SKPaymentTransaction *transaction, NSInteger state, NSError *error)
+{
+    if (!journal) { return; }
+    DYFStoreJournalAppend(journal, kind,
+                          DYFStoreJournalHashString(transaction.transactionIdentifier),
+                          DYFStoreJournalHashString(transaction.payment.productIdentifier),
+                          (uint16_t)state, (int32_t)error.code);
+}
+
 @implementation DYFStore
 
 // Provides a global static variable.
@@ -113,10 +181,15 @@ static DYFStore *_instance = nil;
 {
     self.availableProducts      = [NSMutableArray arrayWithCapacity:0];
     self.invalidIdentifiers     = [NSMutableArray arrayWithCapacity:0];
+    self.catalog                = [[DYFStoreCatalog alloc] init];
+    self.prefetchRequests       = [NSMapTable strongToStrongObjectsMapTable];
+    self.refreshReceiptPromises = [NSMutableArray arrayWithCapacity:0];
     self.purchasedTranscations  = [NSMutableArray arrayWithCapacity:0];
     self.restoredTranscations   = [NSMutableArray arrayWithCapacity:0];
-    self.quantity               = 1;
     self.hostedContentSupported = NO;
+    self.paymentBackend         = [[DYFStoreDefaultPaymentBackend alloc] init];
+    self.paymentAdmission       = [[DYFStorePaymentAdmission alloc] initWithClock:nil];
+    self.stateMachine           = [[DYFStoreTransactionStateMachine alloc] init];
 }
 
 #pragma mark - StoreKit Wrapper
@@ -125,19 +198,24 @@ static DYFStore *_instance = nil;
  */
 - (void)addPaymentTransactionObserver
 {
-    [SKPaymentQueue.defaultQueue addTransactionObserver:self];
+    [self.paymentBackend addTransactionObserver:self];
+    [self.warmUp startWithStore:self];
 }
 
 /** Removes an observer from the payment queue.
  */
 - (void)removePaymentTransactionObserver
 {
-    [SKPaymentQueue.defaultQueue removeTransactionObserver:self];
+    [self.paymentBackend removeTransactionObserver:self];
+    // No transactions will complete the pending payments any more.
+    [self.paymentAdmission removeAllPayments];
+    // The payment queue delivers the unfinished transactions again to the next observer.
+    [self.stateMachine reset];
 }
 
 + (BOOL)canMakePayments
 {
-    return SKPaymentQueue.canMakePayments;
+    return [DYFStore.defaultStore.paymentBackend canMakePayments];
 }
 
 - (void)requestProductWithIdentifier:(NSString *)identifier
@@ -184,18 +262,100 @@ static DYFStore *_instance = nil;
     DYFStoreLog(@"product identifiers: %@", identifiers);
     
     if (!self.productsRequest) {
+        NSSet *setOfProductId = [NSSet setWithArray:identifiers];
+        if ([self.warmUp consumeProductsWithIdentifiers:setOfProductId]) {
+            [self answerProductsRequestWithIdentifiers:identifiers success:success];
+            return;
+        }
+        
         self.productsRequestDidFinish = success;
         self.productsRequestDidFail = failure;
         
-        NSSet *setOfProductId = [NSSet setWithArray:identifiers];
+        self.requestedIdentifiers = setOfProductId;
         // Creates a product request object and initialize it with our product identifiers.
-        self.productsRequest = [[SKProductsRequest alloc] initWithProductIdentifiers:setOfProductId];
+        self.productsRequest = [self.paymentBackend productsRequestWithProductIdentifiers:setOfProductId];
         self.productsRequest.delegate = self;
+        DYFStoreMetricsCount(DYFStoreCounterProductsRequests);
+        DYFStoreMetricsBegin(self.productsRequest, DYFStoreMetricProductsRequest);
         // Sends the request to the App Store.
         [self.productsRequest start];
     }
 }
 
+/** Answers a products request from the catalog, which the warm-up has filled.
+ */
+- (void)answerProductsRequestWithIdentifiers:(NSArray *)identifiers success:(DYFStoreProductsRequestDidFinish)success
+{
+    DYFStoreLog(@"products request answered by the warm-up");
+    DYFStoreProductsResult *result = [self productsResultWithIdentifiers:identifiers snapshot:self.catalog.snapshot];
+    
+    dispatch_async(dispatch_get_main_queue(), ^{
+        !success ?: success(result.products, result.invalidIdentifiers);
+    });
+}
+
+/** Looks up the products of a request in a snapshot of the catalog.
+ */
+- (DYFStoreProductsResult *)productsResultWithIdentifiers:(NSArray *)identifiers snapshot:(DYFStoreCatalogSnapshot *)snapshot
+{
+    NSSet *invalidIdentifiers = [NSSet setWithArray:snapshot.invalidIdentifiers];
+    
+    NSMutableArray *products = [NSMutableArray arrayWithCapacity:identifiers.count];
+    NSMutableArray *invalidProductIdentifiers = [NSMutableArray array];
+    for (NSString *identifier in [NSOrderedSet orderedSetWithArray:identifiers]) {
+        SKProduct *product = [snapshot productForIdentifier:identifier];
+        if (product) {
+            [products addObject:product];
+        } else if ([invalidIdentifiers containsObject:identifier]) {
+            [invalidProductIdentifiers addObject:identifier];
+        }
+    }
+    
+    return [[DYFStoreProductsResult alloc] initWithProducts:products invalidIdentifiers:invalidProductIdentifiers];
+}
+
+- (void)prefetchProductsWithIdentifiers:(NSArray<NSString *> *)identifiers
+                             completion:(void (^)(DYFStoreCatalogChangeset *changeset, NSError *error))completion
+{
+    if (identifiers.count == 0) { return; }
+    DYFStoreLog(@"prefetching product identifiers: %@", identifiers);
+    [self startPrefetchRequestWithIdentifiers:[NSSet setWithArray:identifiers] completion:completion];
+}
+
+/** Starts a products request that applies its response to the catalog, independently of the pending products request.
+ 
+ @param identifiers The set of product identifiers.
+ @param completion The block to be called on the main queue when the request completes. Can be `nil`.
+ @return The request.
+ */
+- (SKProductsRequest *)startPrefetchRequestWithIdentifiers:(NSSet<NSString *> *)identifiers
+                                                completion:(void (^)(DYFStoreCatalogChangeset *changeset, NSError *error))completion
+{
+    SKProductsRequest *request = [self.paymentBackend productsRequestWithProductIdentifiers:identifiers];
+    request.delegate = self;
+    @synchronized (self.prefetchRequests) {
+        [self.prefetchRequests setObject:@[identifiers, completion ? [completion copy] : NSNull.null] forKey:request];
+    }
+    DYFStoreMetricsCount(DYFStoreCounterProductsRequests);
+    DYFStoreMetricsBegin(request, DYFStoreMetricProductsRequest);
+    [request start];
+    return request;
+}
+
+/** Removes a prefetch request.
+ 
+ @param request A request.
+ @return The product identifiers and the completion block of the request, or nil if it is not a prefetch request.
+ */
+- (NSArray *)removePrefetchRequest:(SKRequest *)request
+{
+    @synchronized (self.prefetchRequests) {
+        NSArray *prefetch = [self.prefetchRequests objectForKey:request];
+        [self.prefetchRequests removeObjectForKey:request];
+        return prefetch;
+    }
+}
+
 #pragma mark - Product management
 
 /** Whether the product is contained in the list of available products.
@@ -205,28 +365,12 @@ static DYFStore *_instance = nil;
  */
 - (BOOL)containsProduct:(SKProduct *)product
 {
-    BOOL contained = NO;
-    for (SKProduct *aProduct in self.availableProducts) {
-        NSString *id = aProduct.productIdentifier;
-        if ([id isEqualToString:product.productIdentifier]) {
-            contained = YES;
-            break;
-        }
-    }
-    return contained;
+    return [self productForIdentifier:product.productIdentifier] != nil;
 }
 
 - (SKProduct *)productForIdentifier:(NSString *)productIdentifier
 {
-    SKProduct *product = nil;
-    for (SKProduct *aProduct in self.availableProducts) {
-        NSString *id = aProduct.productIdentifier;
-        if ([id isEqualToString:productIdentifier]) {
-            product = aProduct;
-            break;
-        }
-    }
-    return product;
+    return [self.catalog.snapshot productForIdentifier:productIdentifier];
 }
 
 - (NSString *)localizedPriceOfProduct:(SKProduct *)product
@@ -241,12 +385,80 @@ static DYFStore *_instance = nil;
     return [numberFormatter stringFromNumber:product.price];
 }
 
+/** Mirrors the changed catalog in the available products and the invalid identifiers, and posts a notification.
+ 
+ @param changeset The changes of the catalog.
+ */
+- (void)applyCatalogChangeset:(DYFStoreCatalogChangeset *)changeset
+{
+    if (changeset.isEmpty) { return; }
+    DYFStoreLog(@"catalog version %lu: %lu added, %lu updated, %lu removed", (unsigned long)changeset.toVersion, (unsigned long)changeset.addedProducts.count, (unsigned long)changeset.updatedProducts.count, (unsigned long)changeset.removedProductIdentifiers.count);
+    
+    // Responses are handled on the threads of their requests, e.g. a warm-up prefetch next to a products request. The mirroring is serialized with the catalog, and a changeset that is not newer than the mirrored version arrived late and is dropped.
+    @synchronized (self.catalog) {
+        if (changeset.toVersion <= self.availableProductsVersion) { return; }
+        
+        // The arrays are updated in place, as callers may hold them.
+        [self applyProductChangesOfChangeset:changeset];
+        [self.invalidIdentifiers setArray:changeset.snapshot.invalidIdentifiers];
+        
+        // Posted in the order of the versions.
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [NSNotificationCenter.defaultCenter postNotificationName:DYFStoreCatalogChangedNotification object:changeset];
+        });
+    }
+}
+
+/** Applies the added, updated and removed products of a changeset to `availableProducts`, so that only the changed entries are touched. The array is replaced with the snapshot if it does not mirror the version the changes apply to. Called with the catalog locked.
+ */
+- (void)applyProductChangesOfChangeset:(DYFStoreCatalogChangeset *)changeset
+{
+    NSMutableArray *products = self.availableProducts;
+    NSArray<SKProduct *> *snapshotProducts = changeset.snapshot.products;
+    BOOL mirrors = changeset.fromVersion == self.availableProductsVersion;
+    self.availableProductsVersion = changeset.toVersion;
+    if (!mirrors) {
+        [products setArray:snapshotProducts];
+        return;
+    }
+    
+    if (changeset.updatedProducts.count > 0 || changeset.removedProductIdentifiers.count > 0) {
+        NSMutableDictionary<NSString *, NSNumber *> *indexes = [NSMutableDictionary dictionaryWithCapacity:products.count];
+        [products enumerateObjectsUsingBlock:^(SKProduct *product, NSUInteger idx, BOOL *stop) {
+            !product.productIdentifier ?: [indexes setObject:@(idx) forKey:product.productIdentifier];
+        }];
+        
+        for (SKProduct *product in changeset.updatedProducts) {
+            NSNumber *index = indexes[product.productIdentifier ?: @""];
+            if (index) {
+                [products replaceObjectAtIndex:index.unsignedIntegerValue withObject:product];
+            } else {
+                [products addObject:product];
+            }
+        }
+        
+        NSMutableIndexSet *removed = [NSMutableIndexSet indexSet];
+        for (NSString *identifier in changeset.removedProductIdentifiers) {
+            NSNumber *index = indexes[identifier];
+            !index ?: [removed addIndex:index.unsignedIntegerValue];
+        }
+        [products removeObjectsAtIndexes:removed];
+    }
+    [products addObjectsFromArray:changeset.addedProducts];
+    
+    // The array was changed by other means.
+    if (products.count != snapshotProducts.count) {
+        [products setArray:snapshotProducts];
+    }
+}
+
 #pragma mark - SKProductsRequestDelegate
 
 // Accepts the response from the App Store that contains the requested product information.
 - (void)productsRequest:(SKProductsRequest *)request didReceiveResponse:(SKProductsResponse *)response
 {
     DYFStoreLog(@"products request received response");
+    DYFStoreMetricsEnd(request, DYFStoreMetricProductsRequest);
     // The array contains products whose identifiers have been recognized by the App Store.
     NSArray<SKProduct *> *products = response.products;
     // The array contains all product identifiers have not been recognized by the App Store.
@@ -254,17 +466,25 @@ static DYFStore *_instance = nil;
     
     for (SKProduct *product in products) {
         DYFStoreLog(@"received product with id: %@", product.productIdentifier);
-        if (![self containsProduct:product]) {
-            [self.availableProducts addObject:product];
-        }
     }
     
     for (int idx = 0; idx < invalidProductIdentifiers.count; idx++) {
         NSString *value = invalidProductIdentifiers[idx];
         DYFStoreLog(@"invalid product with id: %@, index: %d", value, idx);
-        if (![self.invalidIdentifiers containsObject:value]) {
-            [self.invalidIdentifiers addObject:value];
-        }
+    }
+    
+    NSArray *prefetch = [self removePrefetchRequest:request];
+    DYFStoreCatalogChangeset *changeset = [self.catalog applyProducts:products
+                                                   invalidIdentifiers:invalidProductIdentifiers
+                                                 requestedIdentifiers:prefetch ? prefetch[0] : self.requestedIdentifiers];
+    [self applyCatalogChangeset:changeset];
+    
+    if (prefetch) {
+        void (^completion)(DYFStoreCatalogChangeset *, NSError *) = prefetch[1] != NSNull.null ? prefetch[1] : nil;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            !completion ?: completion(changeset, nil);
+        });
+        return;
     }
     
     dispatch_async(dispatch_get_main_queue(), ^{
@@ -281,25 +501,48 @@ static DYFStore *_instance = nil;
     if (self.productsRequest && self.productsRequest == request) {
         DYFStoreLog(@"products request finished");
         self.productsRequest = nil;
+        self.requestedIdentifiers = nil;
     } else if (self.refreshReceiptRequest &&
                self.refreshReceiptRequest == request) {
         DYFStoreLog(@"refresh receipt finished");
+        DYFStoreMetricsEnd(request, DYFStoreMetricReceiptRefresh);
+        
+        // The outcomes verified against the previous receipt no longer apply.
+        if (self.verificationCache) {
+            DYFStoreReceiptHandle *receipt = self.warmUp ? self.warmUp.receipt : DYFStoreReceiptHandle.appStoreReceipt;
+            if ([self.verificationCache invalidateWithReceiptDigest:receipt.digest]) {
+                [self.verificationCache synchronize];
+            }
+        }
         
+        DYFStoreRefreshReceiptSuccessBlock successBlock = self.refreshReceiptSuccessBlock;
+        self.refreshReceiptSuccessBlock = nil;
+        self.refreshReceiptFailureBlock = nil;
         dispatch_async(dispatch_get_main_queue(), ^{
-            !self.refreshReceiptSuccessBlock ?:
-            self.refreshReceiptSuccessBlock();
+            !successBlock ?: successBlock();
         });
         
         self.refreshReceiptRequest = nil;
+        [self completeRefreshReceiptPromisesWithError:nil];
     }
 }
 
 // Tells the delegate that the request failed to execute. The requestDidFinish(_:) method is not called after this method is called.
 - (void)request:(SKRequest *)request didFailWithError:(NSError *)error
 {
-    if (self.productsRequest && self.productsRequest == request) {
+    NSArray *prefetch = [self removePrefetchRequest:request];
+    if (prefetch) {
+        DYFStoreLog(@"prefetch request failed with error: %@", error);
+        DYFStoreMetricsEnd(request, DYFStoreMetricProductsRequest);
+        
+        void (^completion)(DYFStoreCatalogChangeset *, NSError *) = prefetch[1] != NSNull.null ? prefetch[1] : nil;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            !completion ?: completion(nil, error);
+        });
+    } else if (self.productsRequest && self.productsRequest == request) {
         // Prints the cause of the product request failure.
         DYFStoreLog(@"products request failed with error: %@", error);
+        DYFStoreMetricsEnd(request, DYFStoreMetricProductsRequest);
         
         dispatch_async(dispatch_get_main_queue(), ^{
             !self.productsRequestDidFail ?:
@@ -307,16 +550,21 @@ static DYFStore *_instance = nil;
         });
         
         self.productsRequest = nil;
+        self.requestedIdentifiers = nil;
     } else if (self.refreshReceiptRequest &&
                self.refreshReceiptRequest == request) {
         DYFStoreLog(@"refresh receipt failed with error: %@", error);
+        DYFStoreMetricsEnd(request, DYFStoreMetricReceiptRefresh);
         
+        DYFStoreRefreshReceiptFailureBlock failureBlock = self.refreshReceiptFailureBlock;
+        self.refreshReceiptSuccessBlock = nil;
+        self.refreshReceiptFailureBlock = nil;
         dispatch_async(dispatch_get_main_queue(), ^{
-            !self.refreshReceiptFailureBlock ?:
-            self.refreshReceiptFailureBlock(error);
+            !failureBlock ?: failureBlock(error);
         });
         
         self.refreshReceiptRequest = nil;
+        [self completeRefreshReceiptPromisesWithError:error];
     }
 }
 
@@ -328,6 +576,10 @@ static DYFStore *_instance = nil;
  */
 - (void)postNotification:(DYFStoreNotificationInfo *)info
 {
+    if (self.batchInfos) {
+        [self.batchInfos addObject:info];
+        if (self.batchesTransactionNotifications) { return; }
+    }
     [self postNotificationWithName:DYFStorePurchasedNotification info:info];
 }
 
@@ -405,6 +657,13 @@ static DYFStore *_instance = nil;
 }
 
 - (void)purchaseProduct:(NSString *)productIdentifier userIdentifier:(NSString *)userIdentifier quantity:(NSInteger)quantity
+{
+    [self futureForPurchaseOfProduct:productIdentifier userIdentifier:userIdentifier quantity:quantity];
+}
+
+- (DYFStoreFuture<DYFStoreNotificationInfo *> *)futureForPurchaseOfProduct:(NSString *)productIdentifier
+                                                             userIdentifier:(NSString *)userIdentifier
+                                                                   quantity:(NSInteger)quantity
 {
     if (!productIdentifier || productIdentifier.length == 0) {
         DYFStoreLog(@"The given product identifier is null or empty");
@@ -419,22 +678,20 @@ static DYFStore *_instance = nil;
         info.state = DYFStorePurchaseStateFailed;
         info.error = error;
         [self postNotificationWithName:DYFStorePurchasedNotification info:info];
-        return;
+        return [DYFStoreFuture futureWithError:error];
     }
     
     SKProduct *product = [self productForIdentifier:productIdentifier];
     if (product) {
         DYFStoreLog(@"productIdentifier: %@, quantity: %zi", productIdentifier, quantity);
-        self.quantity = quantity;
         
-        // Creates and adds a mutable payment request to the payment queue.
+        // Creates a mutable payment request, which carries its own quantity, and adds it to the payment queue.
         SKMutablePayment *paymet = [SKMutablePayment paymentWithProduct:product];
         paymet.quantity = quantity;
         if (@available(iOS 7.0, *)) {
             paymet.applicationUsername = userIdentifier;
         }
-        [SKPaymentQueue.defaultQueue addPayment:paymet];
-        return;
+        return [self admitPayment:paymet];
     }
     
     DYFStoreLog(@"Unknown product identifier: %@", productIdentifier);
@@ -450,6 +707,43 @@ static DYFStore *_instance = nil;
     info.productIdentifier = productIdentifier;
     info.error = error;
     [self postNotificationWithName:DYFStorePurchasedNotification info:info];
+    return [DYFStoreFuture futureWithError:error];
+}
+
+/** Adds a payment to the payment queue, unless the payment admission coalesces or refuses it.
+ 
+ @param payment The payment.
+ @return The future of the outcome of the payment.
+ */
+- (DYFStoreFuture<DYFStoreNotificationInfo *> *)admitPayment:(SKPayment *)payment
+{
+    DYFStorePaymentAdmissionDecision decision = DYFStorePaymentAdmissionDecisionAdmitted;
+    DYFStoreFuture *future = [self.paymentAdmission admitPayment:payment decision:&decision];
+    
+    switch (decision) {
+        case DYFStorePaymentAdmissionDecisionAdmitted:
+            DYFStoreMetricsCount(DYFStoreCounterPaymentsAdded);
+            DYFStoreJournalAppend(self.journal, DYFStoreJournalEventPaymentAdded, 0, DYFStoreJournalHashString(payment.productIdentifier), 0, 0);
+            [self.paymentBackend addPayment:payment];
+            break;
+        case DYFStorePaymentAdmissionDecisionCoalesced:
+            DYFStoreLog(@"The payment joins the pending payment of %@", payment.productIdentifier);
+            DYFStoreMetricsCount(DYFStoreCounterPaymentsCoalesced);
+            break;
+        case DYFStorePaymentAdmissionDecisionRateLimited: {
+            DYFStoreLog(@"The payment of %@ is refused by the rate limit", payment.productIdentifier);
+            DYFStoreMetricsCount(DYFStoreCounterPaymentsRateLimited);
+            
+            DYFStoreNotificationInfo *info = [[DYFStoreNotificationInfo alloc] init];
+            info.state = DYFStorePurchaseStateFailed;
+            info.productIdentifier = payment.productIdentifier;
+            info.error = future.error;
+            [self postNotificationWithName:DYFStorePurchasedNotification info:info];
+            break;
+        }
+    }
+    
+    return future;
 }
 
 - (void)restoreTransactions
@@ -460,26 +754,77 @@ static DYFStore *_instance = nil;
 - (void)restoreTransactions:(NSString *)userIdentifier
 {
     self.restoredTranscations = [NSMutableArray arrayWithCapacity:0];
+    self.restoreSession = [[DYFStoreRestoreSession alloc] initWithUserIdentifier:userIdentifier];
+    [self.paymentBackend restoreCompletedTransactionsWithApplicationUsername:userIdentifier];
+}
+
+/** Finishes the restore session in progress and posts its notification.
+ 
+ @param error The error if restoring the transactions failed, or nil.
+ */
+- (void)completeRestoreSessionWithError:(NSError *)error
+{
+    DYFStoreRestoreSession *session = self.restoreSession;
+    if (!session) { return; }
     
-    if (!userIdentifier || userIdentifier.length == 0) {
-        [SKPaymentQueue.defaultQueue restoreCompletedTransactions];
+    self.restoreSession = nil;
+    [session finishWithError:error];
+    DYFStoreLog(@"The restore session finished with %zi transactions and %zi duplicates", session.transactions.count, session.duplicateCount);
+    
+    [NSNotificationCenter.defaultCenter postNotificationName:DYFStoreRestoreCompletedNotification object:session];
+}
+
+- (void)finishTransaction:(SKPaymentTransaction *)transaction
+{
+    DYFStoreLog(@"transactionIdentifier: %@", transaction.transactionIdentifier ?: @"");
+    if (!transaction) { return; }
+    if ([self.stateMachine applyInput:DYFStoreTransactionInputFinish toTransaction:transaction] == DYFStoreTransactionPhaseRejected) {
+        DYFStoreLog(@"The transaction cannot be finished in phase %d", [self.stateMachine phaseOfTransaction:transaction]);
+        DYFStoreMetricsCount(DYFStoreCounterTransitionsRejected);
         return;
     }
+    DYFStoreMetricsCount(DYFStoreCounterTransactionsFinished);
+    DYFStoreJournalTransaction(self.journal, DYFStoreJournalEventFinished, transaction, transaction.transactionState, nil);
+    DYFStoreMetricsEnd(transaction, DYFStoreMetricPurchasedToFinished);
+    [self.paymentBackend finishTransaction:transaction];
+}
+
+- (void)finishTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers
+{
+    if (transactionIdentifiers.count == 0) { return; }
     
-    NSAssert([SKPaymentQueue.defaultQueue respondsToSelector:@selector(restoreCompletedTransactionsWithApplicationUsername:)], @"restoreCompletedTransactionsWithApplicationUsername: not supported in this iOS version. Use restoreCompletedTransactions instead.");
+    NSSet *identifiers = [NSSet setWithArray:transactionIdentifiers];
+    NSMutableArray<SKPaymentTransaction *> *transactions = [NSMutableArray arrayWithCapacity:identifiers.count];
+    for (NSMutableArray<SKPaymentTransaction *> *recorded in @[self.purchasedTranscations, self.restoredTranscations]) {
+        NSIndexSet *indexes = [recorded indexesOfObjectsPassingTest:^BOOL(SKPaymentTransaction *transaction, NSUInteger idx, BOOL *stop) {
+            return transaction.transactionIdentifier && [identifiers containsObject:transaction.transactionIdentifier];
+        }];
+        [transactions addObjectsFromArray:[recorded objectsAtIndexes:indexes]];
+        [recorded removeObjectsAtIndexes:indexes];
+    }
     
-    if (@available(iOS 7.0, *)) {
-        [SKPaymentQueue.defaultQueue restoreCompletedTransactionsWithApplicationUsername:userIdentifier];
-    } else {
-        [SKPaymentQueue.defaultQueue restoreCompletedTransactions];
+    DYFStoreLog(@"Finishes %zi transactions", transactions.count);
+    for (SKPaymentTransaction *transaction in transactions) {
+        [self finishTransaction:transaction];
     }
 }
 
-- (void)finishTransaction:(SKPaymentTransaction *)transaction
+#pragma mark - Journal
+
+- (BOOL)startJournalAtPath:(NSString *)path capacity:(NSUInteger)capacity
 {
-    DYFStoreLog(@"transactionIdentifier: %@", transaction.transactionIdentifier ?: @"");
-    if (!transaction) { return; }
-    [SKPaymentQueue.defaultQueue finishTransaction:transaction];
+    @synchronized (self) {
+        if (self.journal) { return YES; }
+        
+        DYFStoreJournal *journal = DYFStoreJournalOpen(path.fileSystemRepresentation, (uint32_t)MIN(capacity, (NSUInteger)UINT32_MAX));
+        if (!journal) {
+            DYFStoreLog(@"The journal cannot be opened: %s", strerror(errno));
+            return NO;
+        }
+        self.journalPath = path;
+        self.journal = journal;
+        return YES;
+    }
 }
 
 #pragma mark - Receipt
@@ -494,13 +839,120 @@ static DYFStore *_instance = nil;
 
 - (void)refreshReceiptOnSuccess:(DYFStoreRefreshReceiptSuccessBlock)successBlock failure:(DYFStoreRefreshReceiptFailureBlock)failureBlock
 {
-    if (!self.refreshReceiptRequest) {
-        self.refreshReceiptSuccessBlock = successBlock;
-        self.refreshReceiptFailureBlock = failureBlock;
-        
-        self.refreshReceiptRequest = [[SKReceiptRefreshRequest alloc] initWithReceiptProperties:@{}];
-        self.refreshReceiptRequest.delegate = self;
-        [self.refreshReceiptRequest start];
+    // The blocks of a pending refresh are kept, while a refresh started by the futures takes the blocks.
+    if (self.refreshReceiptRequest && (self.refreshReceiptSuccessBlock || self.refreshReceiptFailureBlock)) { return; }
+    
+    self.refreshReceiptSuccessBlock = successBlock;
+    self.refreshReceiptFailureBlock = failureBlock;
+    [self startRefreshReceiptRequest];
+}
+
+/** Starts the refresh receipt request, unless it is pending.
+ */
+- (void)startRefreshReceiptRequest
+{
+    if (self.refreshReceiptRequest) { return; }
+    
+    self.refreshReceiptRequest = [self.paymentBackend receiptRefreshRequestWithReceiptProperties:@{}];
+    self.refreshReceiptRequest.delegate = self;
+    DYFStoreMetricsCount(DYFStoreCounterReceiptRefreshes);
+    DYFStoreMetricsBegin(self.refreshReceiptRequest, DYFStoreMetricReceiptRefresh);
+    [self.refreshReceiptRequest start];
+}
+
+#pragma mark - Futures
+
+- (DYFStoreFuture<DYFStoreProductsResult *> *)futureForProductsWithIdentifiers:(NSArray<NSString *> *)identifiers
+{
+    if (identifiers.count == 0) {
+        NSString *errDesc = NSLocalizedStringFromTable(@"An array of product identifiers is null or empty", @"DYFStore", @"Error description");
+        NSDictionary *userInfo = @{NSLocalizedDescriptionKey: errDesc};
+        NSError *error = [NSError errorWithDomain:DYFStoreErrorDomain
+                                             code:DYFStoreErrorCodeInvalidParameter
+                                         userInfo:userInfo];
+        return [DYFStoreFuture futureWithError:error];
+    }
+    
+    DYFStoreLog(@"product identifiers: %@", identifiers);
+    
+    NSSet *setOfProductId = [NSSet setWithArray:identifiers];
+    if ([self.warmUp consumeProductsWithIdentifiers:setOfProductId]) {
+        return [DYFStoreFuture futureWithResult:[self productsResultWithIdentifiers:identifiers snapshot:self.catalog.snapshot]];
+    }
+    
+    DYFStorePromise *promise = [[DYFStorePromise alloc] init];
+    SKProductsRequest *request = [self startPrefetchRequestWithIdentifiers:setOfProductId completion:^(DYFStoreCatalogChangeset *changeset, NSError *error) {
+        if (error) {
+            [promise rejectWithError:error];
+        } else {
+            [promise fulfillWithResult:[self productsResultWithIdentifiers:identifiers snapshot:changeset.snapshot]];
+        }
+    }];
+    
+    __weak typeof(self) weakSelf = self;
+    promise.cancellationHandler = ^{
+        // The response of a cancelled request is not delivered.
+        if ([weakSelf removePrefetchRequest:request]) {
+            DYFStoreLog(@"products request cancelled");
+            DYFStoreMetricsEnd(request, DYFStoreMetricProductsRequest);
+            [request cancel];
+        }
+    };
+    return promise.future;
+}
+
+- (DYFStoreFuture<NSNull *> *)futureForReceiptRefresh
+{
+    DYFStorePromise *promise = [[DYFStorePromise alloc] init];
+    @synchronized (self.refreshReceiptPromises) {
+        [self.refreshReceiptPromises addObject:promise];
+    }
+    [self startRefreshReceiptRequest];
+    
+    __weak typeof(self) weakSelf = self;
+    __weak DYFStorePromise *weakPromise = promise;
+    promise.cancellationHandler = ^{
+        [weakSelf cancelRefreshReceiptPromise:weakPromise];
+    };
+    return promise.future;
+}
+
+/** Stops a future waiting for the refresh receipt request, and cancels the request when nothing else waits for it.
+ */
+- (void)cancelRefreshReceiptPromise:(DYFStorePromise *)promise
+{
+    BOOL waiting = NO;
+    @synchronized (self.refreshReceiptPromises) {
+        [self.refreshReceiptPromises removeObject:promise];
+        waiting = self.refreshReceiptPromises.count > 0;
+    }
+    
+    if (!waiting && self.refreshReceiptRequest && !self.refreshReceiptSuccessBlock && !self.refreshReceiptFailureBlock) {
+        DYFStoreLog(@"refresh receipt cancelled");
+        DYFStoreMetricsEnd(self.refreshReceiptRequest, DYFStoreMetricReceiptRefresh);
+        [self.refreshReceiptRequest cancel];
+        self.refreshReceiptRequest = nil;
+    }
+}
+
+/** Completes the futures waiting for the refresh receipt request.
+ 
+ @param error The error of the request, or nil if it is successful.
+ */
+- (void)completeRefreshReceiptPromisesWithError:(NSError *)error
+{
+    NSArray<DYFStorePromise *> *promises = nil;
+    @synchronized (self.refreshReceiptPromises) {
+        promises = [self.refreshReceiptPromises copy];
+        [self.refreshReceiptPromises removeAllObjects];
+    }
+    
+    for (DYFStorePromise *promise in promises) {
+        if (error) {
+            [promise rejectWithError:error];
+        } else {
+            [promise fulfillWithResult:NSNull.null];
+        }
     }
 }
 
@@ -509,30 +961,57 @@ static DYFStore *_instance = nil;
 // Tells an observer that one or more transactions have been updated.
 - (void)paymentQueue:(SKPaymentQueue *)queue updatedTransactions:(NSArray<SKPaymentTransaction *> *)transactions
 {
+    DYFStoreMetricsScope(DYFStoreMetricUpdatedTransactions);
+    DYFStoreJournal *journal = self.journal;
     for (SKPaymentTransaction *transaction in transactions) {
-        switch (transaction.transactionState) {
-            case SKPaymentTransactionStatePurchasing:
+        DYFStoreJournalTransaction(journal, DYFStoreJournalEventUpdated, transaction, transaction.transactionState, transaction.error);
+    }
+    
+    // The whole batch passes through the state machine at once, and only the accepted transitions are processed.
+    DYFStoreTransactionBatch *batch = [self.stateMachine applyTransactions:transactions];
+    if (batch.rejectedCount > 0) {
+        DYFStoreLog(@"Rejects %zi illegal or duplicate transaction updates", batch.rejectedCount);
+        DYFStoreMetricsAdd(DYFStoreCounterTransitionsRejected, batch.rejectedCount);
+    }
+    
+    // A callback can be nested in the processing of another one by a synchronous payment queue.
+    NSMutableArray<DYFStoreNotificationInfo *> *outerInfos = self.batchInfos;
+    self.batchInfos = [NSMutableArray arrayWithCapacity:batch.count];
+    
+    NSArray<SKPaymentTransaction *> *accepted = batch.transactions;
+    [self grantProductsOfBatch:batch];
+    for (NSUInteger idx = 0; idx < accepted.count; idx++) {
+        SKPaymentTransaction *transaction = accepted[idx];
+        switch ([batch transitionAtIndex:idx].to) {
+            case DYFStoreTransactionPhasePurchasing:
                 [self purchasingTransaction:transaction queue:queue];
                 break;
-            case SKPaymentTransactionStatePurchased:
+            case DYFStoreTransactionPhasePurchased:
                 [self didPurchaseTransaction:transaction queue:queue];
                 break;
-            case SKPaymentTransactionStateFailed:
+            case DYFStoreTransactionPhaseFailed:
                 [self didFailWithTransaction:transaction queue:queue error:transaction.error];
                 break;
-            case SKPaymentTransactionStateRestored:
+            case DYFStoreTransactionPhaseRestored:
                 [self didRestoreTransaction:transaction queue:queue];
                 break;
-#if __IPHONE_OS_VERSION_MAX_ALLOWED >= __IPHONE_8_0
-            case SKPaymentTransactionStateDeferred:
+            case DYFStoreTransactionPhaseDeferred:
                 [self didDeferTransaction:transaction queue:queue];
                 break;
-#endif
             default:
                 DYFStoreLog(@"Unknown transaction state");
                 break;
         }
     }
+    
+    // The entitlements granted by the whole batch are written once.
+    [self.entitlements synchronize];
+    
+    NSArray<DYFStoreNotificationInfo *> *infos = self.batchInfos;
+    self.batchInfos = outerInfos;
+    if (transactions.count > 0) {
+        [NSNotificationCenter.defaultCenter postNotificationName:DYFStoreTransactionsChangedNotification object:batch userInfo:@{DYFStoreNotificationInfosKey: infos}];
+    }
 }
 
 // Tells the observer that the payment queue has updated one or more download objects.
@@ -540,6 +1019,7 @@ static DYFStore *_instance = nil;
 {
     for (SKDownload *download in downloads) {
         SKDownloadState state = [self stateForDownload:download];
+        DYFStoreJournalTransaction(self.journal, DYFStoreJournalEventDownload, download.transaction, state, download.error);
         switch (state) {
             case SKDownloadStateWaiting:
                 DYFStoreLog(@"The download is inactive, waiting to be downloaded.");
@@ -564,18 +1044,22 @@ static DYFStore *_instance = nil;
                 break;
         }
     }
+    [self.entitlements synchronize];
 }
 
 // Tells the observer that the payment queue has finished sending restored transactions.
 - (void)paymentQueueRestoreCompletedTransactionsFinished:(SKPaymentQueue *)queue
 {
     DYFStoreLog(@"The payment queue has finished sending restored transactions");
+    DYFStoreJournalAppend(self.journal, DYFStoreJournalEventRestoreFinished, 0, 0, 0, 0);
+    [self completeRestoreSessionWithError:nil];
 }
 
 // Tells the observer that an error occurred while restoring transactions.
 - (void)paymentQueue:(SKPaymentQueue *)queue restoreCompletedTransactionsFailedWithError:(NSError *)error
 {
     DYFStoreLog(@"The restored transactions failed with error(%@)", error);
+    DYFStoreJournalAppend(self.journal, DYFStoreJournalEventRestoreFinished, 0, 0, 0, (int32_t)error.code);
     DYFStoreNotificationInfo *info = [[DYFStoreNotificationInfo alloc] init];
     
     // The user cancels the purchase.
@@ -587,6 +1071,7 @@ static DYFStore *_instance = nil;
     info.error = error;
     
     [self postNotification:info];
+    [self completeRestoreSessionWithError:error];
 }
 
 // Tells an observer that one or more transactions have been removed from the queue.
@@ -603,8 +1088,10 @@ static DYFStore *_instance = nil;
 - (BOOL)paymentQueue:(SKPaymentQueue *)queue shouldAddStorePayment:(SKPayment *)payment forProduct:(SKProduct *)product
 {
     if (@available(iOS 11.0, *)) {
-        if (![self containsProduct:product]) {
-            [self.availableProducts addObject:product];
+        if (product.productIdentifier) {
+            NSSet *identifiers = [NSSet setWithObject:product.productIdentifier];
+            DYFStoreCatalogChangeset *changeset = [self.catalog applyProducts:@[product] invalidIdentifiers:nil requestedIdentifiers:identifiers];
+            [self applyCatalogChangeset:changeset];
         }
         if (OBJC_RESPONDS_TO_SEL(self.delegate,
                                  @selector(didReceiveAppStorePurchaseRequest:payment:forProduct:))
@@ -625,6 +1112,10 @@ static DYFStore *_instance = nil;
 - (void)purchasingTransaction:(SKPaymentTransaction *)transaction queue:(SKPaymentQueue *)queue
 {
     DYFStoreLog(@"The transaction is purchasing");
+    DYFStoreMetricsCount(DYFStoreCounterPurchasing);
+    DYFStoreMetricsBegin(transaction, DYFStoreMetricPurchasingToPurchased);
+    // Only this transaction completes the pending payment that produced it.
+    [self.paymentAdmission bindTransaction:transaction];
     DYFStoreNotificationInfo *info = [[DYFStoreNotificationInfo alloc] init];
     info.state = DYFStorePurchaseStatePurchasing;
     [self postNotification:info];
@@ -638,11 +1129,17 @@ static DYFStore *_instance = nil;
 - (void)didPurchaseTransaction:(SKPaymentTransaction *)transaction queue:(SKPaymentQueue *)queue
 {
     DYFStoreLog(@"The transaction purchased. Deliver the content for %@", transaction.payment.productIdentifier);
+    DYFStoreMetricsCount(DYFStoreCounterPurchased);
+    DYFStoreMetricsEnd(transaction, DYFStoreMetricPurchasingToPurchased);
+    DYFStoreMetricsBegin(transaction, DYFStoreMetricPurchasedToFinished);
     [self.purchasedTranscations addObject:transaction];
     // Checks whether the purchased product has content hosted with Apple.
     if (_hostedContentSupported && transaction.downloads.count > 0) {
         // Starts the download process and send a DYFStoreDownloadStateStarted notification.
-        [queue startDownloads:transaction.downloads];
+        DYFStoreMetricsCount(DYFStoreCounterDownloadsStarted);
+        DYFStoreMetricsBegin(transaction, DYFStoreMetricDownload);
+        [self.stateMachine applyInput:DYFStoreTransactionInputDownloadStarted toTransaction:transaction];
+        [self.paymentBackend startDownloads:transaction.downloads];
         
         DYFStoreNotificationInfo *info = [[DYFStoreNotificationInfo alloc] init];
         info.downloadState = DYFStoreDownloadStateStarted;
@@ -666,14 +1163,20 @@ static DYFStore *_instance = nil;
     // The user cancels the purchase.
     if (error.code == SKErrorPaymentCancelled) {
         info.state = DYFStorePurchaseStateCancelled;
+        DYFStoreMetricsCount(DYFStoreCounterCancelled);
     } else {
         info.state = DYFStorePurchaseStateFailed;
+        DYFStoreMetricsCount(DYFStoreCounterFailed);
     }
     
     info.error = error;
     info.productIdentifier = transaction.payment.productIdentifier;
+    if (@available(iOS 7.0, *)) {
+        info.userIdentifier = transaction.payment.applicationUsername;
+    }
     
     [self postNotification:info];
+    [self.paymentAdmission completePaymentWithTransaction:transaction info:info];
     [self finishTransaction:transaction];
 }
 
@@ -685,10 +1188,27 @@ static DYFStore *_instance = nil;
 - (void)didRestoreTransaction:(SKPaymentTransaction *)transaction queue:(SKPaymentQueue *)queue
 {
     DYFStoreLog(@"The transaction restored. Restore the content for %@", transaction.payment.productIdentifier);
+    DYFStoreMetricsCount(DYFStoreCounterRestored);
+    DYFStoreMetricsBegin(transaction, DYFStoreMetricPurchasedToFinished);
+    // Of the transactions of the same original purchase, only the latest one is kept.
+    SKPaymentTransaction *duplicate = [self.restoreSession addTransaction:transaction];
+    if (duplicate == transaction) {
+        DYFStoreLog(@"The transaction duplicates a later restored purchase of %@", transaction.payment.productIdentifier);
+        [self finishTransaction:transaction];
+        return;
+    }
+    if (duplicate) {
+        DYFStoreLog(@"The transaction supersedes an earlier restored purchase of %@", transaction.payment.productIdentifier);
+        [self.restoredTranscations removeObjectIdenticalTo:duplicate];
+        [self finishTransaction:duplicate];
+    }
     [self.restoredTranscations addObject:transaction];
     // Sends a DYFStoreDownloadStateStarted notification if it has.
     if (_hostedContentSupported && transaction.downloads.count > 0) {
-        [queue startDownloads:transaction.downloads];
+        DYFStoreMetricsCount(DYFStoreCounterDownloadsStarted);
+        DYFStoreMetricsBegin(transaction, DYFStoreMetricDownload);
+        [self.stateMachine applyInput:DYFStoreTransactionInputDownloadStarted toTransaction:transaction];
+        [self.paymentBackend startDownloads:transaction.downloads];
         
         DYFStoreNotificationInfo *info = [[DYFStoreNotificationInfo alloc] init];
         info.downloadState = DYFStoreDownloadStateStarted;
@@ -707,10 +1227,13 @@ static DYFStore *_instance = nil;
 {
     // Do not block your UI. Allow the user to continue using your app.
     DYFStoreLog(@"The transaction deferred. Do not block your UI. Allow the user to continue using your app.");
+    DYFStoreMetricsCount(DYFStoreCounterDeferred);
     
     DYFStoreNotificationInfo *info = [[DYFStoreNotificationInfo alloc] init];
     info.state = DYFStorePurchaseStateDeferred;
     [self postNotification:info];
+    // The approval can take days, so the pending payment is dropped instead of blocking the next one.
+    [self.paymentAdmission completePaymentWithTransaction:transaction info:info];
 }
 
 /** Notifies the user about the purchase process finished.
@@ -736,7 +1259,46 @@ static DYFStore *_instance = nil;
         info.originalTransactionIdentifier = originalTx.transactionIdentifier;
     }
     
-    [self postNotification:info];
+    // Grants the product before the notification, so that the observers can already see it owned. The product of a transaction without downloads was granted with its batch, and the snapshot is written at the end of the callback.
+    if (self.entitlements && (state == DYFStorePurchaseStateSucceeded || state == DYFStorePurchaseStateRestored)) {
+        [self.entitlements grantProduct:info.productIdentifier toUser:info.userIdentifier];
+    }
+    
+    // The restored transactions of a session can be reported together when it finishes.
+    BOOL inSession = state == DYFStorePurchaseStateRestored && self.restoreSession;
+    if (inSession) {
+        [self.restoreSession addInfo:info];
+    }
+    if (!inSession || !self.aggregatesRestoredTransactions) {
+        [self postNotification:info];
+    }
+    [self.paymentAdmission completePaymentWithTransaction:transaction info:info];
+}
+
+/** Grants the products of the purchased and restored transactions of a batch in one update of the entitlements. The transactions with downloads are granted when their content is downloaded.
+ 
+ @param batch The transitions accepted by the state machine.
+ */
+- (void)grantProductsOfBatch:(DYFStoreTransactionBatch *)batch
+{
+    if (!self.entitlements) { return; }
+    
+    NSArray<SKPaymentTransaction *> *accepted = batch.transactions;
+    [self.entitlements grantProductsWithBlock:^(void (^grant)(NSString *, NSString *)) {
+        for (NSUInteger idx = 0; idx < accepted.count; idx++) {
+            DYFStoreTransactionPhase phase = [batch transitionAtIndex:idx].to;
+            if (phase != DYFStoreTransactionPhasePurchased && phase != DYFStoreTransactionPhaseRestored) { continue; }
+            
+            SKPaymentTransaction *transaction = accepted[idx];
+            if (self.hostedContentSupported && transaction.downloads.count > 0) { continue; }
+            
+            NSString *userIdentifier = nil;
+            if (@available(iOS 7.0, *)) {
+                userIdentifier = transaction.payment.applicationUsername;
+            }
+            grant(transaction.payment.productIdentifier, userIdentifier);
+        }
+    }];
 }
 
 #pragma mark - Download Transaction
@@ -775,7 +1337,8 @@ static DYFStore *_instance = nil;
     [self postNotificationWithName:DYFStoreDownloadedNotification info:info];
     
     BOOL hasPendingDownloads = [self.class hasPendingDownloadsInTransaction:transaction];
-    if (!hasPendingDownloads) {
+    if (!hasPendingDownloads && [self applyDownloadInput:DYFStoreTransactionInputDownloadFailed toTransaction:transaction]) {
+        DYFStoreMetricsEnd(transaction, DYFStoreMetricDownload);
         NSString *errDesc = NSLocalizedStringFromTable(@"The download cancelled", @"DYFStore", @"Error description");
         NSDictionary *userInfo = @{NSLocalizedDescriptionKey: errDesc};
         NSError *error = [NSError errorWithDomain:DYFStoreErrorDomain
@@ -806,7 +1369,9 @@ static DYFStore *_instance = nil;
     [self postNotificationWithName:DYFStoreDownloadedNotification info:info];
     
     BOOL hasPendingDownloads = [self.class hasPendingDownloadsInTransaction:transaction];
-    if (!hasPendingDownloads) {
+    if (!hasPendingDownloads && [self applyDownloadInput:DYFStoreTransactionInputDownloadFailed toTransaction:transaction]) {
+        DYFStoreMetricsCount(DYFStoreCounterDownloadsFailed);
+        DYFStoreMetricsEnd(transaction, DYFStoreMetricDownload);
         [self didFailWithTransaction:transaction queue:queue error:error];
     }
 }
@@ -829,7 +1394,9 @@ static DYFStore *_instance = nil;
         allAssetsDownloaded = NO;
     }
     
-    if (allAssetsDownloaded) {
+    if (allAssetsDownloaded && [self applyDownloadInput:DYFStoreTransactionInputDownloadFinished toTransaction:transaction]) {
+        DYFStoreMetricsCount(DYFStoreCounterDownloadsFinished);
+        DYFStoreMetricsEnd(transaction, DYFStoreMetricDownload);
         DYFStorePurchaseState state;
         if (transaction.transactionState == SKPaymentTransactionStateRestored) {
             state = DYFStorePurchaseStateRestored;
@@ -840,6 +1407,22 @@ static DYFStore *_instance = nil;
     }
 }
 
+/** Applies the completion of the downloads to the transaction in the state machine.
+ 
+ @param input DYFStoreTransactionInputDownloadFinished or DYFStoreTransactionInputDownloadFailed.
+ @param transaction An `SKPaymentTransaction` object in the payment queue.
+ @return NO if the downloads of the transaction have already been completed, or were never started.
+ */
+- (BOOL)applyDownloadInput:(DYFStoreTransactionInput)input toTransaction:(SKPaymentTransaction *)transaction
+{
+    if ([self.stateMachine applyInput:input toTransaction:transaction] == DYFStoreTransactionPhaseRejected) {
+        DYFStoreLog(@"The downloads of the transaction(%@) are not in progress", transaction.transactionIdentifier ?: @"");
+        DYFStoreMetricsCount(DYFStoreCounterTransitionsRejected);
+        return NO;
+    }
+    return YES;
+}
+
 /** Returns the state that a download operation can be in.
  
  @param download Downloadable content associated with a product.
@@ -980,6 +1563,79 @@ static DYFStore *_instance = nil;
 
 @end
 
+@implementation DYFStoreProductsResult
+
+- (instancetype)initWithProducts:(NSArray<SKProduct *> *)products invalidIdentifiers:(NSArray<NSString *> *)invalidIdentifiers
+{
+    self = [super init];
+    if (self) {
+        _products = [products copy] ?: @[];
+        _invalidIdentifiers = [invalidIdentifiers copy] ?: @[];
+    }
+    return self;
+}
+
+@end
+
 @implementation DYFStoreNotificationInfo
 
+DYFSTORE_FIELD_INTEGER(DYFStoreNotificationInfo, state)
+DYFSTORE_FIELD_INTEGER(DYFStoreNotificationInfo, downloadState)
+DYFSTORE_FIELD_FLOAT(DYFStoreNotificationInfo, downloadProgress)
+DYFSTORE_FIELD_OBJECT(DYFStoreNotificationInfo, error, NSError)
+DYFSTORE_FIELD_OBJECT(DYFStoreNotificationInfo, productIdentifier, NSString)
+DYFSTORE_FIELD_OBJECT(DYFStoreNotificationInfo, userIdentifier, NSString)
+DYFSTORE_FIELD_OBJECT(DYFStoreNotificationInfo, originalTransactionDate, NSDate)
+DYFSTORE_FIELD_OBJECT(DYFStoreNotificationInfo, originalTransactionIdentifier, NSString)
+DYFSTORE_FIELD_OBJECT(DYFStoreNotificationInfo, transactionDate, NSDate)
+DYFSTORE_FIELD_OBJECT(DYFStoreNotificationInfo, transactionIdentifier, NSString)
+
+static const DYFStoreField DYFStoreNotificationInfoFields[] = {
+    DYFSTORE_FIELD(DYFStoreNotificationInfo, state),
+    DYFSTORE_FIELD(DYFStoreNotificationInfo, downloadState),
+    DYFSTORE_FIELD(DYFStoreNotificationInfo, downloadProgress),
+    DYFSTORE_FIELD(DYFStoreNotificationInfo, error),
+    DYFSTORE_FIELD(DYFStoreNotificationInfo, productIdentifier),
+    DYFSTORE_FIELD(DYFStoreNotificationInfo, userIdentifier),
+    DYFSTORE_FIELD(DYFStoreNotificationInfo, originalTransactionDate),
+    DYFSTORE_FIELD(DYFStoreNotificationInfo, originalTransactionIdentifier),
+    DYFSTORE_FIELD(DYFStoreNotificationInfo, transactionDate),
+    DYFSTORE_FIELD(DYFStoreNotificationInfo, transactionIdentifier)
+};
+
++ (DYFStoreFieldTable)fieldTable
+{
+    return DYFStoreFieldTableMake(DYFStoreNotificationInfoFields);
+}
+
+- (instancetype)initWithCoder:(NSCoder *)aDecoder
+{
+    self = [super init];
+    if (self) {
+        DYFStoreFieldTableDecode(DYFStoreNotificationInfo.fieldTable, self, aDecoder);
+    }
+    return self;
+}
+
+- (void)encodeWithCoder:(NSCoder *)aCoder
+{
+    DYFStoreFieldTableEncode(DYFStoreNotificationInfo.fieldTable, self, aCoder);
+}
+
+- (instancetype)initWithDictionary:(NSDictionary *)dictionary
+{
+    if (![dictionary isKindOfClass:NSDictionary.class]) { return nil; }
+    
+    self = [super init];
+    if (self) {
+        DYFStoreFieldTableApplyDictionary(DYFStoreNotificationInfo.fieldTable, self, dictionary);
+    }
+    return self;
+}
+
+- (NSDictionary *)dictionaryRepresentation
+{
+    return DYFStoreFieldTableDictionary(DYFStoreNotificationInfo.fieldTable, self);
+}
+
 @end
@@ -0,0 +1,75 @@
+//
+//  DYFStoreBulkDecoder.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Decodes one stored record. It is called concurrently from the worker threads.
+ 
+ @param record The stored record.
+ @return The decoded object, or nil to skip the record.
+ */
+typedef id (^DYFStoreBulkDecodeBlock)(id record);
+
+/** Decodes the stored records of a persister in parallel, e.g. the archived transactions of a large store.
+ 
+ The records are cut into chunks that are decoded by at most `concurrency` worker threads from the concurrent queues of libdispatch. The decoded objects keep the order of the records.
+ */
+@interface DYFStoreBulkDecoder : NSObject
+
+/** The maximum number of worker threads. The default value is the number of active processors.
+ */
+@property (nonatomic, assign) NSUInteger concurrency;
+
+/** The number of records of a chunk. The default value is 256.
+ */
+@property (nonatomic, assign) NSUInteger chunkSize;
+
+/** The number of records below which they are decoded on the calling thread, where the workers would cost more than they save. The default value is 512.
+ */
+@property (nonatomic, assign) NSUInteger parallelThreshold;
+
+/** Returns the decoder the persisters share.
+ */
++ (instancetype)sharedDecoder;
+
+/** Decodes records.
+ 
+ @param records The stored records.
+ @param decode The block that decodes a record.
+ @return An array of the decoded objects, in the order of the records.
+ */
+- (NSArray *)decodeRecords:(NSArray *)records usingBlock:(DYFStoreBulkDecodeBlock)decode;
+
+/** Decodes records and yields the decoded objects, in the order of the records, as soon as their chunk is ready, without building one array of them. At most twice `concurrency` chunks are decoded ahead of the block.
+ 
+ @param records The stored records.
+ @param decode The block that decodes a record.
+ @param block The block called on the calling thread for each decoded object. Set `stop` to YES to stop decoding.
+ */
+- (void)enumerateRecords:(NSArray *)records
+                  decode:(DYFStoreBulkDecodeBlock)decode
+              usingBlock:(void (^)(id object, BOOL *stop))block;
+
+@end
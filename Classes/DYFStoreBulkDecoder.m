@@ -0,0 +1,213 @@
+//
+//  DYFStoreBulkDecoder.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreBulkDecoder.h"
+#import <stdatomic.h>
+
+/** The state of an enumeration, shared by the calling thread and the workers.
+ */
+@interface DYFStoreBulkDecoderStream : NSObject
+/** The decoded chunks that have not been yielded yet, NSNull until they are ready. */
+@property (nonatomic, strong) NSMutableArray *chunks;
+/** Signaled once per chunk when it is ready. */
+@property (nonatomic, copy) NSArray<dispatch_semaphore_t> *readySignals;
+/** Bounds the number of chunks decoded ahead of the calling thread. */
+@property (nonatomic, strong) dispatch_semaphore_t slots;
+@end
+
+@implementation DYFStoreBulkDecoderStream {
+    @package
+    atomic_size_t _nextChunk;
+    atomic_bool _cancelled;
+}
+
+@end
+
+@implementation DYFStoreBulkDecoder
+
++ (instancetype)sharedDecoder
+{
+    static DYFStoreBulkDecoder *decoder;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        decoder = [[self alloc] init];
+    });
+    return decoder;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _concurrency = NSProcessInfo.processInfo.activeProcessorCount;
+        _chunkSize = 256;
+        _parallelThreshold = 512;
+    }
+    return self;
+}
+
+/** Decodes the records of a chunk on a worker thread.
+ */
+static NSArray *DYFStoreBulkDecodeChunk(NSArray *records, NSUInteger chunk, NSUInteger chunkSize, DYFStoreBulkDecodeBlock decode)
+{
+    NSUInteger first = chunk * chunkSize;
+    NSUInteger last = MIN(first + chunkSize, records.count);
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:last - first];
+    
+    @autoreleasepool {
+        for (NSUInteger idx = first; idx < last; idx++) {
+            id object = decode(records[idx]);
+            if (object) {
+                [objects addObject:object];
+            }
+        }
+    }
+    
+    return objects;
+}
+
+- (NSArray *)decodeRecords:(NSArray *)records usingBlock:(DYFStoreBulkDecodeBlock)decode
+{
+    NSUInteger count = records.count;
+    NSUInteger chunkSize = MAX(self.chunkSize, 1);
+    NSUInteger chunkCount = (count + chunkSize - 1) / chunkSize;
+    NSUInteger workers = MIN(MAX(self.concurrency, 1), chunkCount);
+    
+    if (count < self.parallelThreshold || workers <= 1) {
+        return DYFStoreBulkDecodeChunk(records, 0, MAX(count, 1), decode);
+    }
+    
+    NSMutableArray *chunks = [NSMutableArray arrayWithCapacity:chunkCount];
+    for (NSUInteger idx = 0; idx < chunkCount; idx++) {
+        [chunks addObject:NSNull.null];
+    }
+    
+    // Each worker takes the next chunk until none is left, so that slow chunks do not hold up the others.
+    atomic_size_t nextChunk = 0;
+    atomic_size_t *next = &nextChunk;
+    dispatch_apply(workers, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t worker) {
+        for (;;) {
+            size_t chunk = atomic_fetch_add_explicit(next, 1, memory_order_relaxed);
+            if (chunk >= chunkCount) { break; }
+            
+            NSArray *objects = DYFStoreBulkDecodeChunk(records, chunk, chunkSize, decode);
+            @synchronized (chunks) {
+                chunks[chunk] = objects;
+            }
+        }
+    });
+    
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:count];
+    for (NSArray *chunk in chunks) {
+        [objects addObjectsFromArray:chunk];
+    }
+    
+    return objects;
+}
+
+- (void)enumerateRecords:(NSArray *)records
+                  decode:(DYFStoreBulkDecodeBlock)decode
+              usingBlock:(void (^)(id object, BOOL *stop))block
+{
+    NSUInteger count = records.count;
+    NSUInteger chunkSize = MAX(self.chunkSize, 1);
+    NSUInteger chunkCount = (count + chunkSize - 1) / chunkSize;
+    NSUInteger workers = MIN(MAX(self.concurrency, 1), chunkCount);
+    BOOL stop = NO;
+    
+    if (count < self.parallelThreshold || workers <= 1) {
+        for (NSUInteger idx = 0; idx < count && !stop; idx++) {
+            @autoreleasepool {
+                id object = decode(records[idx]);
+                if (object) {
+                    block(object, &stop);
+                }
+            }
+        }
+        return;
+    }
+    
+    DYFStoreBulkDecoderStream *stream = [[DYFStoreBulkDecoderStream alloc] init];
+    stream.chunks = [NSMutableArray arrayWithCapacity:chunkCount];
+    NSMutableArray *readySignals = [NSMutableArray arrayWithCapacity:chunkCount];
+    for (NSUInteger idx = 0; idx < chunkCount; idx++) {
+        [stream.chunks addObject:NSNull.null];
+        [readySignals addObject:dispatch_semaphore_create(0)];
+    }
+    stream.readySignals = readySignals;
+    // The slots are signaled rather than given as the initial value, because a stopped enumeration leaves some of them taken.
+    stream.slots = dispatch_semaphore_create(0);
+    for (NSUInteger idx = 0; idx < workers * 2; idx++) {
+        dispatch_semaphore_signal(stream.slots);
+    }
+    
+    // A worker takes a slot before it takes a chunk, so the chunk the calling thread waits for always has one.
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+    for (NSUInteger worker = 0; worker < workers; worker++) {
+        dispatch_group_async(group, queue, ^{
+            for (;;) {
+                dispatch_semaphore_wait(stream.slots, DISPATCH_TIME_FOREVER);
+                size_t chunk = atomic_fetch_add_explicit(&stream->_nextChunk, 1, memory_order_relaxed);
+                if (chunk >= chunkCount || atomic_load_explicit(&stream->_cancelled, memory_order_acquire)) {
+                    dispatch_semaphore_signal(stream.slots);
+                    break;
+                }
+                
+                NSArray *objects = DYFStoreBulkDecodeChunk(records, chunk, chunkSize, decode);
+                @synchronized (stream.chunks) {
+                    stream.chunks[chunk] = objects;
+                }
+                dispatch_semaphore_signal(stream.readySignals[chunk]);
+            }
+        });
+    }
+    
+    for (NSUInteger chunk = 0; chunk < chunkCount && !stop; chunk++) {
+        dispatch_semaphore_wait(stream.readySignals[chunk], DISPATCH_TIME_FOREVER);
+        NSArray *objects;
+        @synchronized (stream.chunks) {
+            objects = stream.chunks[chunk];
+            stream.chunks[chunk] = NSNull.null;
+        }
+        dispatch_semaphore_signal(stream.slots);
+        
+        for (id object in objects) {
+            @autoreleasepool {
+                block(object, &stop);
+            }
+            if (stop) { break; }
+        }
+    }
+    
+    // The workers that are still decoding finish their chunk, and the ones waiting for a slot are woken, then all of them see the cancellation.
+    atomic_store_explicit(&stream->_cancelled, true, memory_order_release);
+    for (NSUInteger worker = 0; worker < workers; worker++) {
+        dispatch_semaphore_signal(stream.slots);
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+}
+
+@end
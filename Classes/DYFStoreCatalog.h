@@ -0,0 +1,117 @@
+//
+//  DYFStoreCatalog.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import <Foundation/Foundation.h>
+#import <StoreKit/StoreKit.h>
+
+/** An immutable version of the catalog.
+ */
+@interface DYFStoreCatalogSnapshot : NSObject
+
+/** The version, incremented by every response that changes the catalog. The empty catalog has version 0.
+ */
+@property (nonatomic, assign, readonly) NSUInteger version;
+
+/** The available products, in the order they were first received.
+ */
+@property (nonatomic, copy, readonly) NSArray<SKProduct *> *products;
+
+/** The product identifiers that were not recognized by the App Store.
+ */
+@property (nonatomic, copy, readonly) NSArray<NSString *> *invalidIdentifiers;
+
+/** Returns the product with a given identifier, in constant time.
+ 
+ @param productIdentifier A string used to identify a product.
+ @return An `SKProduct` object, or nil.
+ */
+- (SKProduct *)productForIdentifier:(NSString *)productIdentifier;
+
+@end
+
+/** The difference between two versions of the catalog.
+ */
+@interface DYFStoreCatalogChangeset : NSObject
+
+/** The version the changes apply to.
+ */
+@property (nonatomic, assign, readonly) NSUInteger fromVersion;
+
+/** The version the changes lead to. It equals `fromVersion` if nothing changed.
+ */
+@property (nonatomic, assign, readonly) NSUInteger toVersion;
+
+/** The products that were not available before.
+ */
+@property (nonatomic, copy, readonly) NSArray<SKProduct *> *addedProducts;
+
+/** The products whose price, locale, title, description or terms changed. They replace the stale ones.
+ */
+@property (nonatomic, copy, readonly) NSArray<SKProduct *> *updatedProducts;
+
+/** The identifiers of the products that are no longer available.
+ */
+@property (nonatomic, copy, readonly) NSArray<NSString *> *removedProductIdentifiers;
+
+/** The snapshot after the changes.
+ */
+@property (nonatomic, strong, readonly) DYFStoreCatalogSnapshot *snapshot;
+
+/** Whether nothing changed.
+ */
+@property (nonatomic, assign, readonly, getter=isEmpty) BOOL empty;
+
+@end
+
+/** The products received from the App Store, kept as versioned snapshots. Every products response is applied as a diff against the current snapshot, which yields the products that were added, updated and removed.
+ */
+@interface DYFStoreCatalog : NSObject
+
+/** The current snapshot. Reading it is thread-safe.
+ */
+@property (atomic, strong, readonly) DYFStoreCatalogSnapshot *snapshot;
+
+/** Applies a products response.
+ 
+ @param products The products of the response.
+ @param invalidIdentifiers The product identifiers of the response that were not recognized.
+ @param requestedIdentifiers The product identifiers that were requested. A requested product that is missing from the response is removed; the products that were not requested are kept. If nil, the response is taken as the whole catalog.
+ @return The changes.
+ */
+- (DYFStoreCatalogChangeset *)applyProducts:(NSArray<SKProduct *> *)products
+                         invalidIdentifiers:(NSArray<NSString *> *)invalidIdentifiers
+                       requestedIdentifiers:(NSSet<NSString *> *)requestedIdentifiers;
+
+/** Returns the changes from an older snapshot to the current one, e.g. for a cache that skipped some versions.
+ 
+ @param snapshot An older snapshot of this catalog.
+ @return The changes.
+ */
+- (DYFStoreCatalogChangeset *)changesetFromSnapshot:(DYFStoreCatalogSnapshot *)snapshot;
+
+/** Removes all products.
+ */
+- (void)removeAllProducts;
+
+@end
@@ -0,0 +1,255 @@
+//
+//  DYFStoreCatalog.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import "DYFStoreCatalog.h"
+
+static inline BOOL DYFStoreObjectsEqual(id a, id b)
+{
+    return a == b || [a isEqual:b];
+}
+
+/** Returns whether a product changed in a way the user can see.
+ */
+static BOOL DYFStoreProductChanged(SKProduct *old, SKProduct *new)
+{
+    if (old == new) { return NO; }
+    
+    if (!DYFStoreObjectsEqual(old.price, new.price) ||
+        !DYFStoreObjectsEqual(old.priceLocale.localeIdentifier, new.priceLocale.localeIdentifier) ||
+        !DYFStoreObjectsEqual(old.localizedTitle, new.localizedTitle) ||
+        !DYFStoreObjectsEqual(old.localizedDescription, new.localizedDescription) ||
+        old.isDownloadable != new.isDownloadable) {
+        return YES;
+    }
+    
+    if (@available(iOS 11.2, *)) {
+        SKProductSubscriptionPeriod *oldPeriod = old.subscriptionPeriod;
+        SKProductSubscriptionPeriod *newPeriod = new.subscriptionPeriod;
+        if (oldPeriod.numberOfUnits != newPeriod.numberOfUnits || oldPeriod.unit != newPeriod.unit ||
+            !DYFStoreObjectsEqual(old.introductoryPrice.price, new.introductoryPrice.price)) {
+            return YES;
+        }
+    }
+    
+    return NO;
+}
+
+@interface DYFStoreCatalogSnapshot ()
+@property (nonatomic, assign) NSUInteger version;
+@property (nonatomic, copy) NSArray<NSString *> *identifiers;
+@property (nonatomic, copy) NSDictionary<NSString *, SKProduct *> *productTable;
+@property (nonatomic, copy) NSArray<NSString *> *invalidIdentifiers;
+@end
+
+@implementation DYFStoreCatalogSnapshot
+{
+    NSArray<SKProduct *> *_products;
+}
+
+- (NSArray<SKProduct *> *)products
+{
+    @synchronized (self) {
+        // Built on first use, so an applied response that nobody lists does not pay for it.
+        if (!_products) {
+            _products = [self.productTable objectsForKeys:self.identifiers notFoundMarker:NSNull.null];
+        }
+        return _products;
+    }
+}
+
+- (SKProduct *)productForIdentifier:(NSString *)productIdentifier
+{
+    return productIdentifier ? self.productTable[productIdentifier] : nil;
+}
+
+@end
+
+@interface DYFStoreCatalogChangeset ()
+@property (nonatomic, assign) NSUInteger fromVersion;
+@property (nonatomic, assign) NSUInteger toVersion;
+@property (nonatomic, copy) NSArray<SKProduct *> *addedProducts;
+@property (nonatomic, copy) NSArray<SKProduct *> *updatedProducts;
+@property (nonatomic, copy) NSArray<NSString *> *removedProductIdentifiers;
+@property (nonatomic, strong) DYFStoreCatalogSnapshot *snapshot;
+@end
+
+@implementation DYFStoreCatalogChangeset
+
+- (BOOL)isEmpty
+{
+    return self.fromVersion == self.toVersion;
+}
+
+@end
+
+@interface DYFStoreCatalog ()
+@property (atomic, strong) DYFStoreCatalogSnapshot *snapshot;
+@end
+
+@implementation DYFStoreCatalog
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _snapshot = [[DYFStoreCatalogSnapshot alloc] init];
+        _snapshot.identifiers = @[];
+        _snapshot.productTable = @{};
+        _snapshot.invalidIdentifiers = @[];
+    }
+    return self;
+}
+
+- (DYFStoreCatalogChangeset *)applyProducts:(NSArray<SKProduct *> *)products
+                         invalidIdentifiers:(NSArray<NSString *> *)invalidIdentifiers
+                       requestedIdentifiers:(NSSet<NSString *> *)requestedIdentifiers
+{
+    @synchronized (self) {
+        DYFStoreCatalogSnapshot *old = self.snapshot;
+        NSDictionary<NSString *, SKProduct *> *oldTable = old.productTable;
+        
+        NSMutableArray *added = [NSMutableArray array];
+        NSMutableArray *updated = [NSMutableArray array];
+        NSMutableArray *removed = [NSMutableArray array];
+        NSMutableSet *received = [NSMutableSet setWithCapacity:products.count];
+        
+        for (SKProduct *product in products) {
+            NSString *identifier = product.productIdentifier;
+            if (!identifier || [received containsObject:identifier]) { continue; }
+            [received addObject:identifier];
+            
+            SKProduct *existing = oldTable[identifier];
+            if (!existing) {
+                [added addObject:product];
+            } else if (DYFStoreProductChanged(existing, product)) {
+                [updated addObject:product];
+            }
+        }
+        
+        // Only the requested products can have been removed, besides the ones reported invalid.
+        NSMutableOrderedSet *candidates = [NSMutableOrderedSet orderedSetWithArray:requestedIdentifiers ? requestedIdentifiers.allObjects : old.identifiers];
+        [candidates addObjectsFromArray:invalidIdentifiers ?: @[]];
+        for (NSString *identifier in candidates) {
+            if (oldTable[identifier] && ![received containsObject:identifier]) {
+                [removed addObject:identifier];
+            }
+        }
+        
+        NSMutableOrderedSet *invalid = [NSMutableOrderedSet orderedSetWithArray:requestedIdentifiers ? old.invalidIdentifiers : @[]];
+        [invalid minusSet:requestedIdentifiers ?: [NSSet set]];
+        [invalid minusSet:received];
+        [invalid addObjectsFromArray:invalidIdentifiers ?: @[]];
+        BOOL invalidChanged = ![invalid.array isEqualToArray:old.invalidIdentifiers];
+        
+        DYFStoreCatalogChangeset *changeset = [[DYFStoreCatalogChangeset alloc] init];
+        changeset.fromVersion = old.version;
+        changeset.addedProducts = added;
+        changeset.updatedProducts = updated;
+        changeset.removedProductIdentifiers = removed;
+        
+        if (added.count == 0 && updated.count == 0 && removed.count == 0 && !invalidChanged) {
+            changeset.toVersion = old.version;
+            changeset.snapshot = old;
+            return changeset;
+        }
+        
+        NSMutableDictionary *table = [oldTable mutableCopy];
+        [table removeObjectsForKeys:removed];
+        NSMutableArray *identifiers = [old.identifiers mutableCopy];
+        if (removed.count > 0) {
+            NSSet *removedSet = [NSSet setWithArray:removed];
+            [identifiers filterUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(NSString *identifier, NSDictionary *bindings) {
+                return ![removedSet containsObject:identifier];
+            }]];
+        }
+        for (SKProduct *product in updated) {
+            table[product.productIdentifier] = product;
+        }
+        for (SKProduct *product in added) {
+            table[product.productIdentifier] = product;
+            [identifiers addObject:product.productIdentifier];
+        }
+        
+        DYFStoreCatalogSnapshot *snapshot = [[DYFStoreCatalogSnapshot alloc] init];
+        snapshot.version = old.version + 1;
+        snapshot.identifiers = identifiers;
+        snapshot.productTable = table;
+        snapshot.invalidIdentifiers = invalid.array;
+        self.snapshot = snapshot;
+        
+        changeset.toVersion = snapshot.version;
+        changeset.snapshot = snapshot;
+        return changeset;
+    }
+}
+
+- (DYFStoreCatalogChangeset *)changesetFromSnapshot:(DYFStoreCatalogSnapshot *)snapshot
+{
+    DYFStoreCatalogSnapshot *current = self.snapshot;
+    NSDictionary *oldTable = snapshot.productTable ?: @{};
+    
+    NSMutableArray *added = [NSMutableArray array];
+    NSMutableArray *updated = [NSMutableArray array];
+    NSMutableArray *removed = [NSMutableArray array];
+    
+    if (snapshot != current) {
+        for (NSString *identifier in current.identifiers) {
+            SKProduct *product = current.productTable[identifier];
+            SKProduct *existing = oldTable[identifier];
+            if (!existing) {
+                [added addObject:product];
+            } else if (DYFStoreProductChanged(existing, product)) {
+                [updated addObject:product];
+            }
+        }
+        for (NSString *identifier in snapshot.identifiers) {
+            if (!current.productTable[identifier]) {
+                [removed addObject:identifier];
+            }
+        }
+    }
+    
+    DYFStoreCatalogChangeset *changeset = [[DYFStoreCatalogChangeset alloc] init];
+    changeset.fromVersion = snapshot.version;
+    changeset.toVersion = current.version;
+    changeset.addedProducts = added;
+    changeset.updatedProducts = updated;
+    changeset.removedProductIdentifiers = removed;
+    changeset.snapshot = current;
+    return changeset;
+}
+
+- (void)removeAllProducts
+{
+    @synchronized (self) {
+        DYFStoreCatalogSnapshot *snapshot = [[DYFStoreCatalogSnapshot alloc] init];
+        snapshot.version = self.snapshot.version + 1;
+        snapshot.identifiers = @[];
+        snapshot.productTable = @{};
+        snapshot.invalidIdentifiers = @[];
+        self.snapshot = snapshot;
+    }
+}
+
+@end
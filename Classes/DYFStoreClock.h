@@ -0,0 +1,73 @@
+//
+//  DYFStoreClock.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** A source of time and of delayed work, so that code which waits can be driven by a simulated clock.
+ */
+@protocol DYFStoreClock <NSObject>
+
+/** The current time, in seconds since 1970. It survives relaunches, so it can be persisted.
+ */
+- (NSTimeInterval)now;
+
+/** Performs a block once the clock has advanced by a delay.
+ 
+ @param delay The delay in seconds.
+ @param queue The queue on which the block is performed.
+ @param block The block to perform.
+ */
+- (void)performAfterDelay:(NSTimeInterval)delay onQueue:(dispatch_queue_t)queue block:(dispatch_block_t)block;
+
+@end
+
+/** The wall clock, with `dispatch_after` on wall time for delayed work, so that a delay also runs while the device sleeps.
+ */
+@interface DYFStoreSystemClock : NSObject <DYFStoreClock>
+
+@end
+
+/** A clock that only moves when it is advanced. The blocks that become due are performed in order of their due time, on their queues.
+ */
+@interface DYFStoreSimulatedClock : NSObject <DYFStoreClock>
+
+/** The number of blocks that are not due yet.
+ */
+@property (nonatomic, assign, readonly) NSUInteger pendingCount;
+
+/** Creates a clock.
+ 
+ @param now The initial time, in seconds since 1970.
+ @return A `DYFStoreSimulatedClock` object.
+ */
+- (instancetype)initWithTime:(NSTimeInterval)now;
+
+/** Advances the clock and performs the blocks that have become due, including the ones they schedule within the interval. Each block is performed synchronously on its queue, so this must not be called on one of those queues.
+ 
+ @param interval The interval in seconds.
+ */
+- (void)advanceBy:(NSTimeInterval)interval;
+
+@end
@@ -0,0 +1,141 @@
+//
+//  DYFStoreClock.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreClock.h"
+
+@implementation DYFStoreSystemClock
+
+- (NSTimeInterval)now
+{
+    return NSDate.date.timeIntervalSince1970;
+}
+
+- (void)performAfterDelay:(NSTimeInterval)delay onQueue:(dispatch_queue_t)queue block:(dispatch_block_t)block
+{
+    // Wall time, as `now` is, so that a delay keeps running while the device sleeps.
+    dispatch_after(dispatch_walltime(NULL, (int64_t)(MAX(delay, 0) * NSEC_PER_SEC)), queue, block);
+}
+
+@end
+
+/** A block waiting for a simulated time.
+ */
+@interface DYFStoreSimulatedTimer : NSObject
+@property (nonatomic, assign) NSTimeInterval dueTime;
+@property (nonatomic, assign) NSUInteger sequence;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, copy) dispatch_block_t block;
+@end
+
+@implementation DYFStoreSimulatedTimer
+@end
+
+@interface DYFStoreSimulatedClock ()
+@property (nonatomic, assign) NSTimeInterval time;
+@property (nonatomic, assign) NSUInteger sequence;
+@property (nonatomic, strong) NSMutableArray<DYFStoreSimulatedTimer *> *timers;
+@end
+
+@implementation DYFStoreSimulatedClock
+
+- (instancetype)init
+{
+    return [self initWithTime:0];
+}
+
+- (instancetype)initWithTime:(NSTimeInterval)now
+{
+    self = [super init];
+    if (self) {
+        _time = now;
+        _timers = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (NSTimeInterval)now
+{
+    @synchronized (self) {
+        return self.time;
+    }
+}
+
+- (NSUInteger)pendingCount
+{
+    @synchronized (self) {
+        return self.timers.count;
+    }
+}
+
+- (void)performAfterDelay:(NSTimeInterval)delay onQueue:(dispatch_queue_t)queue block:(dispatch_block_t)block
+{
+    DYFStoreSimulatedTimer *timer = [[DYFStoreSimulatedTimer alloc] init];
+    timer.queue = queue;
+    timer.block = block;
+    
+    @synchronized (self) {
+        timer.dueTime = self.time + MAX(delay, 0);
+        timer.sequence = self.sequence++;
+        [self.timers addObject:timer];
+    }
+}
+
+/** Removes and returns the earliest timer due by a time, or nil.
+ */
+- (DYFStoreSimulatedTimer *)dequeueTimerDueBy:(NSTimeInterval)time
+{
+    @synchronized (self) {
+        DYFStoreSimulatedTimer *next = nil;
+        for (DYFStoreSimulatedTimer *timer in self.timers) {
+            if (timer.dueTime > time) { continue; }
+            if (!next || timer.dueTime < next.dueTime ||
+                (timer.dueTime == next.dueTime && timer.sequence < next.sequence)) {
+                next = timer;
+            }
+        }
+        if (next) {
+            [self.timers removeObject:next];
+            self.time = MAX(self.time, next.dueTime);
+        }
+        return next;
+    }
+}
+
+- (void)advanceBy:(NSTimeInterval)interval
+{
+    NSTimeInterval target = self.now + MAX(interval, 0);
+    
+    DYFStoreSimulatedTimer *timer;
+    while ((timer = [self dequeueTimerDueBy:target])) {
+        // Waits for the block, so that what it schedules is seen by the next iteration.
+        dispatch_sync(timer.queue, timer.block);
+    }
+    
+    @synchronized (self) {
+        self.time = target;
+    }
+}
+
+@end
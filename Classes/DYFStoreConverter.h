@@ -114,4 +114,55 @@
  */
 + (id)jsonObjectWithJSON:(NSString *)json options:(NSJSONReadingOptions)options;
 
+/**
+ Returns the byte range of the first object in a JSON array whose member has a given string value. The array is scanned with `DYFStoreJSONReader`, no other element is built.
+ 
+ @param data A data object containing a JSON array.
+ @param key The name of the member.
+ @param value The string value of the member.
+ @return The range of the object in data, or {NSNotFound, 0} if there is none.
+ */
++ (NSRange)rangeOfObjectInJSONArray:(NSData *)data whereKey:(NSString *)key equalsString:(NSString *)value;
+
+/**
+ Returns the first object in a JSON array whose member has a given string value. Only that object is built.
+ 
+ @param data A data object containing a JSON array.
+ @param key The name of the member.
+ @param value The string value of the member.
+ @return A dictionary, or nil if there is none.
+ */
++ (NSDictionary *)objectInJSONArray:(NSData *)data whereKey:(NSString *)key equalsString:(NSString *)value;
+
+/**
+ Enumerates the objects of a JSON array, reading only the string and number members with the given names. Other members, e.g. large receipts, are skipped without being built.
+ 
+ @param data A data object containing a JSON array.
+ @param keys The names of the members to read.
+ @param block The block called for each object with the members read and the byte range of the object in data. Set `stop` to YES to stop the enumeration.
+ @return NO if the data is not a well-formed JSON array.
+ */
++ (BOOL)enumerateObjectsInJSONArray:(NSData *)data
+                               keys:(NSSet<NSString *> *)keys
+                         usingBlock:(void (^)(NSDictionary *values, NSRange range, BOOL *stop))block;
+
+/**
+ Returns a JSON array with an element appended, without parsing the existing elements.
+ 
+ @param data A data object containing a JSON array. Can be nil, which is equivalent to an empty array.
+ @param obj The Foundation object to append.
+ @return JSON data for the new array, or nil if data is not an array or obj cannot be written.
+ */
++ (NSData *)jsonArray:(NSData *)data byAppendingObject:(id)obj;
+
+/**
+ Returns a JSON array without the first object whose member has a given string value. The other elements are copied byte for byte.
+ 
+ @param data A data object containing a JSON array.
+ @param key The name of the member.
+ @param value The string value of the member.
+ @return JSON data for the new array, or nil if there is no such object.
+ */
++ (NSData *)jsonArray:(NSData *)data byRemovingObjectWhereKey:(NSString *)key equalsString:(NSString *)value;
+
 @end
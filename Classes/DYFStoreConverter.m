@@ -24,6 +24,9 @@
 //
 
 #import "DYFStoreConverter.h"
+#import "DYFStoreLogger.h"
+#import "DYFStoreJSONReader.h"
+#import "DYFStoreJSONWriter.h"
 
 @implementation DYFStoreConverter
 
@@ -53,9 +56,7 @@
             [unarchiver finishDecoding];
             return object;
         }
-        #if DEBUG
-        NSLog(@"%s error: %@", __FUNCTION__, error);
-        #endif
+        DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"error: %@", error);
         return nil;
     }
     
@@ -77,13 +78,9 @@
         if (!error) {
             return data;
         }
-        #if DEBUG
-        NSLog(@"%s error: %@", __FUNCTION__, error);
-        #endif
+        DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"error: %@", error);
     } @catch (NSException *exception) {
-        #if DEBUG
-        NSLog(@"%s exception: %@, %@", __FUNCTION__, exception.name, exception.reason);
-        #endif
+        DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"exception: %@, %@", exception.name, exception.reason);
     } @finally {}
     
     return nil;
@@ -98,7 +95,7 @@
 {
     NSData *data = [self jsonWithObject:obj options:options];
     
-    if (!data) {
+    if (data) {
         return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
     }
     
@@ -120,9 +117,7 @@
         return obj;
     }
     
-    #if DEBUG
-    NSLog(@"%s error: %@", __FUNCTION__, error);
-    #endif
+    DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"error: %@", error);
     
     return nil;
 }
@@ -140,4 +135,179 @@
     return [self jsonObjectWithData:data options:options];
 }
 
++ (NSRange)rangeOfObjectInJSONArray:(NSData *)data whereKey:(NSString *)key equalsString:(NSString *)value
+{
+    if (!data || !key || !value) { return NSMakeRange(NSNotFound, 0); }
+    
+    DYFStoreJSONReader *reader = [[DYFStoreJSONReader alloc] initWithData:data];
+    if ([reader nextToken] != DYFStoreJSONTokenBeginArray) {
+        return NSMakeRange(NSNotFound, 0);
+    }
+    
+    DYFStoreJSONToken token;
+    while ((token = [reader nextToken]) != DYFStoreJSONTokenEndArray) {
+        if (token != DYFStoreJSONTokenBeginObject) {
+            if (token == DYFStoreJSONTokenError || ![reader skipValue]) { break; }
+            continue;
+        }
+        
+        NSUInteger start = reader.tokenRange.location;
+        BOOL matched = NO;
+        while ((token = [reader nextToken]) == DYFStoreJSONTokenKey) {
+            BOOL isKey = !matched && [reader stringValueEqualsString:key];
+            token = [reader nextToken];
+            if (isKey && token == DYFStoreJSONTokenString) {
+                matched = [reader stringValueEqualsString:value];
+            } else if (![reader skipValue]) {
+                break;
+            }
+        }
+        if (token != DYFStoreJSONTokenEndObject) { break; }
+        
+        if (matched) {
+            return NSMakeRange(start, NSMaxRange(reader.tokenRange) - start);
+        }
+    }
+    
+    if (reader.error) {
+        DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"error: %@", reader.error);
+    }
+    
+    return NSMakeRange(NSNotFound, 0);
+}
+
++ (NSDictionary *)objectInJSONArray:(NSData *)data whereKey:(NSString *)key equalsString:(NSString *)value
+{
+    NSRange range = [self rangeOfObjectInJSONArray:data whereKey:key equalsString:value];
+    if (range.location == NSNotFound) { return nil; }
+    
+    // Only the bytes of the matching object are read a second time.
+    NSData *objectData = [data subdataWithRange:range];
+    DYFStoreJSONReader *reader = [[DYFStoreJSONReader alloc] initWithData:objectData];
+    [reader nextToken];
+    return [reader readValue];
+}
+
++ (BOOL)enumerateObjectsInJSONArray:(NSData *)data
+                               keys:(NSSet<NSString *> *)keys
+                         usingBlock:(void (^)(NSDictionary *values, NSRange range, BOOL *stop))block
+{
+    if (!data) { return NO; }
+    
+    DYFStoreJSONReader *reader = [[DYFStoreJSONReader alloc] initWithData:data];
+    if ([reader nextToken] != DYFStoreJSONTokenBeginArray) {
+        return NO;
+    }
+    
+    DYFStoreJSONToken token;
+    BOOL stop = NO;
+    while (!stop && (token = [reader nextToken]) != DYFStoreJSONTokenEndArray) {
+        if (token != DYFStoreJSONTokenBeginObject) {
+            if (token == DYFStoreJSONTokenError || ![reader skipValue]) { break; }
+            continue;
+        }
+        
+        NSUInteger start = reader.tokenRange.location;
+        NSMutableDictionary *values = [NSMutableDictionary dictionaryWithCapacity:keys.count];
+        while ((token = [reader nextToken]) == DYFStoreJSONTokenKey) {
+            // Only the names that are asked for are unescaped.
+            NSString *key = nil;
+            for (NSString *candidate in keys) {
+                if ([reader stringValueEqualsString:candidate]) {
+                    key = candidate;
+                    break;
+                }
+            }
+            
+            token = [reader nextToken];
+            if (key && token == DYFStoreJSONTokenString) {
+                values[key] = [reader stringValue];
+            } else if (key && token == DYFStoreJSONTokenNumber) {
+                values[key] = [reader numberValue];
+            } else if (![reader skipValue]) {
+                break;
+            }
+        }
+        if (token != DYFStoreJSONTokenEndObject) { break; }
+        
+        block(values, NSMakeRange(start, NSMaxRange(reader.tokenRange) - start), &stop);
+    }
+    
+    if (reader.error) {
+        DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"error: %@", reader.error);
+        return NO;
+    }
+    
+    return YES;
+}
+
+/** Returns the index of the closing bracket of a JSON array and whether the array is empty, by looking at its last bytes only.
+ */
++ (NSUInteger)indexOfClosingBracketInJSONArray:(NSData *)data isEmpty:(BOOL *)isEmpty
+{
+    const uint8_t *bytes = data.bytes;
+    NSUInteger idx = data.length;
+    while (idx > 0 && isspace(bytes[idx - 1])) { idx--; }
+    if (idx < 2 || bytes[idx - 1] != ']') { return NSNotFound; }
+    
+    NSUInteger closing = idx - 1;
+    while (idx > 1 && isspace(bytes[idx - 2])) { idx--; }
+    *isEmpty = bytes[idx - 2] == '[';
+    
+    return closing;
+}
+
++ (NSData *)jsonArray:(NSData *)data byAppendingObject:(id)obj
+{
+    if (!obj) { return nil; }
+    
+    BOOL isEmpty = YES;
+    NSUInteger closing = 0;
+    if (data.length > 0) {
+        closing = [self indexOfClosingBracketInJSONArray:data isEmpty:&isEmpty];
+        if (closing == NSNotFound) { return nil; }
+    }
+    
+    NSMutableData *result = [NSMutableData dataWithCapacity:closing + 1024];
+    if (data.length > 0) {
+        [result appendBytes:data.bytes length:closing];
+    } else {
+        [result appendBytes:"[" length:1];
+    }
+    if (!isEmpty) {
+        [result appendBytes:"," length:1];
+    }
+    
+    DYFStoreJSONWriter *writer = [[DYFStoreJSONWriter alloc] initWithData:result];
+    [writer writeObject:obj];
+    if (writer.failed) { return nil; }
+    
+    [result appendBytes:"]" length:1];
+    return result;
+}
+
++ (NSData *)jsonArray:(NSData *)data byRemovingObjectWhereKey:(NSString *)key equalsString:(NSString *)value
+{
+    NSRange range = [self rangeOfObjectInJSONArray:data whereKey:key equalsString:value];
+    if (range.location == NSNotFound) { return nil; }
+    
+    // Removes the separating comma too: the following one, or the preceding one for the last element.
+    const uint8_t *bytes = data.bytes;
+    NSUInteger start = range.location, end = NSMaxRange(range);
+    NSUInteger idx = end;
+    while (idx < data.length && isspace(bytes[idx])) { idx++; }
+    if (idx < data.length && bytes[idx] == ',') {
+        end = idx + 1;
+    } else {
+        idx = start;
+        while (idx > 0 && isspace(bytes[idx - 1])) { idx--; }
+        if (idx > 0 && bytes[idx - 1] == ',') { start = idx - 1; }
+    }
+    
+    NSMutableData *result = [NSMutableData dataWithCapacity:data.length - (end - start)];
+    [result appendBytes:bytes length:start];
+    [result appendBytes:bytes + end length:data.length - end];
+    return result;
+}
+
 @end
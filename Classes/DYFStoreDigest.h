@@ -0,0 +1,34 @@
+//
+//  DYFStoreDigest.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Returns the SHA-256 hash of the UTF-8 bytes of a string as a lowercase hex string, or nil if the string is too long to hash. It needs nothing but Foundation and Common Crypto, so that tools which do not link StoreKit compute the same digests as the app.
+ */
+FOUNDATION_EXPORT NSString *DYFStoreDigestSHA256(NSString *string);
+
+/** Returns the same digest as `DYFStoreDigestSHA256` returns for the base64 encoding of some data, without holding the encoding: the data is encoded and hashed in chunks of a few kilobytes.
+ */
+FOUNDATION_EXPORT NSString *DYFStoreDigestSHA256OfBase64EncodedData(NSData *data);
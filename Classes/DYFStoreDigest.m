@@ -0,0 +1,84 @@
+//
+//  DYFStoreDigest.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreDigest.h"
+#import <CommonCrypto/CommonCrypto.h>
+#import "DYFStoreLogger.h"
+
+/** Returns the hex string of a digest.
+ */
+static NSString *DYFStoreDigestHexString(const unsigned char *md, int digestLength)
+{
+    // Convert the array of bytes into a string showing its hex represention.
+    static const char hexDigits[] = "0123456789abcdef";
+    char hex[CC_SHA256_DIGEST_LENGTH * 2];
+    for (int i = 0; i < digestLength; i++) {
+        hex[2 * i] = hexDigits[md[i] >> 4];
+        hex[2 * i + 1] = hexDigits[md[i] & 0x0f];
+    }
+    
+    return [[NSString alloc] initWithBytes:hex length:digestLength * 2 encoding:NSASCIIStringEncoding];
+}
+
+NSString *DYFStoreDigestSHA256(NSString *string)
+{
+    const int digestLength = CC_SHA256_DIGEST_LENGTH; // 32
+    unsigned char md[digestLength];
+    const char *cStr = [string UTF8String];
+    if (!cStr) { return nil; }
+    size_t cStrLen = strlen(cStr);
+    
+    // Confirm that the length of C string is small enough
+    // to be recast when calling the hash function.
+    if (cStrLen > UINT32_MAX) {
+        DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"C string too long to hash: %@", string);
+        return nil;
+    }
+    
+    CC_SHA256(cStr, (CC_LONG)cStrLen, md);
+    return DYFStoreDigestHexString(md, digestLength);
+}
+
+NSString *DYFStoreDigestSHA256OfBase64EncodedData(NSData *data)
+{
+    if (!data) { return nil; }
+    
+    // A multiple of 3 bytes encodes without padding, so the encoded chunks concatenate to the encoding of the whole.
+    const NSUInteger chunkLength = 3 * 16 * 1024;
+    CC_SHA256_CTX context;
+    CC_SHA256_Init(&context);
+    
+    for (NSUInteger offset = 0; offset < data.length; offset += chunkLength) {
+        @autoreleasepool {
+            NSData *chunk = [data subdataWithRange:NSMakeRange(offset, MIN(chunkLength, data.length - offset))];
+            NSData *encoded = [chunk base64EncodedDataWithOptions:kNilOptions];
+            CC_SHA256_Update(&context, encoded.bytes, (CC_LONG)encoded.length);
+        }
+    }
+    
+    unsigned char md[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(md, &context);
+    return DYFStoreDigestHexString(md, CC_SHA256_DIGEST_LENGTH);
+}
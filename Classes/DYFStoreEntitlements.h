@@ -0,0 +1,118 @@
+//
+//  DYFStoreEntitlements.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import <Foundation/Foundation.h>
+#import "DYFStoreTransaction.h"
+
+/** Answers whether a user owns a product in constant time.
+ 
+ Every product identifier is given a dense integer, and every user has a bitset of the products it owns, plus one bitset of the products owned by anyone. The tables are held by an immutable snapshot: an update builds the next snapshot and publishes it through an atomic pointer, so a query reads the current snapshot without a lock and without waiting for an update to be applied.
+ 
+ The snapshot is written to a compact binary file by `synchronize` and read back when the engine is created, so the answers are available at launch before any transaction is decoded.
+ */
+@interface DYFStoreEntitlements : NSObject
+
+/** The path of the file the snapshot is written to.
+ */
+@property (nonatomic, copy, readonly) NSString *path;
+
+/** The number of product identifiers that have been given an integer.
+ */
+@property (nonatomic, assign, readonly) NSUInteger productCount;
+
+/** Creates an engine whose file is "DYFStoreEntitlements.bin" in the caches directory.
+ */
+- (instancetype)init;
+
+/** Creates an engine and loads the snapshot of the file if there is one.
+ 
+ @param path The path of the file the snapshot is read from and written to.
+ @return A `DYFStoreEntitlements` object.
+ */
+- (instancetype)initWithPath:(NSString *)path;
+
+/** Returns a Boolean value that indicates whether a user owns a product.
+ 
+ @param productIdentifier A string used to identify a product.
+ @param userIdentifier An opaque identifier for the user’s account on your system. Nil for the purchases made without one.
+ @return YES if the product was purchased or restored for the user.
+ */
+- (BOOL)isProduct:(NSString *)productIdentifier ownedByUser:(NSString *)userIdentifier;
+
+/** Returns a Boolean value that indicates whether any user owns a product.
+ 
+ @param productIdentifier A string used to identify a product.
+ @return YES if the product was purchased or restored for any user.
+ */
+- (BOOL)isProductOwned:(NSString *)productIdentifier;
+
+/** Returns the products a user owns.
+ 
+ @param userIdentifier An opaque identifier for the user’s account on your system. Nil for the purchases made without one.
+ @return The product identifiers, in the order they were first granted.
+ */
+- (NSArray<NSString *> *)productsOwnedByUser:(NSString *)userIdentifier;
+
+/** Grants a product to a user.
+ 
+ @param productIdentifier A string used to identify a product.
+ @param userIdentifier An opaque identifier for the user’s account on your system. Nil for the purchases made without one.
+ */
+- (void)grantProduct:(NSString *)productIdentifier toUser:(NSString *)userIdentifier;
+
+/** Grants several products, publishing one snapshot for all of them.
+ 
+ @param block Calls the given block once for every product to grant, with the user to grant it to.
+ */
+- (void)grantProductsWithBlock:(void (^)(void (^grant)(NSString *productIdentifier, NSString *userIdentifier)))block;
+
+/** Revokes a product from a user, e.g. after a refund.
+ 
+ @param productIdentifier A string used to identify a product.
+ @param userIdentifier An opaque identifier for the user’s account on your system. Nil for the purchases made without one.
+ */
+- (void)revokeProduct:(NSString *)productIdentifier fromUser:(NSString *)userIdentifier;
+
+/** Grants the products of persisted transactions, publishing one snapshot for all of them. Use it to build the engine from a persister when there is no snapshot yet.
+ 
+ @param transactions The `DYFStoreTransaction` objects.
+ */
+- (void)grantTransactions:(NSArray<DYFStoreTransaction *> *)transactions;
+
+/** Grants the products of the in-app purchase entries of a verified receipt, i.e. the "in_app" array of the "receipt" member of the response of the App Store.
+ 
+ @param receipt The decoded receipt.
+ @param userIdentifier An opaque identifier for the user’s account on your system. Nil for the purchases made without one.
+ */
+- (void)grantInAppPurchasesOfReceipt:(NSDictionary *)receipt toUser:(NSString *)userIdentifier;
+
+/** Removes all entitlements.
+ */
+- (void)removeAllEntitlements;
+
+/** Writes the snapshot to the file if it has changed.
+ */
+- (void)synchronize;
+
+@end
@@ -0,0 +1,445 @@
+//
+//  DYFStoreEntitlements.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import "DYFStoreEntitlements.h"
+#import "DYFStore.h"
+#import <stdatomic.h>
+
+// The magic ("DYFE") and the version of the file format.
+static const uint32_t DYFStoreEntitlementsMagic = 0x45465944;
+static const uint32_t DYFStoreEntitlementsVersion = 1;
+
+// The key of the purchases made without a user identifier.
+static NSString *const DYFStoreEntitlementsNoUser = @"";
+
+static inline BOOL DYFStoreBitsetContains(NSData *bitset, NSUInteger bit)
+{
+    if (bit / 64 >= bitset.length / sizeof(uint64_t)) { return NO; }
+    return (((const uint64_t *)bitset.bytes)[bit / 64] >> (bit % 64)) & 1;
+}
+
+/** The immutable tables of the engine.
+ */
+@interface DYFStoreEntitlementSnapshot : NSObject
+@property (nonatomic, copy, readonly) NSDictionary<NSString *, NSNumber *> *productIDs;
+@property (nonatomic, copy, readonly) NSArray<NSString *> *products;
+@property (nonatomic, copy, readonly) NSDictionary<NSString *, NSData *> *bitsets;
+@property (nonatomic, copy, readonly) NSData *anyUser;
+@end
+
+@implementation DYFStoreEntitlementSnapshot
+
+- (instancetype)initWithProducts:(NSArray<NSString *> *)products productIDs:(NSDictionary<NSString *, NSNumber *> *)productIDs bitsets:(NSDictionary<NSString *, NSData *> *)bitsets
+{
+    self = [super init];
+    if (self) {
+        _products = [products copy];
+        _productIDs = [productIDs copy];
+        _bitsets = [bitsets copy];
+        
+        // The union of the bitsets of all users.
+        NSMutableData *anyUser = [NSMutableData dataWithLength:(products.count + 63) / 64 * sizeof(uint64_t)];
+        uint64_t *words = anyUser.mutableBytes;
+        for (NSData *bitset in _bitsets.objectEnumerator) {
+            const uint64_t *bits = bitset.bytes;
+            NSUInteger count = MIN(bitset.length, anyUser.length) / sizeof(uint64_t);
+            for (NSUInteger idx = 0; idx < count; idx++) {
+                words[idx] |= bits[idx];
+            }
+        }
+        _anyUser = anyUser;
+    }
+    return self;
+}
+
+@end
+
+@interface DYFStoreEntitlements ()
+{
+    // The published snapshot, retained by the engine. A query loads it with neither a lock nor a retain, between entering and leaving the readers.
+    _Atomic(void *) _snapshot;
+    // The number of queries reading a snapshot.
+    atomic_uint _readers;
+}
+@property (nonatomic, copy) NSString *path;
+// The snapshots replaced while a query could still read them, released by a later update once no query reads any.
+@property (nonatomic, strong) NSMutableArray<DYFStoreEntitlementSnapshot *> *retiredSnapshots;
+@property (nonatomic, assign) BOOL dirty;
+// Returns at +0 without a retain by the caller, which reads the snapshot into an unretained variable.
+- (DYFStoreEntitlementSnapshot *)enterSnapshot NS_RETURNS_NOT_RETAINED;
+@end
+
+@implementation DYFStoreEntitlements
+
+- (instancetype)init
+{
+    NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+    return [self initWithPath:[caches stringByAppendingPathComponent:@"DYFStoreEntitlements.bin"]];
+}
+
+- (instancetype)initWithPath:(NSString *)path
+{
+    self = [super init];
+    if (self) {
+        _path = [path copy];
+        _retiredSnapshots = [NSMutableArray array];
+        DYFStoreEntitlementSnapshot *snapshot = [self loadSnapshot] ?: [[DYFStoreEntitlementSnapshot alloc] initWithProducts:@[] productIDs:@{} bitsets:@{}];
+        atomic_init(&_snapshot, (__bridge_retained void *)snapshot);
+        atomic_init(&_readers, 0);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    CFBridgingRelease(atomic_load(&_snapshot));
+}
+
+- (NSUInteger)productCount
+{
+    __unsafe_unretained DYFStoreEntitlementSnapshot *snapshot = [self enterSnapshot];
+    NSUInteger count = snapshot.products.count;
+    [self leaveSnapshot];
+    return count;
+}
+
+#pragma mark - Snapshots
+
+/** Loads the published snapshot for a query, which calls `leaveSnapshot` once it no longer reads it. The snapshot is not retained: a snapshot replaced while a query reads it is retired rather than released.
+ */
+- (DYFStoreEntitlementSnapshot *)enterSnapshot
+{
+    atomic_fetch_add(&_readers, 1);
+    return (__bridge DYFStoreEntitlementSnapshot *)atomic_load(&_snapshot);
+}
+
+- (void)leaveSnapshot
+{
+    atomic_fetch_sub(&_readers, 1);
+}
+
+/** Returns the published snapshot for an update. Called under the lock.
+ */
+- (DYFStoreEntitlementSnapshot *)currentSnapshot
+{
+    return (__bridge DYFStoreEntitlementSnapshot *)atomic_load(&_snapshot);
+}
+
+/** Publishes the next snapshot. Called under the lock.
+ */
+- (void)publishSnapshot:(DYFStoreEntitlementSnapshot *)snapshot
+{
+    void *previous = atomic_exchange(&_snapshot, (__bridge_retained void *)snapshot);
+    [self.retiredSnapshots addObject:CFBridgingRelease(previous)];
+    
+    // A query that entered before the exchange may still read a retired snapshot, while one that enters after it reads the new one. So the retired snapshots can be released once no query is reading.
+    if (atomic_load(&_readers) == 0) {
+        [self.retiredSnapshots removeAllObjects];
+    }
+    self.dirty = YES;
+}
+
+#pragma mark - Queries
+
+- (BOOL)isProduct:(NSString *)productIdentifier ownedByUser:(NSString *)userIdentifier
+{
+    __unsafe_unretained DYFStoreEntitlementSnapshot *snapshot = [self enterSnapshot];
+    NSNumber *productID = productIdentifier ? snapshot.productIDs[productIdentifier] : nil;
+    BOOL owned = productID && DYFStoreBitsetContains(snapshot.bitsets[userIdentifier ?: DYFStoreEntitlementsNoUser], productID.unsignedIntegerValue);
+    [self leaveSnapshot];
+    
+    return owned;
+}
+
+- (BOOL)isProductOwned:(NSString *)productIdentifier
+{
+    __unsafe_unretained DYFStoreEntitlementSnapshot *snapshot = [self enterSnapshot];
+    NSNumber *productID = productIdentifier ? snapshot.productIDs[productIdentifier] : nil;
+    BOOL owned = productID && DYFStoreBitsetContains(snapshot.anyUser, productID.unsignedIntegerValue);
+    [self leaveSnapshot];
+    
+    return owned;
+}
+
+- (NSArray<NSString *> *)productsOwnedByUser:(NSString *)userIdentifier
+{
+    __unsafe_unretained DYFStoreEntitlementSnapshot *snapshot = [self enterSnapshot];
+    NSData *bitset = snapshot.bitsets[userIdentifier ?: DYFStoreEntitlementsNoUser];
+    
+    NSMutableArray *products = [NSMutableArray array];
+    for (NSUInteger idx = 0; idx < snapshot.products.count; idx++) {
+        if (DYFStoreBitsetContains(bitset, idx)) {
+            [products addObject:snapshot.products[idx]];
+        }
+    }
+    [self leaveSnapshot];
+    
+    return products;
+}
+
+#pragma mark - Updates
+
+/** Builds the next snapshot from mutable copies of the current tables and publishes it if the block changed anything.
+ 
+ @param block Sets and clears bits through the given setter, which returns whether the bit changed.
+ */
+- (void)updateWithBlock:(void (^)(BOOL (^setBit)(NSString *productIdentifier, NSString *userIdentifier, BOOL owned)))block
+{
+    @synchronized (self) {
+        DYFStoreEntitlementSnapshot *snapshot = [self currentSnapshot];
+        NSMutableArray *products = [snapshot.products mutableCopy];
+        NSMutableDictionary *productIDs = [snapshot.productIDs mutableCopy];
+        NSMutableDictionary *bitsets = [snapshot.bitsets mutableCopy];
+        // The bitsets copied by this update, changed in place by the following bits.
+        NSMutableSet *copied = [NSMutableSet set];
+        __block BOOL changed = NO;
+        
+        block(^BOOL(NSString *productIdentifier, NSString *userIdentifier, BOOL owned) {
+            if (productIdentifier.length == 0) { return NO; }
+            
+            NSNumber *productID = productIDs[productIdentifier];
+            if (!productID) {
+                if (!owned) { return NO; }
+                productID = @(products.count);
+                productIDs[productIdentifier] = productID;
+                [products addObject:productIdentifier];
+            }
+            
+            NSString *user = userIdentifier ?: DYFStoreEntitlementsNoUser;
+            NSUInteger bit = productID.unsignedIntegerValue;
+            if (DYFStoreBitsetContains(bitsets[user], bit) == owned) { return NO; }
+            
+            NSMutableData *bitset = bitsets[user];
+            if (![copied containsObject:user]) {
+                bitset = [NSMutableData dataWithData:bitsets[user] ?: [NSData data]];
+                bitsets[user] = bitset;
+                [copied addObject:user];
+            }
+            NSUInteger length = (bit / 64 + 1) * sizeof(uint64_t);
+            if (bitset.length < length) {
+                bitset.length = length;
+            }
+            
+            uint64_t *words = bitset.mutableBytes;
+            if (owned) {
+                words[bit / 64] |= 1ULL << (bit % 64);
+            } else {
+                words[bit / 64] &= ~(1ULL << (bit % 64));
+            }
+            changed = YES;
+            return YES;
+        });
+        
+        if (!changed) { return; }
+        
+        for (NSString *user in copied) {
+            bitsets[user] = [bitsets[user] copy];
+        }
+        [self publishSnapshot:[[DYFStoreEntitlementSnapshot alloc] initWithProducts:products productIDs:productIDs bitsets:bitsets]];
+    }
+}
+
+- (void)grantProduct:(NSString *)productIdentifier toUser:(NSString *)userIdentifier
+{
+    // A product that is already owned, e.g. granted with the batch of its transaction, needs no update.
+    if ([self isProduct:productIdentifier ownedByUser:userIdentifier]) { return; }
+    
+    [self updateWithBlock:^(BOOL (^setBit)(NSString *, NSString *, BOOL)) {
+        setBit(productIdentifier, userIdentifier, YES);
+    }];
+}
+
+- (void)grantProductsWithBlock:(void (^)(void (^grant)(NSString *productIdentifier, NSString *userIdentifier)))block
+{
+    [self updateWithBlock:^(BOOL (^setBit)(NSString *, NSString *, BOOL)) {
+        block(^(NSString *productIdentifier, NSString *userIdentifier) {
+            setBit(productIdentifier, userIdentifier, YES);
+        });
+    }];
+}
+
+- (void)revokeProduct:(NSString *)productIdentifier fromUser:(NSString *)userIdentifier
+{
+    [self updateWithBlock:^(BOOL (^setBit)(NSString *, NSString *, BOOL)) {
+        setBit(productIdentifier, userIdentifier, NO);
+    }];
+}
+
+- (void)grantTransactions:(NSArray<DYFStoreTransaction *> *)transactions
+{
+    [self updateWithBlock:^(BOOL (^setBit)(NSString *, NSString *, BOOL)) {
+        for (DYFStoreTransaction *transaction in transactions) {
+            setBit(transaction.productIdentifier, transaction.userIdentifier, YES);
+        }
+    }];
+}
+
+- (void)grantInAppPurchasesOfReceipt:(NSDictionary *)receipt toUser:(NSString *)userIdentifier
+{
+    NSArray *inApp = [receipt isKindOfClass:NSDictionary.class] ? receipt[@"in_app"] : nil;
+    if (![inApp isKindOfClass:NSArray.class]) { return; }
+    
+    [self updateWithBlock:^(BOOL (^setBit)(NSString *, NSString *, BOOL)) {
+        for (NSDictionary *entry in inApp) {
+            if (![entry isKindOfClass:NSDictionary.class]) { continue; }
+            // A cancelled entry was refunded by Apple customer support.
+            if (entry[@"cancellation_date"]) { continue; }
+            
+            NSString *productIdentifier = entry[@"product_id"];
+            if ([productIdentifier isKindOfClass:NSString.class]) {
+                setBit(productIdentifier, userIdentifier, YES);
+            }
+        }
+    }];
+}
+
+- (void)removeAllEntitlements
+{
+    @synchronized (self) {
+        [self publishSnapshot:[[DYFStoreEntitlementSnapshot alloc] initWithProducts:@[] productIDs:@{} bitsets:@{}]];
+    }
+}
+
+#pragma mark - Snapshot File
+
+// The file is: magic, version, the product count and the products, the user count and, for every user, the user and its bitset. Counts are 32-bit, strings are a 32-bit length and UTF-8 bytes, a bitset is a 32-bit word count and 64-bit words, all little-endian.
+
+static void DYFStoreAppendUInt32(NSMutableData *data, uint32_t value)
+{
+    value = CFSwapInt32HostToLittle(value);
+    [data appendBytes:&value length:sizeof(value)];
+}
+
+static void DYFStoreAppendString(NSMutableData *data, NSString *string)
+{
+    NSData *bytes = [string dataUsingEncoding:NSUTF8StringEncoding];
+    DYFStoreAppendUInt32(data, (uint32_t)bytes.length);
+    [data appendData:bytes];
+}
+
+/** Reads the file format above, advancing a cursor and failing on a truncated file.
+ */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} DYFStoreEntitlementsCursor;
+
+static BOOL DYFStoreReadUInt32(DYFStoreEntitlementsCursor *cursor, uint32_t *value)
+{
+    if (cursor->end - cursor->p < (ptrdiff_t)sizeof(uint32_t)) { return NO; }
+    memcpy(value, cursor->p, sizeof(uint32_t));
+    *value = CFSwapInt32LittleToHost(*value);
+    cursor->p += sizeof(uint32_t);
+    return YES;
+}
+
+static NSString *DYFStoreReadString(DYFStoreEntitlementsCursor *cursor)
+{
+    uint32_t length;
+    if (!DYFStoreReadUInt32(cursor, &length) || cursor->end - cursor->p < (ptrdiff_t)length) { return nil; }
+    NSString *string = [[NSString alloc] initWithBytes:cursor->p length:length encoding:NSUTF8StringEncoding];
+    cursor->p += length;
+    return string;
+}
+
+- (DYFStoreEntitlementSnapshot *)loadSnapshot
+{
+    NSData *data = [NSData dataWithContentsOfFile:self.path];
+    if (!data) { return nil; }
+    
+    DYFStoreEntitlementsCursor cursor = {data.bytes, (const uint8_t *)data.bytes + data.length};
+    uint32_t magic, version, productCount, userCount;
+    if (!DYFStoreReadUInt32(&cursor, &magic) || magic != DYFStoreEntitlementsMagic ||
+        !DYFStoreReadUInt32(&cursor, &version) || version != DYFStoreEntitlementsVersion ||
+        !DYFStoreReadUInt32(&cursor, &productCount)) {
+        return nil;
+    }
+    
+    NSMutableArray *products = [NSMutableArray arrayWithCapacity:productCount];
+    NSMutableDictionary *productIDs = [NSMutableDictionary dictionaryWithCapacity:productCount];
+    for (uint32_t idx = 0; idx < productCount; idx++) {
+        NSString *product = DYFStoreReadString(&cursor);
+        if (!product) { return nil; }
+        productIDs[product] = @(idx);
+        [products addObject:product];
+    }
+    
+    if (!DYFStoreReadUInt32(&cursor, &userCount)) { return nil; }
+    NSMutableDictionary *bitsets = [NSMutableDictionary dictionaryWithCapacity:userCount];
+    for (uint32_t idx = 0; idx < userCount; idx++) {
+        NSString *user = DYFStoreReadString(&cursor);
+        uint32_t wordCount;
+        if (!user || !DYFStoreReadUInt32(&cursor, &wordCount) ||
+            (NSUInteger)(cursor.end - cursor.p) / sizeof(uint64_t) < wordCount) {
+            return nil;
+        }
+        
+        NSMutableData *bitset = [NSMutableData dataWithBytes:cursor.p length:wordCount * sizeof(uint64_t)];
+        uint64_t *words = bitset.mutableBytes;
+        for (uint32_t word = 0; word < wordCount; word++) {
+            words[word] = CFSwapInt64LittleToHost(words[word]);
+        }
+        cursor.p += wordCount * sizeof(uint64_t);
+        bitsets[user] = [bitset copy];
+    }
+    
+    DYFStoreLog(@"loaded the entitlements of %zi products and %zi users", products.count, bitsets.count);
+    return [[DYFStoreEntitlementSnapshot alloc] initWithProducts:products productIDs:productIDs bitsets:bitsets];
+}
+
+- (void)synchronize
+{
+    DYFStoreEntitlementSnapshot *snapshot = nil;
+    @synchronized (self) {
+        if (!self.dirty) { return; }
+        self.dirty = NO;
+        snapshot = [self currentSnapshot];
+    }
+    
+    // The snapshot is immutable, so it is encoded outside of the lock.
+    NSMutableData *data = [NSMutableData data];
+    DYFStoreAppendUInt32(data, DYFStoreEntitlementsMagic);
+    DYFStoreAppendUInt32(data, DYFStoreEntitlementsVersion);
+    DYFStoreAppendUInt32(data, (uint32_t)snapshot.products.count);
+    for (NSString *product in snapshot.products) {
+        DYFStoreAppendString(data, product);
+    }
+    DYFStoreAppendUInt32(data, (uint32_t)snapshot.bitsets.count);
+    [snapshot.bitsets enumerateKeysAndObjectsUsingBlock:^(NSString *user, NSData *bitset, BOOL *stop) {
+        DYFStoreAppendString(data, user);
+        NSUInteger wordCount = bitset.length / sizeof(uint64_t);
+        DYFStoreAppendUInt32(data, (uint32_t)wordCount);
+        const uint64_t *words = bitset.bytes;
+        for (NSUInteger idx = 0; idx < wordCount; idx++) {
+            uint64_t word = CFSwapInt64HostToLittle(words[idx]);
+            [data appendBytes:&word length:sizeof(word)];
+        }
+    }];
+    
+    if (![data writeToFile:self.path atomically:YES]) {
+        DYFStoreLog(@"failed to write the entitlements");
+    }
+}
+
+@end
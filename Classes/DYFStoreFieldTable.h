@@ -0,0 +1,111 @@
+//
+//  DYFStoreFieldTable.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+typedef id (*DYFStoreFieldGetter)(id object);
+typedef void (*DYFStoreFieldSetter)(id object, id value);
+
+/** Describes a persisted property: the key it is stored under and two functions that read and write its instance variable directly. Scalars are boxed in `NSNumber` objects.
+ */
+typedef struct {
+    __unsafe_unretained NSString *key;
+    DYFStoreFieldGetter get;
+    DYFStoreFieldSetter set;
+} DYFStoreField;
+
+/** A static list of fields.
+ */
+typedef struct {
+    const DYFStoreField *fields;
+    NSUInteger count;
+} DYFStoreFieldTable;
+
+/** Defines the accessors of an object field inside the `@implementation` of a class. The value is copied, or set to nil if it is not a kind of `ValueClass`.
+ */
+#define DYFSTORE_FIELD_OBJECT(Class, name, ValueClass) \
+    static id Class##_get_##name(Class *object) { return object->_##name; } \
+    static void Class##_set_##name(Class *object, id value) { object->_##name = [value isKindOfClass:[ValueClass class]] ? [value copy] : nil; }
+
+/** Defines the accessors of an integer or enumeration field inside the `@implementation` of a class.
+ */
+#define DYFSTORE_FIELD_INTEGER(Class, name) \
+    static id Class##_get_##name(Class *object) { return @(object->_##name); } \
+    static void Class##_set_##name(Class *object, id value) { object->_##name = (__typeof__(object->_##name))([value respondsToSelector:@selector(longLongValue)] ? [value longLongValue] : 0); }
+
+/** Defines the accessors of a float field inside the `@implementation` of a class.
+ */
+#define DYFSTORE_FIELD_FLOAT(Class, name) \
+    static id Class##_get_##name(Class *object) { return @(object->_##name); } \
+    static void Class##_set_##name(Class *object, id value) { object->_##name = [value respondsToSelector:@selector(floatValue)] ? [value floatValue] : 0; }
+
+/** An entry of a field list, which refers to the accessors defined above. The key is the property name.
+ */
+#define DYFSTORE_FIELD(Class, name) \
+    { @#name, (DYFStoreFieldGetter)Class##_get_##name, (DYFStoreFieldSetter)Class##_set_##name }
+
+/** Makes a table from a static array of fields.
+ */
+#define DYFStoreFieldTableMake(fieldList) \
+    ((DYFStoreFieldTable){ fieldList, sizeof(fieldList) / sizeof(fieldList[0]) })
+
+/** Encodes the fields of an object with their keys.
+ */
+FOUNDATION_EXPORT void DYFStoreFieldTableEncode(DYFStoreFieldTable table, id object, NSCoder *coder);
+
+/** Decodes the fields of an object from their keys. Missing keys are skipped.
+ */
+FOUNDATION_EXPORT void DYFStoreFieldTableDecode(DYFStoreFieldTable table, id object, NSCoder *coder);
+
+/** Returns a dictionary of the non-nil fields of an object.
+ */
+FOUNDATION_EXPORT NSDictionary *DYFStoreFieldTableDictionary(DYFStoreFieldTable table, id object);
+
+/** Sets the fields of an object from a dictionary. Missing keys are skipped, `NSNull` values are treated as nil.
+ */
+FOUNDATION_EXPORT void DYFStoreFieldTableApplyDictionary(DYFStoreFieldTable table, id object, NSDictionary *dictionary);
+
+/** A class whose persisted properties are described by a static field table, which replaces the runtime introspection of `DYFRuntimeProvider`.
+ */
+@protocol DYFStoreFieldMapping <NSObject>
+
+/** Returns the field table of the class.
+ */
++ (DYFStoreFieldTable)fieldTable;
+
+/** Creates an object from a dictionary whose keys are the property names.
+
+ @param dictionary A dictionary produced by `dictionaryRepresentation` or `DYFRuntimeProvider`.
+ @return An object, or nil if dictionary is not a dictionary.
+ */
+- (instancetype)initWithDictionary:(NSDictionary *)dictionary;
+
+/** Returns a dictionary whose keys are the property names.
+
+ @return A dictionary of the non-nil properties.
+ */
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
@@ -0,0 +1,77 @@
+//
+//  DYFStoreFieldTable.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreFieldTable.h"
+
+// The maximum number of fields that a dictionary is built from.
+#define DYFSTORE_FIELD_MAX_COUNT 32
+
+void DYFStoreFieldTableEncode(DYFStoreFieldTable table, id object, NSCoder *coder)
+{
+    for (NSUInteger idx = 0; idx < table.count; idx++) {
+        const DYFStoreField *field = &table.fields[idx];
+        [coder encodeObject:field->get(object) forKey:field->key];
+    }
+}
+
+void DYFStoreFieldTableDecode(DYFStoreFieldTable table, id object, NSCoder *coder)
+{
+    for (NSUInteger idx = 0; idx < table.count; idx++) {
+        const DYFStoreField *field = &table.fields[idx];
+        if ([coder containsValueForKey:field->key]) {
+            field->set(object, [coder decodeObjectForKey:field->key]);
+        }
+    }
+}
+
+NSDictionary *DYFStoreFieldTableDictionary(DYFStoreFieldTable table, id object)
+{
+    id keys[DYFSTORE_FIELD_MAX_COUNT];
+    id values[DYFSTORE_FIELD_MAX_COUNT];
+    NSUInteger count = 0;
+
+    for (NSUInteger idx = 0; idx < MIN(table.count, DYFSTORE_FIELD_MAX_COUNT); idx++) {
+        const DYFStoreField *field = &table.fields[idx];
+        id value = field->get(object);
+        if (value) {
+            keys[count] = field->key;
+            values[count] = value;
+            count++;
+        }
+    }
+
+    return [NSDictionary dictionaryWithObjects:values forKeys:keys count:count];
+}
+
+void DYFStoreFieldTableApplyDictionary(DYFStoreFieldTable table, id object, NSDictionary *dictionary)
+{
+    for (NSUInteger idx = 0; idx < table.count; idx++) {
+        const DYFStoreField *field = &table.fields[idx];
+        id value = dictionary[field->key];
+        if (value) {
+            field->set(object, value == [NSNull null] ? nil : value);
+        }
+    }
+}
@@ -0,0 +1,145 @@
+//
+//  DYFStoreFuture.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import <Foundation/Foundation.h>
+
+/** The result of an asynchronous operation of the store, which completes once with a result or an error. The blocks registered on a future are called on the main queue, like the blocks of `DYFStore`.
+ 
+ A future can be cancelled, which completes it with a `DYFStoreErrorCodeOperationCancelled` error and cancels the work behind it. The futures derived from a future cancel it in turn.
+ */
+@interface DYFStoreFuture<__covariant ResultType> : NSObject
+
+/** Whether the future has completed.
+ */
+@property (nonatomic, assign, readonly, getter=isFinished) BOOL finished;
+
+/** Whether the future was cancelled.
+ */
+@property (nonatomic, assign, readonly, getter=isCancelled) BOOL cancelled;
+
+/** The result, if the future completed successfully.
+ */
+@property (nonatomic, strong, readonly) ResultType result;
+
+/** The error, if the future failed or was cancelled.
+ */
+@property (nonatomic, strong, readonly) NSError *error;
+
+/** Creates a future that has completed with a result.
+ 
+ @param result The result. Can be `nil`.
+ @return A `DYFStoreFuture` object.
+ */
++ (instancetype)futureWithResult:(ResultType)result;
+
+/** Creates a future that has failed with an error.
+ 
+ @param error The error.
+ @return A `DYFStoreFuture` object.
+ */
++ (instancetype)futureWithError:(NSError *)error;
+
+/** Creates a future that completes with the results of the given futures, in the same order, or fails with the first error, cancelling the others.
+ 
+ @param futures An array of `DYFStoreFuture` objects.
+ @return A future of an array whose elements are the results, with `NSNull` for a `nil` result.
+ */
++ (DYFStoreFuture<NSArray *> *)all:(NSArray<DYFStoreFuture *> *)futures;
+
+/** Creates a future that completes with the first result of the given futures, cancelling the others, or fails with the last error if all of them fail.
+ 
+ @param futures An array of `DYFStoreFuture` objects.
+ @return A `DYFStoreFuture` object.
+ */
++ (DYFStoreFuture *)any:(NSArray<DYFStoreFuture *> *)futures;
+
+/** Registers the blocks to be called when the future completes.
+ 
+ @param success The block to be called with the result. Can be `nil`.
+ @param failure The block to be called with the error. Can be `nil`.
+ @return The receiver.
+ */
+- (instancetype)onSuccess:(void (^)(ResultType result))success failure:(void (^)(NSError *error))failure;
+
+/** Registers a block to be called when the future completes.
+ 
+ @param block The block to be called with the result or the error.
+ @return The receiver.
+ */
+- (instancetype)whenFinished:(void (^)(ResultType result, NSError *error))block;
+
+/** Creates a future of what a block returns for the result. The error passes through without calling the block.
+ 
+ @param block The block to be called with the result. If it returns a `DYFStoreFuture`, the created future completes with it.
+ @return A `DYFStoreFuture` object.
+ */
+- (DYFStoreFuture *)then:(id (^)(ResultType result))block;
+
+/** Creates a future of what a block returns for the error. The result passes through without calling the block.
+ 
+ @param block The block to be called with the error. If it returns a `DYFStoreFuture`, the created future completes with it.
+ @return A `DYFStoreFuture` object.
+ */
+- (DYFStoreFuture *)recover:(id (^)(NSError *error))block;
+
+/** Creates a future that fails with a `DYFStoreErrorCodeTimedOut` error, cancelling the receiver, if the receiver does not complete within an interval.
+ 
+ @param interval The interval in seconds.
+ @return A `DYFStoreFuture` object.
+ */
+- (DYFStoreFuture<ResultType> *)timeout:(NSTimeInterval)interval;
+
+/** Cancels the future. It has no effect if the future has completed.
+ */
+- (void)cancel;
+
+@end
+
+/** The producer side of a `DYFStoreFuture`.
+ */
+@interface DYFStorePromise<ResultType> : NSObject
+
+/** The future that the promise completes.
+ */
+@property (nonatomic, strong, readonly) DYFStoreFuture<ResultType> *future;
+
+/** The block to be called once if the future is cancelled, to cancel the work behind it. It is called at once if the future has been cancelled.
+ */
+@property (nonatomic, copy) void (^cancellationHandler)(void);
+
+/** Completes the future with a result.
+ 
+ @param result The result. Can be `nil`.
+ @return YES if the future completed, or NO if it had completed.
+ */
+- (BOOL)fulfillWithResult:(ResultType)result;
+
+/** Completes the future with an error.
+ 
+ @param error The error.
+ @return YES if the future completed, or NO if it had completed.
+ */
+- (BOOL)rejectWithError:(NSError *)error;
+
+@end
@@ -0,0 +1,298 @@
+//
+//  DYFStoreFuture.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import "DYFStoreFuture.h"
+#import "DYFStore.h"
+
+/** Creates an error of the store.
+ */
+static NSError *DYFStoreFutureError(DYFStoreErrorCode code, NSString *description)
+{
+    NSString *errDesc = NSLocalizedStringFromTable(description, @"DYFStore", @"Error description");
+    return [NSError errorWithDomain:DYFStoreErrorDomain code:code userInfo:@{NSLocalizedDescriptionKey: errDesc}];
+}
+
+@interface DYFStoreFuture ()
+@property (nonatomic, assign, readwrite, getter=isFinished) BOOL finished;
+@property (nonatomic, assign, readwrite, getter=isCancelled) BOOL cancelled;
+@property (nonatomic, strong, readwrite) id result;
+@property (nonatomic, strong, readwrite) NSError *error;
+/** The blocks to be called when the future completes. */
+@property (nonatomic, strong) NSMutableArray *callbacks;
+@property (nonatomic, copy) void (^cancellationHandler)(void);
+- (BOOL)completeWithResult:(id)result error:(NSError *)error cancelled:(BOOL)cancelled;
+- (void)setCancellationHandlerIfPending:(void (^)(void))cancellationHandler;
+@end
+
+@implementation DYFStoreFuture
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _callbacks = [NSMutableArray array];
+    }
+    return self;
+}
+
++ (instancetype)futureWithResult:(id)result
+{
+    DYFStoreFuture *future = [[self alloc] init];
+    [future completeWithResult:result error:nil cancelled:NO];
+    return future;
+}
+
++ (instancetype)futureWithError:(NSError *)error
+{
+    DYFStoreFuture *future = [[self alloc] init];
+    [future completeWithResult:nil error:error cancelled:NO];
+    return future;
+}
+
+/** Completes the future once, and calls its blocks on the main queue.
+ 
+ @return YES if the future completed, or NO if it had completed.
+ */
+- (BOOL)completeWithResult:(id)result error:(NSError *)error cancelled:(BOOL)cancelled
+{
+    NSArray *callbacks = nil;
+    void (^cancellationHandler)(void) = nil;
+    @synchronized (self) {
+        if (self.finished) { return NO; }
+        self.finished = YES;
+        self.cancelled = cancelled;
+        self.result = result;
+        self.error = error;
+        
+        callbacks = self.callbacks;
+        self.callbacks = nil;
+        cancellationHandler = cancelled ? self.cancellationHandler : nil;
+        self.cancellationHandler = nil;
+    }
+    
+    !cancellationHandler ?: cancellationHandler();
+    if (callbacks.count > 0) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            for (void (^callback)(id, NSError *) in callbacks) {
+                callback(result, error);
+            }
+        });
+    }
+    return YES;
+}
+
+/** Sets the block that cancels the work behind the future, calling it at once if the future has been cancelled.
+ */
+- (void)setCancellationHandlerIfPending:(void (^)(void))cancellationHandler
+{
+    @synchronized (self) {
+        if (!self.finished) {
+            self.cancellationHandler = cancellationHandler;
+            return;
+        }
+        if (!self.cancelled) { return; }
+    }
+    !cancellationHandler ?: cancellationHandler();
+}
+
+- (instancetype)whenFinished:(void (^)(id result, NSError *error))block
+{
+    if (!block) { return self; }
+    
+    @synchronized (self) {
+        if (!self.finished) {
+            [self.callbacks addObject:[block copy]];
+            return self;
+        }
+    }
+    
+    dispatch_async(dispatch_get_main_queue(), ^{
+        block(self.result, self.error);
+    });
+    return self;
+}
+
+- (instancetype)onSuccess:(void (^)(id result))success failure:(void (^)(NSError *error))failure
+{
+    return [self whenFinished:^(id result, NSError *error) {
+        if (error) {
+            !failure ?: failure(error);
+        } else {
+            !success ?: success(result);
+        }
+    }];
+}
+
+/** Completes a promise with a value, which can be a future to complete it with.
+ */
+static void DYFStoreFutureResolve(DYFStorePromise *promise, id value, NSError *error)
+{
+    if (error) {
+        [promise rejectWithError:error];
+    } else if ([value isKindOfClass:DYFStoreFuture.class]) {
+        DYFStoreFuture *future = value;
+        promise.cancellationHandler = ^{ [future cancel]; };
+        [future whenFinished:^(id result, NSError *error) {
+            DYFStoreFutureResolve(promise, result, error);
+        }];
+    } else {
+        [promise fulfillWithResult:value];
+    }
+}
+
+- (DYFStoreFuture *)then:(id (^)(id result))block
+{
+    DYFStorePromise *promise = [[DYFStorePromise alloc] init];
+    promise.cancellationHandler = ^{ [self cancel]; };
+    [self whenFinished:^(id result, NSError *error) {
+        DYFStoreFutureResolve(promise, error || !block ? result : block(result), error);
+    }];
+    return promise.future;
+}
+
+- (DYFStoreFuture *)recover:(id (^)(NSError *error))block
+{
+    DYFStorePromise *promise = [[DYFStorePromise alloc] init];
+    promise.cancellationHandler = ^{ [self cancel]; };
+    [self whenFinished:^(id result, NSError *error) {
+        if (error && block) {
+            DYFStoreFutureResolve(promise, block(error), nil);
+        } else {
+            DYFStoreFutureResolve(promise, result, error);
+        }
+    }];
+    return promise.future;
+}
+
+- (DYFStoreFuture *)timeout:(NSTimeInterval)interval
+{
+    DYFStorePromise *promise = [[DYFStorePromise alloc] init];
+    promise.cancellationHandler = ^{ [self cancel]; };
+    [self whenFinished:^(id result, NSError *error) {
+        DYFStoreFutureResolve(promise, result, error);
+    }];
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        if ([promise rejectWithError:DYFStoreFutureError(DYFStoreErrorCodeTimedOut, @"The operation timed out")]) {
+            [self cancel];
+        }
+    });
+    return promise.future;
+}
+
+- (void)cancel
+{
+    [self completeWithResult:nil error:DYFStoreFutureError(DYFStoreErrorCodeOperationCancelled, @"The operation was cancelled") cancelled:YES];
+}
+
++ (DYFStoreFuture<NSArray *> *)all:(NSArray<DYFStoreFuture *> *)futures
+{
+    if (futures.count == 0) { return [self futureWithResult:@[]]; }
+    
+    DYFStorePromise *promise = [[DYFStorePromise alloc] init];
+    promise.cancellationHandler = ^{
+        [futures makeObjectsPerformSelector:@selector(cancel)];
+    };
+    
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:futures.count];
+    for (NSUInteger idx = 0; idx < futures.count; idx++) {
+        [results addObject:NSNull.null];
+    }
+    __block NSUInteger remaining = futures.count;
+    
+    // The blocks are called on the main queue, one at a time.
+    [futures enumerateObjectsUsingBlock:^(DYFStoreFuture *future, NSUInteger idx, BOOL *stop) {
+        [future whenFinished:^(id result, NSError *error) {
+            if (error) {
+                if ([promise rejectWithError:error]) {
+                    [futures makeObjectsPerformSelector:@selector(cancel)];
+                }
+                return;
+            }
+            
+            results[idx] = result ?: NSNull.null;
+            if (--remaining == 0) {
+                [promise fulfillWithResult:[results copy]];
+            }
+        }];
+    }];
+    return promise.future;
+}
+
++ (DYFStoreFuture *)any:(NSArray<DYFStoreFuture *> *)futures
+{
+    if (futures.count == 0) {
+        return [self futureWithError:DYFStoreFutureError(DYFStoreErrorCodeInvalidParameter, @"An array of futures is null or empty")];
+    }
+    
+    DYFStorePromise *promise = [[DYFStorePromise alloc] init];
+    promise.cancellationHandler = ^{
+        [futures makeObjectsPerformSelector:@selector(cancel)];
+    };
+    __block NSUInteger remaining = futures.count;
+    
+    for (DYFStoreFuture *future in futures) {
+        [future whenFinished:^(id result, NSError *error) {
+            if (!error) {
+                if ([promise fulfillWithResult:result]) {
+                    [futures makeObjectsPerformSelector:@selector(cancel)];
+                }
+            } else if (--remaining == 0) {
+                [promise rejectWithError:error];
+            }
+        }];
+    }
+    return promise.future;
+}
+
+@end
+
+@implementation DYFStorePromise
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _future = [[DYFStoreFuture alloc] init];
+    }
+    return self;
+}
+
+- (void)setCancellationHandler:(void (^)(void))cancellationHandler
+{
+    _cancellationHandler = [cancellationHandler copy];
+    [self.future setCancellationHandlerIfPending:_cancellationHandler];
+}
+
+- (BOOL)fulfillWithResult:(id)result
+{
+    return [self.future completeWithResult:result error:nil cancelled:NO];
+}
+
+- (BOOL)rejectWithError:(NSError *)error
+{
+    return [self.future completeWithResult:nil error:error cancelled:NO];
+}
+
+@end
@@ -0,0 +1,115 @@
+//
+//  DYFStoreJSONReader.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Uses enumeration to inicate the token that a JSON reader is positioned at.
+ */
+typedef NS_ENUM(NSInteger, DYFStoreJSONToken)
+{
+    /** No token has been read yet. */
+    DYFStoreJSONTokenNone,
+    DYFStoreJSONTokenBeginArray,
+    DYFStoreJSONTokenEndArray,
+    DYFStoreJSONTokenBeginObject,
+    DYFStoreJSONTokenEndObject,
+    /** The name of an object member. The member's value is the next token. */
+    DYFStoreJSONTokenKey,
+    DYFStoreJSONTokenString,
+    DYFStoreJSONTokenNumber,
+    DYFStoreJSONTokenTrue,
+    DYFStoreJSONTokenFalse,
+    DYFStoreJSONTokenNull,
+    /** The document has been read completely. */
+    DYFStoreJSONTokenEnd,
+    /** The document is malformed, see `error`. */
+    DYFStoreJSONTokenError
+};
+
+/** A pull parser that reads JSON data token by token, without building Foundation objects unless asked to.
+ */
+@interface DYFStoreJSONReader : NSObject
+
+/** The current token.
+ */
+@property (nonatomic, assign, readonly) DYFStoreJSONToken token;
+
+/** The byte range of the current token in the data. For keys and strings the range includes the quotes.
+ */
+@property (nonatomic, assign, readonly) NSRange tokenRange;
+
+/** The number of arrays and objects that enclose the position after the current token.
+ */
+@property (nonatomic, assign, readonly) NSUInteger depth;
+
+/** The reason why the token is DYFStoreJSONTokenError.
+ */
+@property (nonatomic, strong, readonly) NSError *error;
+
+/** Creates a reader. The data is not copied and must not be mutated while it is read.
+
+ @param data A data object containing JSON data.
+ @return A `DYFStoreJSONReader` object.
+ */
+- (instancetype)initWithData:(NSData *)data;
+
+/** Advances to the next token.
+
+ @return The new current token.
+ */
+- (DYFStoreJSONToken)nextToken;
+
+/** Skips the array or object that begins at the current token, so the next token follows it. Does nothing for other tokens.
+
+ @return NO if the document is malformed.
+ */
+- (BOOL)skipValue;
+
+/** Builds the Foundation object for the value that begins at the current token, and advances past it.
+
+ @return A Foundation object, or nil if the document is malformed.
+ */
+- (id)readValue;
+
+/** Returns the unescaped current key or string.
+
+ @return A string, or nil if the current token is not a key or string.
+ */
+- (NSString *)stringValue;
+
+/** Returns the current number.
+
+ @return A number, or nil if the current token is not a number.
+ */
+- (NSNumber *)numberValue;
+
+/** Compares the current key or string with a string. It does not allocate unless the token contains escape sequences.
+
+ @param string The string to compare with.
+ @return YES if the current token is a key or string equal to `string`.
+ */
+- (BOOL)stringValueEqualsString:(NSString *)string;
+
+@end
@@ -0,0 +1,452 @@
+//
+//  DYFStoreJSONReader.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreJSONReader.h"
+
+// The same limit as NSJSONSerialization.
+#define DYFSTORE_JSON_MAX_DEPTH 512
+
+@interface DYFStoreJSONReader ()
+{
+    NSData *_data;
+    const uint8_t *_bytes;
+    NSUInteger _length;
+    NSUInteger _pos;
+
+    char _stack[DYFSTORE_JSON_MAX_DEPTH];
+    BOOL _needsComma;  // A value has been read in the innermost container.
+    BOOL _afterComma;  // A comma has been read, a value must follow.
+    BOOL _afterKey;    // A key and its colon have been read, a value must follow.
+    BOOL _rootDone;
+
+    BOOL _hasEscapes;  // The current key or string contains escape sequences.
+    BOOL _isInteger;   // The current number has no fraction or exponent.
+}
+@property (nonatomic, assign) DYFStoreJSONToken token;
+@property (nonatomic, assign) NSRange tokenRange;
+@property (nonatomic, assign) NSUInteger depth;
+@property (nonatomic, strong) NSError *error;
+@end
+
+@implementation DYFStoreJSONReader
+
+- (instancetype)initWithData:(NSData *)data
+{
+    self = [super init];
+    if (self) {
+        _data = data;
+        _bytes = data.bytes;
+        _length = data.length;
+    }
+    return self;
+}
+
+#pragma mark - Tokenizing
+
+- (DYFStoreJSONToken)failWithDescription:(NSString *)description
+{
+    if (_token != DYFStoreJSONTokenError) {
+        NSString *message = [NSString stringWithFormat:@"%@ around character %lu.", description, (unsigned long)_pos];
+        _error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSPropertyListReadCorruptError userInfo:@{NSDebugDescriptionErrorKey: message}];
+        _token = DYFStoreJSONTokenError;
+    }
+    return DYFStoreJSONTokenError;
+}
+
+- (void)skipWhitespace
+{
+    while (_pos < _length) {
+        uint8_t c = _bytes[_pos];
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') { break; }
+        _pos++;
+    }
+}
+
+- (void)valueCompleted
+{
+    if (_depth == 0) {
+        _rootDone = YES;
+    } else {
+        _needsComma = YES;
+    }
+}
+
+- (DYFStoreJSONToken)setToken:(DYFStoreJSONToken)token from:(NSUInteger)start
+{
+    _tokenRange = NSMakeRange(start, _pos - start);
+    _token = token;
+    return token;
+}
+
+/** Scans a string whose opening quote is at the current position.
+ */
+- (BOOL)scanString
+{
+    _hasEscapes = NO;
+    _pos++;
+    while (_pos < _length) {
+        uint8_t c = _bytes[_pos];
+        if (c == '"') {
+            _pos++;
+            return YES;
+        } else if (c == '\\') {
+            _hasEscapes = YES;
+            _pos += 2;
+        } else if (c < 0x20) {
+            return NO;
+        } else {
+            _pos++;
+        }
+    }
+    return NO;
+}
+
+- (BOOL)scanNumber
+{
+    NSUInteger start = _pos;
+    _isInteger = YES;
+    if (_bytes[_pos] == '-') { _pos++; }
+
+    NSUInteger digits = _pos;
+    while (_pos < _length && isdigit(_bytes[_pos])) { _pos++; }
+    if (_pos == digits || (_bytes[digits] == '0' && _pos - digits > 1)) { return NO; }
+
+    if (_pos < _length && _bytes[_pos] == '.') {
+        _isInteger = NO;
+        digits = ++_pos;
+        while (_pos < _length && isdigit(_bytes[_pos])) { _pos++; }
+        if (_pos == digits) { return NO; }
+    }
+    if (_pos < _length && (_bytes[_pos] == 'e' || _bytes[_pos] == 'E')) {
+        _isInteger = NO;
+        _pos++;
+        if (_pos < _length && (_bytes[_pos] == '+' || _bytes[_pos] == '-')) { _pos++; }
+        digits = _pos;
+        while (_pos < _length && isdigit(_bytes[_pos])) { _pos++; }
+        if (_pos == digits) { return NO; }
+    }
+    return _pos > start;
+}
+
+- (BOOL)scanLiteral:(const char *)literal
+{
+    size_t length = strlen(literal);
+    if (_length - _pos < length || memcmp(_bytes + _pos, literal, length) != 0) {
+        return NO;
+    }
+    _pos += length;
+    return YES;
+}
+
+- (DYFStoreJSONToken)nextToken
+{
+    if (_token == DYFStoreJSONTokenError || _token == DYFStoreJSONTokenEnd) {
+        return _token;
+    }
+
+    [self skipWhitespace];
+
+    if (_rootDone) {
+        if (_pos < _length) { return [self failWithDescription:@"Garbage at end"]; }
+        return [self setToken:DYFStoreJSONTokenEnd from:_pos];
+    }
+    if (_pos >= _length) {
+        return [self failWithDescription:@"Unexpected end of data"];
+    }
+
+    uint8_t c = _bytes[_pos];
+    NSUInteger start = _pos;
+
+    if (_depth > 0) {
+        char container = _stack[_depth - 1];
+
+        if ((c == ']' || c == '}') && !_afterKey && !_afterComma) {
+            if (c != (container == '[' ? ']' : '}')) {
+                return [self failWithDescription:@"Mismatched closing bracket"];
+            }
+            _pos++;
+            _depth--;
+            [self valueCompleted];
+            return [self setToken:(c == ']' ? DYFStoreJSONTokenEndArray : DYFStoreJSONTokenEndObject) from:start];
+        }
+
+        if (_needsComma) {
+            if (c != ',') { return [self failWithDescription:@"Expected a comma"]; }
+            _pos++;
+            _needsComma = NO;
+            _afterComma = YES;
+            [self skipWhitespace];
+            if (_pos >= _length) { return [self failWithDescription:@"Unexpected end of data"]; }
+            c = _bytes[_pos];
+            start = _pos;
+        }
+
+        if (container == '{' && !_afterKey) {
+            if (c != '"') { return [self failWithDescription:@"Expected a key"]; }
+            if (![self scanString]) { return [self failWithDescription:@"Unterminated string"]; }
+            NSUInteger end = _pos;
+
+            [self skipWhitespace];
+            if (_pos >= _length || _bytes[_pos] != ':') { return [self failWithDescription:@"Expected a colon"]; }
+            _pos++;
+
+            _afterKey = YES;
+            _afterComma = NO;
+            _tokenRange = NSMakeRange(start, end - start);
+            _token = DYFStoreJSONTokenKey;
+            return DYFStoreJSONTokenKey;
+        }
+    }
+
+    _afterKey = NO;
+    _afterComma = NO;
+
+    switch (c) {
+        case '[':
+        case '{':
+            if (_depth >= DYFSTORE_JSON_MAX_DEPTH) { return [self failWithDescription:@"Too deeply nested"]; }
+            _pos++;
+            _stack[_depth] = (char)c;
+            _depth++;
+            _needsComma = NO;
+            return [self setToken:(c == '[' ? DYFStoreJSONTokenBeginArray : DYFStoreJSONTokenBeginObject) from:start];
+        case '"':
+            if (![self scanString]) { return [self failWithDescription:@"Unterminated string"]; }
+            [self valueCompleted];
+            return [self setToken:DYFStoreJSONTokenString from:start];
+        case 't':
+            if (![self scanLiteral:"true"]) { break; }
+            [self valueCompleted];
+            return [self setToken:DYFStoreJSONTokenTrue from:start];
+        case 'f':
+            if (![self scanLiteral:"false"]) { break; }
+            [self valueCompleted];
+            return [self setToken:DYFStoreJSONTokenFalse from:start];
+        case 'n':
+            if (![self scanLiteral:"null"]) { break; }
+            [self valueCompleted];
+            return [self setToken:DYFStoreJSONTokenNull from:start];
+        default:
+            if (c != '-' && !isdigit(c)) { break; }
+            if (![self scanNumber]) { return [self failWithDescription:@"Invalid number"]; }
+            [self valueCompleted];
+            return [self setToken:DYFStoreJSONTokenNumber from:start];
+    }
+
+    return [self failWithDescription:@"Invalid value"];
+}
+
+#pragma mark - Values
+
+- (BOOL)skipValue
+{
+    if (_token != DYFStoreJSONTokenBeginArray && _token != DYFStoreJSONTokenBeginObject) {
+        return _token != DYFStoreJSONTokenError;
+    }
+
+    NSUInteger depth = _depth - 1;
+    while (_depth > depth) {
+        if ([self nextToken] == DYFStoreJSONTokenError) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (id)readValue
+{
+    switch (_token) {
+        case DYFStoreJSONTokenBeginArray: {
+            NSMutableArray *array = [NSMutableArray array];
+            while ([self nextToken] != DYFStoreJSONTokenEndArray) {
+                id value = [self readValue];
+                if (!value) { return nil; }
+                [array addObject:value];
+            }
+            return array;
+        }
+        case DYFStoreJSONTokenBeginObject: {
+            NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+            DYFStoreJSONToken token;
+            while ((token = [self nextToken]) == DYFStoreJSONTokenKey) {
+                NSString *key = [self stringValue];
+                [self nextToken];
+                id value = [self readValue];
+                if (!key || !value) { return nil; }
+                dictionary[key] = value;
+            }
+            return token == DYFStoreJSONTokenEndObject ? dictionary : nil;
+        }
+        case DYFStoreJSONTokenString:
+            return [self stringValue];
+        case DYFStoreJSONTokenNumber:
+            return [self numberValue];
+        case DYFStoreJSONTokenTrue:
+            return @YES;
+        case DYFStoreJSONTokenFalse:
+            return @NO;
+        case DYFStoreJSONTokenNull:
+            return [NSNull null];
+        default:
+            return nil;
+    }
+}
+
+/** Appends the UTF-8 encoding of a code point.
+ */
+static inline NSUInteger DYFStoreJSONEncodeUTF8(uint32_t codePoint, uint8_t *out)
+{
+    if (codePoint < 0x80) {
+        out[0] = (uint8_t)codePoint;
+        return 1;
+    } else if (codePoint < 0x800) {
+        out[0] = (uint8_t)(0xC0 | (codePoint >> 6));
+        out[1] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        return 2;
+    } else if (codePoint < 0x10000) {
+        out[0] = (uint8_t)(0xE0 | (codePoint >> 12));
+        out[1] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+        out[2] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    out[0] = (uint8_t)(0xF0 | (codePoint >> 18));
+    out[1] = (uint8_t)(0x80 | ((codePoint >> 12) & 0x3F));
+    out[2] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+    out[3] = (uint8_t)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+static inline BOOL DYFStoreJSONReadHex4(const uint8_t *p, const uint8_t *end, uint32_t *value)
+{
+    if (end - p < 4) { return NO; }
+    uint32_t v = 0;
+    for (int idx = 0; idx < 4; idx++) {
+        uint8_t c = p[idx];
+        v <<= 4;
+        if (c >= '0' && c <= '9') { v |= c - '0'; }
+        else if (c >= 'a' && c <= 'f') { v |= c - 'a' + 10; }
+        else if (c >= 'A' && c <= 'F') { v |= c - 'A' + 10; }
+        else { return NO; }
+    }
+    *value = v;
+    return YES;
+}
+
+- (NSString *)stringValue
+{
+    if (_token != DYFStoreJSONTokenKey && _token != DYFStoreJSONTokenString) {
+        return nil;
+    }
+
+    const uint8_t *p = _bytes + _tokenRange.location + 1;
+    const uint8_t *end = _bytes + NSMaxRange(_tokenRange) - 1;
+    if (!_hasEscapes) {
+        return [[NSString alloc] initWithBytes:p length:end - p encoding:NSUTF8StringEncoding];
+    }
+
+    // Unescaping never makes a string longer.
+    uint8_t *buffer = malloc(end - p);
+    uint8_t *out = buffer;
+    while (p < end) {
+        if (*p != '\\') { *out++ = *p++; continue; }
+
+        p++;
+        switch (*p++) {
+            case '"':  *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '/':  *out++ = '/'; break;
+            case 'b':  *out++ = '\b'; break;
+            case 'f':  *out++ = '\f'; break;
+            case 'n':  *out++ = '\n'; break;
+            case 'r':  *out++ = '\r'; break;
+            case 't':  *out++ = '\t'; break;
+            case 'u': {
+                uint32_t codePoint, low;
+                if (!DYFStoreJSONReadHex4(p, end, &codePoint)) { free(buffer); return nil; }
+                p += 4;
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 &&
+                    end - p >= 6 && p[0] == '\\' && p[1] == 'u' &&
+                    DYFStoreJSONReadHex4(p + 2, end, &low) && low >= 0xDC00 && low < 0xE000) {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                out += DYFStoreJSONEncodeUTF8(codePoint, out);
+                break;
+            }
+            default:
+                free(buffer);
+                return nil;
+        }
+    }
+
+    return [[NSString alloc] initWithBytesNoCopy:buffer length:out - buffer encoding:NSUTF8StringEncoding freeWhenDone:YES];
+}
+
+- (NSNumber *)numberValue
+{
+    if (_token != DYFStoreJSONTokenNumber) {
+        return nil;
+    }
+
+    char stackBuffer[64];
+    NSUInteger length = _tokenRange.length;
+    char *buffer = length < sizeof(stackBuffer) ? stackBuffer : malloc(length + 1);
+    memcpy(buffer, _bytes + _tokenRange.location, length);
+    buffer[length] = '\0';
+
+    NSNumber *number = nil;
+    if (_isInteger) {
+        errno = 0;
+        if (buffer[0] == '-') {
+            long long value = strtoll(buffer, NULL, 10);
+            if (errno == 0) { number = @(value); }
+        } else {
+            unsigned long long value = strtoull(buffer, NULL, 10);
+            if (errno == 0) { number = value <= LLONG_MAX ? @((long long)value) : @(value); }
+        }
+    }
+    if (!number) {
+        number = @(strtod(buffer, NULL));
+    }
+
+    if (buffer != stackBuffer) { free(buffer); }
+    return number;
+}
+
+- (BOOL)stringValueEqualsString:(NSString *)string
+{
+    if (!string || (_token != DYFStoreJSONTokenKey && _token != DYFStoreJSONTokenString)) {
+        return NO;
+    }
+    if (_hasEscapes) {
+        return [[self stringValue] isEqualToString:string];
+    }
+
+    const char *utf8 = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8) ?: string.UTF8String;
+    size_t length = strlen(utf8);
+    return _tokenRange.length == length + 2 && memcmp(_bytes + _tokenRange.location + 1, utf8, length) == 0;
+}
+
+@end
@@ -0,0 +1,73 @@
+//
+//  DYFStoreJSONWriter.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Writes compact JSON incrementally, e.g. one record at a time, into a growing buffer. Commas and colons are inserted automatically.
+ */
+@interface DYFStoreJSONWriter : NSObject
+
+/** The JSON written so far.
+ */
+@property (nonatomic, strong, readonly) NSMutableData *data;
+
+/** Whether an invalid value, e.g. a non-finite number or an unsupported class, has been written.
+ */
+@property (nonatomic, assign, readonly) BOOL failed;
+
+/** Creates a writer with an empty buffer.
+ */
+- (instancetype)init;
+
+/** Creates a writer that appends to a buffer.
+
+ @param data The buffer to append to.
+ @return A `DYFStoreJSONWriter` object.
+ */
+- (instancetype)initWithData:(NSMutableData *)data;
+
+- (void)beginArray;
+- (void)endArray;
+- (void)beginObject;
+- (void)endObject;
+
+/** Writes the name of an object member. The member's value must be written next.
+
+ @param key The name of the member.
+ */
+- (void)writeKey:(NSString *)key;
+
+- (void)writeString:(NSString *)string;
+- (void)writeNumber:(NSNumber *)number;
+- (void)writeBool:(BOOL)value;
+- (void)writeNull;
+
+/** Writes a Foundation object that `NSJSONSerialization` accepts: an array, dictionary, string, number or null.
+
+ @param object The object to write.
+ */
+- (void)writeObject:(id)object;
+
+@end
@@ -0,0 +1,217 @@
+//
+//  DYFStoreJSONWriter.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreJSONWriter.h"
+
+@interface DYFStoreJSONWriter ()
+{
+    BOOL _needsComma;
+}
+@property (nonatomic, strong) NSMutableData *data;
+@property (nonatomic, assign) BOOL failed;
+@end
+
+@implementation DYFStoreJSONWriter
+
+- (instancetype)init
+{
+    return [self initWithData:[NSMutableData data]];
+}
+
+- (instancetype)initWithData:(NSMutableData *)data
+{
+    self = [super init];
+    if (self) {
+        _data = data ?: [NSMutableData data];
+    }
+    return self;
+}
+
+- (void)beginValue
+{
+    if (_needsComma) {
+        [_data appendBytes:"," length:1];
+    }
+}
+
+- (void)beginArray
+{
+    [self beginValue];
+    [_data appendBytes:"[" length:1];
+    _needsComma = NO;
+}
+
+- (void)endArray
+{
+    [_data appendBytes:"]" length:1];
+    _needsComma = YES;
+}
+
+- (void)beginObject
+{
+    [self beginValue];
+    [_data appendBytes:"{" length:1];
+    _needsComma = NO;
+}
+
+- (void)endObject
+{
+    [_data appendBytes:"}" length:1];
+    _needsComma = YES;
+}
+
+- (void)writeKey:(NSString *)key
+{
+    [self writeString:key];
+    [_data appendBytes:":" length:1];
+    _needsComma = NO;
+}
+
+- (void)writeString:(NSString *)string
+{
+    [self beginValue];
+
+    const char *utf8 = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8) ?: string.UTF8String ?: "";
+    const uint8_t *p = (const uint8_t *)utf8;
+
+    // Copies the runs that need no escaping in one go.
+    [_data appendBytes:"\"" length:1];
+    const uint8_t *run = p;
+    for (; *p; p++) {
+        uint8_t c = *p;
+        if (c >= 0x20 && c != '"' && c != '\\') { continue; }
+
+        [_data appendBytes:run length:p - run];
+        switch (c) {
+            case '"':  [_data appendBytes:"\\\"" length:2]; break;
+            case '\\': [_data appendBytes:"\\\\" length:2]; break;
+            case '\n': [_data appendBytes:"\\n" length:2]; break;
+            case '\r': [_data appendBytes:"\\r" length:2]; break;
+            case '\t': [_data appendBytes:"\\t" length:2]; break;
+            case '\b': [_data appendBytes:"\\b" length:2]; break;
+            case '\f': [_data appendBytes:"\\f" length:2]; break;
+            default: {
+                char escape[7];
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                [_data appendBytes:escape length:6];
+                break;
+            }
+        }
+        run = p + 1;
+    }
+    [_data appendBytes:run length:p - run];
+    [_data appendBytes:"\"" length:1];
+
+    _needsComma = YES;
+}
+
+- (void)writeNumber:(NSNumber *)number
+{
+    if (CFGetTypeID((__bridge CFTypeRef)number) == CFBooleanGetTypeID()) {
+        [self writeBool:number.boolValue];
+        return;
+    }
+
+    char buffer[32];
+    int length;
+    if ([number isKindOfClass:NSDecimalNumber.class]) {
+        [self beginValue];
+        NSData *digits = [number.description dataUsingEncoding:NSUTF8StringEncoding];
+        [_data appendData:digits];
+        _needsComma = YES;
+        return;
+    } else if (CFNumberIsFloatType((__bridge CFNumberRef)number)) {
+        double value = number.doubleValue;
+        if (!isfinite(value)) {
+            self.failed = YES;
+            [self writeNull];
+            return;
+        }
+        // The shortest of the two precisions that reads back the same value.
+        length = snprintf(buffer, sizeof(buffer), "%.15g", value);
+        if (strtod(buffer, NULL) != value) {
+            length = snprintf(buffer, sizeof(buffer), "%.17g", value);
+        }
+    } else if (number.objCType[0] == 'Q' || number.objCType[0] == 'L') {
+        length = snprintf(buffer, sizeof(buffer), "%llu", number.unsignedLongLongValue);
+    } else {
+        length = snprintf(buffer, sizeof(buffer), "%lld", number.longLongValue);
+    }
+
+    [self beginValue];
+    [_data appendBytes:buffer length:length];
+    _needsComma = YES;
+}
+
+- (void)writeBool:(BOOL)value
+{
+    [self beginValue];
+    if (value) {
+        [_data appendBytes:"true" length:4];
+    } else {
+        [_data appendBytes:"false" length:5];
+    }
+    _needsComma = YES;
+}
+
+- (void)writeNull
+{
+    [self beginValue];
+    [_data appendBytes:"null" length:4];
+    _needsComma = YES;
+}
+
+- (void)writeObject:(id)object
+{
+    if ([object isKindOfClass:NSString.class]) {
+        [self writeString:object];
+    } else if ([object isKindOfClass:NSNumber.class]) {
+        [self writeNumber:object];
+    } else if ([object isKindOfClass:NSDictionary.class]) {
+        [self beginObject];
+        [(NSDictionary *)object enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
+            if (![key isKindOfClass:NSString.class]) {
+                self.failed = YES;
+                return;
+            }
+            [self writeKey:key];
+            [self writeObject:obj];
+        }];
+        [self endObject];
+    } else if ([object isKindOfClass:NSArray.class]) {
+        [self beginArray];
+        for (id obj in (NSArray *)object) {
+            [self writeObject:obj];
+        }
+        [self endArray];
+    } else if (!object || object == [NSNull null]) {
+        [self writeNull];
+    } else {
+        self.failed = YES;
+        [self writeNull];
+    }
+}
+
+@end
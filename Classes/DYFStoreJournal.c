@@ -0,0 +1,251 @@
+//
+//  DYFStoreJournal.c
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "DYFStoreJournal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// "DYFJ" in little-endian order.
+#define DYFStoreJournalMagic 0x4A465944u
+#define DYFStoreJournalVersion 1u
+
+// The bounds of the capacity of a journal.
+#define DYFStoreJournalMinCapacity 64u
+#define DYFStoreJournalMaxCapacity (1u << 24)
+
+/** The header of the file, 64 bytes. The ring of events follows it.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t eventSize;
+    uint32_t capacity;
+    /** The number of the latest event reserved. */
+    uint64_t sequence;
+    uint64_t reserved[5];
+} DYFStoreJournalHeader;
+
+struct DYFStoreJournal {
+    DYFStoreJournalHeader *header;
+    DYFStoreJournalEvent *events;
+    size_t size;
+    uint32_t mask;
+};
+
+// MARK: - Helpers
+
+static inline size_t DYFStoreJournalSize(uint32_t capacity)
+{
+    return sizeof(DYFStoreJournalHeader) + (size_t)capacity * sizeof(DYFStoreJournalEvent);
+}
+
+static uint32_t DYFStoreJournalRoundCapacity(uint32_t capacity)
+{
+    uint32_t rounded = DYFStoreJournalMinCapacity;
+    while (rounded < capacity && rounded < DYFStoreJournalMaxCapacity) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+static int DYFStoreJournalIsValid(const DYFStoreJournalHeader *header, off_t fileSize)
+{
+    uint32_t capacity = header->capacity;
+    return header->magic == DYFStoreJournalMagic &&
+           header->version == DYFStoreJournalVersion &&
+           header->eventSize == sizeof(DYFStoreJournalEvent) &&
+           capacity >= DYFStoreJournalMinCapacity && capacity <= DYFStoreJournalMaxCapacity &&
+           (capacity & (capacity - 1)) == 0 &&
+           (uint64_t)fileSize >= DYFStoreJournalSize(capacity);
+}
+
+static int DYFStoreJournalReadFully(int fd, void *buffer, size_t length, off_t offset)
+{
+    char *p = buffer;
+    while (length > 0) {
+        ssize_t n = pread(fd, p, length, offset);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) {
+            if (n == 0) { errno = EINVAL; }
+            return -1;
+        }
+        p += n;
+        length -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+// gettimeofday reads the time from a page that the kernel shares with the process, on Darwin and on Linux, without entering the kernel.
+static inline uint64_t DYFStoreJournalNow(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint64_t)now.tv_sec * 1000000u + (uint64_t)now.tv_usec;
+}
+
+/** Copies the events numbered from the oldest that the ring can hold after `after` to `before`, skipping the slots that hold another event.
+ 
+ An event numbered up to `before` was reserved when the header was read first. If it was written before its slot was read, the slot holds its number, unless the slot was reserved again for an event numbered up to `after`, which the bounds exclude.
+ */
+static long DYFStoreJournalCollect(const DYFStoreJournalEvent *slots, uint32_t capacity, uint64_t before, uint64_t after, DYFStoreJournalEvent **events)
+{
+    uint64_t first = after >= capacity ? after - capacity + 1 : 1;
+    if (first > before) {
+        *events = NULL;
+        return 0;
+    }
+    
+    *events = malloc((size_t)(before - first + 1) * sizeof(DYFStoreJournalEvent));
+    if (!*events) { return -1; }
+    
+    long count = 0;
+    for (uint64_t sequence = first; sequence <= before; sequence++) {
+        const DYFStoreJournalEvent *event = &slots[(sequence - 1) & (capacity - 1)];
+        if (event->sequence != sequence) { continue; }
+        (*events)[count++] = *event;
+    }
+    return count;
+}
+
+// MARK: - Journal
+
+DYFStoreJournal *DYFStoreJournalOpen(const char *path, uint32_t capacity)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) { return NULL; }
+    
+    // An existing journal is kept as it is. Anything else is replaced by an empty journal.
+    DYFStoreJournalHeader existing;
+    struct stat status;
+    int valid = fstat(fd, &status) == 0 &&
+                status.st_size >= (off_t)sizeof(existing) &&
+                DYFStoreJournalReadFully(fd, &existing, sizeof(existing), 0) == 0 &&
+                DYFStoreJournalIsValid(&existing, status.st_size);
+    capacity = valid ? existing.capacity : DYFStoreJournalRoundCapacity(capacity);
+    size_t size = DYFStoreJournalSize(capacity);
+    if (!valid && (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0)) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return NULL;
+    }
+    
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    DYFStoreJournal *journal = map != MAP_FAILED ? calloc(1, sizeof(*journal)) : NULL;
+    if (!journal) {
+        if (map != MAP_FAILED) {
+            error = errno;
+            munmap(map, size);
+        }
+        errno = error;
+        return NULL;
+    }
+    
+    journal->header = map;
+    journal->events = (DYFStoreJournalEvent *)(journal->header + 1);
+    journal->size = size;
+    journal->mask = capacity - 1;
+    if (!valid) {
+        // The file was truncated to zeros. The magic is written last, so that a journal is never valid half initialized.
+        journal->header->version = DYFStoreJournalVersion;
+        journal->header->eventSize = sizeof(DYFStoreJournalEvent);
+        journal->header->capacity = capacity;
+        __atomic_store_n(&journal->header->magic, DYFStoreJournalMagic, __ATOMIC_RELEASE);
+    }
+    return journal;
+}
+
+void DYFStoreJournalClose(DYFStoreJournal *journal)
+{
+    if (!journal) { return; }
+    
+    munmap(journal->header, journal->size);
+    free(journal);
+}
+
+uint64_t DYFStoreJournalHash(const char *identifier, size_t length)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t idx = 0; idx < length; idx++) {
+        hash = (hash ^ (uint8_t)identifier[idx]) * 1099511628211ull;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+void DYFStoreJournalAppend(DYFStoreJournal *journal, DYFStoreJournalEventKind kind, uint64_t transactionHash, uint64_t productHash, uint16_t state, int32_t errorCode)
+{
+    if (!journal) { return; }
+    
+    uint64_t sequence = __atomic_add_fetch(&journal->header->sequence, 1, __ATOMIC_RELAXED);
+    DYFStoreJournalEvent *event = &journal->events[(sequence - 1) & journal->mask];
+    
+    // The slot holds no event while it is written, and its number is written last.
+    __atomic_store_n(&event->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    event->timestamp = DYFStoreJournalNow();
+    event->transactionHash = transactionHash;
+    event->productHash = (uint32_t)productHash;
+    event->errorCode = errorCode;
+    event->kind = (uint16_t)kind;
+    event->state = state;
+    event->reserved = 0;
+    __atomic_store_n(&event->sequence, sequence, __ATOMIC_RELEASE);
+}
+
+long DYFStoreJournalCopyEvents(const char *path, DYFStoreJournalEvent **events)
+{
+    *events = NULL;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return -1; }
+    
+    // The header is read before and after the events, which may be appended meanwhile.
+    DYFStoreJournalHeader before, after;
+    struct stat status;
+    DYFStoreJournalEvent *slots = NULL;
+    long count = -1;
+    if (fstat(fd, &status) == 0 && DYFStoreJournalReadFully(fd, &before, sizeof(before), 0) == 0) {
+        if (!DYFStoreJournalIsValid(&before, status.st_size)) {
+            errno = EINVAL;
+        } else if ((slots = malloc((size_t)before.capacity * sizeof(DYFStoreJournalEvent))) &&
+                   DYFStoreJournalReadFully(fd, slots, (size_t)before.capacity * sizeof(DYFStoreJournalEvent), sizeof(before)) == 0 &&
+                   DYFStoreJournalReadFully(fd, &after, sizeof(after), 0) == 0) {
+            count = DYFStoreJournalCollect(slots, before.capacity, before.sequence, after.sequence, events);
+        }
+    }
+    
+    int error = errno;
+    free(slots);
+    close(fd);
+    errno = error;
+    return count;
+}
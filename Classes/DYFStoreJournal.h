@@ -0,0 +1,110 @@
+//
+//  DYFStoreJournal.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef DYFStoreJournal_h
+#define DYFStoreJournal_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** An append-only journal of the lifecycle events of the transactions, in a memory-mapped file of fixed-size events. It is plain POSIX, so a journal copied from a device can be read on Linux, e.g. by Tools/DYFStoreJournalReplay.c.
+ 
+ The file is a ring: when it is full, the oldest events are overwritten. Appending an event reserves its number with an atomic increment and writes it into the mapping, without a lock or a system call. The pages belong to the file, so the events written before a crash of the process are kept.
+ 
+ The events are written in the byte order of the device, which is little-endian on all of them.
+ */
+typedef struct DYFStoreJournal DYFStoreJournal;
+
+/** The kinds of event.
+ */
+typedef enum {
+    /** The payment queue updated a transaction. The state is its `SKPaymentTransactionState`. */
+    DYFStoreJournalEventUpdated = 1,
+    /** The payment queue updated a download of a transaction. The state is its `SKDownloadState`. */
+    DYFStoreJournalEventDownload = 2,
+    /** The transaction was finished. */
+    DYFStoreJournalEventFinished = 3,
+    /** A payment was added to the payment queue. Only the product is known. */
+    DYFStoreJournalEventPaymentAdded = 4,
+    /** The payment queue finished restoring the transactions, or failed with the error code. */
+    DYFStoreJournalEventRestoreFinished = 5
+} DYFStoreJournalEventKind;
+
+/** An event of the journal, 40 bytes.
+ */
+typedef struct {
+    /** The number of the event, from 1. 0 while the event is written. */
+    uint64_t sequence;
+    /** The microseconds since 1970. */
+    uint64_t timestamp;
+    /** The hash of the transaction identifier, or 0 if the transaction has none yet, e.g. while it is purchasing. */
+    uint64_t transactionHash;
+    /** The hash of the product identifier, truncated. */
+    uint32_t productHash;
+    /** The code of the error, or 0. */
+    int32_t errorCode;
+    /** The kind of the event, a `DYFStoreJournalEventKind`. */
+    uint16_t kind;
+    /** The state of the transaction or the download. */
+    uint16_t state;
+    uint32_t reserved;
+} DYFStoreJournalEvent;
+
+/** Opens a journal, which is created if needed. An existing journal keeps its events and its capacity.
+ 
+ @param path The path of the file.
+ @param capacity The number of events of a new journal, rounded up to a power of two.
+ @return The journal, or NULL with errno set.
+ */
+DYFStoreJournal *DYFStoreJournalOpen(const char *path, uint32_t capacity);
+
+/** Closes a journal. No event may be appended to it at the same time.
+ */
+void DYFStoreJournalClose(DYFStoreJournal *journal);
+
+/** Returns the hash of an identifier, as recorded in the events. Never 0.
+ */
+uint64_t DYFStoreJournalHash(const char *identifier, size_t length);
+
+/** Appends an event. Takes no lock and makes no system call, and is safe to call from any thread.
+ */
+void DYFStoreJournalAppend(DYFStoreJournal *journal, DYFStoreJournalEventKind kind, uint64_t transactionHash, uint64_t productHash, uint16_t state, int32_t errorCode);
+
+/** Copies the complete events of a journal file, oldest first. The events that were being written, or were overwritten while the file was read, are skipped.
+ 
+ @param path The path of the file.
+ @param events Receives the events, to be released with `free`.
+ @return The number of events, or -1 with errno set, e.g. EINVAL if the file is not a journal.
+ */
+long DYFStoreJournalCopyEvents(const char *path, DYFStoreJournalEvent **events);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DYFStoreJournal_h */
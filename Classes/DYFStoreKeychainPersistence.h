@@ -24,13 +24,13 @@
 //
 
 #import <Foundation/Foundation.h>
-#import "DYFStoreTransaction.h"
+#import "DYFStoreTransactionPersistence.h"
 /** Deprecated. */
 #if __has_include(<DYFKeychain/DYFKeychain.h>)
 
 /** The transaction persistence using the keychain.
  */
-@interface DYFStoreKeychainPersistence : NSObject
+@interface DYFStoreKeychainPersistence : NSObject <DYFStoreTransactionPersistence>
 
 /** Returns a Boolean value that indicates whether a transaction is present in the keychain with a given transaction ientifier.
  
@@ -51,6 +51,33 @@
  */
 - (NSArray<DYFStoreTransaction *> *)retrieveTransactions;
 
+/** Retrieves the headers of the transactions from the keychain, without decoding the full records. The headers are read from the stored JSON without building the records or their receipts.
+ 
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeaders;
+
+/** Retrieves the `DYFStoreTransaction` objects from the keychain with the given transaction identifiers, decoding only their records.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
+/** Retrieves the headers of the transactions stored in the keychain that match a query.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeadersMatchingQuery:(DYFStoreTransactionQuery *)query;
+
+/** Retrieves the `DYFStoreTransaction` objects stored in the keychain that match a query.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query;
+
 /** Retrieves an `DYFStoreTransaction` object from the keychain with a given transaction ientifier.
  
  @param transactionIdentifier The unique server-provided identifier.
@@ -64,6 +91,12 @@
  */
 - (void)removeTransaction:(NSString *)transactionIdentifier;
 
+/** Removes the `DYFStoreTransaction` objects from the keychain with the given transaction identifiers, reading and writing it once.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ */
+- (void)removeTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
 /** Removes all transactions from the keychain.
  */
 - (void)removeTransactions;
@@ -25,14 +25,18 @@
 
 #import "DYFStoreKeychainPersistence.h"
 #import "DYFStoreConverter.h"
+#import "DYFStoreJSONReader.h"
+#import "DYFStoreMetrics.h"
 #if __has_include(<DYFKeychain/DYFKeychain.h>)
 #import "DYFKeychain.h"
-#import "DYFRuntimeProvider.h"
 
 @interface DYFStoreKeychainPersistence ()
 @property (nonatomic, strong) DYFKeychain *keychain;
 @end
 
+// The name of the member that identifies a transaction record.
+static NSString *const DYFStoreTransactionIdentifierKey = @"transactionIdentifier";
+
 @implementation DYFStoreKeychainPersistence
 
 /** Creates an instance of DYFKeychain using lazy load.
@@ -58,91 +62,218 @@
 
 - (BOOL)containsTransaction:(NSString *)transactionIdentifier
 {
-    NSArray *array = [self loadDataFromKeychain];
-    if (!array) { return NO; }
-    
-    NSMutableArray *arr = [NSMutableArray arrayWithArray:array];
-    for (int idx = 0; idx < arr.count; idx++) {
-        NSDictionary *dict = arr[idx];
-        DYFStoreTransaction *transaction = [DYFRuntimeProvider asObjectWithDictionary:dict forClass:DYFStoreTransaction.class];
-        NSString *identifier = transaction.transactionIdentifier;
-        if ([identifier isEqualToString:transactionIdentifier]) {
-            return YES;
-        }
-    }
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSData *data = [self.keychain getData:DYFStoreTransactionsKey];
+    if (!data) { return NO; }
     
-    return NO;
+    NSRange range = [DYFStoreConverter rangeOfObjectInJSONArray:data whereKey:DYFStoreTransactionIdentifierKey equalsString:transactionIdentifier];
+    return range.location != NSNotFound;
 }
 
 - (void)storeTransaction:(DYFStoreTransaction *)transaction
 {
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceStore);
     if (!transaction) { return; }
     
-    NSMutableArray *transactions;
-    NSArray *array = [self loadDataFromKeychain];
-    if (!array) {
-        transactions = [NSMutableArray arrayWithCapacity:0];
-    } else {
-        transactions = [NSMutableArray arrayWithArray:array];
+    // Appends the record to the stored array instead of decoding and encoding all of them.
+    NSData *data = [self.keychain getData:DYFStoreTransactionsKey];
+    NSDictionary *dict = [transaction dictionaryRepresentation];
+    NSData *tData = [DYFStoreConverter jsonArray:data byAppendingObject:dict];
+    if (!tData) {
+        NSArray *array = [DYFStoreConverter jsonObjectWithData:data];
+        NSMutableArray *transactions = [NSMutableArray arrayWithArray:[array isKindOfClass:NSArray.class] ? array : @[]];
+        [transactions addObject:dict];
+        tData = [DYFStoreConverter jsonWithObject:transactions];
     }
+    [self.keychain addData:tData forKey:DYFStoreTransactionsKey];
+}
+
+/** Returns the ranges of the records in the stored JSON array, so that the records can be built on the worker threads.
+ */
+- (NSArray<NSValue *> *)rangesOfRecordsInData:(NSData *)data
+{
+    NSMutableArray<NSValue *> *ranges = [NSMutableArray array];
+    [DYFStoreConverter enumerateObjectsInJSONArray:data keys:[NSSet set] usingBlock:^(NSDictionary *values, NSRange range, BOOL *stop) {
+        [ranges addObject:[NSValue valueWithRange:range]];
+    }];
+    return ranges;
+}
+
+- (void)storeTransactions:(NSArray<DYFStoreTransaction *> *)transactions
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceStore);
+    if (transactions.count == 0) { return; }
     
-    NSDictionary *dict = [DYFRuntimeProvider asDictionaryWithObject:transaction];
-    [transactions addObject:dict];
+    NSArray *array = [self loadDataFromKeychain];
+    NSMutableArray *arr = [NSMutableArray arrayWithArray:[array isKindOfClass:NSArray.class] ? array : @[]];
+    for (DYFStoreTransaction *transaction in transactions) {
+        [arr addObject:[transaction dictionaryRepresentation]];
+    }
     
-    NSData *tData = [DYFStoreConverter jsonWithObject:transactions];
+    NSData *tData = [DYFStoreConverter jsonWithObject:arr];
     [self.keychain addData:tData forKey:DYFStoreTransactionsKey];
 }
 
 - (NSArray<DYFStoreTransaction *> *)retrieveTransactions
 {
-    NSArray *array = [self loadDataFromKeychain];
-    if (!array) { return nil; }
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSData *data = [self.keychain getData:DYFStoreTransactionsKey];
+    if (!data) { return nil; }
     
-    NSMutableArray *transactions = [NSMutableArray array];
-    for (NSDictionary *dict in array) {
-        DYFStoreTransaction *transaction = [DYFRuntimeProvider asObjectWithDictionary:dict forClass:DYFStoreTransaction.class];
+    return [DYFStoreBulkDecoder.sharedDecoder decodeRecords:[self rangesOfRecordsInData:data] usingBlock:^id (NSValue *range) {
+        return [self transactionInData:data range:range.rangeValue];
+    }];
+}
+
+- (void)enumerateTransactionsUsingBlock:(void (^)(DYFStoreTransaction *transaction, BOOL *stop))block
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSData *data = [self.keychain getData:DYFStoreTransactionsKey];
+    if (!data) { return; }
+    
+    [DYFStoreBulkDecoder.sharedDecoder enumerateRecords:[self rangesOfRecordsInData:data] decode:^id (NSValue *range) {
+        return [self transactionInData:data range:range.rangeValue];
+    } usingBlock:block];
+}
+
+/** Reads the headers of the stored records without building them.
+ 
+ @param data The stored JSON array.
+ @param ranges If not NULL, receives the ranges of the records in data.
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects.
+ */
+- (NSMutableArray<DYFStoreTransactionHeader *> *)headersInData:(NSData *)data ranges:(NSMutableArray<NSValue *> *)ranges
+{
+    static NSSet *keys;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        keys = [NSSet setWithObjects:DYFStoreTransactionIdentifierKey, @"state", @"productIdentifier", @"userIdentifier", @"transactionTimestamp", nil];
+    });
+    
+    NSMutableArray *headers = [NSMutableArray array];
+    [DYFStoreConverter enumerateObjectsInJSONArray:data keys:keys usingBlock:^(NSDictionary *values, NSRange range, BOOL *stop) {
+        DYFStoreTransactionHeader *header = [[DYFStoreTransactionHeader alloc] init];
+        header.transactionIdentifier = values[DYFStoreTransactionIdentifierKey];
+        header.state = [values[@"state"] unsignedIntegerValue];
+        header.productIdentifier = values[@"productIdentifier"];
+        header.userIdentifier = values[@"userIdentifier"];
+        header.transactionTimestamp = values[@"transactionTimestamp"];
+        [headers addObject:header];
+        [ranges addObject:[NSValue valueWithRange:range]];
+    }];
+    
+    return headers;
+}
+
+/** Builds the record in a range of the stored JSON array.
+ */
+- (DYFStoreTransaction *)transactionInData:(NSData *)data range:(NSRange)range
+{
+    DYFStoreJSONReader *reader = [[DYFStoreJSONReader alloc] initWithData:[data subdataWithRange:range]];
+    [reader nextToken];
+    return [[DYFStoreTransaction alloc] initWithDictionary:[reader readValue]];
+}
+
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeaders
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSData *data = [self.keychain getData:DYFStoreTransactionsKey];
+    if (!data) { return nil; }
+    
+    return [self headersInData:data ranges:nil];
+}
+
+// The keychain item can be changed by other processes sharing its access group, so the index is built from the headers of each query rather than cached.
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeadersMatchingQuery:(DYFStoreTransactionQuery *)query
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSData *data = [self.keychain getData:DYFStoreTransactionsKey];
+    if (!data) { return @[]; }
+    
+    DYFStoreTransactionIndex *index = [[DYFStoreTransactionIndex alloc] initWithHeaders:[self headersInData:data ranges:nil]];
+    return [index.headers objectsAtIndexes:[index indexesOfTransactionsMatchingQuery:query]];
+}
+
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSData *data = [self.keychain getData:DYFStoreTransactionsKey];
+    if (!data) { return @[]; }
+    
+    NSMutableArray<NSValue *> *ranges = [NSMutableArray array];
+    DYFStoreTransactionIndex *index = [[DYFStoreTransactionIndex alloc] initWithHeaders:[self headersInData:data ranges:ranges]];
+    NSIndexSet *indexes = [index indexesOfTransactionsMatchingQuery:query];
+    
+    NSMutableArray *transactions = [NSMutableArray arrayWithCapacity:indexes.count];
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        DYFStoreTransaction *transaction = [self transactionInData:data range:ranges[idx].rangeValue];
         if (transaction) {
             [transactions addObject:transaction];
         }
-    }
+    }];
     
     return transactions;
 }
 
-- (DYFStoreTransaction *)retrieveTransaction:(NSString *)transactionIdentifier
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers
 {
-    NSArray *array = [self retrieveTransactions];
-    if (!array) { return nil; }
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSData *data = [self.keychain getData:DYFStoreTransactionsKey];
+    if (!data || transactionIdentifiers.count == 0) { return @[]; }
     
-    for (DYFStoreTransaction *transaction in array) {
-        NSString *identifier = transaction.transactionIdentifier;
-        if ([identifier isEqualToString:transactionIdentifier]) {
-            return transaction;
+    NSSet *identifiers = [NSSet setWithArray:transactionIdentifiers];
+    NSMutableArray *transactions = [NSMutableArray arrayWithCapacity:transactionIdentifiers.count];
+    [DYFStoreConverter enumerateObjectsInJSONArray:data keys:[NSSet setWithObject:DYFStoreTransactionIdentifierKey] usingBlock:^(NSDictionary *values, NSRange range, BOOL *stop) {
+        if (![identifiers containsObject:values[DYFStoreTransactionIdentifierKey] ?: @""]) { return; }
+        
+        // Only the matching records are built.
+        DYFStoreTransaction *transaction = [self transactionInData:data range:range];
+        if (transaction) {
+            [transactions addObject:transaction];
         }
-    }
+    }];
+    
+    return transactions;
+}
+
+- (DYFStoreTransaction *)retrieveTransaction:(NSString *)transactionIdentifier
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSData *data = [self.keychain getData:DYFStoreTransactionsKey];
+    NSDictionary *dict = [DYFStoreConverter objectInJSONArray:data whereKey:DYFStoreTransactionIdentifierKey equalsString:transactionIdentifier];
+    if (!dict) { return nil; }
     
-    return nil;
+    return [[DYFStoreTransaction alloc] initWithDictionary:dict];
 }
 
 - (void)removeTransaction:(NSString *)transactionIdentifier
 {
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRemove);
+    NSData *data = [self.keychain getData:DYFStoreTransactionsKey];
+    if (!data) { return; }
+    
+    NSData *tData = [DYFStoreConverter jsonArray:data byRemovingObjectWhereKey:DYFStoreTransactionIdentifierKey equalsString:transactionIdentifier];
+    if (tData) {
+        [self.keychain addData:tData forKey:DYFStoreTransactionsKey];
+    }
+}
+
+- (void)removeTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRemove);
     NSArray *array = [self loadDataFromKeychain];
-    if (!array) { return; }
-    
-    NSMutableArray *arr = [NSMutableArray arrayWithArray:array];
-    int index = -1;
-    for (int idx = 0; idx < arr.count; idx++) {
-        NSDictionary *dict = arr[idx];
-        DYFStoreTransaction *transaction = [DYFRuntimeProvider asObjectWithDictionary:dict forClass:DYFStoreTransaction.class];
-        NSString *identifier = transaction.transactionIdentifier;
-        if ([identifier isEqualToString:transactionIdentifier]) {
-            index = idx;
-            break;
+    if (!array || transactionIdentifiers.count == 0) { return; }
+    
+    NSSet *identifiers = [NSSet setWithArray:transactionIdentifiers];
+    NSMutableArray *arr = [NSMutableArray arrayWithCapacity:array.count];
+    for (NSDictionary *dict in array) {
+        id identifier = [dict isKindOfClass:NSDictionary.class] ? dict[DYFStoreTransactionIdentifierKey] : nil;
+        if (![identifiers containsObject:identifier ?: @""]) {
+            [arr addObject:dict];
         }
     }
     
-    if (index >= 0) {
-        [arr removeObjectAtIndex:index];
+    if (arr.count < array.count) {
         NSData *tData = [DYFStoreConverter jsonWithObject:arr];
         [self.keychain addData:tData forKey:DYFStoreTransactionsKey];
     }
@@ -150,6 +281,7 @@
 
 - (void)removeTransactions
 {
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRemove);
     [self.keychain delete:DYFStoreTransactionsKey];
 }
 
@@ -0,0 +1,86 @@
+//
+//  DYFStoreLogger.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Whether `DYFStoreLog` records into the logger. It is on in release builds too. Define it as 0 in the preprocessor macros to compile the logging out.
+ */
+#ifndef DYFSTORE_LOGGER_ENABLED
+#define DYFSTORE_LOGGER_ENABLED 1
+#endif
+
+/** Records a log entry without formatting it.
+
+ The format string, which must be a literal, is kept by address and the arguments are copied raw into a lock-free ring buffer owned by the calling thread. Objects are retained until the entry is formatted. At most 8 arguments are kept, `*` widths and precisions are not supported.
+
+ @param function The name of the calling function, e.g. `__PRETTY_FUNCTION__`.
+ @param line The line of the call.
+ @param format A literal format string.
+ */
+FOUNDATION_EXPORT void DYFStoreLoggerRecord(const char *function, int line, NSString *format, ...) NS_FORMAT_FUNCTION(3, 4);
+
+/** Receives formatted log lines on the drain queue.
+ */
+typedef void (^DYFStoreLoggerSink)(NSArray<NSString *> *lines);
+
+/** Formats the entries recorded by `DYFStoreLoggerRecord` on a background queue.
+ */
+@interface DYFStoreLogger : NSObject
+
+/** Sets the block that receives the formatted lines. By default the lines are written to the standard error in debug builds and only kept in memory in release builds.
+
+ @param sink The block that receives the formatted lines. Can be `nil`.
+ */
++ (void)setSink:(DYFStoreLoggerSink)sink;
+
+/** Sets the delay of the background drain. A drain is scheduled by the first entry recorded after the previous one, so no timer runs while nothing is logged. A thread that records half a ring buffer within the delay triggers a drain at once. The default value is 0.25 seconds.
+
+ @param interval The delay in seconds.
+ */
++ (void)setDrainInterval:(NSTimeInterval)interval;
+
+/** Formats all pending entries and passes them to the sink on the calling thread.
+ */
++ (void)drain;
+
+/** Returns the most recent formatted lines, at most 256.
+
+ @return An array of formatted lines, oldest first.
+ */
++ (NSArray<NSString *> *)recentLines;
+
+/** Returns the number of entries dropped because a thread's ring buffer was full.
+
+ @return The number of dropped entries.
+ */
++ (uint64_t)droppedCount;
+
+/** Installs an uncaught exception handler that formats the pending entries and writes them with the recent lines to a file before the app terminates. The previous handler is still called.
+
+ @param path The path of the file.
+ */
++ (void)installCrashDumpToPath:(NSString *)path;
+
+@end
@@ -0,0 +1,548 @@
+//
+//  DYFStoreLogger.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreLogger.h"
+#import "DYFStoreMetrics.h"
+#import <pthread.h>
+#import <stdatomic.h>
+
+#define DYFSTORE_LOG_MAX_ARGS      8
+#define DYFSTORE_LOG_RING_CAPACITY 512 // A power of two.
+#define DYFSTORE_LOG_HISTORY       256
+#define DYFSTORE_LOG_DRAIN_THRESHOLD (DYFSTORE_LOG_RING_CAPACITY / 2)
+
+typedef NS_ENUM(uint8_t, DYFStoreLogArgKind)
+{
+    DYFStoreLogArgSigned,
+    DYFStoreLogArgUnsigned,
+    DYFStoreLogArgDouble,
+    DYFStoreLogArgPointer,
+    /** A retained object, C strings are converted to this kind too. */
+    DYFStoreLogArgObject
+};
+
+typedef struct {
+    uint64_t timestamp;
+    const char *function;
+    __unsafe_unretained NSString *format;
+    int line;
+    uint8_t argc;
+    DYFStoreLogArgKind kinds[DYFSTORE_LOG_MAX_ARGS];
+    uint64_t args[DYFSTORE_LOG_MAX_ARGS];
+} DYFStoreLogRecord;
+
+/** A single-producer, single-consumer ring owned by one thread. The owning thread advances `head`, the drain advances `tail`.
+ */
+typedef struct DYFStoreLogRing {
+    _Atomic(uint64_t) head;
+    _Atomic(uint64_t) tail;
+    _Atomic(uint64_t) dropped;
+    _Atomic(bool) abandoned;
+    uint64_t threadID;
+    struct DYFStoreLogRing *next;
+    DYFStoreLogRecord records[DYFSTORE_LOG_RING_CAPACITY];
+} DYFStoreLogRing;
+
+static pthread_key_t DYFStoreLogRingKey;
+static pthread_mutex_t DYFStoreLogRingsLock = PTHREAD_MUTEX_INITIALIZER;
+static DYFStoreLogRing *DYFStoreLogRings;
+static _Atomic(uint64_t) DYFStoreLogDroppedTotal;
+
+static void DYFStoreLoggerPrepareDraining(void);
+static void DYFStoreLogScheduleDrain(uint64_t pending);
+
+static void DYFStoreLogRingAbandon(void *ring)
+{
+    // The ring stays registered until the drain has consumed it.
+    atomic_store_explicit(&((DYFStoreLogRing *)ring)->abandoned, true, memory_order_release);
+}
+
+static void DYFStoreLoggerSetUp(void)
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&DYFStoreLogRingKey, DYFStoreLogRingAbandon);
+        DYFStoreLoggerPrepareDraining();
+    });
+}
+
+static DYFStoreLogRing *DYFStoreLogCurrentRing(void)
+{
+    DYFStoreLoggerSetUp();
+
+    DYFStoreLogRing *ring = pthread_getspecific(DYFStoreLogRingKey);
+    if (ring) { return ring; }
+
+    ring = calloc(1, sizeof(DYFStoreLogRing));
+    if (!ring) { return NULL; }
+    pthread_threadid_np(NULL, &ring->threadID);
+    pthread_setspecific(DYFStoreLogRingKey, ring);
+
+    pthread_mutex_lock(&DYFStoreLogRingsLock);
+    ring->next = DYFStoreLogRings;
+    DYFStoreLogRings = ring;
+    pthread_mutex_unlock(&DYFStoreLogRingsLock);
+
+    return ring;
+}
+
+/** Returns the bytes of a format string. Literals are usually stored as ASCII, which avoids a copy.
+ */
+static inline const char *DYFStoreLogFormatBytes(NSString *format)
+{
+    const char *bytes = CFStringGetCStringPtr((__bridge CFStringRef)format, kCFStringEncodingASCII);
+    return bytes ?: format.UTF8String;
+}
+
+/** Reads the length modifier and the conversion of a format specification, and returns the position after it.
+ */
+static const char *DYFStoreLogScanSpec(const char *p, char *conversion, char *modifier, BOOL *star)
+{
+    *modifier = 0; *star = NO;
+    for (; *p; p++) {
+        char c = *p;
+        switch (c) {
+            case '*':
+                *star = YES;
+                break;
+            case 'h': case 'l': case 'q': case 'z': case 't': case 'j': case 'L':
+                // "ll" and "hh" are told apart by an upper case letter.
+                *modifier = (*modifier == c) ? (char)(c - 32) : c;
+                break;
+            case '-': case '+': case ' ': case '#': case '.': case '\'':
+            case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+                break;
+            default:
+                *conversion = c;
+                return p + 1;
+        }
+    }
+    *conversion = 0;
+    return p;
+}
+
+void DYFStoreLoggerRecord(const char *function, int line, NSString *format, ...)
+{
+    DYFStoreLogRing *ring = DYFStoreLogCurrentRing();
+    if (!ring) { return; }
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= DYFSTORE_LOG_RING_CAPACITY) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&DYFStoreLogDroppedTotal, 1, memory_order_relaxed);
+        return;
+    }
+
+    DYFStoreLogRecord *record = &ring->records[head & (DYFSTORE_LOG_RING_CAPACITY - 1)];
+    record->timestamp = DYFStoreMetricsNow();
+    record->function = function;
+    record->format = format;
+    record->line = line;
+    record->argc = 0;
+
+    va_list ap;
+    va_start(ap, format);
+
+    const char *p = DYFStoreLogFormatBytes(format);
+    while ((p = strchr(p, '%'))) {
+        char conversion, modifier; BOOL star;
+        p = DYFStoreLogScanSpec(p + 1, &conversion, &modifier, &star);
+        if (conversion == '%' || conversion == 0) { continue; }
+        if (star) { (void)va_arg(ap, int); }
+
+        DYFStoreLogArgKind kind;
+        uint64_t value;
+        switch (conversion) {
+            case 'd': case 'i': case 'D':
+                kind = DYFStoreLogArgSigned;
+                switch (modifier) {
+                    case 'l': value = (uint64_t)va_arg(ap, long); break;
+                    case 'L': case 'q': value = (uint64_t)va_arg(ap, long long); break;
+                    case 'z': value = (uint64_t)va_arg(ap, ssize_t); break;
+                    case 't': value = (uint64_t)va_arg(ap, ptrdiff_t); break;
+                    case 'j': value = (uint64_t)va_arg(ap, intmax_t); break;
+                    default: value = (uint64_t)(int64_t)va_arg(ap, int); break;
+                }
+                break;
+            case 'u': case 'U': case 'o': case 'O': case 'x': case 'X': case 'c': case 'C':
+                kind = DYFStoreLogArgUnsigned;
+                switch (modifier) {
+                    case 'l': value = va_arg(ap, unsigned long); break;
+                    case 'L': case 'q': value = va_arg(ap, unsigned long long); break;
+                    case 'z': value = va_arg(ap, size_t); break;
+                    case 't': value = (uint64_t)va_arg(ap, ptrdiff_t); break;
+                    case 'j': value = va_arg(ap, uintmax_t); break;
+                    default: value = va_arg(ap, unsigned int); break;
+                }
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                kind = DYFStoreLogArgDouble;
+                double d = (modifier == 'L') ? (double)va_arg(ap, long double) : va_arg(ap, double);
+                memcpy(&value, &d, sizeof(value));
+                break;
+            }
+            case 's': {
+                kind = DYFStoreLogArgObject;
+                const char *s = va_arg(ap, const char *);
+                // The C string may not outlive the call, so it is copied.
+                value = (uint64_t)(uintptr_t)CFBridgingRetain(s ? @(s) : nil);
+                break;
+            }
+            case '@': {
+                kind = DYFStoreLogArgObject;
+                __unsafe_unretained id object = va_arg(ap, id);
+                value = (uint64_t)(uintptr_t)CFBridgingRetain(object);
+                break;
+            }
+            default:
+                kind = DYFStoreLogArgPointer;
+                value = (uint64_t)(uintptr_t)va_arg(ap, void *);
+                break;
+        }
+
+        if (record->argc < DYFSTORE_LOG_MAX_ARGS) {
+            record->kinds[record->argc] = kind;
+            record->args[record->argc] = value;
+            record->argc++;
+        } else if (kind == DYFStoreLogArgObject && value) {
+            CFRelease((CFTypeRef)(uintptr_t)value);
+        }
+    }
+
+    va_end(ap);
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    DYFStoreLogScheduleDrain(head + 1 - tail);
+}
+
+#pragma mark - Formatting
+
+static inline void DYFStoreLogAppendBytes(NSMutableString *string, const char *bytes, size_t length)
+{
+    if (length == 0) { return; }
+    NSString *literal = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+    [string appendString:literal ?: @""];
+}
+
+/** Returns a specification that prints a 64-bit integer with the flags, width and precision of the original one.
+ */
+static NSString *DYFStoreLogWidenedSpec(const char *spec, size_t length, char conversion)
+{
+    // Strip the length modifiers that precede the conversion.
+    size_t end = length - 1;
+    while (end > 1 && strchr("hlqztjL", spec[end - 1])) { end--; }
+    char lower = (conversion == 'D' || conversion == 'U' || conversion == 'O') ? (char)(conversion + 32) : conversion;
+    return [NSString stringWithFormat:@"%.*sll%c", (int)end, spec, lower];
+}
+
+static NSString *DYFStoreLogFormatRecord(DYFStoreLogRecord *record, uint64_t threadID, NSDate *referenceDate, uint64_t referenceTime)
+{
+    const char *p = DYFStoreLogFormatBytes(record->format);
+    NSMutableString *message = [NSMutableString stringWithCapacity:strlen(p) + 32];
+
+    uint8_t argIndex = 0;
+    const char *spec;
+    while ((spec = strchr(p, '%'))) {
+        DYFStoreLogAppendBytes(message, p, spec - p);
+
+        char conversion, modifier; BOOL star;
+        p = DYFStoreLogScanSpec(spec + 1, &conversion, &modifier, &star);
+
+        if (conversion == '%') { [message appendString:@"%"]; continue; }
+        if (conversion == 0) { break; }
+        if (argIndex >= record->argc) { [message appendString:@"<?>"]; continue; }
+
+        NSString *specString = [[NSString alloc] initWithBytes:spec length:p - spec encoding:NSUTF8StringEncoding];
+        if (star) { specString = [specString stringByReplacingOccurrencesOfString:@"*" withString:@""]; }
+
+        uint64_t value = record->args[argIndex];
+        switch (record->kinds[argIndex++]) {
+            case DYFStoreLogArgSigned:
+            case DYFStoreLogArgUnsigned:
+                if (conversion == 'c' || conversion == 'C') {
+                    [message appendFormat:@"%C", (unichar)value];
+                } else {
+                    const char *bytes = specString.UTF8String;
+                    [message appendFormat:DYFStoreLogWidenedSpec(bytes, strlen(bytes), conversion), value];
+                }
+                break;
+            case DYFStoreLogArgDouble: {
+                double d;
+                memcpy(&d, &value, sizeof(d));
+                [message appendFormat:[specString stringByReplacingOccurrencesOfString:@"L" withString:@""], d];
+                break;
+            }
+            case DYFStoreLogArgPointer:
+                [message appendFormat:@"%p", (void *)(uintptr_t)value];
+                break;
+            case DYFStoreLogArgObject: {
+                id object = value ? (__bridge id)(void *)(uintptr_t)value : nil;
+                [message appendString:object ? [object description] : @"(null)"];
+                break;
+            }
+        }
+    }
+    if (p) {
+        DYFStoreLogAppendBytes(message, p, strlen(p));
+    }
+
+    static NSDateFormatter *dateFormatter;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dateFormatter = [[NSDateFormatter alloc] init];
+        dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        dateFormatter.dateFormat = @"yyyy-MM-dd HH:mm:ss.SSS";
+    });
+    NSTimeInterval offset = ((double)record->timestamp - (double)referenceTime) / NSEC_PER_SEC;
+    NSString *date = [dateFormatter stringFromDate:[referenceDate dateByAddingTimeInterval:offset]];
+
+    return [NSString stringWithFormat:@"%@ [%llu] %s [Line: %d] [DYFStore] %@", date, threadID, record->function, record->line, message];
+}
+
+static void DYFStoreLogReleaseRecord(DYFStoreLogRecord *record)
+{
+    for (uint8_t idx = 0; idx < record->argc; idx++) {
+        if (record->kinds[idx] == DYFStoreLogArgObject && record->args[idx]) {
+            CFRelease((CFTypeRef)(uintptr_t)record->args[idx]);
+        }
+    }
+    record->argc = 0;
+}
+
+#pragma mark - Draining
+
+static DYFStoreLoggerSink DYFStoreLogSink;
+static NSMutableArray<NSString *> *DYFStoreLogHistory;
+static dispatch_queue_t DYFStoreLogDrainQueue;
+static _Atomic(uint64_t) DYFStoreLogDrainDelay = 250 * NSEC_PER_MSEC;
+static _Atomic(bool) DYFStoreLogDrainScheduled;
+
+typedef struct {
+    DYFStoreLogRecord *record;
+    uint64_t threadID;
+} DYFStoreLogPending;
+
+static int DYFStoreLogComparePending(const void *lhs, const void *rhs)
+{
+    uint64_t a = ((const DYFStoreLogPending *)lhs)->record->timestamp;
+    uint64_t b = ((const DYFStoreLogPending *)rhs)->record->timestamp;
+    return (a > b) - (a < b);
+}
+
+/** Formats the pending entries of all threads in the order they were recorded. Must be called with `DYFStoreLogRingsLock` held.
+ */
+static NSArray<NSString *> *DYFStoreLogDrainLocked(void)
+{
+    NSUInteger capacity = 0;
+    for (DYFStoreLogRing *ring = DYFStoreLogRings; ring; ring = ring->next) {
+        capacity += DYFSTORE_LOG_RING_CAPACITY;
+    }
+    if (capacity == 0) { return @[]; }
+
+    DYFStoreLogPending *pending = malloc(sizeof(DYFStoreLogPending) * capacity);
+    uint64_t *heads = malloc(sizeof(uint64_t) * capacity / DYFSTORE_LOG_RING_CAPACITY);
+    NSUInteger count = 0, ringIndex = 0;
+
+    for (DYFStoreLogRing *ring = DYFStoreLogRings; ring; ring = ring->next, ringIndex++) {
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        heads[ringIndex] = head;
+        for (; tail < head; tail++) {
+            pending[count].record = &ring->records[tail & (DYFSTORE_LOG_RING_CAPACITY - 1)];
+            pending[count].threadID = ring->threadID;
+            count++;
+        }
+    }
+    qsort(pending, count, sizeof(DYFStoreLogPending), DYFStoreLogComparePending);
+
+    NSDate *referenceDate = [NSDate date];
+    uint64_t referenceTime = DYFStoreMetricsNow();
+
+    NSMutableArray *lines = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        @autoreleasepool {
+            [lines addObject:DYFStoreLogFormatRecord(pending[idx].record, pending[idx].threadID, referenceDate, referenceTime)];
+            DYFStoreLogReleaseRecord(pending[idx].record);
+        }
+    }
+
+    // Hand the slots back to the producers, and free the rings of exited threads once they are empty.
+    DYFStoreLogRing **link = &DYFStoreLogRings;
+    ringIndex = 0;
+    while (*link) {
+        DYFStoreLogRing *ring = *link;
+        atomic_store_explicit(&ring->tail, heads[ringIndex++], memory_order_release);
+
+        if (atomic_load_explicit(&ring->abandoned, memory_order_acquire) &&
+            atomic_load_explicit(&ring->head, memory_order_acquire) == heads[ringIndex - 1]) {
+            *link = ring->next;
+            free(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+
+    free(heads);
+    free(pending);
+
+    return lines;
+}
+
+static void DYFStoreLogDeliver(NSArray<NSString *> *lines)
+{
+    if (lines.count == 0) { return; }
+
+    DYFStoreLoggerSink sink;
+    @synchronized (DYFStoreLogHistory) {
+        [DYFStoreLogHistory addObjectsFromArray:lines];
+        if (DYFStoreLogHistory.count > DYFSTORE_LOG_HISTORY) {
+            [DYFStoreLogHistory removeObjectsInRange:NSMakeRange(0, DYFStoreLogHistory.count - DYFSTORE_LOG_HISTORY)];
+        }
+        sink = DYFStoreLogSink;
+    }
+
+    !sink ?: sink(lines);
+}
+
+static void DYFStoreLogDrainScheduledEntries(void *context)
+{
+    // Entries recorded from now on schedule the next drain.
+    atomic_store_explicit(&DYFStoreLogDrainScheduled, false, memory_order_release);
+    [DYFStoreLogger drain];
+}
+
+/** Schedules a drain after the drain delay unless one is already pending, so that nothing runs while no entries are recorded. A ring that fills up within the delay is drained at once, before entries get dropped.
+ */
+static void DYFStoreLogScheduleDrain(uint64_t pending)
+{
+    if (pending == DYFSTORE_LOG_DRAIN_THRESHOLD) {
+        dispatch_async_f(DYFStoreLogDrainQueue, NULL, DYFStoreLogDrainScheduledEntries);
+    }
+
+    if (atomic_load_explicit(&DYFStoreLogDrainScheduled, memory_order_relaxed) ||
+        atomic_exchange_explicit(&DYFStoreLogDrainScheduled, true, memory_order_acq_rel)) {
+        return;
+    }
+    uint64_t delay = atomic_load_explicit(&DYFStoreLogDrainDelay, memory_order_relaxed);
+    dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW, (int64_t)delay), DYFStoreLogDrainQueue, NULL, DYFStoreLogDrainScheduledEntries);
+}
+
+static void DYFStoreLoggerPrepareDraining(void)
+{
+    DYFStoreLogHistory = [NSMutableArray arrayWithCapacity:DYFSTORE_LOG_HISTORY];
+#if DEBUG
+    DYFStoreLogSink = ^(NSArray<NSString *> *lines) {
+        for (NSString *line in lines) {
+            fprintf(stderr, "%s\n", line.UTF8String);
+        }
+    };
+#endif
+
+    DYFStoreLogDrainQueue = dispatch_queue_create("com.dyfstore.logger.drain", DISPATCH_QUEUE_SERIAL);
+    dispatch_set_target_queue(DYFStoreLogDrainQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+}
+
+#pragma mark - Crash Dump
+
+static NSString *DYFStoreLogCrashDumpPath;
+static NSUncaughtExceptionHandler *DYFStoreLogPreviousExceptionHandler;
+
+static void DYFStoreLogUncaughtExceptionHandler(NSException *exception)
+{
+    // Another thread may be stuck holding the lock, so the pending entries are skipped rather than waited for.
+    NSArray *pending = @[];
+    if (pthread_mutex_trylock(&DYFStoreLogRingsLock) == 0) {
+        pending = DYFStoreLogDrainLocked();
+        pthread_mutex_unlock(&DYFStoreLogRingsLock);
+    }
+
+    NSMutableArray *lines = [NSMutableArray arrayWithArray:[DYFStoreLogger recentLines]];
+    [lines addObjectsFromArray:pending];
+    [lines addObject:[NSString stringWithFormat:@"Uncaught exception %@: %@", exception.name, exception.reason]];
+    [lines addObjectsFromArray:exception.callStackSymbols ?: @[]];
+
+    [[lines componentsJoinedByString:@"\n"] writeToFile:DYFStoreLogCrashDumpPath atomically:YES encoding:NSUTF8StringEncoding error:nil];
+
+    !DYFStoreLogPreviousExceptionHandler ?: DYFStoreLogPreviousExceptionHandler(exception);
+}
+
+@implementation DYFStoreLogger
+
++ (void)initialize
+{
+    if (self == [DYFStoreLogger class]) {
+        // Make sure the drain and the history exist even if nothing has been recorded yet.
+        DYFStoreLoggerSetUp();
+    }
+}
+
++ (void)setSink:(DYFStoreLoggerSink)sink
+{
+    @synchronized (DYFStoreLogHistory) {
+        DYFStoreLogSink = [sink copy];
+    }
+}
+
++ (void)setDrainInterval:(NSTimeInterval)interval
+{
+    atomic_store_explicit(&DYFStoreLogDrainDelay, (uint64_t)(MAX(interval, 0) * NSEC_PER_SEC), memory_order_relaxed);
+}
+
++ (void)drain
+{
+    NSArray *lines;
+    pthread_mutex_lock(&DYFStoreLogRingsLock);
+    lines = DYFStoreLogDrainLocked();
+    pthread_mutex_unlock(&DYFStoreLogRingsLock);
+
+    DYFStoreLogDeliver(lines);
+}
+
++ (NSArray<NSString *> *)recentLines
+{
+    @synchronized (DYFStoreLogHistory) {
+        return [DYFStoreLogHistory copy];
+    }
+}
+
++ (uint64_t)droppedCount
+{
+    return atomic_load_explicit(&DYFStoreLogDroppedTotal, memory_order_relaxed);
+}
+
++ (void)installCrashDumpToPath:(NSString *)path
+{
+    static dispatch_once_t onceToken;
+    DYFStoreLogCrashDumpPath = [path copy];
+    dispatch_once(&onceToken, ^{
+        DYFStoreLogPreviousExceptionHandler = NSGetUncaughtExceptionHandler();
+        NSSetUncaughtExceptionHandler(DYFStoreLogUncaughtExceptionHandler);
+    });
+}
+
+@end
@@ -0,0 +1,163 @@
+//
+//  DYFStoreMetrics.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Whether the latency instrumentation is compiled in. Define it as 0 in the preprocessor macros to remove it entirely.
+ */
+#ifndef DYFSTORE_METRICS_ENABLED
+#define DYFSTORE_METRICS_ENABLED 1
+#endif
+
+/** Uses enumeration to inicate a latency histogram of the purchase lifecycle.
+ */
+typedef NS_ENUM(NSUInteger, DYFStoreMetric)
+{
+    /** From starting a products request to its response or failure. */
+    DYFStoreMetricProductsRequest,
+    /** From starting a receipt refresh request to its completion or failure. */
+    DYFStoreMetricReceiptRefresh,
+    /** From the purchasing state of a transaction to its purchased state. */
+    DYFStoreMetricPurchasingToPurchased,
+    /** From starting the downloads of a transaction to their completion. */
+    DYFStoreMetricDownload,
+    /** From the purchased or restored state of a transaction to `finishTransaction:`, which includes the receipt verification. */
+    DYFStoreMetricPurchasedToFinished,
+    /** The time spent in a single `paymentQueue:updatedTransactions:` callback. */
+    DYFStoreMetricUpdatedTransactions,
+    /** The time spent storing a transaction in a persister. */
+    DYFStoreMetricPersistenceStore,
+    /** The time spent retrieving or looking up transactions in a persister. */
+    DYFStoreMetricPersistenceRetrieve,
+    /** The time spent removing transactions from a persister. */
+    DYFStoreMetricPersistenceRemove,
+    /** The time spent verifying a receipt. Recorded by the app, which owns the verifier. */
+    DYFStoreMetricVerification,
+    /** The number of histograms. */
+    DYFStoreMetricCount
+};
+
+/** Uses enumeration to inicate an event counter of the purchase lifecycle.
+ */
+typedef NS_ENUM(NSUInteger, DYFStoreCounter)
+{
+    DYFStoreCounterProductsRequests,
+    DYFStoreCounterReceiptRefreshes,
+    DYFStoreCounterPaymentsAdded,
+    DYFStoreCounterPurchasing,
+    DYFStoreCounterPurchased,
+    DYFStoreCounterFailed,
+    DYFStoreCounterCancelled,
+    DYFStoreCounterRestored,
+    DYFStoreCounterDeferred,
+    DYFStoreCounterDownloadsStarted,
+    DYFStoreCounterDownloadsFinished,
+    DYFStoreCounterDownloadsFailed,
+    DYFStoreCounterTransactionsFinished,
+    /** A transaction settled from the verification cache. */
+    DYFStoreCounterVerificationCacheHits,
+    /** A transaction that had to be verified by the server. */
+    DYFStoreCounterVerificationCacheMisses,
+    /** A verification request that was not sent because all transactions of its receipt were cached. */
+    DYFStoreCounterVerificationRequestsAvoided,
+    /** A receipt file that was memory-mapped. */
+    DYFStoreCounterReceiptMaps,
+    /** A receipt buffer that was materialized by encoding or decoding base64. */
+    DYFStoreCounterReceiptCopies,
+    /** A payment that joined the pending payment of the same product, user and quantity instead of being added. */
+    DYFStoreCounterPaymentsCoalesced,
+    /** A payment that was refused by the rate limit of the payment admission. */
+    DYFStoreCounterPaymentsRateLimited,
+    /** A transaction update or finish that the transaction state machine rejected as illegal or duplicate. */
+    DYFStoreCounterTransitionsRejected,
+    /** The number of counters. */
+    DYFStoreCounterCount
+};
+
+/** Returns the current monotonic time in nanoseconds.
+ */
+FOUNDATION_EXPORT uint64_t DYFStoreMetricsNow(void);
+
+/** Records a latency value in a histogram. Lock-free and safe to call from any thread.
+ */
+FOUNDATION_EXPORT void DYFStoreMetricsRecordValue(DYFStoreMetric metric, uint64_t nanoseconds);
+
+/** Increments an event counter. Lock-free and safe to call from any thread.
+ */
+FOUNDATION_EXPORT void DYFStoreMetricsIncrement(DYFStoreCounter counter);
+
+/** Adds a number of events to a counter at once, e.g. those of a batch. Lock-free and safe to call from any thread.
+ */
+FOUNDATION_EXPORT void DYFStoreMetricsIncrementBy(DYFStoreCounter counter, uint64_t count);
+
+/** Remembers the current time for an object, e.g. a request or a transaction, as the start of a metric. The mark is kept in a fixed side table without retaining the object; if the table runs full, the oldest marks are dropped. Lock-free and safe to call from any thread.
+ */
+FOUNDATION_EXPORT void DYFStoreMetricsMarkObject(id object, DYFStoreMetric metric);
+
+/** Records the time elapsed since `DYFStoreMetricsMarkObject` was called with the same object and metric, and forgets the mark. Does nothing if there is no mark.
+ */
+FOUNDATION_EXPORT void DYFStoreMetricsMeasureObject(id object, DYFStoreMetric metric);
+
+/** The state of a scoped measurement. Use `DYFStoreMetricsScope` instead.
+ */
+typedef struct {
+    DYFStoreMetric metric;
+    uint64_t start;
+} DYFStoreMetricsScopeState;
+
+FOUNDATION_EXPORT void DYFStoreMetricsScopeEnd(DYFStoreMetricsScopeState *state);
+
+#if DYFSTORE_METRICS_ENABLED
+    #define DYFStoreMetricsCount(counter) DYFStoreMetricsIncrement(counter)
+    #define DYFStoreMetricsAdd(counter, count) DYFStoreMetricsIncrementBy(counter, count)
+    #define DYFStoreMetricsBegin(object, metric) DYFStoreMetricsMarkObject(object, metric)
+    #define DYFStoreMetricsEnd(object, metric) DYFStoreMetricsMeasureObject(object, metric)
+    /** Measures the time until the end of the enclosing scope. */
+    #define DYFStoreMetricsScope(metric) __attribute__((cleanup(DYFStoreMetricsScopeEnd), unused)) DYFStoreMetricsScopeState _dyf_metrics_scope_ = {metric, DYFStoreMetricsNow()}
+#else
+    #define DYFStoreMetricsCount(counter)
+    #define DYFStoreMetricsAdd(counter, count)
+    #define DYFStoreMetricsBegin(object, metric)
+    #define DYFStoreMetricsEnd(object, metric)
+    #define DYFStoreMetricsScope(metric)
+#endif
+
+/** Exports the lifecycle metrics.
+ */
+@interface DYFStoreMetrics : NSObject
+
+/** Takes a snapshot of all counters and histograms.
+
+ The snapshot is of the form {"counters": {name: count}, "ratios": {name: ratio}, "histograms": {name: {"count", "sum_ns", "mean_ns", "max_ns", "p50_ns", "p90_ns", "p99_ns"}}} and can be serialized as JSON. Percentiles are accurate to within 12.5%. It is empty if DYFSTORE_METRICS_ENABLED is 0.
+
+ @return A snapshot of the metrics.
+ */
++ (NSDictionary *)snapshot;
+
+/** Resets all counters and histograms to zero.
+ */
++ (void)reset;
+
+@end
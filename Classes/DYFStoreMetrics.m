@@ -0,0 +1,318 @@
+//
+//  DYFStoreMetrics.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreMetrics.h"
+#import <mach/mach_time.h>
+#import <stdatomic.h>
+
+uint64_t DYFStoreMetricsNow(void)
+{
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+}
+
+#if DYFSTORE_METRICS_ENABLED
+
+// A log-linear histogram: values below 8 have their own bucket, above that every power of two is split into 8 sub-buckets.
+#define DYFSTORE_HISTOGRAM_SUB_BITS    3
+#define DYFSTORE_HISTOGRAM_SUB_BUCKETS (1 << DYFSTORE_HISTOGRAM_SUB_BITS)
+#define DYFSTORE_HISTOGRAM_BUCKETS     (DYFSTORE_HISTOGRAM_SUB_BUCKETS + (64 - DYFSTORE_HISTOGRAM_SUB_BITS) * DYFSTORE_HISTOGRAM_SUB_BUCKETS)
+
+typedef struct {
+    _Atomic(uint64_t) buckets[DYFSTORE_HISTOGRAM_BUCKETS];
+    _Atomic(uint64_t) sum;
+    _Atomic(uint64_t) max;
+} DYFStoreHistogram;
+
+static DYFStoreHistogram DYFStoreHistograms[DYFStoreMetricCount];
+static _Atomic(uint64_t) DYFStoreCounters[DYFStoreCounterCount];
+
+// The marks of objects live in a fixed side table, keyed by the address of the object combined with the metric. Objective-C objects are 16-byte aligned, which leaves the low bits of the address for the metric.
+#define DYFSTORE_MARK_TABLE_BITS 10
+#define DYFSTORE_MARK_TABLE_SIZE (1 << DYFSTORE_MARK_TABLE_BITS)
+#define DYFSTORE_MARK_PROBES     8
+
+_Static_assert(DYFStoreMetricCount <= 16, "The metric must fit into the low bits of an object address.");
+
+typedef struct {
+    _Atomic(uintptr_t) key;
+    _Atomic(uint64_t) start;
+} DYFStoreMark;
+
+static DYFStoreMark DYFStoreMarks[DYFSTORE_MARK_TABLE_SIZE];
+
+static inline uintptr_t DYFStoreMarkKey(__unsafe_unretained id object, DYFStoreMetric metric)
+{
+    return (uintptr_t)(__bridge void *)object | (uintptr_t)metric;
+}
+
+static inline NSUInteger DYFStoreMarkIndex(uintptr_t key)
+{
+    return (NSUInteger)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> (64 - DYFSTORE_MARK_TABLE_BITS));
+}
+
+static inline NSUInteger DYFStoreHistogramIndex(uint64_t value)
+{
+    if (value < DYFSTORE_HISTOGRAM_SUB_BUCKETS) {
+        return (NSUInteger)value;
+    }
+    unsigned msb = 63 - __builtin_clzll(value);
+    unsigned sub = (unsigned)(value >> (msb - DYFSTORE_HISTOGRAM_SUB_BITS)) & (DYFSTORE_HISTOGRAM_SUB_BUCKETS - 1);
+    return DYFSTORE_HISTOGRAM_SUB_BUCKETS + (msb - DYFSTORE_HISTOGRAM_SUB_BITS) * DYFSTORE_HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+/** Returns the midpoint of the values that fall into a bucket.
+ */
+static inline uint64_t DYFStoreHistogramValue(NSUInteger index)
+{
+    if (index < DYFSTORE_HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+    NSUInteger msb = (index - DYFSTORE_HISTOGRAM_SUB_BUCKETS) / DYFSTORE_HISTOGRAM_SUB_BUCKETS + DYFSTORE_HISTOGRAM_SUB_BITS;
+    NSUInteger sub = (index - DYFSTORE_HISTOGRAM_SUB_BUCKETS) % DYFSTORE_HISTOGRAM_SUB_BUCKETS;
+    uint64_t width = 1ULL << (msb - DYFSTORE_HISTOGRAM_SUB_BITS);
+    uint64_t lower = (1ULL << msb) | (sub * width);
+    return lower + width / 2;
+}
+
+void DYFStoreMetricsRecordValue(DYFStoreMetric metric, uint64_t nanoseconds)
+{
+    if (metric >= DYFStoreMetricCount) { return; }
+
+    DYFStoreHistogram *histogram = &DYFStoreHistograms[metric];
+    atomic_fetch_add_explicit(&histogram->buckets[DYFStoreHistogramIndex(nanoseconds)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum, nanoseconds, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    while (nanoseconds > max &&
+           !atomic_compare_exchange_weak_explicit(&histogram->max, &max, nanoseconds, memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+void DYFStoreMetricsIncrement(DYFStoreCounter counter)
+{
+    if (counter >= DYFStoreCounterCount) { return; }
+    atomic_fetch_add_explicit(&DYFStoreCounters[counter], 1, memory_order_relaxed);
+}
+
+void DYFStoreMetricsIncrementBy(DYFStoreCounter counter, uint64_t count)
+{
+    if (counter >= DYFStoreCounterCount) { return; }
+    atomic_fetch_add_explicit(&DYFStoreCounters[counter], count, memory_order_relaxed);
+}
+
+void DYFStoreMetricsMarkObject(id object, DYFStoreMetric metric)
+{
+    if (!object || metric >= DYFStoreMetricCount) { return; }
+
+    uintptr_t key = DYFStoreMarkKey(object, metric);
+    NSUInteger home = DYFStoreMarkIndex(key);
+    uint64_t now = DYFStoreMetricsNow();
+
+    DYFStoreMark *oldest = NULL;
+    uint64_t oldestStart = UINT64_MAX;
+    for (NSUInteger probe = 0; probe < DYFSTORE_MARK_PROBES; probe++) {
+        DYFStoreMark *mark = &DYFStoreMarks[(home + probe) & (DYFSTORE_MARK_TABLE_SIZE - 1)];
+        uintptr_t current = atomic_load_explicit(&mark->key, memory_order_acquire);
+        if (current == key) {
+            atomic_store_explicit(&mark->start, now, memory_order_release);
+            return;
+        }
+        if (current == 0 && atomic_compare_exchange_strong_explicit(&mark->key, &current, key, memory_order_acq_rel, memory_order_acquire)) {
+            atomic_store_explicit(&mark->start, now, memory_order_release);
+            return;
+        }
+        uint64_t start = atomic_load_explicit(&mark->start, memory_order_relaxed);
+        if (start < oldestStart) {
+            oldest = mark;
+            oldestStart = start;
+        }
+    }
+
+    // The marks of objects that went away without being measured would fill the table, so the oldest one gives way.
+    if (!oldest) { return; }
+    uintptr_t victim = atomic_load_explicit(&oldest->key, memory_order_acquire);
+    if (victim != 0 && atomic_compare_exchange_strong_explicit(&oldest->key, &victim, key, memory_order_acq_rel, memory_order_acquire)) {
+        atomic_store_explicit(&oldest->start, now, memory_order_release);
+    }
+}
+
+void DYFStoreMetricsMeasureObject(id object, DYFStoreMetric metric)
+{
+    if (!object || metric >= DYFStoreMetricCount) { return; }
+
+    uintptr_t key = DYFStoreMarkKey(object, metric);
+    NSUInteger home = DYFStoreMarkIndex(key);
+
+    for (NSUInteger probe = 0; probe < DYFSTORE_MARK_PROBES; probe++) {
+        DYFStoreMark *mark = &DYFStoreMarks[(home + probe) & (DYFSTORE_MARK_TABLE_SIZE - 1)];
+        if (atomic_load_explicit(&mark->key, memory_order_acquire) != key) { continue; }
+
+        uint64_t start = atomic_exchange_explicit(&mark->start, 0, memory_order_acq_rel);
+        atomic_compare_exchange_strong_explicit(&mark->key, &key, 0, memory_order_acq_rel, memory_order_relaxed);
+        if (start != 0) {
+            DYFStoreMetricsRecordValue(metric, DYFStoreMetricsNow() - start);
+        }
+        return;
+    }
+}
+
+void DYFStoreMetricsScopeEnd(DYFStoreMetricsScopeState *state)
+{
+    DYFStoreMetricsRecordValue(state->metric, DYFStoreMetricsNow() - state->start);
+}
+
+#else
+
+void DYFStoreMetricsRecordValue(DYFStoreMetric metric, uint64_t nanoseconds) {}
+void DYFStoreMetricsIncrement(DYFStoreCounter counter) {}
+void DYFStoreMetricsIncrementBy(DYFStoreCounter counter, uint64_t count) {}
+void DYFStoreMetricsMarkObject(id object, DYFStoreMetric metric) {}
+void DYFStoreMetricsMeasureObject(id object, DYFStoreMetric metric) {}
+void DYFStoreMetricsScopeEnd(DYFStoreMetricsScopeState *state) {}
+
+#endif
+
+@implementation DYFStoreMetrics
+
++ (NSArray<NSString *> *)metricNames
+{
+    return @[@"productsRequest",
+             @"receiptRefresh",
+             @"purchasingToPurchased",
+             @"download",
+             @"purchasedToFinished",
+             @"updatedTransactions",
+             @"persistenceStore",
+             @"persistenceRetrieve",
+             @"persistenceRemove",
+             @"verification"];
+}
+
++ (NSArray<NSString *> *)counterNames
+{
+    return @[@"productsRequests",
+             @"receiptRefreshes",
+             @"paymentsAdded",
+             @"purchasing",
+             @"purchased",
+             @"failed",
+             @"cancelled",
+             @"restored",
+             @"deferred",
+             @"downloadsStarted",
+             @"downloadsFinished",
+             @"downloadsFailed",
+             @"transactionsFinished",
+             @"verificationCacheHits",
+             @"verificationCacheMisses",
+             @"verificationRequestsAvoided",
+             @"receiptMaps",
+             @"receiptCopies",
+             @"paymentsCoalesced",
+             @"paymentsRateLimited",
+             @"transitionsRejected"];
+}
+
++ (NSDictionary *)snapshot
+{
+#if DYFSTORE_METRICS_ENABLED
+    NSArray *counterNames = [self counterNames];
+    NSMutableDictionary *counters = [NSMutableDictionary dictionaryWithCapacity:DYFStoreCounterCount];
+    for (NSUInteger idx = 0; idx < DYFStoreCounterCount; idx++) {
+        counters[counterNames[idx]] = @(atomic_load_explicit(&DYFStoreCounters[idx], memory_order_relaxed));
+    }
+
+    NSArray *metricNames = [self metricNames];
+    NSMutableDictionary *histograms = [NSMutableDictionary dictionaryWithCapacity:DYFStoreMetricCount];
+    uint64_t *buckets = malloc(sizeof(uint64_t) * DYFSTORE_HISTOGRAM_BUCKETS);
+
+    for (NSUInteger idx = 0; idx < DYFStoreMetricCount; idx++) {
+        DYFStoreHistogram *histogram = &DYFStoreHistograms[idx];
+
+        // The buckets are copied first, so the percentiles refer to a consistent total.
+        uint64_t total = 0;
+        for (NSUInteger bucket = 0; bucket < DYFSTORE_HISTOGRAM_BUCKETS; bucket++) {
+            buckets[bucket] = atomic_load_explicit(&histogram->buckets[bucket], memory_order_relaxed);
+            total += buckets[bucket];
+        }
+        uint64_t sum = atomic_load_explicit(&histogram->sum, memory_order_relaxed);
+        uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+
+        double ratios[3] = {0.50, 0.90, 0.99};
+        uint64_t percentiles[3] = {0, 0, 0};
+        for (int p = 0; p < 3 && total > 0; p++) {
+            uint64_t rank = (uint64_t)ceil(ratios[p] * total);
+            uint64_t seen = 0;
+            for (NSUInteger bucket = 0; bucket < DYFSTORE_HISTOGRAM_BUCKETS; bucket++) {
+                seen += buckets[bucket];
+                if (seen >= rank) {
+                    percentiles[p] = MIN(DYFStoreHistogramValue(bucket), max);
+                    break;
+                }
+            }
+        }
+
+        histograms[metricNames[idx]] = @{@"count": @(total),
+                                         @"sum_ns": @(sum),
+                                         @"mean_ns": @(total > 0 ? sum / total : 0),
+                                         @"max_ns": @(max),
+                                         @"p50_ns": @(percentiles[0]),
+                                         @"p90_ns": @(percentiles[1]),
+                                         @"p99_ns": @(percentiles[2])};
+    }
+
+    free(buckets);
+
+    uint64_t hits = atomic_load_explicit(&DYFStoreCounters[DYFStoreCounterVerificationCacheHits], memory_order_relaxed);
+    uint64_t misses = atomic_load_explicit(&DYFStoreCounters[DYFStoreCounterVerificationCacheMisses], memory_order_relaxed);
+    NSDictionary *ratios = @{@"verificationCacheHitRate": @(hits + misses > 0 ? (double)hits / (hits + misses) : 0)};
+
+    return @{@"counters": counters, @"ratios": ratios, @"histograms": histograms};
+#else
+    return @{};
+#endif
+}
+
++ (void)reset
+{
+#if DYFSTORE_METRICS_ENABLED
+    for (NSUInteger idx = 0; idx < DYFStoreCounterCount; idx++) {
+        atomic_store_explicit(&DYFStoreCounters[idx], 0, memory_order_relaxed);
+    }
+    for (NSUInteger idx = 0; idx < DYFStoreMetricCount; idx++) {
+        DYFStoreHistogram *histogram = &DYFStoreHistograms[idx];
+        for (NSUInteger bucket = 0; bucket < DYFSTORE_HISTOGRAM_BUCKETS; bucket++) {
+            atomic_store_explicit(&histogram->buckets[bucket], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&histogram->sum, 0, memory_order_relaxed);
+        atomic_store_explicit(&histogram->max, 0, memory_order_relaxed);
+    }
+#endif
+}
+
+@end
@@ -0,0 +1,112 @@
+//
+//  DYFStorePaymentAdmission.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import <Foundation/Foundation.h>
+#import <StoreKit/StoreKit.h>
+#import "DYFStoreClock.h"
+#import "DYFStoreFuture.h"
+
+@class DYFStoreNotificationInfo;
+
+/** Uses enumeration to inicate the decision of the payment admission.
+ */
+typedef NS_ENUM(NSUInteger, DYFStorePaymentAdmissionDecision)
+{
+    /** The payment is admitted and must be added to the payment queue. */
+    DYFStorePaymentAdmissionDecisionAdmitted,
+    /** The payment joins the pending payment of the same product, user and quantity, and must not be added. */
+    DYFStorePaymentAdmissionDecisionCoalesced,
+    /** The payment is refused by the rate limit. */
+    DYFStorePaymentAdmissionDecisionRateLimited
+};
+
+/** Decides which payments reach the payment queue. It tracks the pending payments by product, user and quantity, so that double taps and retry loops join the pending payment instead of adding another one, and bounds the rate of the payments.
+ 
+ A pending payment is tied to the transaction it produced when that transaction is purchasing, and only that transaction completes it, so that restored transactions and the transactions replayed after a relaunch never do. A pending payment is dropped when its transaction is deferred, or when it expires.
+ 
+ The payments carry their own quantity: a payment only joins a pending payment of the same quantity, so that a larger purchase is never resolved by a smaller one. The admission is thread-safe.
+ */
+@interface DYFStorePaymentAdmission : NSObject
+
+/** Creates a payment admission.
+ 
+ @param clock The clock that times the rate limit and the expiry of the pending payments. The default is a `DYFStoreSystemClock`.
+ @return A `DYFStorePaymentAdmission` object.
+ */
+- (instancetype)initWithClock:(id<DYFStoreClock>)clock NS_DESIGNATED_INITIALIZER;
+
+/** The clock that times the rate limit and the expiry of the pending payments.
+ */
+@property (nonatomic, strong, readonly) id<DYFStoreClock> clock;
+
+/** Whether a payment joins the pending payment of the same product, user and quantity. The default value is YES.
+ */
+@property (nonatomic, assign) BOOL coalescesPayments;
+
+/** The maximum number of payments admitted within `rateLimitInterval`. The default value is 0, which does not limit the rate.
+ */
+@property (nonatomic, assign) NSUInteger maximumPaymentsPerInterval;
+
+/** The interval of the rate limit. The default value is 60 seconds.
+ */
+@property (nonatomic, assign) NSTimeInterval rateLimitInterval;
+
+/** The time after which a pending payment expires: its future fails with a `DYFStoreErrorCodeTimedOut` error, and the next payment of the product and the user is admitted again. The default value is 600 seconds. 0 never expires them.
+ */
+@property (nonatomic, assign) NSTimeInterval pendingPaymentTimeout;
+
+/** The number of pending payments.
+ */
+@property (nonatomic, assign, readonly) NSUInteger pendingCount;
+
+/** Decides whether a payment is added to the payment queue.
+ 
+ @param payment The payment.
+ @param decision Receives the decision.
+ @return The future of the outcome of the payment, or of the pending payment it joins. It fails with a `DYFStoreErrorCodePaymentRateLimited` error if the payment is refused.
+ */
+- (DYFStoreFuture<DYFStoreNotificationInfo *> *)admitPayment:(SKPayment *)payment decision:(DYFStorePaymentAdmissionDecision *)decision;
+
+/** Ties a purchasing transaction to the oldest pending payment of its product, user and quantity that has no transaction yet.
+ 
+ @param transaction A purchasing `SKPaymentTransaction` object.
+ @return YES if the transaction was tied to a pending payment.
+ */
+- (BOOL)bindTransaction:(SKPaymentTransaction *)transaction;
+
+/** Completes the pending payment that produced a transaction.
+ 
+ The pending payment tied to the transaction is completed. A failed or deferred transaction that was never purchasing completes the oldest pending payment of its product, user and quantity without a transaction, as the payment queue can fail a payment at once. Restored transactions complete nothing.
+ 
+ @param transaction The `SKPaymentTransaction` object.
+ @param info The `DYFStoreNotificationInfo` object of the transaction. It fulfills the future if the state is succeeded, and rejects it with its error if the state is failed or cancelled. If the state is deferred, the pending payment is dropped and the future fails with a `DYFStoreErrorCodePaymentDeferred` error.
+ @return YES if a pending payment was completed.
+ */
+- (BOOL)completePaymentWithTransaction:(SKPaymentTransaction *)transaction info:(DYFStoreNotificationInfo *)info;
+
+/** Forgets the pending payments, cancelling their futures, e.g. when the payment queue is no longer observed.
+ */
+- (void)removeAllPayments;
+
+@end
@@ -0,0 +1,323 @@
+//
+//  DYFStorePaymentAdmission.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import "DYFStorePaymentAdmission.h"
+#import "DYFStore.h"
+
+/** A payment that was admitted and has not completed.
+ */
+@interface DYFStorePendingPayment : NSObject
+/** The promise of the outcome, whose future is shared by the payments that joined it. */
+@property (nonatomic, strong) DYFStorePromise *promise;
+/** The time the payment was admitted. */
+@property (nonatomic, assign) NSTimeInterval admittedAt;
+/** The transaction the payment produced, once it is purchasing. */
+@property (nonatomic, strong) SKPaymentTransaction *transaction;
+@end
+
+@implementation DYFStorePendingPayment
+@end
+
+@interface DYFStorePaymentAdmission ()
+@property (nonatomic, strong) id<DYFStoreClock> clock;
+/** The pending payments by product, user and quantity, oldest first. */
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableArray<DYFStorePendingPayment *> *> *pendingPayments;
+/** The times the payments within the rate limit interval were admitted, oldest first. */
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *admissionTimes;
+/** The queue on which the pending payments expire. */
+@property (nonatomic, strong) dispatch_queue_t expiryQueue;
+@end
+
+/** Returns the key of the pending payments of a product, a user and a quantity. Payments of different quantities never join each other.
+ */
+static NSString *DYFStorePaymentAdmissionKey(NSString *productIdentifier, NSString *userIdentifier, NSInteger quantity)
+{
+    return [NSString stringWithFormat:@"%@\n%@\n%ld", productIdentifier ?: @"", userIdentifier ?: @"", (long)quantity];
+}
+
+/** Returns the key of the pending payments of the product, the user and the quantity of a transaction.
+ */
+static NSString *DYFStorePaymentAdmissionTransactionKey(SKPaymentTransaction *transaction)
+{
+    NSString *userIdentifier = nil;
+    if (@available(iOS 7.0, *)) {
+        userIdentifier = transaction.payment.applicationUsername;
+    }
+    return DYFStorePaymentAdmissionKey(transaction.payment.productIdentifier, userIdentifier, transaction.payment.quantity);
+}
+
+static NSError *DYFStorePaymentAdmissionError(NSInteger code, NSString *description)
+{
+    NSString *errDesc = NSLocalizedStringFromTable(description, @"DYFStore", @"Error description");
+    return [NSError errorWithDomain:DYFStoreErrorDomain code:code userInfo:@{NSLocalizedDescriptionKey: errDesc}];
+}
+
+/** Returns a future that follows a shared future, so that a caller that cancels it stops waiting without cancelling the payment for the others.
+ */
+static DYFStoreFuture *DYFStorePaymentAdmissionFollow(DYFStoreFuture *future)
+{
+    DYFStorePromise *promise = [[DYFStorePromise alloc] init];
+    [future whenFinished:^(id result, NSError *error) {
+        if (error) {
+            [promise rejectWithError:error];
+        } else {
+            [promise fulfillWithResult:result];
+        }
+    }];
+    return promise.future;
+}
+
+@implementation DYFStorePaymentAdmission
+
+- (instancetype)init
+{
+    return [self initWithClock:nil];
+}
+
+- (instancetype)initWithClock:(id<DYFStoreClock>)clock
+{
+    self = [super init];
+    if (self) {
+        _clock = clock ?: [[DYFStoreSystemClock alloc] init];
+        _coalescesPayments = YES;
+        _rateLimitInterval = 60;
+        _pendingPaymentTimeout = 600;
+        _pendingPayments = [NSMutableDictionary dictionary];
+        _admissionTimes = [NSMutableArray array];
+        _expiryQueue = dispatch_queue_create("com.dyf.storekit.admission.expiry", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (NSUInteger)pendingCount
+{
+    @synchronized (self) {
+        NSUInteger count = 0;
+        for (NSArray *payments in self.pendingPayments.allValues) {
+            count += payments.count;
+        }
+        return count;
+    }
+}
+
+- (DYFStoreFuture<DYFStoreNotificationInfo *> *)admitPayment:(SKPayment *)payment decision:(DYFStorePaymentAdmissionDecision *)decision
+{
+    NSString *userIdentifier = nil;
+    if (@available(iOS 7.0, *)) {
+        userIdentifier = payment.applicationUsername;
+    }
+    NSString *key = DYFStorePaymentAdmissionKey(payment.productIdentifier, userIdentifier, payment.quantity);
+    DYFStorePaymentAdmissionDecision result = DYFStorePaymentAdmissionDecisionAdmitted;
+    DYFStoreFuture *future = nil;
+    DYFStorePendingPayment *admitted = nil;
+    NSArray<DYFStorePendingPayment *> *expired = nil;
+    NSTimeInterval now = self.clock.now;
+    NSTimeInterval timeout = self.pendingPaymentTimeout;
+    
+    @synchronized (self) {
+        // A delayed expiry must not keep a payment joinable past its timeout.
+        expired = [self removeExpiredPaymentsForKey:key at:now];
+        NSMutableArray<DYFStorePendingPayment *> *payments = self.pendingPayments[key];
+        if (self.coalescesPayments && payments.count > 0) {
+            result = DYFStorePaymentAdmissionDecisionCoalesced;
+            future = payments.firstObject.promise.future;
+        } else if (![self admitAt:now]) {
+            result = DYFStorePaymentAdmissionDecisionRateLimited;
+        } else {
+            admitted = [[DYFStorePendingPayment alloc] init];
+            admitted.promise = [[DYFStorePromise alloc] init];
+            admitted.admittedAt = now;
+            if (!payments) {
+                payments = [NSMutableArray arrayWithCapacity:1];
+                self.pendingPayments[key] = payments;
+            }
+            [payments addObject:admitted];
+            future = admitted.promise.future;
+        }
+    }
+    
+    [self expirePayments:expired];
+    if (admitted && timeout > 0) {
+        __weak typeof(self) weakSelf = self;
+        __weak DYFStorePendingPayment *weakPayment = admitted;
+        [self.clock performAfterDelay:timeout onQueue:self.expiryQueue block:^{
+            [weakSelf expirePayment:weakPayment forKey:key];
+        }];
+    }
+    
+    if (decision) { *decision = result; }
+    if (result == DYFStorePaymentAdmissionDecisionRateLimited) {
+        return [DYFStoreFuture futureWithError:DYFStorePaymentAdmissionError(DYFStoreErrorCodePaymentRateLimited, @"Too many payments, try again later")];
+    }
+    return DYFStorePaymentAdmissionFollow(future);
+}
+
+/** Records an admission within the rate limit. Called under the lock.
+ 
+ @param now The current time.
+ @return NO if the rate limit is reached.
+ */
+- (BOOL)admitAt:(NSTimeInterval)now
+{
+    if (self.maximumPaymentsPerInterval == 0) { return YES; }
+    
+    while (self.admissionTimes.count > 0 && now - self.admissionTimes.firstObject.doubleValue >= self.rateLimitInterval) {
+        [self.admissionTimes removeObjectAtIndex:0];
+    }
+    if (self.admissionTimes.count >= self.maximumPaymentsPerInterval) { return NO; }
+    
+    [self.admissionTimes addObject:@(now)];
+    return YES;
+}
+
+/** Removes a pending payment. Called under the lock.
+ */
+- (void)removePayment:(DYFStorePendingPayment *)payment forKey:(NSString *)key
+{
+    NSMutableArray<DYFStorePendingPayment *> *payments = self.pendingPayments[key];
+    [payments removeObjectIdenticalTo:payment];
+    if (payments.count == 0) {
+        [self.pendingPayments removeObjectForKey:key];
+    }
+}
+
+/** Removes the pending payments of a key that have expired. Called under the lock.
+ 
+ @return The expired payments, whose futures are to be rejected outside of the lock.
+ */
+- (NSArray<DYFStorePendingPayment *> *)removeExpiredPaymentsForKey:(NSString *)key at:(NSTimeInterval)now
+{
+    NSTimeInterval timeout = self.pendingPaymentTimeout;
+    NSMutableArray<DYFStorePendingPayment *> *payments = self.pendingPayments[key];
+    if (timeout <= 0 || payments.count == 0) { return nil; }
+    
+    NSIndexSet *indexes = [payments indexesOfObjectsPassingTest:^BOOL(DYFStorePendingPayment *payment, NSUInteger idx, BOOL *stop) {
+        return now - payment.admittedAt >= timeout;
+    }];
+    if (indexes.count == 0) { return nil; }
+    
+    NSArray *expired = [payments objectsAtIndexes:indexes];
+    [payments removeObjectsAtIndexes:indexes];
+    if (payments.count == 0) {
+        [self.pendingPayments removeObjectForKey:key];
+    }
+    return expired;
+}
+
+- (void)expirePayment:(DYFStorePendingPayment *)payment forKey:(NSString *)key
+{
+    if (!payment) { return; }
+    @synchronized (self) {
+        if (![self.pendingPayments[key] containsObject:payment]) { return; }
+        [self removePayment:payment forKey:key];
+    }
+    [self expirePayments:@[payment]];
+}
+
+- (void)expirePayments:(NSArray<DYFStorePendingPayment *> *)payments
+{
+    for (DYFStorePendingPayment *payment in payments) {
+        [payment.promise rejectWithError:DYFStorePaymentAdmissionError(DYFStoreErrorCodeTimedOut, @"The payment did not complete in time")];
+    }
+}
+
+- (BOOL)bindTransaction:(SKPaymentTransaction *)transaction
+{
+    if (!transaction) { return NO; }
+    
+    NSString *key = DYFStorePaymentAdmissionTransactionKey(transaction);
+    @synchronized (self) {
+        NSArray<DYFStorePendingPayment *> *payments = self.pendingPayments[key];
+        for (DYFStorePendingPayment *payment in payments) {
+            if (payment.transaction == transaction) { return YES; }
+        }
+        for (DYFStorePendingPayment *payment in payments) {
+            if (!payment.transaction) {
+                payment.transaction = transaction;
+                return YES;
+            }
+        }
+    }
+    return NO;
+}
+
+- (BOOL)completePaymentWithTransaction:(SKPaymentTransaction *)transaction info:(DYFStoreNotificationInfo *)info
+{
+    DYFStorePurchaseState state = info.state;
+    if (!transaction || (state != DYFStorePurchaseStateSucceeded && state != DYFStorePurchaseStateDeferred &&
+                         state != DYFStorePurchaseStateFailed && state != DYFStorePurchaseStateCancelled)) {
+        return NO;
+    }
+    
+    NSString *key = DYFStorePaymentAdmissionTransactionKey(transaction);
+    BOOL canBeUnbound = state != DYFStorePurchaseStateSucceeded;
+    DYFStorePendingPayment *completed = nil;
+    @synchronized (self) {
+        NSArray<DYFStorePendingPayment *> *payments = self.pendingPayments[key];
+        for (DYFStorePendingPayment *payment in payments) {
+            if (payment.transaction == transaction) {
+                completed = payment;
+                break;
+            }
+        }
+        // The payment queue can fail or defer a payment without reporting it as purchasing first.
+        if (!completed && canBeUnbound) {
+            for (DYFStorePendingPayment *payment in payments) {
+                if (!payment.transaction) {
+                    completed = payment;
+                    break;
+                }
+            }
+        }
+        if (!completed) { return NO; }
+        [self removePayment:completed forKey:key];
+    }
+    
+    if (state == DYFStorePurchaseStateSucceeded) {
+        [completed.promise fulfillWithResult:info];
+    } else if (state == DYFStorePurchaseStateDeferred) {
+        [completed.promise rejectWithError:DYFStorePaymentAdmissionError(DYFStoreErrorCodePaymentDeferred, @"The payment is waiting for approval")];
+    } else {
+        NSInteger code = state == DYFStorePurchaseStateCancelled ? SKErrorPaymentCancelled : SKErrorUnknown;
+        [completed.promise rejectWithError:info.error ?: [NSError errorWithDomain:SKErrorDomain code:code userInfo:nil]];
+    }
+    return YES;
+}
+
+- (void)removeAllPayments
+{
+    NSArray<NSArray<DYFStorePendingPayment *> *> *pending = nil;
+    @synchronized (self) {
+        pending = self.pendingPayments.allValues;
+        [self.pendingPayments removeAllObjects];
+    }
+    
+    for (NSArray<DYFStorePendingPayment *> *payments in pending) {
+        for (DYFStorePendingPayment *payment in payments) {
+            [payment.promise.future cancel];
+        }
+    }
+}
+
+@end
@@ -0,0 +1,95 @@
+//
+//  DYFStorePaymentBackend.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <StoreKit/StoreKit.h>
+
+/** Abstracts the StoreKit services the store depends on: the payment queue, the products request and the receipt refresh request.
+ */
+@protocol DYFStorePaymentBackend <NSObject>
+
+/** Whether the user is allowed to make payments.
+
+ @return NO if this device is not able or allowed to make payments.
+ */
+- (BOOL)canMakePayments;
+
+/** Adds an observer to the payment queue.
+
+ @param observer The observer to add to the queue.
+ */
+- (void)addTransactionObserver:(id<SKPaymentTransactionObserver>)observer;
+
+/** Removes an observer from the payment queue.
+
+ @param observer The observer to remove.
+ */
+- (void)removeTransactionObserver:(id<SKPaymentTransactionObserver>)observer;
+
+/** Adds a payment request to the queue.
+
+ @param payment A payment request.
+ */
+- (void)addPayment:(SKPayment *)payment;
+
+/** Asks the payment queue to restore previously completed purchases.
+
+ @param username An opaque identifier for the user’s account on your system. Can be `nil`.
+ */
+- (void)restoreCompletedTransactionsWithApplicationUsername:(NSString *)username;
+
+/** Completes a pending transaction.
+
+ @param transaction The transaction to finish.
+ */
+- (void)finishTransaction:(SKPaymentTransaction *)transaction;
+
+/** Adds a set of downloads to the download list.
+
+ @param downloads An array of `SKDownload` objects to begin downloading.
+ */
+- (void)startDownloads:(NSArray<SKDownload *> *)downloads;
+
+/** Creates a products request that has not been started yet.
+
+ @param productIdentifiers The set of product identifiers for the products you wish to retrieve information of.
+ @return A products request.
+ */
+- (SKProductsRequest *)productsRequestWithProductIdentifiers:(NSSet<NSString *> *)productIdentifiers;
+
+/** Creates a receipt refresh request that has not been started yet.
+
+ @param properties The properties of the receipt request.
+ @return A receipt refresh request.
+ */
+- (SKReceiptRefreshRequest *)receiptRefreshRequestWithReceiptProperties:(NSDictionary *)properties;
+
+@end
+
+/** The backend that forwards everything to `SKPaymentQueue.defaultQueue` and the StoreKit requests.
+ */
+@interface DYFStoreDefaultPaymentBackend : NSObject <DYFStorePaymentBackend>
+
+@end
@@ -0,0 +1,86 @@
+//
+//  DYFStorePaymentBackend.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStorePaymentBackend.h"
+
+@implementation DYFStoreDefaultPaymentBackend
+
+- (BOOL)canMakePayments
+{
+    return SKPaymentQueue.canMakePayments;
+}
+
+- (void)addTransactionObserver:(id<SKPaymentTransactionObserver>)observer
+{
+    [SKPaymentQueue.defaultQueue addTransactionObserver:observer];
+}
+
+- (void)removeTransactionObserver:(id<SKPaymentTransactionObserver>)observer
+{
+    [SKPaymentQueue.defaultQueue removeTransactionObserver:observer];
+}
+
+- (void)addPayment:(SKPayment *)payment
+{
+    [SKPaymentQueue.defaultQueue addPayment:payment];
+}
+
+- (void)restoreCompletedTransactionsWithApplicationUsername:(NSString *)username
+{
+    if (!username || username.length == 0) {
+        [SKPaymentQueue.defaultQueue restoreCompletedTransactions];
+        return;
+    }
+
+    NSAssert([SKPaymentQueue.defaultQueue respondsToSelector:@selector(restoreCompletedTransactionsWithApplicationUsername:)], @"restoreCompletedTransactionsWithApplicationUsername: not supported in this iOS version. Use restoreCompletedTransactions instead.");
+
+    if (@available(iOS 7.0, *)) {
+        [SKPaymentQueue.defaultQueue restoreCompletedTransactionsWithApplicationUsername:username];
+    } else {
+        [SKPaymentQueue.defaultQueue restoreCompletedTransactions];
+    }
+}
+
+- (void)finishTransaction:(SKPaymentTransaction *)transaction
+{
+    [SKPaymentQueue.defaultQueue finishTransaction:transaction];
+}
+
+- (void)startDownloads:(NSArray<SKDownload *> *)downloads
+{
+    [SKPaymentQueue.defaultQueue startDownloads:downloads];
+}
+
+- (SKProductsRequest *)productsRequestWithProductIdentifiers:(NSSet<NSString *> *)productIdentifiers
+{
+    return [[SKProductsRequest alloc] initWithProductIdentifiers:productIdentifiers];
+}
+
+- (SKReceiptRefreshRequest *)receiptRefreshRequestWithReceiptProperties:(NSDictionary *)properties
+{
+    return [[SKReceiptRefreshRequest alloc] initWithReceiptProperties:properties];
+}
+
+@end
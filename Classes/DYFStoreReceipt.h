@@ -0,0 +1,76 @@
+//
+//  DYFStoreReceipt.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import <Foundation/Foundation.h>
+#import "DYFStoreTransaction.h"
+
+/** The error domain of receipt decoding.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreReceiptErrorDomain;
+
+/** Uses enumeration to inicate the error code of receipt decoding.
+ */
+typedef NS_ENUM(NSInteger, DYFStoreReceiptErrorCode)
+{
+    /** Indicates that the data is not a PKCS #7 container or is truncated. */
+    DYFStoreReceiptErrorCodeMalformed = 1,
+    /** Indicates that the receipt belongs to another app. */
+    DYFStoreReceiptErrorCodeBundleMismatch = 2
+};
+
+/** An App Store receipt decoded from its PKCS #7 container, e.g. the contents of `NSBundle.appStoreReceiptURL`.
+ 
+ The decoder only depends on Foundation, so it runs on a server as well as in the app. It does not check the signature of the container; the receipt must still be verified with the App Store or with Apple's certificate.
+ */
+@interface DYFStoreReceipt : NSObject
+
+/** The bundle identifier of the app.
+ */
+@property (nonatomic, copy, readonly) NSString *bundleIdentifier;
+
+/** The version of the app.
+ */
+@property (nonatomic, copy, readonly) NSString *appVersion;
+
+/** The in-app purchase entries, with the keys and formats of the "in_app" entries of the response of the App Store: "product_id", "transaction_id", "original_transaction_id", "quantity", "purchase_date_ms", "original_purchase_date_ms" and, if present, "expires_date_ms", "cancellation_date_ms" and "web_order_line_item_id". They can be given to `DYFStoreEntitlements` and `DYFStoreSubscriptionTimeline`.
+ */
+@property (nonatomic, copy, readonly) NSArray<NSDictionary *> *inAppEntries;
+
+/** Decodes a receipt.
+ 
+ @param data The receipt data.
+ @param error If the receipt cannot be decoded, upon return contains an error in `DYFStoreReceiptErrorDomain`.
+ @return A `DYFStoreReceipt` object, or nil.
+ */
++ (instancetype)receiptWithData:(NSData *)data error:(NSError **)error;
+
+/** Maps the in-app purchase entries to purchased `DYFStoreTransaction` objects, whose timestamps are in seconds since 1970.
+ 
+ Since the signature is not checked, the transactions are what the receipt claims, not verified purchases.
+ 
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)transactions;
+
+@end
@@ -0,0 +1,348 @@
+//
+//  DYFStoreReceipt.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import "DYFStoreReceipt.h"
+
+NSString *const DYFStoreReceiptErrorDomain = @"DYFStoreReceiptErrorDomain";
+
+// The attribute types of the receipt payload and of its in-app purchase receipts.
+enum {
+    DYFStoreReceiptAttributeBundleIdentifier = 2,
+    DYFStoreReceiptAttributeAppVersion = 3,
+    DYFStoreReceiptAttributeInAppPurchase = 17,
+    DYFStoreReceiptAttributeQuantity = 1701,
+    DYFStoreReceiptAttributeProductIdentifier = 1702,
+    DYFStoreReceiptAttributeTransactionIdentifier = 1703,
+    DYFStoreReceiptAttributePurchaseDate = 1704,
+    DYFStoreReceiptAttributeOriginalTransactionIdentifier = 1705,
+    DYFStoreReceiptAttributeOriginalPurchaseDate = 1706,
+    DYFStoreReceiptAttributeExpiresDate = 1708,
+    DYFStoreReceiptAttributeWebOrderLineItemIdentifier = 1711,
+    DYFStoreReceiptAttributeCancellationDate = 1712
+};
+
+// The tags of the ASN.1 elements of a receipt.
+enum {
+    DYFStoreDERInteger = 0x02,
+    DYFStoreDEROctetString = 0x04,
+    DYFStoreDERObjectIdentifier = 0x06,
+    DYFStoreDERUTF8String = 0x0c,
+    DYFStoreDERPrintableString = 0x13,
+    DYFStoreDERIA5String = 0x16,
+    DYFStoreDERSequence = 0x30,
+    DYFStoreDERSet = 0x31,
+    DYFStoreDERContextZero = 0xa0
+};
+
+// How deep elements of indefinite length may be nested.
+static const int DYFStoreDERMaxDepth = 16;
+
+// The object identifiers of PKCS #7 signed data and data.
+static const uint8_t DYFStoreOIDSignedData[] = {0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x07, 0x02};
+static const uint8_t DYFStoreOIDData[] = {0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x07, 0x01};
+
+/** A range of encoded elements.
+ */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} DYFStoreDER;
+
+static BOOL DYFStoreDERNextAtDepth(DYFStoreDER *der, uint8_t *tag, DYFStoreDER *contents, int depth)
+{
+    if (depth > DYFStoreDERMaxDepth || der->end - der->p < 2) { return NO; }
+    
+    uint8_t t = *der->p++;
+    // High tag numbers do not occur in receipts.
+    if ((t & 0x1f) == 0x1f) { return NO; }
+    
+    uint8_t l = *der->p++;
+    if (l == 0x80) {
+        // An indefinite length, which the PKCS #7 container uses: the contents end with two zero octets.
+        if (!(t & 0x20)) { return NO; }
+        DYFStoreDER rest = {der->p, der->end};
+        while (rest.end - rest.p >= 2 && (rest.p[0] != 0 || rest.p[1] != 0)) {
+            uint8_t innerTag;
+            DYFStoreDER inner;
+            if (!DYFStoreDERNextAtDepth(&rest, &innerTag, &inner, depth + 1)) { return NO; }
+        }
+        if (rest.end - rest.p < 2) { return NO; }
+        contents->p = der->p;
+        contents->end = rest.p;
+        der->p = rest.p + 2;
+    } else {
+        size_t length = l;
+        if (l & 0x80) {
+            size_t count = l & 0x7f;
+            if (count > 4 || (size_t)(der->end - der->p) < count) { return NO; }
+            length = 0;
+            for (size_t idx = 0; idx < count; idx++) {
+                length = length << 8 | *der->p++;
+            }
+        }
+        if ((size_t)(der->end - der->p) < length) { return NO; }
+        contents->p = der->p;
+        contents->end = der->p + length;
+        der->p += length;
+    }
+    
+    *tag = t;
+    return YES;
+}
+
+/** Reads the next element, which must have a given tag.
+ */
+static BOOL DYFStoreDERExpect(DYFStoreDER *der, uint8_t tag, DYFStoreDER *contents)
+{
+    uint8_t t;
+    return DYFStoreDERNextAtDepth(der, &t, contents, 0) && t == tag;
+}
+
+static BOOL DYFStoreDERInteger64(DYFStoreDER contents, int64_t *value)
+{
+    size_t length = contents.end - contents.p;
+    if (length == 0 || length > 8) { return NO; }
+    
+    int64_t result = (int8_t)contents.p[0];
+    for (size_t idx = 1; idx < length; idx++) {
+        result = (int64_t)((uint64_t)result << 8 | contents.p[idx]);
+    }
+    *value = result;
+    return YES;
+}
+
+static BOOL DYFStoreDEREqualsOID(DYFStoreDER contents, const uint8_t *oid, size_t length)
+{
+    return (size_t)(contents.end - contents.p) == length && memcmp(contents.p, oid, length) == 0;
+}
+
+/** Reads the string encoded in the value of an attribute.
+ */
+static NSString *DYFStoreDERString(DYFStoreDER value)
+{
+    uint8_t tag;
+    DYFStoreDER contents;
+    if (!DYFStoreDERNextAtDepth(&value, &tag, &contents, 0)) { return nil; }
+    if (tag != DYFStoreDERUTF8String && tag != DYFStoreDERIA5String && tag != DYFStoreDERPrintableString) { return nil; }
+    
+    return [[NSString alloc] initWithBytes:contents.p length:contents.end - contents.p encoding:NSUTF8StringEncoding];
+}
+
+static BOOL DYFStoreReadDigits(const uint8_t **p, const uint8_t *end, int count, int *value)
+{
+    if (end - *p < count) { return NO; }
+    int result = 0;
+    for (int idx = 0; idx < count; idx++) {
+        uint8_t c = (*p)[idx];
+        if (c < '0' || c > '9') { return NO; }
+        result = result * 10 + (c - '0');
+    }
+    *p += count;
+    *value = result;
+    return YES;
+}
+
+/** Reads an RFC 3339 date in UTC, e.g. "2014-11-04T08:00:00Z", as milliseconds since 1970, without a date formatter, so that it is cheap and thread-safe.
+ */
+static BOOL DYFStoreDERDate(DYFStoreDER value, int64_t *milliseconds)
+{
+    uint8_t tag;
+    DYFStoreDER contents;
+    if (!DYFStoreDERNextAtDepth(&value, &tag, &contents, 0) || tag != DYFStoreDERIA5String) { return NO; }
+    
+    const uint8_t *p = contents.p;
+    int year, month, day, hour, minute, second;
+    if (!DYFStoreReadDigits(&p, contents.end, 4, &year) || p == contents.end || *p++ != '-' ||
+        !DYFStoreReadDigits(&p, contents.end, 2, &month) || p == contents.end || *p++ != '-' ||
+        !DYFStoreReadDigits(&p, contents.end, 2, &day) || p == contents.end || *p++ != 'T' ||
+        !DYFStoreReadDigits(&p, contents.end, 2, &hour) || p == contents.end || *p++ != ':' ||
+        !DYFStoreReadDigits(&p, contents.end, 2, &minute) || p == contents.end || *p++ != ':' ||
+        !DYFStoreReadDigits(&p, contents.end, 2, &second) ||
+        month < 1 || month > 12 || day < 1 || day > 31) {
+        return NO;
+    }
+    
+    // The days since 1970 of the civil date.
+    int y = month <= 2 ? year - 1 : year;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+    
+    *milliseconds = ((days * 24 + hour) * 60 + minute) * 60000LL + second * 1000LL;
+    return YES;
+}
+
+@interface DYFStoreReceipt ()
+@property (nonatomic, copy) NSString *bundleIdentifier;
+@property (nonatomic, copy) NSString *appVersion;
+@property (nonatomic, copy) NSArray<NSDictionary *> *inAppEntries;
+@end
+
+@implementation DYFStoreReceipt
+
+/** Reads the SET of attributes `SEQUENCE { type INTEGER, version INTEGER, value OCTET STRING }`.
+ */
+static BOOL DYFStoreEnumerateAttributes(DYFStoreDER set, void (^block)(int64_t type, DYFStoreDER value))
+{
+    while (set.p < set.end) {
+        DYFStoreDER attribute, type, version, value;
+        int64_t typeValue;
+        if (!DYFStoreDERExpect(&set, DYFStoreDERSequence, &attribute) ||
+            !DYFStoreDERExpect(&attribute, DYFStoreDERInteger, &type) ||
+            !DYFStoreDERExpect(&attribute, DYFStoreDERInteger, &version) ||
+            !DYFStoreDERExpect(&attribute, DYFStoreDEROctetString, &value) ||
+            !DYFStoreDERInteger64(type, &typeValue)) {
+            return NO;
+        }
+        block(typeValue, value);
+    }
+    return YES;
+}
+
+/** Decodes an in-app purchase receipt into an entry with the keys of the response of the App Store.
+ */
+static NSDictionary *DYFStoreInAppEntry(DYFStoreDER value)
+{
+    DYFStoreDER set;
+    if (!DYFStoreDERExpect(&value, DYFStoreDERSet, &set)) { return nil; }
+    
+    NSMutableDictionary *entry = [NSMutableDictionary dictionaryWithCapacity:8];
+    BOOL valid = DYFStoreEnumerateAttributes(set, ^(int64_t type, DYFStoreDER attributeValue) {
+        NSString *key = nil;
+        switch (type) {
+            case DYFStoreReceiptAttributeProductIdentifier: key = @"product_id"; break;
+            case DYFStoreReceiptAttributeTransactionIdentifier: key = @"transaction_id"; break;
+            case DYFStoreReceiptAttributeOriginalTransactionIdentifier: key = @"original_transaction_id"; break;
+            case DYFStoreReceiptAttributePurchaseDate: key = @"purchase_date_ms"; break;
+            case DYFStoreReceiptAttributeOriginalPurchaseDate: key = @"original_purchase_date_ms"; break;
+            case DYFStoreReceiptAttributeExpiresDate: key = @"expires_date_ms"; break;
+            case DYFStoreReceiptAttributeCancellationDate: key = @"cancellation_date_ms"; break;
+            case DYFStoreReceiptAttributeQuantity: key = @"quantity"; break;
+            case DYFStoreReceiptAttributeWebOrderLineItemIdentifier: key = @"web_order_line_item_id"; break;
+            default: return;
+        }
+        
+        if (type == DYFStoreReceiptAttributeQuantity || type == DYFStoreReceiptAttributeWebOrderLineItemIdentifier) {
+            DYFStoreDER integer;
+            int64_t number;
+            if (DYFStoreDERExpect(&attributeValue, DYFStoreDERInteger, &integer) && DYFStoreDERInteger64(integer, &number)) {
+                entry[key] = [NSString stringWithFormat:@"%lld", number];
+            }
+        } else if ([key hasSuffix:@"_ms"]) {
+            // The dates of a subscription that has not expired or been cancelled are empty.
+            int64_t milliseconds;
+            if (DYFStoreDERDate(attributeValue, &milliseconds)) {
+                entry[key] = [NSString stringWithFormat:@"%lld", milliseconds];
+            }
+        } else {
+            NSString *string = DYFStoreDERString(attributeValue);
+            !string ?: (entry[key] = string);
+        }
+    });
+    
+    return valid && entry[@"product_id"] && entry[@"transaction_id"] ? entry : nil;
+}
+
+static NSError *DYFStoreReceiptError(DYFStoreReceiptErrorCode code, NSString *message)
+{
+    return [NSError errorWithDomain:DYFStoreReceiptErrorDomain code:code userInfo:@{NSLocalizedDescriptionKey: message}];
+}
+
++ (instancetype)receiptWithData:(NSData *)data error:(NSError **)error
+{
+    // ContentInfo { contentType OID, [0] SignedData { version, digestAlgorithms, encapContentInfo { OID, [0] OCTET STRING payload }, ... } }
+    DYFStoreDER der = {data.bytes, (const uint8_t *)data.bytes + data.length};
+    DYFStoreDER contentInfo, oid, explicitSignedData, signedData, version, algorithms, encapsulated, dataOID, explicitContent, payload, attributes;
+    if (!DYFStoreDERExpect(&der, DYFStoreDERSequence, &contentInfo) ||
+        !DYFStoreDERExpect(&contentInfo, DYFStoreDERObjectIdentifier, &oid) ||
+        !DYFStoreDEREqualsOID(oid, DYFStoreOIDSignedData, sizeof(DYFStoreOIDSignedData)) ||
+        !DYFStoreDERExpect(&contentInfo, DYFStoreDERContextZero, &explicitSignedData) ||
+        !DYFStoreDERExpect(&explicitSignedData, DYFStoreDERSequence, &signedData) ||
+        !DYFStoreDERExpect(&signedData, DYFStoreDERInteger, &version) ||
+        !DYFStoreDERExpect(&signedData, DYFStoreDERSet, &algorithms) ||
+        !DYFStoreDERExpect(&signedData, DYFStoreDERSequence, &encapsulated) ||
+        !DYFStoreDERExpect(&encapsulated, DYFStoreDERObjectIdentifier, &dataOID) ||
+        !DYFStoreDEREqualsOID(dataOID, DYFStoreOIDData, sizeof(DYFStoreOIDData)) ||
+        !DYFStoreDERExpect(&encapsulated, DYFStoreDERContextZero, &explicitContent) ||
+        !DYFStoreDERExpect(&explicitContent, DYFStoreDEROctetString, &payload) ||
+        !DYFStoreDERExpect(&payload, DYFStoreDERSet, &attributes)) {
+        !error ?: (*error = DYFStoreReceiptError(DYFStoreReceiptErrorCodeMalformed, @"The receipt is not a PKCS #7 container."));
+        return nil;
+    }
+    
+    DYFStoreReceipt *receipt = [[self alloc] init];
+    NSMutableArray *entries = [NSMutableArray array];
+    __block BOOL valid = YES;
+    BOOL wellFormed = DYFStoreEnumerateAttributes(attributes, ^(int64_t type, DYFStoreDER value) {
+        switch (type) {
+            case DYFStoreReceiptAttributeBundleIdentifier:
+                receipt.bundleIdentifier = DYFStoreDERString(value);
+                break;
+            case DYFStoreReceiptAttributeAppVersion:
+                receipt.appVersion = DYFStoreDERString(value);
+                break;
+            case DYFStoreReceiptAttributeInAppPurchase: {
+                NSDictionary *entry = DYFStoreInAppEntry(value);
+                if (entry) {
+                    [entries addObject:entry];
+                } else {
+                    valid = NO;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    });
+    
+    if (!wellFormed || !valid) {
+        !error ?: (*error = DYFStoreReceiptError(DYFStoreReceiptErrorCodeMalformed, @"The receipt payload is truncated."));
+        return nil;
+    }
+    
+    receipt.inAppEntries = entries;
+    return receipt;
+}
+
+- (NSArray<DYFStoreTransaction *> *)transactions
+{
+    NSMutableArray *transactions = [NSMutableArray arrayWithCapacity:self.inAppEntries.count];
+    for (NSDictionary *entry in self.inAppEntries) {
+        DYFStoreTransaction *transaction = [[DYFStoreTransaction alloc] init];
+        transaction.state = DYFStoreTransactionStatePurchased;
+        transaction.productIdentifier = entry[@"product_id"];
+        transaction.transactionIdentifier = entry[@"transaction_id"];
+        transaction.originalTransactionIdentifier = entry[@"original_transaction_id"];
+        transaction.transactionTimestamp = [NSString stringWithFormat:@"%lld", [entry[@"purchase_date_ms"] longLongValue] / 1000];
+        if (entry[@"original_purchase_date_ms"]) {
+            transaction.originalTransactionTimestamp = [NSString stringWithFormat:@"%lld", [entry[@"original_purchase_date_ms"] longLongValue] / 1000];
+        }
+        [transactions addObject:transaction];
+    }
+    return transactions;
+}
+
+@end
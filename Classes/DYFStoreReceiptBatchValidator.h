@@ -0,0 +1,148 @@
+//
+//  DYFStoreReceiptBatchValidator.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import <Foundation/Foundation.h>
+#import "DYFStoreReceipt.h"
+
+/** The outcome of decoding one receipt of a batch.
+ 
+ The receipt is only decoded; its signature is not checked, see `signatureChecked`.
+ */
+@interface DYFStoreReceiptBatchRecord : NSObject
+
+/** The position of the receipt in the input.
+ */
+@property (nonatomic, assign, readonly) NSUInteger index;
+
+/** The digest of the base64 encoded receipt, computed by `DYFStoreDigestSHA256` like `+[DYFStoreVerificationCache digestOfReceipt:]` in the app.
+ */
+@property (nonatomic, copy, readonly) NSString *receiptDigest;
+
+/** The decoded receipt, nil if it could not be decoded.
+ */
+@property (nonatomic, strong, readonly) DYFStoreReceipt *receipt;
+
+/** The transactions of the receipt.
+ */
+@property (nonatomic, copy, readonly) NSArray<DYFStoreTransaction *> *transactions;
+
+/** The error if the receipt could not be decoded or belongs to another app.
+ */
+@property (nonatomic, strong, readonly) NSError *error;
+
+/** Whether the PKCS #7 signature of the receipt was checked. It is always NO: a forged receipt is decoded like a genuine one, so its transactions are claims, not verified purchases, until the receipt is verified with the App Store or with Apple's certificate.
+ */
+@property (nonatomic, assign, readonly) BOOL signatureChecked;
+
+@end
+
+/** The totals of a batch.
+ */
+@interface DYFStoreReceiptBatchSummary : NSObject
+
+/** The number of receipts read.
+ */
+@property (nonatomic, assign, readonly) NSUInteger receiptCount;
+
+/** The number of transactions of the decoded receipts.
+ */
+@property (nonatomic, assign, readonly) NSUInteger transactionCount;
+
+/** The number of receipts that failed.
+ */
+@property (nonatomic, assign, readonly) NSUInteger failureCount;
+
+/** The wall time of the batch, in seconds.
+ */
+@property (nonatomic, assign, readonly) NSTimeInterval duration;
+
+@end
+
+/** Receives the records of one chunk of receipts. It is called concurrently from the worker threads, and the chunks complete in no particular order.
+ */
+typedef void (^DYFStoreReceiptBatchHandler)(NSArray<DYFStoreReceiptBatchRecord *> *records);
+
+/** Decodes large batches of receipts outside of an app, e.g. on a server, and maps them to normalized transaction records.
+ 
+ @warning Despite its name, it does not validate the receipts: like `DYFStoreReceipt`, it does not check their PKCS #7 signature, so a forged receipt passes and its transactions are emitted. Every record and every JSON line says so with `signatureChecked` set to NO/false. Verify the receipts with the App Store or with Apple's certificate before granting anything from the records.
+ 
+ The input is cut into chunks that are decoded on the concurrent queues of libdispatch, which balances them over the cores. At most `concurrency` chunks are in flight, so a stream is read only as fast as it is decoded.
+ */
+@interface DYFStoreReceiptBatchValidator : NSObject
+
+/** The maximum number of chunks decoded at the same time. The default value is the number of active processors.
+ */
+@property (nonatomic, assign) NSUInteger concurrency;
+
+/** The number of receipts of a chunk. The default value is 64.
+ */
+@property (nonatomic, assign) NSUInteger chunkSize;
+
+/** When set, the receipts of other apps fail with `DYFStoreReceiptErrorCodeBundleMismatch`. The default is nil.
+ */
+@property (nonatomic, copy) NSString *bundleIdentifier;
+
+/** Decodes receipts.
+ 
+ @param receipts The receipt data.
+ @param handler The block that receives the records.
+ @return The totals of the batch.
+ */
+- (DYFStoreReceiptBatchSummary *)validateReceipts:(NSArray<NSData *> *)receipts handler:(DYFStoreReceiptBatchHandler)handler;
+
+/** Decodes newline-delimited base64 encoded receipts. Empty lines are skipped.
+ 
+ @param data The lines.
+ @param handler The block that receives the records.
+ @return The totals of the batch.
+ */
+- (DYFStoreReceiptBatchSummary *)validateLines:(NSData *)data handler:(DYFStoreReceiptBatchHandler)handler;
+
+/** Decodes a file of newline-delimited base64 encoded receipts. The file is mapped into memory rather than read.
+ 
+ @param path The path of the file.
+ @param handler The block that receives the records.
+ @param error If the file cannot be read, upon return contains an error.
+ @return The totals of the batch, or nil.
+ */
+- (DYFStoreReceiptBatchSummary *)validateLinesOfFileAtPath:(NSString *)path handler:(DYFStoreReceiptBatchHandler)handler error:(NSError **)error;
+
+/** Decodes receipt files, one receipt per file, e.g. copies of `NSBundle.appStoreReceiptURL`.
+ 
+ @param paths The paths of the files. A file that cannot be read fails.
+ @param handler The block that receives the records.
+ @return The totals of the batch.
+ */
+- (DYFStoreReceiptBatchSummary *)validateFilesAtPaths:(NSArray<NSString *> *)paths handler:(DYFStoreReceiptBatchHandler)handler;
+
+/** Decodes a file of newline-delimited base64 encoded receipts, and writes one JSON line per transaction to another file: the fields of `DYFStoreTransaction` plus "receiptIndex", "receiptDigest", "bundleIdentifier" and "signatureChecked", which is false. A receipt that fails gives a line with "receiptIndex", "receiptDigest", "signatureChecked" and "error".
+ 
+ @param inputPath The path of the receipts.
+ @param outputPath The path of the records. It is replaced.
+ @param error If a file cannot be read or written, upon return contains an error.
+ @return The totals of the batch, or nil.
+ */
+- (DYFStoreReceiptBatchSummary *)writeRecordsForLinesOfFileAtPath:(NSString *)inputPath toPath:(NSString *)outputPath error:(NSError **)error;
+
+@end
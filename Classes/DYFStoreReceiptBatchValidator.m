@@ -0,0 +1,283 @@
+//
+//  DYFStoreReceiptBatchValidator.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import "DYFStoreReceiptBatchValidator.h"
+#import "DYFStoreDigest.h"
+#import "DYFStoreJSONWriter.h"
+
+@interface DYFStoreReceiptBatchRecord ()
+@property (nonatomic, assign) NSUInteger index;
+@property (nonatomic, copy) NSString *receiptDigest;
+@property (nonatomic, strong) DYFStoreReceipt *receipt;
+@property (nonatomic, copy) NSArray<DYFStoreTransaction *> *transactions;
+@property (nonatomic, strong) NSError *error;
+@property (nonatomic, assign) BOOL signatureChecked;
+@end
+
+@implementation DYFStoreReceiptBatchRecord
+
+@end
+
+@interface DYFStoreReceiptBatchSummary ()
+@property (nonatomic, assign) NSUInteger receiptCount;
+@property (nonatomic, assign) NSUInteger transactionCount;
+@property (nonatomic, assign) NSUInteger failureCount;
+@property (nonatomic, assign) NSTimeInterval duration;
+@end
+
+@implementation DYFStoreReceiptBatchSummary
+
+@end
+
+@implementation DYFStoreReceiptBatchValidator
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _concurrency = NSProcessInfo.processInfo.activeProcessorCount;
+        _chunkSize = 64;
+    }
+    return self;
+}
+
+#pragma mark - Decoding
+
+/** Decodes one receipt, given either as data or as base64, on a worker thread.
+ */
+- (DYFStoreReceiptBatchRecord *)recordWithData:(NSData *)data base64:(NSString *)base64 index:(NSUInteger)index
+{
+    DYFStoreReceiptBatchRecord *record = [[DYFStoreReceiptBatchRecord alloc] init];
+    record.index = index;
+    
+    if (!base64) {
+        base64 = [data base64EncodedStringWithOptions:0];
+    } else if (!data) {
+        data = [[NSData alloc] initWithBase64EncodedString:base64 options:NSDataBase64DecodingIgnoreUnknownCharacters];
+    }
+    record.receiptDigest = base64.length > 0 ? DYFStoreDigestSHA256(base64) : nil;
+    
+    NSError *error = nil;
+    DYFStoreReceipt *receipt = [DYFStoreReceipt receiptWithData:data error:&error];
+    if (receipt && self.bundleIdentifier && ![receipt.bundleIdentifier isEqualToString:self.bundleIdentifier]) {
+        error = [NSError errorWithDomain:DYFStoreReceiptErrorDomain
+                                    code:DYFStoreReceiptErrorCodeBundleMismatch
+                                userInfo:@{NSLocalizedDescriptionKey: @"The receipt belongs to another app."}];
+        receipt = nil;
+    }
+    
+    record.receipt = receipt;
+    record.transactions = receipt ? receipt.transactions : @[];
+    record.error = error;
+    // `DYFStoreReceipt` does not check the signature.
+    record.signatureChecked = NO;
+    return record;
+}
+
+/** Decodes the chunks a producer hands out, with at most `concurrency` of them in flight.
+ 
+ @param nextChunk Called on the calling thread; returns the items of the next chunk, or an empty array at the end.
+ @param decode Called on the worker threads to decode an item.
+ @param handler Called on the worker threads with the records of a chunk.
+ @return The totals of the batch.
+ */
+- (DYFStoreReceiptBatchSummary *)runChunks:(NSArray *(^)(void))nextChunk
+                                    decode:(DYFStoreReceiptBatchRecord *(^)(id item, NSUInteger index))decode
+                                   handler:(DYFStoreReceiptBatchHandler)handler
+{
+    DYFStoreReceiptBatchSummary *summary = [[DYFStoreReceiptBatchSummary alloc] init];
+    NSTimeInterval start = NSProcessInfo.processInfo.systemUptime;
+    
+    dispatch_semaphore_t slots = dispatch_semaphore_create(MAX(self.concurrency, 1));
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    NSUInteger base = 0;
+    
+    for (;;) {
+        NSArray *chunk;
+        @autoreleasepool {
+            chunk = nextChunk();
+        }
+        if (chunk.count == 0) { break; }
+        
+        dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+        NSUInteger first = base;
+        base += chunk.count;
+        
+        dispatch_group_async(group, queue, ^{
+            @autoreleasepool {
+                NSMutableArray *records = [NSMutableArray arrayWithCapacity:chunk.count];
+                NSUInteger transactionCount = 0, failureCount = 0;
+                for (NSUInteger idx = 0; idx < chunk.count; idx++) {
+                    DYFStoreReceiptBatchRecord *record = decode(chunk[idx], first + idx);
+                    transactionCount += record.transactions.count;
+                    failureCount += record.error ? 1 : 0;
+                    [records addObject:record];
+                }
+                
+                !handler ?: handler(records);
+                
+                @synchronized (summary) {
+                    summary.receiptCount += chunk.count;
+                    summary.transactionCount += transactionCount;
+                    summary.failureCount += failureCount;
+                }
+            }
+            dispatch_semaphore_signal(slots);
+        });
+    }
+    
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    summary.duration = NSProcessInfo.processInfo.systemUptime - start;
+    return summary;
+}
+
+- (DYFStoreReceiptBatchSummary *)validateReceipts:(NSArray<NSData *> *)receipts handler:(DYFStoreReceiptBatchHandler)handler
+{
+    NSUInteger chunkSize = MAX(self.chunkSize, 1);
+    __block NSUInteger position = 0;
+    
+    return [self runChunks:^NSArray *{
+        NSRange range = NSMakeRange(position, MIN(chunkSize, receipts.count - position));
+        position += range.length;
+        return [receipts subarrayWithRange:range];
+    } decode:^DYFStoreReceiptBatchRecord *(NSData *item, NSUInteger index) {
+        return [self recordWithData:item base64:nil index:index];
+    } handler:handler];
+}
+
+- (DYFStoreReceiptBatchSummary *)validateLines:(NSData *)data handler:(DYFStoreReceiptBatchHandler)handler
+{
+    NSUInteger chunkSize = MAX(self.chunkSize, 1);
+    const char *bytes = data.bytes;
+    const char *end = bytes + data.length;
+    __block const char *p = bytes;
+    
+    // Only the line ranges are cut on the calling thread; the strings are made by the workers.
+    return [self runChunks:^NSArray *{
+        NSMutableArray *chunk = [NSMutableArray arrayWithCapacity:chunkSize];
+        while (p < end && chunk.count < chunkSize) {
+            const char *lineEnd = memchr(p, '\n', end - p) ?: end;
+            const char *last = lineEnd;
+            while (last > p && (last[-1] == '\r' || last[-1] == ' ')) { last--; }
+            if (last > p) {
+                [chunk addObject:[NSValue valueWithRange:NSMakeRange(p - bytes, last - p)]];
+            }
+            p = lineEnd + (lineEnd < end ? 1 : 0);
+        }
+        return chunk;
+    } decode:^DYFStoreReceiptBatchRecord *(NSValue *item, NSUInteger index) {
+        NSRange range = item.rangeValue;
+        NSString *base64 = [[NSString alloc] initWithBytes:bytes + range.location length:range.length encoding:NSASCIIStringEncoding];
+        return [self recordWithData:nil base64:base64 ?: @"" index:index];
+    } handler:handler];
+}
+
+- (DYFStoreReceiptBatchSummary *)validateLinesOfFileAtPath:(NSString *)path handler:(DYFStoreReceiptBatchHandler)handler error:(NSError **)error
+{
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:error];
+    if (!data) { return nil; }
+    
+    return [self validateLines:data handler:handler];
+}
+
+- (DYFStoreReceiptBatchSummary *)validateFilesAtPaths:(NSArray<NSString *> *)paths handler:(DYFStoreReceiptBatchHandler)handler
+{
+    NSUInteger chunkSize = MAX(self.chunkSize, 1);
+    __block NSUInteger position = 0;
+    
+    // The files are read by the workers, so reading overlaps with decoding.
+    return [self runChunks:^NSArray *{
+        NSRange range = NSMakeRange(position, MIN(chunkSize, paths.count - position));
+        position += range.length;
+        return [paths subarrayWithRange:range];
+    } decode:^DYFStoreReceiptBatchRecord *(NSString *item, NSUInteger index) {
+        NSError *error = nil;
+        NSData *data = [NSData dataWithContentsOfFile:item options:0 error:&error];
+        if (!data) {
+            DYFStoreReceiptBatchRecord *record = [[DYFStoreReceiptBatchRecord alloc] init];
+            record.index = index;
+            record.transactions = @[];
+            record.error = error;
+            return record;
+        }
+        return [self recordWithData:data base64:nil index:index];
+    } handler:handler];
+}
+
+#pragma mark - Records
+
+/** Encodes the records of a chunk as JSON lines.
+ */
++ (NSData *)JSONLinesWithRecords:(NSArray<DYFStoreReceiptBatchRecord *> *)records
+{
+    DYFStoreJSONWriter *writer = [[DYFStoreJSONWriter alloc] init];
+    
+    for (DYFStoreReceiptBatchRecord *record in records) {
+        if (record.error) {
+            NSMutableDictionary *line = [NSMutableDictionary dictionaryWithCapacity:4];
+            line[@"receiptIndex"] = @(record.index);
+            line[@"receiptDigest"] = record.receiptDigest;
+            line[@"signatureChecked"] = @(record.signatureChecked);
+            line[@"error"] = @(record.error.code);
+            [writer writeObject:line];
+            [writer.data appendBytes:"\n" length:1];
+            continue;
+        }
+        
+        for (DYFStoreTransaction *transaction in record.transactions) {
+            NSMutableDictionary *line = [transaction.dictionaryRepresentation mutableCopy];
+            line[@"receiptIndex"] = @(record.index);
+            line[@"receiptDigest"] = record.receiptDigest;
+            line[@"bundleIdentifier"] = record.receipt.bundleIdentifier;
+            line[@"signatureChecked"] = @(record.signatureChecked);
+            [writer writeObject:line];
+            [writer.data appendBytes:"\n" length:1];
+        }
+    }
+    
+    return writer.data;
+}
+
+- (DYFStoreReceiptBatchSummary *)writeRecordsForLinesOfFileAtPath:(NSString *)inputPath toPath:(NSString *)outputPath error:(NSError **)error
+{
+    if (![NSFileManager.defaultManager createFileAtPath:outputPath contents:nil attributes:nil]) {
+        !error ?: (*error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:@{NSFilePathErrorKey: outputPath ?: @""}]);
+        return nil;
+    }
+    NSFileHandle *output = [NSFileHandle fileHandleForWritingAtPath:outputPath];
+    
+    // Every chunk is encoded by its worker; only the append is serialized.
+    DYFStoreReceiptBatchSummary *summary = [self validateLinesOfFileAtPath:inputPath handler:^(NSArray<DYFStoreReceiptBatchRecord *> *records) {
+        NSData *lines = [DYFStoreReceiptBatchValidator JSONLinesWithRecords:records];
+        @synchronized (output) {
+            [output writeData:lines];
+        }
+    } error:error];
+    
+    [output closeFile];
+    return summary;
+}
+
+@end
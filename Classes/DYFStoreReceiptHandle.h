@@ -0,0 +1,71 @@
+//
+//  DYFStoreReceiptHandle.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import <Foundation/Foundation.h>
+
+/** A receipt that is read once and shared by every stage of a purchase.
+ 
+ The file is memory-mapped, so `data` is a view of the file rather than a copy. The base64 encoding and the digest are made on first use and kept. A handle whose encoding has been made is registered under it, so that a base64 receipt read back from a persister finds the mapped data instead of decoding it again.
+ */
+@interface DYFStoreReceiptHandle : NSObject
+
+/** The bytes of the receipt. Mapped from the file if the handle was created from one, or decoded once from base64.
+ */
+@property (nonatomic, strong, readonly) NSData *data;
+
+/** The base64 encoded receipt, made on first use.
+ */
+@property (nonatomic, copy, readonly) NSString *base64EncodedString;
+
+/** The digest of the receipt, the same as `+[DYFStoreVerificationCache digestOfReceipt:]` returns for `base64EncodedString`, made on first use.
+ 
+ It hashes the whole base64 encoding, which for a mapped receipt is made and hashed in small chunks rather than kept. Its first use still reads the whole file; after that it is free.
+ */
+@property (nonatomic, copy, readonly) NSString *digest;
+
+/** The length of the receipt in bytes.
+ */
+@property (nonatomic, assign, readonly) NSUInteger length;
+
+/** Returns the handle of the receipt at `receiptURL`. The same handle is returned while the size and the modification date of the file do not change.
+ 
+ @return A `DYFStoreReceiptHandle` object, or nil if there is no receipt.
+ */
++ (instancetype)appStoreReceipt;
+
+/** Maps a receipt file.
+ 
+ @param path The path of the file.
+ @return A `DYFStoreReceiptHandle` object, or nil if the file cannot be mapped or is empty.
+ */
++ (instancetype)handleWithContentsOfFile:(NSString *)path;
+
+/** Returns the handle of a base64 encoded receipt. A live handle with the same encoding is returned if there is one, otherwise a new handle that decodes the string on first use of `data`.
+ 
+ @param string The base64 encoded receipt.
+ @return A `DYFStoreReceiptHandle` object, or nil if the string is empty.
+ */
++ (instancetype)handleWithBase64EncodedString:(NSString *)string;
+
+@end
@@ -0,0 +1,160 @@
+//
+//  DYFStoreReceiptHandle.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import "DYFStoreReceiptHandle.h"
+#import "DYFStore.h"
+#import "DYFStoreDigest.h"
+
+@interface DYFStoreReceiptHandle ()
+@property (nonatomic, strong) NSData *mappedData;
+@property (nonatomic, copy) NSString *encodedString;
+@property (nonatomic, copy) NSString *digestString;
+@end
+
+@implementation DYFStoreReceiptHandle
+
+/** The live handles, keyed by their base64 encoding. The keys are hashed from a few of their characters, so a lookup costs one comparison of the strings. A key is the encoding the handle holds, not a copy, and is removed when its handle is deallocated.
+ */
++ (NSMapTable<NSString *, DYFStoreReceiptHandle *> *)registry
+{
+    static NSMapTable *registry;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        registry = [NSMapTable strongToWeakObjectsMapTable];
+    });
+    return registry;
+}
+
++ (void)registerHandle:(DYFStoreReceiptHandle *)handle forString:(NSString *)string
+{
+    NSMapTable *registry = [self registry];
+    @synchronized (registry) {
+        [registry setObject:handle forKey:string];
+    }
+}
+
++ (instancetype)appStoreReceipt
+{
+    static DYFStoreReceiptHandle *handle;
+    static NSDictionary *attributes;
+    
+    NSString *path = DYFStore.receiptURL.path;
+    NSDictionary *fileAttributes = path ? [NSFileManager.defaultManager attributesOfItemAtPath:path error:nil] : nil;
+    if (!fileAttributes) { return nil; }
+    
+    @synchronized (self) {
+        if (handle &&
+            [attributes[NSFileSize] isEqual:fileAttributes[NSFileSize]] &&
+            [attributes[NSFileModificationDate] isEqual:fileAttributes[NSFileModificationDate]]) {
+            return handle;
+        }
+        
+        handle = [self handleWithContentsOfFile:path];
+        attributes = fileAttributes;
+        return handle;
+    }
+}
+
++ (instancetype)handleWithContentsOfFile:(NSString *)path
+{
+    NSData *data = path ? [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:nil] : nil;
+    if (data.length == 0) { return nil; }
+    DYFStoreMetricsCount(DYFStoreCounterReceiptMaps);
+    
+    DYFStoreReceiptHandle *handle = [[self alloc] init];
+    handle.mappedData = data;
+    return handle;
+}
+
++ (instancetype)handleWithBase64EncodedString:(NSString *)string
+{
+    if (string.length == 0) { return nil; }
+    
+    NSMapTable *registry = [self registry];
+    @synchronized (registry) {
+        DYFStoreReceiptHandle *handle = [registry objectForKey:string];
+        if (handle) { return handle; }
+    }
+    
+    DYFStoreReceiptHandle *handle = [[self alloc] init];
+    handle.encodedString = string;
+    [self registerHandle:handle forString:string];
+    return handle;
+}
+
+- (NSData *)data
+{
+    @synchronized (self) {
+        if (!self.mappedData && self.encodedString) {
+            DYFStoreMetricsCount(DYFStoreCounterReceiptCopies);
+            self.mappedData = [[NSData alloc] initWithBase64EncodedString:self.encodedString options:NSDataBase64DecodingIgnoreUnknownCharacters];
+        }
+        return self.mappedData;
+    }
+}
+
+- (NSString *)base64EncodedString
+{
+    NSString *string = nil;
+    @synchronized (self) {
+        if (self.encodedString) { return self.encodedString; }
+        
+        DYFStoreMetricsCount(DYFStoreCounterReceiptCopies);
+        string = [self.mappedData base64EncodedStringWithOptions:kNilOptions];
+        self.encodedString = string;
+    }
+    [DYFStoreReceiptHandle registerHandle:self forString:string];
+    return string;
+}
+
+- (NSString *)digest
+{
+    @synchronized (self) {
+        if (!self.digestString) {
+            // A mapped receipt is hashed as it is encoded, so the encoding is not kept only for the digest.
+            self.digestString = self.encodedString ? DYFStoreDigestSHA256(self.encodedString) : DYFStoreDigestSHA256OfBase64EncodedData(self.mappedData);
+        }
+        return self.digestString;
+    }
+}
+
+- (NSUInteger)length
+{
+    return self.data.length;
+}
+
+- (void)dealloc
+{
+    if (!_encodedString) { return; }
+    
+    // The weak reference to this handle is already cleared, so an empty entry is ours, unless another handle has taken the key.
+    NSMapTable *registry = [DYFStoreReceiptHandle registry];
+    @synchronized (registry) {
+        if (![registry objectForKey:_encodedString]) {
+            [registry removeObjectForKey:_encodedString];
+        }
+    }
+}
+
+@end
@@ -0,0 +1,87 @@
+//
+//  DYFStoreRestoreSession.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <StoreKit/StoreKit.h>
+
+@class DYFStoreNotificationInfo;
+
+/** Accumulates the transactions of one restore, so that they can be stored, verified and finished together once the payment queue has sent all of them.
+ 
+ A purchase is restored once per session: of the transactions with the same original transaction, e.g. the renewals of a subscription, the one with the latest transaction date is kept, and the others are duplicates.
+ */
+@interface DYFStoreRestoreSession : NSObject
+
+/** Creates a restore session.
+ 
+ @param userIdentifier An opaque identifier for the user’s account on your system, or nil.
+ @return A `DYFStoreRestoreSession` object.
+ */
+- (instancetype)initWithUserIdentifier:(NSString *)userIdentifier NS_DESIGNATED_INITIALIZER;
+
+/** The identifier of the user whose transactions are restored, or nil for all of them.
+ */
+@property (nonatomic, copy, readonly) NSString *userIdentifier;
+
+/** The restored transactions, one per original purchase, in the order they were kept.
+ */
+@property (nonatomic, copy, readonly) NSArray<SKPaymentTransaction *> *transactions;
+
+/** The notification infos of the restored transactions that have finished, one per original purchase, in the order they finished.
+ */
+@property (nonatomic, copy, readonly) NSArray<DYFStoreNotificationInfo *> *infos;
+
+/** The number of restored transactions that were duplicates, including the ones superseded by a later renewal.
+ */
+@property (nonatomic, assign, readonly) NSUInteger duplicateCount;
+
+/** Whether the payment queue has sent all the restored transactions.
+ */
+@property (nonatomic, assign, readonly, getter=isFinished) BOOL finished;
+
+/** The error if restoring the transactions failed.
+ */
+@property (nonatomic, strong, readonly) NSError *error;
+
+/** Adds a restored transaction, unless a transaction of the same original purchase with a later date was added.
+ 
+ @param transaction A restored `SKPaymentTransaction` object.
+ @return The transaction that became a duplicate: the given one if it was not added, the one it replaced, or nil.
+ */
+- (SKPaymentTransaction *)addTransaction:(SKPaymentTransaction *)transaction;
+
+/** Adds the notification info of a restored transaction that has finished.
+ 
+ @param info A `DYFStoreNotificationInfo` object.
+ */
+- (void)addInfo:(DYFStoreNotificationInfo *)info;
+
+/** Marks the session finished.
+ 
+ @param error The error if restoring the transactions failed, or nil.
+ */
+- (void)finishWithError:(NSError *)error;
+
+@end
@@ -0,0 +1,110 @@
+//
+//  DYFStoreRestoreSession.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreRestoreSession.h"
+#import "DYFStore.h"
+
+@interface DYFStoreRestoreSession ()
+@property (nonatomic, copy) NSString *userIdentifier;
+@property (nonatomic, strong) NSMutableArray<SKPaymentTransaction *> *restoredTransactions;
+@property (nonatomic, strong) NSMutableArray<DYFStoreNotificationInfo *> *restoredInfos;
+/** The kept transactions by the identifier of their original transaction. */
+@property (nonatomic, strong) NSMutableDictionary<NSString *, SKPaymentTransaction *> *originalTransactions;
+@property (nonatomic, assign) NSUInteger duplicateCount;
+@property (nonatomic, assign) BOOL finished;
+@property (nonatomic, strong) NSError *error;
+@end
+
+@implementation DYFStoreRestoreSession
+
+- (instancetype)init
+{
+    return [self initWithUserIdentifier:nil];
+}
+
+- (instancetype)initWithUserIdentifier:(NSString *)userIdentifier
+{
+    self = [super init];
+    if (self) {
+        _userIdentifier = [userIdentifier copy];
+        _restoredTransactions = [NSMutableArray array];
+        _restoredInfos = [NSMutableArray array];
+        _originalTransactions = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSArray<SKPaymentTransaction *> *)transactions
+{
+    return [self.restoredTransactions copy];
+}
+
+- (NSArray<DYFStoreNotificationInfo *> *)infos
+{
+    return [self.restoredInfos copy];
+}
+
+- (SKPaymentTransaction *)addTransaction:(SKPaymentTransaction *)transaction
+{
+    // A transaction without an original transaction is its own original purchase.
+    NSString *identifier = transaction.originalTransaction.transactionIdentifier ?: transaction.transactionIdentifier;
+    SKPaymentTransaction *kept = identifier ? self.originalTransactions[identifier] : nil;
+    if (kept) {
+        self.duplicateCount++;
+        // Every renewal of a subscription shares the original transaction, and the latest one tells the current period.
+        NSDate *date = transaction.transactionDate;
+        if (!date || (kept.transactionDate && [date compare:kept.transactionDate] != NSOrderedDescending)) {
+            return transaction;
+        }
+        [self.restoredTransactions removeObjectIdenticalTo:kept];
+        NSString *keptIdentifier = kept.transactionIdentifier;
+        if (keptIdentifier) {
+            NSIndexSet *indexes = [self.restoredInfos indexesOfObjectsPassingTest:^BOOL(DYFStoreNotificationInfo *info, NSUInteger idx, BOOL *stop) {
+                return [info.transactionIdentifier isEqualToString:keptIdentifier];
+            }];
+            [self.restoredInfos removeObjectsAtIndexes:indexes];
+        }
+    }
+    
+    if (identifier) {
+        self.originalTransactions[identifier] = transaction;
+    }
+    [self.restoredTransactions addObject:transaction];
+    return kept;
+}
+
+- (void)addInfo:(DYFStoreNotificationInfo *)info
+{
+    if (!info) { return; }
+    [self.restoredInfos addObject:info];
+}
+
+- (void)finishWithError:(NSError *)error
+{
+    self.finished = YES;
+    self.error = error;
+}
+
+@end
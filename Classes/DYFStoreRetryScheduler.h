@@ -0,0 +1,144 @@
+//
+//  DYFStoreRetryScheduler.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "DYFStoreClock.h"
+#import "DYFStoreVerificationCoordinator.h"
+
+@class DYFStoreRetryScheduler;
+
+/** The key of the persisted attempt state in the standard user defaults, next to the transactions of `DYFStoreUserDefaultsPersistence`.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreRetryStateKey;
+
+/** The delegate of a retry scheduler. Its methods are called on the main queue.
+ */
+@protocol DYFStoreRetrySchedulerDelegate <NSObject>
+
+@optional
+
+/** Tells the delegate that a scheduled receipt refresh has succeeded.
+ 
+ @param scheduler The retry scheduler.
+ */
+- (void)retrySchedulerDidRefreshReceipt:(DYFStoreRetryScheduler *)scheduler;
+
+/** Tells the delegate that transactions have used up their attempts. They are only retried by `retryNow`, once per call.
+ 
+ @param scheduler The retry scheduler.
+ @param transactionIdentifiers The identifiers of the transactions.
+ */
+- (void)retryScheduler:(DYFStoreRetryScheduler *)scheduler didGiveUpOnTransactions:(NSArray<NSString *> *)transactionIdentifiers;
+
+@end
+
+/** Retries the verification of unresolved transactions and failed receipt refreshes in the background, with exponential backoff and jitter.
+ 
+ The attempt state of every transaction is persisted, so the retries resume after a relaunch, see `resume`. Each pass verifies at most `maxTransactionsPerPass` due transactions, the coordinator bounds the requests in flight.
+ */
+@interface DYFStoreRetryScheduler : NSObject <DYFStoreVerificationScheduling>
+
+/** The coordinator that verifies the transactions. The scheduler becomes its scheduler.
+ */
+@property (nonatomic, strong, readonly) DYFStoreVerificationCoordinator *coordinator;
+
+/** The clock that times the retries.
+ */
+@property (nonatomic, strong, readonly) id<DYFStoreClock> clock;
+
+/** The store whose receipt is refreshed. The default is `DYFStore.defaultStore`.
+ */
+@property (nonatomic, weak) DYFStore *store;
+
+/** The delay before the first retry. The default value is 2 seconds.
+ */
+@property (nonatomic, assign) NSTimeInterval baseDelay;
+
+/** The upper bound of the delay, which doubles with every attempt. The default value is 1 hour.
+ */
+@property (nonatomic, assign) NSTimeInterval maxDelay;
+
+/** The fraction of the delay that is randomized, from 0 to 1, so that retries of many devices do not line up. The default value is 0.5.
+ */
+@property (nonatomic, assign) double jitter;
+
+/** The number of attempts after which a transaction is no longer retried automatically. The default value is 12.
+ */
+@property (nonatomic, assign) NSUInteger maxAttempts;
+
+/** The maximum number of transactions verified in one pass. The default value is 32.
+ */
+@property (nonatomic, assign) NSUInteger maxTransactionsPerPass;
+
+/** The delegate of the scheduler.
+ */
+@property (nonatomic, weak) id<DYFStoreRetrySchedulerDelegate> delegate;
+
+/** Creates a scheduler.
+ 
+ @param coordinator The coordinator that verifies the transactions.
+ @param clock The clock that times the retries, e.g. a `DYFStoreSystemClock` object.
+ @return A `DYFStoreRetryScheduler` object.
+ */
+- (instancetype)initWithCoordinator:(DYFStoreVerificationCoordinator *)coordinator clock:(id<DYFStoreClock>)clock;
+
+/** Loads the persisted attempt state and schedules the next retry. Call it once after launch.
+ */
+- (void)resume;
+
+/** Makes all pending transactions, the ones that have used up their attempts, and a pending receipt refresh due, and starts a pass now.
+ */
+- (void)retryNow;
+
+/** Tells the scheduler that the network has become reachable. Drains the pending work immediately if there is any. The transactions that have used up their attempts are not retried.
+ */
+- (void)networkDidBecomeReachable;
+
+/** Refreshes the receipt, and keeps retrying with backoff until it succeeds. Transactions that were not listed in their receipt get the new one.
+ */
+- (void)scheduleReceiptRefresh;
+
+/** Returns the delay before an attempt, without jitter.
+ 
+ @param attempt The number of the attempt, starting with 1.
+ @return The delay in seconds.
+ */
+- (NSTimeInterval)delayForAttempt:(NSUInteger)attempt;
+
+/** Returns the number of failed attempts of a transaction.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ @return The number of failed attempts.
+ */
+- (NSUInteger)attemptCountForTransaction:(NSString *)transactionIdentifier;
+
+/** Returns the time of the next attempt of a transaction.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ @return The time in seconds since 1970, 0 if it is due now, or `DBL_MAX` if it is not retried automatically.
+ */
+- (NSTimeInterval)nextAttemptTimeForTransaction:(NSString *)transactionIdentifier;
+
+@end
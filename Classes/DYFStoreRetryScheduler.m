@@ -0,0 +1,535 @@
+//
+//  DYFStoreRetryScheduler.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreRetryScheduler.h"
+#import "DYFStore.h"
+
+NSString *const DYFStoreRetryStateKey = @"DYFStoreRetryState";
+
+// The keys of the attempt state of a transaction or of the receipt refresh.
+static NSString *const DYFStoreRetryAttemptsKey = @"attempts";
+static NSString *const DYFStoreRetryNextKey     = @"next";
+// Marks a transaction that was not listed in its receipt, and gets the refreshed one.
+static NSString *const DYFStoreRetryStaleKey    = @"stale";
+
+// The time after which a receipt refresh that has not called back counts as failed.
+static const NSTimeInterval DYFStoreRetryRefreshTimeout = 60;
+
+@interface DYFStoreRetryScheduler ()
+@property (nonatomic, strong) DYFStoreVerificationCoordinator *coordinator;
+@property (nonatomic, strong) id<DYFStoreClock> clock;
+@property (nonatomic, strong) dispatch_queue_t queue;
+
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableDictionary *> *states;
+// The attempt counts of the transactions that have used up their attempts, which are retried by `retryNow` only.
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *exhaustedAttempts;
+@property (nonatomic, assign) BOOL refreshPending;
+@property (nonatomic, assign) NSUInteger refreshAttempts;
+@property (nonatomic, assign) NSTimeInterval refreshNext;
+@property (nonatomic, assign) NSUInteger refreshToken;
+@property (nonatomic, assign) BOOL refreshing;
+
+// Set by `retryNow`, makes the next pass ignore the backoff.
+@property (nonatomic, assign) BOOL forceAll;
+// Set by `retryNow`, makes the next pass retry the exhausted transactions too.
+@property (nonatomic, assign) BOOL forceExhausted;
+// Whether the last pass left due transactions behind because of `maxTransactionsPerPass`.
+@property (nonatomic, assign) BOOL backlog;
+
+@property (nonatomic, assign) NSTimeInterval wakeTime;
+@property (nonatomic, assign) NSUInteger generation;
+@end
+
+@implementation DYFStoreRetryScheduler
+
+- (instancetype)initWithCoordinator:(DYFStoreVerificationCoordinator *)coordinator clock:(id<DYFStoreClock>)clock
+{
+    self = [super init];
+    if (self) {
+        _coordinator = coordinator;
+        _clock = clock ?: [[DYFStoreSystemClock alloc] init];
+        _store = DYFStore.defaultStore;
+        _baseDelay = 2;
+        _maxDelay = 3600;
+        _jitter = 0.5;
+        _maxAttempts = 12;
+        _maxTransactionsPerPass = 32;
+        _queue = dispatch_queue_create("com.dyfstore.retry", DISPATCH_QUEUE_SERIAL);
+        _states = [NSMutableDictionary dictionary];
+        _exhaustedAttempts = [NSMutableDictionary dictionary];
+        coordinator.scheduler = self;
+    }
+    return self;
+}
+
+#pragma mark - Persistence
+
+- (void)loadState
+{
+    NSDictionary *state = [NSUserDefaults.standardUserDefaults dictionaryForKey:DYFStoreRetryStateKey];
+    
+    NSDictionary *transactions = state[@"transactions"];
+    if ([transactions isKindOfClass:NSDictionary.class]) {
+        [transactions enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSDictionary *obj, BOOL *stop) {
+            if ([obj isKindOfClass:NSDictionary.class]) {
+                self.states[key] = [obj mutableCopy];
+            }
+        }];
+    }
+    
+    NSDictionary *exhausted = state[@"exhausted"];
+    if ([exhausted isKindOfClass:NSDictionary.class]) {
+        [exhausted enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSNumber *obj, BOOL *stop) {
+            if ([obj isKindOfClass:NSNumber.class]) {
+                self.exhaustedAttempts[key] = obj;
+            }
+        }];
+    }
+    
+    NSDictionary *refresh = state[@"refresh"];
+    if ([refresh isKindOfClass:NSDictionary.class]) {
+        self.refreshPending = YES;
+        self.refreshAttempts = [refresh[DYFStoreRetryAttemptsKey] unsignedIntegerValue];
+        self.refreshNext = [refresh[DYFStoreRetryNextKey] doubleValue];
+    }
+}
+
+/** Writes the attempt state. Must be called within `@synchronized (self)`.
+ */
+- (void)saveState
+{
+    NSMutableDictionary *state = [NSMutableDictionary dictionaryWithCapacity:3];
+    state[@"transactions"] = self.states;
+    state[@"exhausted"] = self.exhaustedAttempts;
+    if (self.refreshPending) {
+        state[@"refresh"] = @{DYFStoreRetryAttemptsKey: @(self.refreshAttempts),
+                              DYFStoreRetryNextKey: @(self.refreshNext)};
+    }
+    [NSUserDefaults.standardUserDefaults setObject:state forKey:DYFStoreRetryStateKey];
+}
+
+#pragma mark - Backoff
+
+- (NSTimeInterval)delayForAttempt:(NSUInteger)attempt
+{
+    if (attempt == 0) { return 0; }
+    return MIN(ldexp(self.baseDelay, (int)MIN(attempt - 1, 62)), self.maxDelay);
+}
+
+- (NSTimeInterval)jitteredDelayForAttempt:(NSUInteger)attempt
+{
+    double random = arc4random_uniform(1 << 24) / (double)(1 << 24);
+    double jitter = MAX(MIN(self.jitter, 1), 0);
+    return [self delayForAttempt:attempt] * (1 - jitter * random);
+}
+
+- (NSUInteger)attemptCountForTransaction:(NSString *)transactionIdentifier
+{
+    @synchronized (self) {
+        NSString *identifier = transactionIdentifier ?: @"";
+        return [(self.exhaustedAttempts[identifier] ?: self.states[identifier][DYFStoreRetryAttemptsKey]) unsignedIntegerValue];
+    }
+}
+
+- (NSTimeInterval)nextAttemptTimeForTransaction:(NSString *)transactionIdentifier
+{
+    @synchronized (self) {
+        NSString *identifier = transactionIdentifier ?: @"";
+        if (self.exhaustedAttempts[identifier]) { return DBL_MAX; }
+        return [self.states[identifier][DYFStoreRetryNextKey] doubleValue];
+    }
+}
+
+#pragma mark - Waking up
+
+/** Schedules a wake-up at a time, unless one is scheduled earlier.
+ */
+- (void)scheduleWakeUpAt:(NSTimeInterval)time
+{
+    NSUInteger generation;
+    NSTimeInterval delay;
+    
+    @synchronized (self) {
+        if (self.wakeTime > 0 && self.wakeTime <= time) { return; }
+        self.wakeTime = time;
+        generation = ++self.generation;
+        delay = time - self.clock.now;
+    }
+    
+    __weak typeof(self) weakSelf = self;
+    [self.clock performAfterDelay:delay onQueue:self.queue block:^{
+        [weakSelf wakeUp:generation];
+    }];
+}
+
+/** Schedules a wake-up at the earliest attempt that is due automatically.
+ */
+- (void)scheduleNextWakeUp
+{
+    NSTimeInterval earliest = DBL_MAX;
+    
+    @synchronized (self) {
+        for (NSDictionary *state in self.states.allValues) {
+            earliest = MIN(earliest, [state[DYFStoreRetryNextKey] doubleValue]);
+        }
+        if (self.refreshPending && !self.refreshing) {
+            earliest = MIN(earliest, self.refreshNext);
+        }
+    }
+    
+    if (earliest < DBL_MAX) {
+        [self scheduleWakeUpAt:earliest];
+    }
+}
+
+- (void)wakeUp:(NSUInteger)generation
+{
+    BOOL refresh = NO;
+    BOOL verify = NO;
+    
+    @synchronized (self) {
+        // A later wake-up has replaced this one.
+        if (generation != self.generation) { return; }
+        self.wakeTime = 0;
+        
+        NSTimeInterval now = self.clock.now;
+        if (self.refreshPending && !self.refreshing && self.refreshNext <= now) {
+            self.refreshing = YES;
+            refresh = YES;
+        }
+        
+        verify = self.backlog;
+        for (NSDictionary *state in self.states.allValues) {
+            if ([state[DYFStoreRetryNextKey] doubleValue] <= now) {
+                verify = YES;
+                break;
+            }
+        }
+    }
+    
+    if (refresh) {
+        [self performReceiptRefresh];
+    }
+    
+    if (verify) {
+        [self.coordinator setNeedsVerification];
+    } else {
+        [self scheduleNextWakeUp];
+    }
+}
+
+#pragma mark - Public
+
+- (void)resume
+{
+    dispatch_async(self.queue, ^{
+        @synchronized (self) {
+            [self loadState];
+        }
+        
+        // Transactions stored before the relaunch that have never been attempted are due now. Only the headers are read, the records are decoded when a pass verifies them.
+        BOOL due = NO;
+        NSTimeInterval now = self.clock.now;
+        DYFStoreWarmUp *warmUp = DYFStore.defaultStore.warmUp;
+        id<DYFStoreTransactionPersistence> persister = self.coordinator.persister;
+        NSArray<DYFStoreTransactionHeader *> *headers = warmUp ? [warmUp transactionHeadersOfPersister:persister] : [persister retrieveTransactionHeaders];
+        for (DYFStoreTransactionHeader *header in headers) {
+            NSTimeInterval next = [self nextAttemptTimeForTransaction:header.transactionIdentifier];
+            if (next <= now) {
+                due = YES;
+                break;
+            }
+        }
+        
+        if (due) {
+            [self.coordinator setNeedsVerification];
+        }
+        [self scheduleNextWakeUp];
+    });
+}
+
+- (void)retryNow
+{
+    @synchronized (self) {
+        self.forceExhausted = YES;
+    }
+    [self retryPendingNow];
+}
+
+/** Makes the pending transactions and a pending receipt refresh due, and starts a pass now.
+ */
+- (void)retryPendingNow
+{
+    BOOL refresh = NO;
+    
+    @synchronized (self) {
+        self.forceAll = YES;
+        if (self.refreshPending && !self.refreshing) {
+            self.refreshing = YES;
+            refresh = YES;
+        }
+    }
+    
+    if (refresh) {
+        [self performReceiptRefresh];
+    }
+    [self.coordinator setNeedsVerification];
+}
+
+- (void)networkDidBecomeReachable
+{
+    BOOL pending;
+    @synchronized (self) {
+        pending = self.states.count > 0 || self.refreshPending;
+    }
+    
+    // The transactions that have used up their attempts are not among the pending ones.
+    if (pending) {
+        DYFStoreLog(@"network reachable, draining the pending retries");
+        [self retryPendingNow];
+    }
+}
+
+- (void)scheduleReceiptRefresh
+{
+    @synchronized (self) {
+        if (self.refreshPending) { return; }
+        self.refreshPending = YES;
+        self.refreshAttempts = 0;
+        self.refreshNext = self.clock.now;
+        [self saveState];
+    }
+    
+    [self scheduleWakeUpAt:self.clock.now];
+}
+
+#pragma mark - Receipt refresh
+
+- (void)performReceiptRefresh
+{
+    NSUInteger token;
+    @synchronized (self) {
+        token = ++self.refreshToken;
+    }
+    
+    // The store ignores a refresh while another one is running, so a missing callback counts as a failure.
+    __weak typeof(self) weakSelf = self;
+    [self.clock performAfterDelay:DYFStoreRetryRefreshTimeout onQueue:self.queue block:^{
+        [weakSelf receiptRefreshDidFail:nil token:token];
+    }];
+    
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self.store refreshReceiptOnSuccess:^{
+            [self receiptRefreshDidSucceedWithToken:token];
+        } failure:^(NSError *error) {
+            [self receiptRefreshDidFail:error token:token];
+        }];
+    });
+}
+
+- (void)receiptRefreshDidSucceedWithToken:(NSUInteger)token
+{
+    @synchronized (self) {
+        if (token != self.refreshToken || !self.refreshing) { return; }
+        self.refreshing = NO;
+        self.refreshPending = NO;
+        self.refreshAttempts = 0;
+        [self saveState];
+    }
+    
+    dispatch_async(self.queue, ^{
+        [self updateStaleTransactions];
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            id<DYFStoreRetrySchedulerDelegate> delegate = self.delegate;
+            if ([delegate respondsToSelector:@selector(retrySchedulerDidRefreshReceipt:)]) {
+                [delegate retrySchedulerDidRefreshReceipt:self];
+            }
+        });
+        
+        [self retryPendingNow];
+    });
+}
+
+- (void)receiptRefreshDidFail:(NSError *)error token:(NSUInteger)token
+{
+    @synchronized (self) {
+        if (token != self.refreshToken || !self.refreshing) { return; }
+        self.refreshing = NO;
+        self.refreshAttempts++;
+        self.refreshNext = self.clock.now + [self jitteredDelayForAttempt:self.refreshAttempts];
+        [self saveState];
+    }
+    
+    DYFStoreLog(@"receipt refresh attempt %zi failed: %@", self.refreshAttempts, error);
+    [self scheduleNextWakeUp];
+}
+
+/** Gives the refreshed receipt to the transactions that were not listed in their own.
+ */
+- (void)updateStaleTransactions
+{
+    DYFStoreWarmUp *warmUp = DYFStore.defaultStore.warmUp;
+    NSString *receipt = (warmUp ? warmUp.receipt : DYFStoreReceiptHandle.appStoreReceipt).base64EncodedString;
+    if (receipt.length == 0) { return; }
+    
+    NSMutableArray<NSString *> *identifiers = [NSMutableArray array];
+    @synchronized (self) {
+        [self.states enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSMutableDictionary *state, BOOL *stop) {
+            if ([state[DYFStoreRetryStaleKey] boolValue]) {
+                [state removeObjectForKey:DYFStoreRetryStaleKey];
+                [identifiers addObject:key];
+            }
+        }];
+        [self saveState];
+    }
+    if (identifiers.count == 0) { return; }
+    
+    NSArray<DYFStoreTransaction *> *stale = [self.coordinator.persister retrieveTransactionsWithIdentifiers:identifiers];
+    for (DYFStoreTransaction *transaction in stale) {
+        transaction.transactionReceipt = receipt;
+    }
+    
+    [self.coordinator.persister removeTransactionsWithIdentifiers:[stale valueForKey:@"transactionIdentifier"]];
+    for (DYFStoreTransaction *transaction in stale) {
+        [self.coordinator.persister storeTransaction:transaction];
+    }
+}
+
+#pragma mark - DYFStoreVerificationScheduling
+
+- (NSArray<DYFStoreTransactionHeader *> *)verificationCoordinator:(DYFStoreVerificationCoordinator *)coordinator transactionsToVerify:(NSArray<DYFStoreTransactionHeader *> *)headers
+{
+    NSMutableArray<DYFStoreTransactionHeader *> *due = [NSMutableArray arrayWithCapacity:headers.count];
+    
+    @synchronized (self) {
+        NSTimeInterval now = self.clock.now;
+        BOOL force = self.forceAll;
+        BOOL forceExhausted = self.forceExhausted;
+        self.forceAll = NO;
+        self.forceExhausted = NO;
+        
+        NSMutableSet<NSString *> *identifiers = [NSMutableSet setWithCapacity:headers.count];
+        for (DYFStoreTransactionHeader *header in headers) {
+            NSString *identifier = header.transactionIdentifier ?: @"";
+            [identifiers addObject:identifier];
+            
+            if (self.exhaustedAttempts[identifier]) {
+                !forceExhausted ?: [due addObject:header];
+                continue;
+            }
+            NSDictionary *state = self.states[identifier];
+            if (force || !state || [state[DYFStoreRetryNextKey] doubleValue] <= now) {
+                [due addObject:header];
+            }
+        }
+        
+        // Forgets the transactions that have been removed by other means.
+        NSPredicate *removed = [NSPredicate predicateWithBlock:^BOOL(NSString *key, NSDictionary *bindings) {
+            return ![identifiers containsObject:key];
+        }];
+        NSArray *gone = [self.states.allKeys filteredArrayUsingPredicate:removed];
+        NSArray *goneExhausted = [self.exhaustedAttempts.allKeys filteredArrayUsingPredicate:removed];
+        if (gone.count > 0 || goneExhausted.count > 0) {
+            [self.states removeObjectsForKeys:gone];
+            [self.exhaustedAttempts removeObjectsForKeys:goneExhausted];
+            [self saveState];
+        }
+        
+        NSUInteger limit = MAX(self.maxTransactionsPerPass, 1);
+        self.backlog = due.count > limit;
+        if (self.backlog) {
+            [due removeObjectsInRange:NSMakeRange(limit, due.count - limit)];
+        }
+    }
+    
+    return due;
+}
+
+- (void)verificationCoordinator:(DYFStoreVerificationCoordinator *)coordinator didSettleWithResult:(DYFStoreVerificationResult *)result
+{
+    NSMutableArray<NSString *> *exhausted = [NSMutableArray array];
+    BOOL needsRefresh = NO;
+    BOOL backlog;
+    
+    @synchronized (self) {
+        for (DYFStoreTransaction *transaction in result.verifiedTransactions) {
+            [self.states removeObjectForKey:transaction.transactionIdentifier ?: @""];
+            [self.exhaustedAttempts removeObjectForKey:transaction.transactionIdentifier ?: @""];
+        }
+        for (DYFStoreTransaction *transaction in result.rejectedTransactions) {
+            [self.states removeObjectForKey:transaction.transactionIdentifier ?: @""];
+            [self.exhaustedAttempts removeObjectForKey:transaction.transactionIdentifier ?: @""];
+        }
+        
+        NSTimeInterval now = self.clock.now;
+        for (DYFStoreTransaction *transaction in result.unresolvedTransactions) {
+            NSString *identifier = transaction.transactionIdentifier ?: @"";
+            NSMutableDictionary *state = self.states[identifier] ?: [NSMutableDictionary dictionary];
+            
+            NSUInteger attempts = [(self.exhaustedAttempts[identifier] ?: state[DYFStoreRetryAttemptsKey]) unsignedIntegerValue] + 1;
+            // An exhausted transaction leaves the pending ones, so that neither a wake-up nor the network coming back retries it.
+            if (attempts >= self.maxAttempts) {
+                [self.states removeObjectForKey:identifier];
+                self.exhaustedAttempts[identifier] = @(attempts);
+                [exhausted addObject:identifier];
+                continue;
+            }
+            state[DYFStoreRetryAttemptsKey] = @(attempts);
+            state[DYFStoreRetryNextKey] = @(now + [self jitteredDelayForAttempt:attempts]);
+            
+            // Without an error, the receipt is missing or predates the transaction.
+            if (!result.error) {
+                state[DYFStoreRetryStaleKey] = @YES;
+                needsRefresh = YES;
+            }
+            self.states[identifier] = state;
+        }
+        
+        [self saveState];
+        backlog = self.backlog;
+    }
+    
+    if (needsRefresh) {
+        [self scheduleReceiptRefresh];
+    }
+    
+    if (backlog) {
+        [self scheduleWakeUpAt:self.clock.now];
+    } else {
+        [self scheduleNextWakeUp];
+    }
+    
+    if (exhausted.count > 0) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            id<DYFStoreRetrySchedulerDelegate> delegate = self.delegate;
+            if ([delegate respondsToSelector:@selector(retryScheduler:didGiveUpOnTransactions:)]) {
+                [delegate retryScheduler:self didGiveUpOnTransactions:exhausted];
+            }
+        });
+    }
+}
+
+@end
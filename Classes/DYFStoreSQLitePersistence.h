@@ -0,0 +1,134 @@
+//
+//  DYFStoreSQLitePersistence.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "DYFStoreTransactionPersistence.h"
+
+/** The transaction persistence in an SQLite database, one row per transaction.
+ 
+ Unlike the persisters that archive all transactions into one value, a write touches only its own rows, and the queries are answered by the indexes of the database on the user identifier, the product identifier, the state and the timestamp. The database is opened in WAL mode, the statements are prepared once and cached, and the writes of several transactions are made in one database transaction.
+ */
+@interface DYFStoreSQLitePersistence : NSObject <DYFStoreTransactionPersistence>
+
+/** Opens the database "DYFStoreKit/Transactions.sqlite" in the application support directory.
+ 
+ @return The persister, or nil if the database cannot be opened.
+ */
+- (instancetype)init;
+
+/** Opens a database, which is created if needed.
+ 
+ @param databaseURL The URL of the database file.
+ @return The persister, or nil if the database cannot be opened.
+ */
+- (instancetype)initWithDatabaseURL:(NSURL *)databaseURL NS_DESIGNATED_INITIALIZER;
+
+/** The URL of the database file.
+ */
+@property (nonatomic, copy, readonly) NSURL *databaseURL;
+
+/** Moves the transactions of another persister into the database, e.g. of a `DYFStoreUserDefaultsPersistence` object at the first launch after an update. The transactions are stored in one database transaction, and only the ones that were stored are removed from the other persister. A transaction without an identifier, or whose record cannot be encoded, stays with the other persister.
+ 
+ @param persister The persister to migrate from.
+ @return The number of transactions migrated, or -1 if they could not be stored.
+ */
+- (NSInteger)migrateTransactionsFromPersister:(id<DYFStoreTransactionPersistence>)persister;
+
+/** Returns a Boolean value that indicates whether a transaction is present in the database with a given transaction ientifier.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ @return True if a transaction is present in the database, otherwise false.
+ */
+- (BOOL)containsTransaction:(NSString *)transactionIdentifier;
+
+/** Stores an `DYFStoreTransaction` object in the database, replacing the transaction with the same identifier.
+ 
+ @param transaction An `DYFStoreTransaction` object.
+ */
+- (void)storeTransaction:(DYFStoreTransaction *)transaction;
+
+/** Stores the `DYFStoreTransaction` objects in the database in one database transaction.
+ 
+ @param transactions The `DYFStoreTransaction` objects.
+ */
+- (void)storeTransactions:(NSArray<DYFStoreTransaction *> *)transactions;
+
+/** Retrieves an array whose elements are the `DYFStoreTransaction` objects from the database.
+ 
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactions;
+
+/** Retrieves the headers of the transactions from the columns of the database, without reading the records.
+ 
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeaders;
+
+/** Retrieves the `DYFStoreTransaction` objects from the database with the given transaction identifiers.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
+/** Retrieves the headers of the transactions stored in the database that match a query.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeadersMatchingQuery:(DYFStoreTransactionQuery *)query;
+
+/** Retrieves the `DYFStoreTransaction` objects stored in the database that match a query.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query;
+
+/** Retrieves an `DYFStoreTransaction` object from the database with a given transaction ientifier.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ @return An `DYFStoreTransaction` object from the database.
+ */
+- (DYFStoreTransaction *)retrieveTransaction:(NSString *)transactionIdentifier;
+
+/** Removes an `DYFStoreTransaction` object from the database with a given transaction ientifier.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ */
+- (void)removeTransaction:(NSString *)transactionIdentifier;
+
+/** Removes the `DYFStoreTransaction` objects from the database with the given transaction identifiers in one database transaction.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ */
+- (void)removeTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
+/** Removes all transactions from the database.
+ */
+- (void)removeTransactions;
+
+@end
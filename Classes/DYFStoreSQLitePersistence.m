@@ -0,0 +1,547 @@
+//
+//  DYFStoreSQLitePersistence.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreSQLitePersistence.h"
+#import "DYFStoreConverter.h"
+#import "DYFStoreLogger.h"
+#import "DYFStoreMetrics.h"
+#import <sqlite3.h>
+
+// The version of the schema, kept in the user version of the database.
+#define DYFSTORE_SQLITE_SCHEMA_VERSION 1
+
+// The columns of a header, in the order read by DYFStoreSQLiteReadHeader.
+#define DYFSTORE_SQLITE_HEADER_COLUMNS @"identifier, state, product_identifier, user_identifier, timestamp"
+
+// The record is the JSON of the transaction. The other columns copy its fields for the indexes, with the timestamp also as a number to be compared as the index of the other persisters does.
+static const char *const DYFStoreSQLiteSchema =
+    "CREATE TABLE IF NOT EXISTS transactions ("
+    "seq INTEGER PRIMARY KEY, "
+    "identifier TEXT NOT NULL UNIQUE, "
+    "state INTEGER NOT NULL, "
+    "product_identifier TEXT, "
+    "user_identifier TEXT, "
+    "timestamp TEXT, "
+    "timestamp_seconds REAL, "
+    "record BLOB NOT NULL);"
+    "CREATE INDEX IF NOT EXISTS transactions_user ON transactions (user_identifier);"
+    "CREATE INDEX IF NOT EXISTS transactions_product ON transactions (product_identifier);"
+    "CREATE INDEX IF NOT EXISTS transactions_state ON transactions (state);"
+    "CREATE INDEX IF NOT EXISTS transactions_timestamp ON transactions (timestamp_seconds);";
+
+static void DYFStoreSQLiteBindText(sqlite3_stmt *statement, int index, NSString *text)
+{
+    const char *chars = text.UTF8String;
+    if (chars) {
+        sqlite3_bind_text(statement, index, chars, -1, SQLITE_TRANSIENT);
+    } else {
+        sqlite3_bind_null(statement, index);
+    }
+}
+
+static void DYFStoreSQLiteBindSeconds(sqlite3_stmt *statement, int index, NSString *timestamp)
+{
+    if (timestamp) {
+        sqlite3_bind_double(statement, index, timestamp.doubleValue);
+    } else {
+        sqlite3_bind_null(statement, index);
+    }
+}
+
+static NSString *DYFStoreSQLiteColumnText(sqlite3_stmt *statement, int index)
+{
+    const unsigned char *text = sqlite3_column_text(statement, index);
+    if (!text) { return nil; }
+    return [[NSString alloc] initWithBytes:text length:sqlite3_column_bytes(statement, index) encoding:NSUTF8StringEncoding];
+}
+
+static NSData *DYFStoreSQLiteColumnData(sqlite3_stmt *statement, int index)
+{
+    const void *bytes = sqlite3_column_blob(statement, index);
+    return [NSData dataWithBytes:bytes length:sqlite3_column_bytes(statement, index)];
+}
+
+/** Reads the header of the current row of a statement that selects DYFSTORE_SQLITE_HEADER_COLUMNS.
+ */
+static DYFStoreTransactionHeader *DYFStoreSQLiteReadHeader(sqlite3_stmt *statement)
+{
+    DYFStoreTransactionHeader *header = [[DYFStoreTransactionHeader alloc] init];
+    header.transactionIdentifier = DYFStoreSQLiteColumnText(statement, 0);
+    header.state = (NSUInteger)sqlite3_column_int64(statement, 1);
+    header.productIdentifier = DYFStoreSQLiteColumnText(statement, 2);
+    header.userIdentifier = DYFStoreSQLiteColumnText(statement, 3);
+    header.transactionTimestamp = DYFStoreSQLiteColumnText(statement, 4);
+    return header;
+}
+
+@interface DYFStoreSQLitePersistence ()
+@property (nonatomic, copy) NSURL *databaseURL;
+@property (nonatomic, assign) sqlite3 *database;
+/** The prepared statements by their SQL. Accessed under the lock of the persister. */
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSValue *> *statements;
+@end
+
+@implementation DYFStoreSQLitePersistence
+
+- (instancetype)init
+{
+    NSURL *supportURL = [NSFileManager.defaultManager URLsForDirectory:NSApplicationSupportDirectory inDomains:NSUserDomainMask].firstObject;
+    NSURL *directoryURL = [supportURL URLByAppendingPathComponent:@"DYFStoreKit" isDirectory:YES];
+    
+    return [self initWithDatabaseURL:[directoryURL URLByAppendingPathComponent:@"Transactions.sqlite"]];
+}
+
+- (instancetype)initWithDatabaseURL:(NSURL *)databaseURL
+{
+    self = [super init];
+    if (self) {
+        if (!databaseURL.isFileURL) { return nil; }
+        [NSFileManager.defaultManager createDirectoryAtURL:databaseURL.URLByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:NULL];
+        
+        // The connection is serialized by the lock of the persister, so SQLite need not lock it as well.
+        sqlite3 *database = NULL;
+        int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+        if (sqlite3_open_v2(databaseURL.fileSystemRepresentation, &database, flags, NULL) != SQLITE_OK) {
+            DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"error: %s", sqlite3_errmsg(database));
+            sqlite3_close(database);
+            return nil;
+        }
+        _database = database;
+        _databaseURL = [databaseURL copy];
+        _statements = [NSMutableDictionary dictionary];
+        
+        // Other connections, e.g. of another persister on the same file, are waited for rather than failed.
+        sqlite3_busy_timeout(database, 1000);
+        
+        // In WAL mode the readers are not blocked by a write, and a commit appends to the log without rewriting the pages. A synchronous mode of NORMAL syncs the log at checkpoints only, which may lose the last commits on power loss but cannot corrupt the database.
+        if (![self executeSQL:"PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;"] ||
+            ![self migrateSchema]) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    for (NSValue *value in _statements.allValues) {
+        sqlite3_finalize(value.pointerValue);
+    }
+    sqlite3_close(_database);
+}
+
+#pragma mark - Statements
+
+- (BOOL)executeSQL:(const char *)sql
+{
+    char *message = NULL;
+    if (sqlite3_exec(self.database, sql, NULL, NULL, &message) == SQLITE_OK) { return YES; }
+    
+    DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"error: %s", message);
+    sqlite3_free(message);
+    return NO;
+}
+
+/** Creates the tables and indexes of a new database, and upgrades the ones of an older schema. The version is read and the schema written in one database transaction, so a failed or concurrent migration by another connection never leaves a partial schema behind a current version.
+ */
+- (BOOL)migrateSchema
+{
+    return [self performTransaction:^BOOL {
+        sqlite3_stmt *statement = NULL;
+        int version = 0;
+        if (sqlite3_prepare_v2(self.database, "PRAGMA user_version", -1, &statement, NULL) == SQLITE_OK &&
+            sqlite3_step(statement) == SQLITE_ROW) {
+            version = sqlite3_column_int(statement, 0);
+        }
+        sqlite3_finalize(statement);
+        if (version >= DYFSTORE_SQLITE_SCHEMA_VERSION) { return YES; }
+        
+        char sql[32];
+        snprintf(sql, sizeof(sql), "PRAGMA user_version = %d", DYFSTORE_SQLITE_SCHEMA_VERSION);
+        return [self executeSQL:DYFStoreSQLiteSchema] && [self executeSQL:sql];
+    }];
+}
+
+/** Returns the statement of some SQL, which is prepared at its first use and cached. Called under the lock, and the statement must be reset with `resetStatement:` after use.
+ */
+- (sqlite3_stmt *)statementForSQL:(NSString *)sql
+{
+    sqlite3_stmt *statement = [self.statements[sql] pointerValue];
+    if (statement) { return statement; }
+    
+    if (sqlite3_prepare_v2(self.database, sql.UTF8String, -1, &statement, NULL) != SQLITE_OK) {
+        DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"error: %s", sqlite3_errmsg(self.database));
+        return NULL;
+    }
+    self.statements[sql] = [NSValue valueWithPointer:statement];
+    
+    return statement;
+}
+
+/** Resets a statement and clears its bindings, which also ends the read of a query that was not stepped to its end.
+ */
+- (void)resetStatement:(sqlite3_stmt *)statement
+{
+    sqlite3_reset(statement);
+    sqlite3_clear_bindings(statement);
+}
+
+/** Steps a statement that returns no rows to its end, and resets it.
+ */
+- (BOOL)runStatement:(sqlite3_stmt *)statement
+{
+    int status = sqlite3_step(statement);
+    if (status != SQLITE_DONE) {
+        DYFStoreLoggerRecord(__PRETTY_FUNCTION__, __LINE__, @"error: %s", sqlite3_errmsg(self.database));
+    }
+    [self resetStatement:statement];
+    
+    return status == SQLITE_DONE;
+}
+
+/** Runs a block in one database transaction, which is committed if the block returns YES, and rolled back otherwise. Called under the lock.
+ */
+- (BOOL)performTransaction:(BOOL (^)(void))block
+{
+    sqlite3_stmt *begin = [self statementForSQL:@"BEGIN IMMEDIATE"];
+    if (!begin || ![self runStatement:begin]) { return NO; }
+    
+    sqlite3_stmt *commit = [self statementForSQL:@"COMMIT"];
+    if (block() && commit && [self runStatement:commit]) { return YES; }
+    [self executeSQL:"ROLLBACK"];
+    return NO;
+}
+
+#pragma mark - Records
+
+/** Decodes the record of a transaction.
+ */
+- (DYFStoreTransaction *)transactionWithData:(NSData *)data
+{
+    NSDictionary *dict = [DYFStoreConverter jsonObjectWithData:data];
+    if (![dict isKindOfClass:NSDictionary.class]) { return nil; }
+    
+    return [[DYFStoreTransaction alloc] initWithDictionary:dict];
+}
+
+/** Inserts a transaction, replacing the one with the same identifier. Called under the lock.
+ */
+- (BOOL)insertTransaction:(DYFStoreTransaction *)transaction record:(NSData *)record
+{
+    sqlite3_stmt *statement = [self statementForSQL:@"INSERT OR REPLACE INTO transactions (identifier, state, product_identifier, user_identifier, timestamp, timestamp_seconds, record) VALUES (?, ?, ?, ?, ?, ?, ?)"];
+    if (!statement) { return NO; }
+    
+    DYFStoreSQLiteBindText(statement, 1, transaction.transactionIdentifier);
+    sqlite3_bind_int64(statement, 2, (sqlite3_int64)transaction.state);
+    DYFStoreSQLiteBindText(statement, 3, transaction.productIdentifier);
+    DYFStoreSQLiteBindText(statement, 4, transaction.userIdentifier);
+    DYFStoreSQLiteBindText(statement, 5, transaction.transactionTimestamp);
+    DYFStoreSQLiteBindSeconds(statement, 6, transaction.transactionTimestamp);
+    sqlite3_bind_blob(statement, 7, record.bytes, (int)record.length, SQLITE_STATIC);
+    
+    return [self runStatement:statement];
+}
+
+/** Stores the transactions in one database transaction. A transaction without an identifier, or whose record cannot be encoded, is skipped.
+ 
+ @return The identifiers of the stored transactions, or nil if they could not be stored and none is.
+ */
+- (NSArray<NSString *> *)writeTransactions:(NSArray<DYFStoreTransaction *> *)transactions
+{
+    // The records are encoded before the lock is taken.
+    NSMutableArray<DYFStoreTransaction *> *stored = [NSMutableArray arrayWithCapacity:transactions.count];
+    NSMutableArray<NSData *> *records = [NSMutableArray arrayWithCapacity:transactions.count];
+    for (DYFStoreTransaction *transaction in transactions) {
+        NSData *record = [DYFStoreConverter jsonWithObject:[transaction dictionaryRepresentation]];
+        if (transaction.transactionIdentifier.length == 0 || !record) { continue; }
+        [stored addObject:transaction];
+        [records addObject:record];
+    }
+    if (stored.count == 0) { return @[]; }
+    
+    BOOL succeeded = NO;
+    @synchronized (self) {
+        succeeded = [self performTransaction:^BOOL {
+            for (NSUInteger idx = 0; idx < stored.count; idx++) {
+                if (![self insertTransaction:stored[idx] record:records[idx]]) { return NO; }
+            }
+            return YES;
+        }];
+    }
+    
+    return succeeded ? [stored valueForKey:@"transactionIdentifier"] : nil;
+}
+
+/** Reads the records of all transactions, in the order they were stored.
+ */
+- (NSArray<NSData *> *)allRecords
+{
+    NSMutableArray<NSData *> *records = [NSMutableArray array];
+    @synchronized (self) {
+        sqlite3_stmt *statement = [self statementForSQL:@"SELECT record FROM transactions ORDER BY seq"];
+        if (!statement) { return nil; }
+        
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            [records addObject:DYFStoreSQLiteColumnData(statement, 0)];
+        }
+        [self resetStatement:statement];
+    }
+    
+    return records;
+}
+
+/** Returns the statement of a query over some columns, in the order the transactions were stored, with the criteria of the query bound. The SQL, and so the cached statement, depends only on which criteria are set. Called under the lock.
+ */
+- (sqlite3_stmt *)statementForQuery:(DYFStoreTransactionQuery *)query columns:(NSString *)columns
+{
+    NSMutableArray<NSString *> *criteria = [NSMutableArray arrayWithCapacity:5];
+    !query.userIdentifier ?: [criteria addObject:@"user_identifier = ?"];
+    !query.productIdentifier ?: [criteria addObject:@"product_identifier = ?"];
+    !query.state ?: [criteria addObject:@"state = ?"];
+    !query.sinceTimestamp ?: [criteria addObject:@"timestamp_seconds >= ?"];
+    !query.beforeTimestamp ?: [criteria addObject:@"timestamp_seconds < ?"];
+    
+    NSMutableString *sql = [NSMutableString stringWithFormat:@"SELECT %@ FROM transactions", columns];
+    if (criteria.count > 0) {
+        [sql appendFormat:@" WHERE %@", [criteria componentsJoinedByString:@" AND "]];
+    }
+    [sql appendString:@" ORDER BY seq"];
+    if (query.limit > 0) {
+        [sql appendString:@" LIMIT ?"];
+    }
+    
+    sqlite3_stmt *statement = [self statementForSQL:sql];
+    if (!statement) { return NULL; }
+    
+    int index = 1;
+    if (query.userIdentifier) { DYFStoreSQLiteBindText(statement, index++, query.userIdentifier); }
+    if (query.productIdentifier) { DYFStoreSQLiteBindText(statement, index++, query.productIdentifier); }
+    if (query.state) { sqlite3_bind_int64(statement, index++, query.state.longLongValue); }
+    if (query.sinceTimestamp) { DYFStoreSQLiteBindSeconds(statement, index++, query.sinceTimestamp); }
+    if (query.beforeTimestamp) { DYFStoreSQLiteBindSeconds(statement, index++, query.beforeTimestamp); }
+    if (query.limit > 0) { sqlite3_bind_int64(statement, index++, (sqlite3_int64)MIN(query.limit, (NSUInteger)INT64_MAX)); }
+    
+    return statement;
+}
+
+- (NSInteger)migrateTransactionsFromPersister:(id<DYFStoreTransactionPersistence>)persister
+{
+    NSArray<DYFStoreTransaction *> *transactions = [persister retrieveTransactions];
+    if (transactions.count == 0) { return 0; }
+    
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceStore);
+    NSArray<NSString *> *identifiers = [self writeTransactions:transactions];
+    if (!identifiers) { return -1; }
+    // The transactions that were skipped stay with the other persister rather than being lost.
+    if (identifiers.count > 0) {
+        [persister removeTransactionsWithIdentifiers:identifiers];
+    }
+    
+    return (NSInteger)identifiers.count;
+}
+
+- (BOOL)containsTransaction:(NSString *)transactionIdentifier
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    if (!transactionIdentifier) { return NO; }
+    
+    @synchronized (self) {
+        sqlite3_stmt *statement = [self statementForSQL:@"SELECT 1 FROM transactions WHERE identifier = ?"];
+        if (!statement) { return NO; }
+        
+        DYFStoreSQLiteBindText(statement, 1, transactionIdentifier);
+        BOOL contains = sqlite3_step(statement) == SQLITE_ROW;
+        [self resetStatement:statement];
+        return contains;
+    }
+}
+
+- (void)storeTransaction:(DYFStoreTransaction *)transaction
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceStore);
+    if (transaction.transactionIdentifier.length == 0) { return; }
+    NSData *record = [DYFStoreConverter jsonWithObject:[transaction dictionaryRepresentation]];
+    if (!record) { return; }
+    
+    @synchronized (self) {
+        [self insertTransaction:transaction record:record];
+    }
+}
+
+- (void)storeTransactions:(NSArray<DYFStoreTransaction *> *)transactions
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceStore);
+    [self writeTransactions:transactions];
+}
+
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactions
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSArray<NSData *> *records = [self allRecords];
+    if (!records) { return nil; }
+    
+    return [DYFStoreBulkDecoder.sharedDecoder decodeRecords:records usingBlock:^id (NSData *record) {
+        return [self transactionWithData:record];
+    }];
+}
+
+- (void)enumerateTransactionsUsingBlock:(void (^)(DYFStoreTransaction *transaction, BOOL *stop))block
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSArray<NSData *> *records = [self allRecords];
+    if (!records) { return; }
+    
+    [DYFStoreBulkDecoder.sharedDecoder enumerateRecords:records decode:^id (NSData *record) {
+        return [self transactionWithData:record];
+    } usingBlock:block];
+}
+
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeaders
+{
+    return [self retrieveTransactionHeadersMatchingQuery:[[DYFStoreTransactionQuery alloc] init]];
+}
+
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSMutableArray<NSArray *> *rows = [NSMutableArray arrayWithCapacity:transactionIdentifiers.count];
+    @synchronized (self) {
+        sqlite3_stmt *statement = [self statementForSQL:@"SELECT seq, record FROM transactions WHERE identifier = ?"];
+        if (!statement) { return @[]; }
+        
+        for (NSString *transactionIdentifier in [NSOrderedSet orderedSetWithArray:transactionIdentifiers]) {
+            DYFStoreSQLiteBindText(statement, 1, transactionIdentifier);
+            if (sqlite3_step(statement) == SQLITE_ROW) {
+                [rows addObject:@[@(sqlite3_column_int64(statement, 0)), DYFStoreSQLiteColumnData(statement, 1)]];
+            }
+            [self resetStatement:statement];
+        }
+    }
+    
+    // The rows are looked up by identifier, and returned in the order they were stored.
+    [rows sortUsingComparator:^NSComparisonResult(NSArray *row1, NSArray *row2) {
+        return [row1[0] compare:row2[0]];
+    }];
+    NSMutableArray<NSData *> *records = [NSMutableArray arrayWithCapacity:rows.count];
+    for (NSArray *row in rows) {
+        [records addObject:row[1]];
+    }
+    
+    return [DYFStoreBulkDecoder.sharedDecoder decodeRecords:records usingBlock:^id (NSData *record) {
+        return [self transactionWithData:record];
+    }];
+}
+
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeadersMatchingQuery:(DYFStoreTransactionQuery *)query
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSMutableArray<DYFStoreTransactionHeader *> *headers = [NSMutableArray array];
+    @synchronized (self) {
+        sqlite3_stmt *statement = [self statementForQuery:query columns:DYFSTORE_SQLITE_HEADER_COLUMNS];
+        if (!statement) { return @[]; }
+        
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            [headers addObject:DYFStoreSQLiteReadHeader(statement)];
+        }
+        [self resetStatement:statement];
+    }
+    
+    return headers;
+}
+
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSMutableArray<NSData *> *records = [NSMutableArray array];
+    @synchronized (self) {
+        sqlite3_stmt *statement = [self statementForQuery:query columns:@"record"];
+        if (!statement) { return @[]; }
+        
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            [records addObject:DYFStoreSQLiteColumnData(statement, 0)];
+        }
+        [self resetStatement:statement];
+    }
+    
+    return [DYFStoreBulkDecoder.sharedDecoder decodeRecords:records usingBlock:^id (NSData *record) {
+        return [self transactionWithData:record];
+    }];
+}
+
+- (DYFStoreTransaction *)retrieveTransaction:(NSString *)transactionIdentifier
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    if (!transactionIdentifier) { return nil; }
+    
+    NSData *record = nil;
+    @synchronized (self) {
+        sqlite3_stmt *statement = [self statementForSQL:@"SELECT record FROM transactions WHERE identifier = ?"];
+        if (!statement) { return nil; }
+        
+        DYFStoreSQLiteBindText(statement, 1, transactionIdentifier);
+        if (sqlite3_step(statement) == SQLITE_ROW) {
+            record = DYFStoreSQLiteColumnData(statement, 0);
+        }
+        [self resetStatement:statement];
+    }
+    
+    return record ? [self transactionWithData:record] : nil;
+}
+
+- (void)removeTransaction:(NSString *)transactionIdentifier
+{
+    if (!transactionIdentifier) { return; }
+    [self removeTransactionsWithIdentifiers:@[transactionIdentifier]];
+}
+
+- (void)removeTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRemove);
+    if (transactionIdentifiers.count == 0) { return; }
+    
+    @synchronized (self) {
+        [self performTransaction:^BOOL {
+            sqlite3_stmt *statement = [self statementForSQL:@"DELETE FROM transactions WHERE identifier = ?"];
+            if (!statement) { return NO; }
+            
+            for (NSString *transactionIdentifier in transactionIdentifiers) {
+                DYFStoreSQLiteBindText(statement, 1, transactionIdentifier);
+                if (![self runStatement:statement]) { return NO; }
+            }
+            return YES;
+        }];
+    }
+}
+
+- (void)removeTransactions
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRemove);
+    @synchronized (self) {
+        sqlite3_stmt *statement = [self statementForSQL:@"DELETE FROM transactions"];
+        !statement ?: [self runStatement:statement];
+    }
+}
+
+@end
@@ -0,0 +1,151 @@
+//
+//  DYFStoreSharedContainerPersistence.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import <Foundation/Foundation.h>
+#import "DYFStoreTransactionPersistence.h"
+
+/** Provides notification about the changes that other processes made to the shared transactions, e.g. a purchase finished by an extension. The object of the notification is the `DYFStoreSharedContainerPersistence` object.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreSharedTransactionsDidChangeNotification;
+
+/** The key of the identifiers of the transactions that were stored or replaced, an array of strings.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreSharedStoredTransactionIdentifiersKey;
+
+/** The key of the identifiers of the transactions that were removed, an array of strings.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreSharedRemovedTransactionIdentifiersKey;
+
+/** The key of a Boolean value that indicates whether the changes are not known one by one, e.g. all transactions were removed or too many changes were made since the last check, so that the observer should retrieve all transactions again.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreSharedTransactionsResetKey;
+
+/** The transaction persistence in a directory shared by several processes, e.g. the container of an app group that the app and its extensions open at once.
+ 
+ The writes of the processes are serialized by a file lock, and the reads take no lock. Every change is numbered, so that the other processes are told exactly which transactions changed.
+ */
+@interface DYFStoreSharedContainerPersistence : NSObject <DYFStoreTransactionPersistence>
+
+/** Opens the transactions in the container of an app group.
+ 
+ @param groupIdentifier The identifier of the app group.
+ @return The persister, or nil if the container cannot be opened.
+ */
+- (instancetype)initWithApplicationGroupIdentifier:(NSString *)groupIdentifier;
+
+/** Opens the transactions in a directory, which is created if needed.
+ 
+ @param directoryURL The URL of the directory.
+ @return The persister, or nil if the directory cannot be opened.
+ */
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** The URL of the directory of the transactions.
+ */
+@property (nonatomic, copy, readonly) NSURL *directoryURL;
+
+/** Starts posting `DYFStoreSharedTransactionsDidChangeNotification` on the main queue when other processes change the transactions.
+ */
+- (void)startObservingChanges;
+
+/** Stops posting `DYFStoreSharedTransactionsDidChangeNotification`.
+ */
+- (void)stopObservingChanges;
+
+/** Reads the changes that other processes made since the last check, and posts `DYFStoreSharedTransactionsDidChangeNotification` if there are any. Called when a change is signaled, and can be called e.g. when the app becomes active.
+ */
+- (void)checkForChanges;
+
+/** Returns a Boolean value that indicates whether a transaction is present in the shared container with a given transaction ientifier.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ @return True if a transaction is present in the shared container, otherwise false.
+ */
+- (BOOL)containsTransaction:(NSString *)transactionIdentifier;
+
+/** Stores an `DYFStoreTransaction` object in the shared container, replacing the transaction with the same identifier.
+ 
+ @param transaction An `DYFStoreTransaction` object.
+ */
+- (void)storeTransaction:(DYFStoreTransaction *)transaction;
+
+/** Retrieves an array whose elements are the `DYFStoreTransaction` objects from the shared container.
+ 
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactions;
+
+/** Retrieves the headers of the transactions from the shared container.
+ 
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeaders;
+
+/** Retrieves the `DYFStoreTransaction` objects from the shared container with the given transaction identifiers, looking up each of them in the index.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
+/** Retrieves the headers of the transactions stored in the shared container that match a query.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeadersMatchingQuery:(DYFStoreTransactionQuery *)query;
+
+/** Retrieves the `DYFStoreTransaction` objects stored in the shared container that match a query.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query;
+
+/** Retrieves an `DYFStoreTransaction` object from the shared container with a given transaction ientifier.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ @return An `DYFStoreTransaction` object from the shared container.
+ */
+- (DYFStoreTransaction *)retrieveTransaction:(NSString *)transactionIdentifier;
+
+/** Removes an `DYFStoreTransaction` object from the shared container with a given transaction ientifier.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ */
+- (void)removeTransaction:(NSString *)transactionIdentifier;
+
+/** Removes the `DYFStoreTransaction` objects from the shared container with the given transaction identifiers under one lock.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ */
+- (void)removeTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
+/** Removes all transactions from the shared container.
+ */
+- (void)removeTransactions;
+
+@end
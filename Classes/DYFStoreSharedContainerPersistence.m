@@ -0,0 +1,394 @@
+//
+//  DYFStoreSharedContainerPersistence.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import "DYFStoreSharedContainerPersistence.h"
+#import "DYFStoreConverter.h"
+#import "DYFStoreMetrics.h"
+#import "DYFStoreSharedFile.h"
+#import <unistd.h>
+#if __has_include(<notify.h>)
+#import <notify.h>
+#define DYFSTORE_SHARED_NOTIFY_ENABLED 1
+#endif
+
+NSString *const DYFStoreSharedTransactionsDidChangeNotification = @"DYFStoreSharedTransactionsDidChangeNotification";
+NSString *const DYFStoreSharedStoredTransactionIdentifiersKey = @"DYFStoreSharedStoredTransactionIdentifiers";
+NSString *const DYFStoreSharedRemovedTransactionIdentifiersKey = @"DYFStoreSharedRemovedTransactionIdentifiers";
+NSString *const DYFStoreSharedTransactionsResetKey = @"DYFStoreSharedTransactionsReset";
+
+@interface DYFStoreSharedContainerPersistence ()
+@property (nonatomic, copy) NSURL *directoryURL;
+@property (nonatomic, assign) DYFStoreSharedFile *file;
+/** The name of the Darwin notification that signals a change to the other processes. */
+@property (nonatomic, copy) NSString *notificationName;
+@property (nonatomic, assign) int notifyToken;
+@property (nonatomic, assign) BOOL observing;
+/** The number of the latest change that was checked. Accessed on the change queue. */
+@property (nonatomic, assign) uint64_t changeNumber;
+@property (nonatomic, strong) dispatch_queue_t changeQueue;
+@end
+
+/** Adds the data of a record to an array.
+ */
+static void DYFStoreSharedCollectRecord(const char *identifier, size_t identifierLength, const void *record, size_t length, void *context)
+{
+    NSMutableArray *records = (__bridge NSMutableArray *)context;
+    [records addObject:[NSData dataWithBytes:record length:length]];
+}
+
+@implementation DYFStoreSharedContainerPersistence
+
+- (instancetype)initWithApplicationGroupIdentifier:(NSString *)groupIdentifier
+{
+    NSURL *containerURL = [NSFileManager.defaultManager containerURLForSecurityApplicationGroupIdentifier:groupIdentifier];
+    if (!containerURL) { return nil; }
+    
+    return [self initWithDirectoryURL:[containerURL URLByAppendingPathComponent:@"DYFStoreKit" isDirectory:YES]];
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL
+{
+    self = [super init];
+    if (self) {
+        _file = DYFStoreSharedFileOpen(directoryURL.fileSystemRepresentation);
+        if (!_file) { return nil; }
+        
+        _directoryURL = [directoryURL copy];
+        _notificationName = [@"DYFStoreSharedTransactionsDidChange." stringByAppendingString:directoryURL.path];
+        _changeNumber = DYFStoreSharedFileChangeNumber(_file);
+        _changeQueue = dispatch_queue_create("com.dyfstorekit.shared.changes", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self stopObservingChanges];
+    DYFStoreSharedFileClose(_file);
+}
+
+#pragma mark - Changes
+
+- (void)startObservingChanges
+{
+    @synchronized (self) {
+        if (self.observing) { return; }
+        self.observing = YES;
+        
+#if DYFSTORE_SHARED_NOTIFY_ENABLED
+        __weak typeof(self) weakSelf = self;
+        int token = 0;
+        notify_register_dispatch(self.notificationName.UTF8String, &token, self.changeQueue, ^(int t) {
+            [weakSelf readChanges];
+        });
+        self.notifyToken = token;
+#endif
+    }
+}
+
+- (void)stopObservingChanges
+{
+    @synchronized (self) {
+        if (!self.observing) { return; }
+        self.observing = NO;
+        
+#if DYFSTORE_SHARED_NOTIFY_ENABLED
+        notify_cancel(self.notifyToken);
+#endif
+    }
+}
+
+- (void)checkForChanges
+{
+    dispatch_async(self.changeQueue, ^{
+        [self readChanges];
+    });
+}
+
+/** Signals a change to the other processes.
+ */
+- (void)postChange
+{
+#if DYFSTORE_SHARED_NOTIFY_ENABLED
+    notify_post(self.notificationName.UTF8String);
+#endif
+}
+
+/** Reads the changes since the last check on the change queue, skipping the ones made by this process, and posts them.
+ */
+- (void)readChanges
+{
+    DYFStoreSharedChange *changes = NULL;
+    int reset = 0;
+    uint64_t current = 0;
+    long count = DYFStoreSharedFileCopyChanges(self.file, self.changeNumber, &changes, &reset, &current);
+    if (count < 0) { return; }
+    self.changeNumber = current;
+    
+    // The latest change of a transaction wins.
+    NSMutableOrderedSet *stored = [NSMutableOrderedSet orderedSet];
+    NSMutableOrderedSet *removed = [NSMutableOrderedSet orderedSet];
+    uint32_t pid = (uint32_t)getpid();
+    for (long idx = 0; idx < count && !reset; idx++) {
+        DYFStoreSharedChange change = changes[idx];
+        if (change.pid == pid) { continue; }
+        
+        if (change.kind == DYFStoreSharedChangeRemoveAll) {
+            reset = 1;
+            break;
+        }
+        NSString *identifier = [[NSString alloc] initWithBytes:change.identifier length:change.identifierLength encoding:NSUTF8StringEncoding];
+        if (!identifier) { continue; }
+        if (change.kind == DYFStoreSharedChangeStore) {
+            [removed removeObject:identifier];
+            [stored addObject:identifier];
+        } else {
+            [stored removeObject:identifier];
+            [removed addObject:identifier];
+        }
+    }
+    DYFStoreSharedFileFreeChanges(changes, (size_t)count);
+    
+    if (!reset && stored.count == 0 && removed.count == 0) { return; }
+    NSDictionary *info = @{DYFStoreSharedStoredTransactionIdentifiersKey: reset ? @[] : stored.array,
+                           DYFStoreSharedRemovedTransactionIdentifiersKey: reset ? @[] : removed.array,
+                           DYFStoreSharedTransactionsResetKey: @(reset != 0)};
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [NSNotificationCenter.defaultCenter postNotificationName:DYFStoreSharedTransactionsDidChangeNotification object:self userInfo:info];
+    });
+}
+
+#pragma mark - Records
+
+/** Decodes the record of a transaction.
+ */
+- (DYFStoreTransaction *)transactionWithData:(NSData *)data
+{
+    NSDictionary *dict = [DYFStoreConverter jsonObjectWithData:data];
+    if (![dict isKindOfClass:NSDictionary.class]) { return nil; }
+    
+    return [[DYFStoreTransaction alloc] initWithDictionary:dict];
+}
+
+/** Reads a consistent snapshot of all the records.
+ */
+- (NSArray<NSData *> *)allRecords
+{
+    NSMutableArray<NSData *> *records = [NSMutableArray array];
+    if (DYFStoreSharedFileEnumerate(self.file, DYFStoreSharedCollectRecord, (__bridge void *)records) < 0) { return nil; }
+    return records;
+}
+
+/** Decodes a consistent snapshot of all the records.
+ */
+- (NSArray<DYFStoreTransaction *> *)allTransactions
+{
+    NSArray<NSData *> *records = [self allRecords];
+    if (!records) { return nil; }
+    
+    return [DYFStoreBulkDecoder.sharedDecoder decodeRecords:records usingBlock:^id (NSData *record) {
+        return [self transactionWithData:record];
+    }];
+}
+
+- (BOOL)containsTransaction:(NSString *)transactionIdentifier
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    const char *identifier = transactionIdentifier.UTF8String;
+    if (!identifier) { return NO; }
+    
+    return DYFStoreSharedFileContains(self.file, identifier, strlen(identifier)) == 1;
+}
+
+- (void)storeTransaction:(DYFStoreTransaction *)transaction
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceStore);
+    const char *identifier = transaction.transactionIdentifier.UTF8String;
+    if (!identifier || strlen(identifier) == 0) { return; }
+    
+    NSData *data = [DYFStoreConverter jsonWithObject:[transaction dictionaryRepresentation]];
+    if (DYFStoreSharedFileStore(self.file, identifier, strlen(identifier), data.bytes, data.length) == 0) {
+        [self postChange];
+    }
+}
+
+- (void)storeTransactions:(NSArray<DYFStoreTransaction *> *)transactions
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceStore);
+    NSUInteger count = transactions.count;
+    if (count == 0) { return; }
+    
+    // The encoded records are kept alive by the array until they are written.
+    NSMutableArray<NSData *> *datas = [NSMutableArray arrayWithCapacity:count];
+    const char **identifiers = malloc(sizeof(char *) * count);
+    size_t *identifierLengths = malloc(sizeof(size_t) * count);
+    const void **records = malloc(sizeof(void *) * count);
+    size_t *lengths = malloc(sizeof(size_t) * count);
+    NSUInteger idx = 0;
+    for (DYFStoreTransaction *transaction in transactions) {
+        const char *identifier = transaction.transactionIdentifier.UTF8String;
+        NSData *data = [DYFStoreConverter jsonWithObject:[transaction dictionaryRepresentation]];
+        if (!identifier || strlen(identifier) == 0 || !data) { continue; }
+        [datas addObject:data];
+        identifiers[idx] = identifier;
+        identifierLengths[idx] = strlen(identifier);
+        records[idx] = data.bytes;
+        lengths[idx] = data.length;
+        idx++;
+    }
+    
+    int status = idx > 0 ? DYFStoreSharedFileStoreAll(self.file, identifiers, identifierLengths, records, lengths, idx) : -1;
+    free(identifiers);
+    free(identifierLengths);
+    free(records);
+    free(lengths);
+    if (status == 0) {
+        [self postChange];
+    }
+}
+
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactions
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    return [self allTransactions];
+}
+
+- (void)enumerateTransactionsUsingBlock:(void (^)(DYFStoreTransaction *transaction, BOOL *stop))block
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSArray<NSData *> *records = [self allRecords];
+    if (!records) { return; }
+    
+    [DYFStoreBulkDecoder.sharedDecoder enumerateRecords:records decode:^id (NSData *record) {
+        return [self transactionWithData:record];
+    } usingBlock:block];
+}
+
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeaders
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSArray *transactions = [self allTransactions];
+    if (!transactions) { return nil; }
+    
+    NSMutableArray *headers = [NSMutableArray arrayWithCapacity:transactions.count];
+    for (DYFStoreTransaction *transaction in transactions) {
+        [headers addObject:[DYFStoreTransactionHeader headerWithTransaction:transaction]];
+    }
+    
+    return headers;
+}
+
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSMutableArray *transactions = [NSMutableArray arrayWithCapacity:transactionIdentifiers.count];
+    for (NSString *transactionIdentifier in [NSOrderedSet orderedSetWithArray:transactionIdentifiers]) {
+        DYFStoreTransaction *transaction = [self retrieveTransaction:transactionIdentifier];
+        if (transaction) {
+            [transactions addObject:transaction];
+        }
+    }
+    
+    return transactions;
+}
+
+// Other processes change the records at any time, so the index is built from the snapshot of each query rather than cached.
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeadersMatchingQuery:(DYFStoreTransactionQuery *)query
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSArray *headers = [self retrieveTransactionHeaders];
+    if (!headers) { return @[]; }
+    
+    DYFStoreTransactionIndex *index = [[DYFStoreTransactionIndex alloc] initWithHeaders:headers];
+    return [index.headers objectsAtIndexes:[index indexesOfTransactionsMatchingQuery:query]];
+}
+
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSArray *transactions = [self allTransactions];
+    if (!transactions) { return @[]; }
+    
+    NSMutableArray *headers = [NSMutableArray arrayWithCapacity:transactions.count];
+    for (DYFStoreTransaction *transaction in transactions) {
+        [headers addObject:[DYFStoreTransactionHeader headerWithTransaction:transaction]];
+    }
+    DYFStoreTransactionIndex *index = [[DYFStoreTransactionIndex alloc] initWithHeaders:headers];
+    return [transactions objectsAtIndexes:[index indexesOfTransactionsMatchingQuery:query]];
+}
+
+- (DYFStoreTransaction *)retrieveTransaction:(NSString *)transactionIdentifier
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    const char *identifier = transactionIdentifier.UTF8String;
+    if (!identifier) { return nil; }
+    
+    size_t length = 0;
+    void *record = DYFStoreSharedFileCopyRecord(self.file, identifier, strlen(identifier), &length);
+    if (!record) { return nil; }
+    
+    NSData *data = [NSData dataWithBytesNoCopy:record length:length freeWhenDone:YES];
+    return [self transactionWithData:data];
+}
+
+- (void)removeTransaction:(NSString *)transactionIdentifier
+{
+    if (!transactionIdentifier) { return; }
+    [self removeTransactionsWithIdentifiers:@[transactionIdentifier]];
+}
+
+- (void)removeTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRemove);
+    NSUInteger count = transactionIdentifiers.count;
+    if (count == 0) { return; }
+    
+    const char **identifiers = malloc(sizeof(char *) * count);
+    size_t *lengths = malloc(sizeof(size_t) * count);
+    NSUInteger idx = 0;
+    for (NSString *transactionIdentifier in transactionIdentifiers) {
+        const char *identifier = transactionIdentifier.UTF8String;
+        if (!identifier) { continue; }
+        identifiers[idx] = identifier;
+        lengths[idx] = strlen(identifier);
+        idx++;
+    }
+    
+    long removed = DYFStoreSharedFileRemove(self.file, identifiers, lengths, idx);
+    free(identifiers);
+    free(lengths);
+    if (removed > 0) {
+        [self postChange];
+    }
+}
+
+- (void)removeTransactions
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRemove);
+    if (DYFStoreSharedFileRemoveAll(self.file) == 0) {
+        [self postChange];
+    }
+}
+
+@end
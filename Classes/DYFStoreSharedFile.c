@@ -0,0 +1,1147 @@
+//
+//  DYFStoreSharedFile.c
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "DYFStoreSharedFile.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// "DYFI" and "DYFL" in little-endian order.
+#define DYFStoreSharedIndexMagic 0x49465944u
+#define DYFStoreSharedLogMagic 0x4C465944u
+#define DYFStoreSharedVersion 1u
+
+// The number of the latest changes kept for the other processes.
+#define DYFStoreSharedRingCapacity 1024u
+
+// The initial number of slots of the hash table, a power of two.
+#define DYFStoreSharedInitialCapacity 1024u
+
+// The hashes of the empty and the deleted slots. Real hashes are moved above them.
+#define DYFStoreSharedEmptySlot 0u
+#define DYFStoreSharedDeletedSlot 1u
+
+// How many times a reader yields to a writer before it takes the lock.
+#define DYFStoreSharedSpins 1000u
+
+// How many times a reader retries a snapshot that keeps changing or failing.
+#define DYFStoreSharedRetries 64u
+
+// The log is compacted when it holds more garbage than this and than live records.
+#define DYFStoreSharedCompactionThreshold (1u << 20)
+
+#define DYFStoreSharedLoad(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define DYFStoreSharedStore(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+/** The header of the index file. The ring of changes and the hash table follow it.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    /** Odd while a writer updates the index. */
+    uint64_t sequence;
+    /** The generation of the log the offsets point into. */
+    uint64_t generation;
+    /** The number of the latest change. */
+    uint64_t changeNumber;
+    /** The committed length of the log. */
+    uint64_t logLength;
+    /** The bytes of the log taken by replaced and removed records. */
+    uint64_t garbage;
+    uint32_t count;
+    uint32_t deleted;
+    uint32_t capacity;
+    uint32_t ringCapacity;
+} DYFStoreSharedIndexHeader;
+
+/** A slot of the hash table, or an entry of the ring of changes, whose first member is then the change number.
+ */
+typedef struct {
+    uint64_t hash;
+    uint64_t offset;
+} DYFStoreSharedSlot;
+
+/** The header of the log file. A compacted log starts with the copies of the live records, which keep their change numbers.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t generation;
+    /** The number of the latest change when the log was compacted. */
+    uint64_t changeNumber;
+    /** The end of the copied records. */
+    uint64_t length;
+} DYFStoreSharedLogHeader;
+
+/** The header of a record of the log. The identifier follows it, then the record of a store, then padding to 8 bytes.
+ */
+typedef struct {
+    uint32_t length;
+    uint16_t kind;
+    uint16_t identifierLength;
+    uint32_t checksum;
+    uint32_t pid;
+    uint64_t changeNumber;
+} DYFStoreSharedRecordHeader;
+
+/** A mapping of the index. A grown index is mapped again, and the old mappings stay valid for the readers until the store is closed.
+ */
+typedef struct DYFStoreSharedMapping {
+    DYFStoreSharedIndexHeader *header;
+    size_t size;
+    struct DYFStoreSharedMapping *next;
+} DYFStoreSharedMapping;
+
+/** An open log of one generation. The logs of older generations stay open until the store is closed.
+ */
+typedef struct DYFStoreSharedLog {
+    int fd;
+    uint64_t generation;
+    struct DYFStoreSharedLog *next;
+} DYFStoreSharedLog;
+
+/** A consistent view of the index for a reader. The capacities are the ones its mapping was sized for, so the reader never probes past it, even if a writer grows the index meanwhile.
+ */
+typedef struct {
+    DYFStoreSharedIndexHeader *header;
+    DYFStoreSharedLog *log;
+    /** The sequence the read began with. */
+    uint64_t sequence;
+    uint32_t capacity;
+    uint32_t ringCapacity;
+} DYFStoreSharedSnapshot;
+
+struct DYFStoreSharedFile {
+    char *indexPath;
+    char *logPath;
+    int indexFd;
+    DYFStoreSharedMapping *mapping;
+    DYFStoreSharedLog *log;
+    /** Serializes the writers of this process, which share the lock of the file, and the remapping. */
+    pthread_mutex_t mutex;
+};
+
+// MARK: - Helpers
+
+static uint64_t DYFStoreSharedHash(const char *identifier, size_t length)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t idx = 0; idx < length; idx++) {
+        hash = (hash ^ (uint8_t)identifier[idx]) * 1099511628211ull;
+    }
+    return hash > DYFStoreSharedDeletedSlot ? hash : hash + 2;
+}
+
+static uint32_t DYFStoreSharedChecksum(const void *bytes, size_t length)
+{
+    const uint8_t *p = bytes;
+    uint32_t hash = 2166136261u;
+    for (size_t idx = 0; idx < length; idx++) {
+        hash = (hash ^ p[idx]) * 16777619u;
+    }
+    return hash;
+}
+
+static inline size_t DYFStoreSharedRecordSize(size_t length)
+{
+    return (sizeof(DYFStoreSharedRecordHeader) + length + 7) & ~(size_t)7;
+}
+
+static inline size_t DYFStoreSharedIndexSize(uint32_t ringCapacity, uint32_t capacity)
+{
+    return sizeof(DYFStoreSharedIndexHeader) + ((size_t)ringCapacity + capacity) * sizeof(DYFStoreSharedSlot);
+}
+
+static inline DYFStoreSharedSlot *DYFStoreSharedRing(DYFStoreSharedIndexHeader *header)
+{
+    return (DYFStoreSharedSlot *)(header + 1);
+}
+
+static inline DYFStoreSharedSlot *DYFStoreSharedTable(DYFStoreSharedIndexHeader *header, uint32_t ringCapacity)
+{
+    return DYFStoreSharedRing(header) + ringCapacity;
+}
+
+static int DYFStoreSharedReadFully(int fd, void *buffer, size_t length, uint64_t offset)
+{
+    uint8_t *p = buffer;
+    while (length > 0) {
+        ssize_t n = pread(fd, p, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return -1; }
+        p += n;
+        offset += (uint64_t)n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+static int DYFStoreSharedWriteFully(int fd, const void *buffer, size_t length, uint64_t offset)
+{
+    const uint8_t *p = buffer;
+    while (length > 0) {
+        ssize_t n = pwrite(fd, p, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return -1; }
+        p += n;
+        offset += (uint64_t)n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+/** Reads a record of the log.
+ 
+ @param length The bytes of the payload to read: the identifier only, or the whole payload, whose checksum is then verified.
+ @param payload Receives the payload, to be released with `free`. Can be NULL.
+ @return 0, or -1 if the record is not within the committed log or is damaged.
+ */
+static int DYFStoreSharedReadRecord(int fd, uint64_t offset, uint64_t logLength, DYFStoreSharedRecordHeader *header, int whole, char **payload)
+{
+    if (offset < sizeof(DYFStoreSharedLogHeader) || offset + sizeof(*header) > logLength) { return -1; }
+    if (DYFStoreSharedReadFully(fd, header, sizeof(*header), offset) != 0) { return -1; }
+    if (header->identifierLength > header->length ||
+        offset + DYFStoreSharedRecordSize(header->length) > logLength) {
+        return -1;
+    }
+    if (!payload) { return 0; }
+    
+    size_t length = whole ? header->length : header->identifierLength;
+    char *bytes = malloc(length + 1);
+    if (!bytes) { return -1; }
+    if (DYFStoreSharedReadFully(fd, bytes, length, offset + sizeof(*header)) != 0 ||
+        (whole && DYFStoreSharedChecksum(bytes, length) != header->checksum)) {
+        free(bytes);
+        return -1;
+    }
+    *payload = bytes;
+    return 0;
+}
+
+static char *DYFStoreSharedPath(const char *directory, const char *name)
+{
+    size_t length = strlen(directory) + strlen(name) + 2;
+    char *path = malloc(length);
+    if (path) {
+        strcpy(path, directory);
+        strcat(path, "/");
+        strcat(path, name);
+    }
+    return path;
+}
+
+// MARK: - Mapping
+
+/** Returns the index mapped over at least `needed` bytes, or NULL if the file is shorter.
+ */
+static DYFStoreSharedIndexHeader *DYFStoreSharedMap(DYFStoreSharedFile *file, size_t needed)
+{
+    DYFStoreSharedMapping *mapping = __atomic_load_n(&file->mapping, __ATOMIC_ACQUIRE);
+    if (mapping && mapping->size >= needed) { return mapping->header; }
+    
+    pthread_mutex_lock(&file->mutex);
+    mapping = file->mapping;
+    if (mapping && mapping->size >= needed) {
+        pthread_mutex_unlock(&file->mutex);
+        return mapping->header;
+    }
+    
+    struct stat st;
+    void *address = MAP_FAILED;
+    if (fstat(file->indexFd, &st) == 0 && (size_t)st.st_size >= needed && st.st_size > 0) {
+        address = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file->indexFd, 0);
+    }
+    DYFStoreSharedMapping *next = address != MAP_FAILED ? malloc(sizeof(*next)) : NULL;
+    if (!next) {
+        if (address != MAP_FAILED) { munmap(address, (size_t)st.st_size); }
+        pthread_mutex_unlock(&file->mutex);
+        return NULL;
+    }
+    
+    next->header = address;
+    next->size = (size_t)st.st_size;
+    next->next = mapping;
+    __atomic_store_n(&file->mapping, next, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&file->mutex);
+    return next->header;
+}
+
+/** Returns the open log of a generation, opening it if needed, or NULL if the log at the path is of another generation.
+ */
+static DYFStoreSharedLog *DYFStoreSharedLogOfGeneration(DYFStoreSharedFile *file, uint64_t generation)
+{
+    DYFStoreSharedLog *log = __atomic_load_n(&file->log, __ATOMIC_ACQUIRE);
+    for (DYFStoreSharedLog *open = log; open; open = open->next) {
+        if (open->generation == generation) { return open; }
+    }
+    
+    pthread_mutex_lock(&file->mutex);
+    DYFStoreSharedLog *result = NULL;
+    int fd = open(file->logPath, O_RDWR | O_CLOEXEC);
+    DYFStoreSharedLogHeader header;
+    if (fd >= 0 &&
+        DYFStoreSharedReadFully(fd, &header, sizeof(header), 0) == 0 &&
+        header.magic == DYFStoreSharedLogMagic && header.generation == generation &&
+        (result = malloc(sizeof(*result)))) {
+        result->fd = fd;
+        result->generation = generation;
+        result->next = file->log;
+        __atomic_store_n(&file->log, result, __ATOMIC_RELEASE);
+    } else if (fd >= 0) {
+        close(fd);
+    }
+    pthread_mutex_unlock(&file->mutex);
+    return result;
+}
+
+// MARK: - Table
+
+/** Finds the slot of an identifier.
+ 
+ @param capacity The capacity of the table. A reader passes the one of its snapshot, not the one in the header, which a writer can grow at any time.
+ @param ringCapacity The capacity of the ring.
+ @param slotIndex Receives the index of the slot, or of the slot to insert into if the identifier is not found.
+ @return 1 if found.
+ */
+static int DYFStoreSharedFind(DYFStoreSharedIndexHeader *header, uint32_t capacity, uint32_t ringCapacity, int fd,
+                              const char *identifier, size_t identifierLength, uint64_t hash, uint32_t *slotIndex)
+{
+    uint64_t logLength = DYFStoreSharedLoad(header->logLength);
+    DYFStoreSharedSlot *table = DYFStoreSharedTable(header, ringCapacity);
+    uint32_t mask = capacity - 1;
+    uint32_t insertion = UINT32_MAX;
+    
+    for (uint32_t probe = 0, idx = (uint32_t)hash & mask; probe < capacity; probe++, idx = (idx + 1) & mask) {
+        uint64_t slotHash = DYFStoreSharedLoad(table[idx].hash);
+        if (slotHash == DYFStoreSharedEmptySlot) {
+            *slotIndex = insertion != UINT32_MAX ? insertion : idx;
+            return 0;
+        }
+        if (slotHash == DYFStoreSharedDeletedSlot) {
+            if (insertion == UINT32_MAX) { insertion = idx; }
+            continue;
+        }
+        if (slotHash != hash) { continue; }
+        
+        // Equal hashes are told apart by the identifier in the log.
+        DYFStoreSharedRecordHeader record;
+        char *stored = NULL;
+        if (DYFStoreSharedReadRecord(fd, DYFStoreSharedLoad(table[idx].offset), logLength, &record, 0, &stored) != 0) {
+            continue;
+        }
+        int equal = record.identifierLength == identifierLength && memcmp(stored, identifier, identifierLength) == 0;
+        free(stored);
+        if (equal) {
+            *slotIndex = idx;
+            return 1;
+        }
+    }
+    
+    *slotIndex = insertion;
+    return 0;
+}
+
+/** Rebuilds the hash table with a capacity for `count` records. Called by a writer while the sequence is odd.
+ */
+static DYFStoreSharedIndexHeader *DYFStoreSharedRehash(DYFStoreSharedFile *file, DYFStoreSharedIndexHeader *header, uint32_t count)
+{
+    uint32_t capacity = DYFStoreSharedInitialCapacity;
+    while (capacity < count * 2) { capacity *= 2; }
+    
+    uint32_t ringCapacity = header->ringCapacity;
+    uint32_t oldCapacity = header->capacity;
+    DYFStoreSharedSlot *table = DYFStoreSharedTable(header, ringCapacity);
+    DYFStoreSharedSlot *live = malloc(sizeof(*live) * (header->count + 1));
+    if (!live) { return NULL; }
+    uint32_t liveCount = 0;
+    for (uint32_t idx = 0; idx < oldCapacity; idx++) {
+        if (table[idx].hash > DYFStoreSharedDeletedSlot) { live[liveCount++] = table[idx]; }
+    }
+    
+    // The file only grows, so that the mappings of the readers stay valid.
+    size_t size = DYFStoreSharedIndexSize(ringCapacity, capacity);
+    struct stat st;
+    if (fstat(file->indexFd, &st) != 0 || ((size_t)st.st_size < size && ftruncate(file->indexFd, (off_t)size) != 0)) {
+        free(live);
+        return NULL;
+    }
+    header = DYFStoreSharedMap(file, size);
+    if (!header) {
+        free(live);
+        return NULL;
+    }
+    
+    table = DYFStoreSharedTable(header, ringCapacity);
+    memset(table, 0, sizeof(*table) * (oldCapacity > capacity ? oldCapacity : capacity));
+    for (uint32_t idx = 0; idx < liveCount; idx++) {
+        uint32_t slot = (uint32_t)live[idx].hash & (capacity - 1);
+        while (table[slot].hash != DYFStoreSharedEmptySlot) { slot = (slot + 1) & (capacity - 1); }
+        table[slot] = live[idx];
+    }
+    free(live);
+    
+    header->capacity = capacity;
+    header->count = liveCount;
+    header->deleted = 0;
+    return header;
+}
+
+// MARK: - Writing
+
+/** Begins an update of the index, which the readers see as in progress.
+ */
+static inline void DYFStoreSharedWriteBegin(DYFStoreSharedIndexHeader *header)
+{
+    uint64_t sequence = header->sequence;
+    __atomic_store_n(&header->sequence, sequence | 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void DYFStoreSharedWriteEnd(DYFStoreSharedIndexHeader *header)
+{
+    __atomic_store_n(&header->sequence, (header->sequence | 1) + 1, __ATOMIC_RELEASE);
+}
+
+/** Applies a record to the table and the ring. Called by a writer while the sequence is odd.
+ */
+static DYFStoreSharedIndexHeader *DYFStoreSharedApply(DYFStoreSharedFile *file, DYFStoreSharedIndexHeader *header, int fd,
+                                                      const DYFStoreSharedRecordHeader *record, const char *identifier, uint64_t offset)
+{
+    uint64_t size = DYFStoreSharedRecordSize(record->length);
+    
+    if (record->kind == DYFStoreSharedChangeRemoveAll) {
+        memset(DYFStoreSharedTable(header, header->ringCapacity), 0, sizeof(DYFStoreSharedSlot) * header->capacity);
+        header->count = 0;
+        header->deleted = 0;
+        header->garbage = offset + size - sizeof(DYFStoreSharedLogHeader);
+    } else {
+        if ((uint64_t)(header->count + header->deleted + 1) * 4 > (uint64_t)header->capacity * 3) {
+            header = DYFStoreSharedRehash(file, header, header->count + 1);
+            if (!header) { return NULL; }
+        }
+        
+        uint64_t hash = DYFStoreSharedHash(identifier, record->identifierLength);
+        uint32_t slot = 0;
+        int found = DYFStoreSharedFind(header, header->capacity, header->ringCapacity, fd, identifier, record->identifierLength, hash, &slot);
+        DYFStoreSharedSlot *table = DYFStoreSharedTable(header, header->ringCapacity);
+        
+        if (found) {
+            DYFStoreSharedRecordHeader old;
+            if (DYFStoreSharedReadRecord(fd, table[slot].offset, offset, &old, 0, NULL) == 0) {
+                header->garbage += DYFStoreSharedRecordSize(old.length);
+            }
+        }
+        
+        if (record->kind == DYFStoreSharedChangeStore) {
+            if (!found) {
+                if (table[slot].hash == DYFStoreSharedDeletedSlot) { header->deleted--; }
+                header->count++;
+            }
+            DYFStoreSharedStore(table[slot].offset, offset);
+            DYFStoreSharedStore(table[slot].hash, hash);
+        } else {
+            if (found) {
+                DYFStoreSharedStore(table[slot].hash, (uint64_t)DYFStoreSharedDeletedSlot);
+                header->count--;
+                header->deleted++;
+            }
+            header->garbage += size;
+        }
+    }
+    
+    DYFStoreSharedSlot *ring = DYFStoreSharedRing(header);
+    DYFStoreSharedSlot *entry = &ring[record->changeNumber % header->ringCapacity];
+    DYFStoreSharedStore(entry->offset, offset);
+    DYFStoreSharedStore(entry->hash, record->changeNumber);
+    header->changeNumber = record->changeNumber;
+    header->logLength = offset + size;
+    return header;
+}
+
+/** Rebuilds the index from the log, after the index was created or a writer died in the middle of an update. Called with the lock held.
+ */
+static DYFStoreSharedIndexHeader *DYFStoreSharedRepair(DYFStoreSharedFile *file, DYFStoreSharedIndexHeader *header)
+{
+    DYFStoreSharedWriteBegin(header);
+    
+    int fd = open(file->logPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) { return NULL; }
+    
+    struct stat st;
+    DYFStoreSharedLogHeader logHeader;
+    if (fstat(fd, &st) != 0 ||
+        (size_t)st.st_size < sizeof(logHeader) ||
+        DYFStoreSharedReadFully(fd, &logHeader, sizeof(logHeader), 0) != 0 ||
+        logHeader.magic != DYFStoreSharedLogMagic) {
+        logHeader.magic = DYFStoreSharedLogMagic;
+        logHeader.version = DYFStoreSharedVersion;
+        logHeader.generation = header->generation + 1;
+        logHeader.changeNumber = 0;
+        logHeader.length = sizeof(logHeader);
+        if (ftruncate(fd, 0) != 0 || DYFStoreSharedWriteFully(fd, &logHeader, sizeof(logHeader), 0) != 0) {
+            close(fd);
+            return NULL;
+        }
+        st.st_size = sizeof(logHeader);
+    }
+    
+    header->generation = logHeader.generation;
+    header->changeNumber = logHeader.length > sizeof(logHeader) ? 0 : logHeader.changeNumber;
+    header->logLength = sizeof(logHeader);
+    header->garbage = 0;
+    header->count = 0;
+    header->deleted = 0;
+    memset(DYFStoreSharedRing(header), 0, sizeof(DYFStoreSharedSlot) * header->ringCapacity);
+    memset(DYFStoreSharedTable(header, header->ringCapacity), 0, sizeof(DYFStoreSharedSlot) * header->capacity);
+    
+    // Replays the records up to the first damaged or uncommitted one, whose change number does not follow.
+    uint64_t offset = sizeof(logHeader);
+    DYFStoreSharedRecordHeader record;
+    char *payload = NULL;
+    while (DYFStoreSharedReadRecord(fd, offset, (uint64_t)st.st_size, &record, 1, &payload) == 0) {
+        int copied = offset < logHeader.length;
+        if ((copied ? record.kind != DYFStoreSharedChangeStore : record.changeNumber != header->changeNumber + 1) ||
+            record.kind < DYFStoreSharedChangeStore || record.kind > DYFStoreSharedChangeRemoveAll) {
+            free(payload);
+            break;
+        }
+        // The records read by `DYFStoreSharedFind` must be within the committed log.
+        header->logLength = offset;
+        DYFStoreSharedIndexHeader *applied = DYFStoreSharedApply(file, header, fd, &record, payload, offset);
+        free(payload);
+        if (!applied) {
+            close(fd);
+            return NULL;
+        }
+        header = applied;
+        offset += DYFStoreSharedRecordSize(record.length);
+        if (offset == logHeader.length) { header->changeNumber = logHeader.changeNumber; }
+    }
+    
+    // Drops the uncommitted tail, so that it is never replayed later.
+    if ((uint64_t)st.st_size > header->logLength && ftruncate(fd, (off_t)header->logLength) != 0) {
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    
+    DYFStoreSharedWriteEnd(header);
+    return header;
+}
+
+/** Takes the lock of the file, and creates or repairs the index if needed.
+ */
+static DYFStoreSharedIndexHeader *DYFStoreSharedLock(DYFStoreSharedFile *file)
+{
+    pthread_mutex_lock(&file->mutex);
+    while (flock(file->indexFd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            pthread_mutex_unlock(&file->mutex);
+            return NULL;
+        }
+    }
+    
+    struct stat st;
+    DYFStoreSharedIndexHeader *header = NULL;
+    if (fstat(file->indexFd, &st) == 0 && (size_t)st.st_size >= sizeof(DYFStoreSharedIndexHeader)) {
+        header = DYFStoreSharedMap(file, sizeof(DYFStoreSharedIndexHeader));
+    }
+    
+    if (!header || header->magic != DYFStoreSharedIndexMagic || header->version != DYFStoreSharedVersion) {
+        size_t size = DYFStoreSharedIndexSize(DYFStoreSharedRingCapacity, DYFStoreSharedInitialCapacity);
+        if (((size_t)st.st_size < size && ftruncate(file->indexFd, (off_t)size) != 0) ||
+            !(header = DYFStoreSharedMap(file, size))) {
+            flock(file->indexFd, LOCK_UN);
+            pthread_mutex_unlock(&file->mutex);
+            return NULL;
+        }
+        uint64_t generation = header->magic == DYFStoreSharedIndexMagic ? header->generation : 0;
+        memset(header, 0, size);
+        header->magic = DYFStoreSharedIndexMagic;
+        header->version = DYFStoreSharedVersion;
+        header->sequence = 1;
+        header->generation = generation;
+        header->capacity = DYFStoreSharedInitialCapacity;
+        header->ringCapacity = DYFStoreSharedRingCapacity;
+    } else {
+        header = DYFStoreSharedMap(file, DYFStoreSharedIndexSize(header->ringCapacity, header->capacity));
+    }
+    
+    if (header && (header->sequence & 1)) {
+        header = DYFStoreSharedRepair(file, header);
+    }
+    if (!header) {
+        flock(file->indexFd, LOCK_UN);
+        pthread_mutex_unlock(&file->mutex);
+    }
+    return header;
+}
+
+static void DYFStoreSharedUnlock(DYFStoreSharedFile *file)
+{
+    flock(file->indexFd, LOCK_UN);
+    pthread_mutex_unlock(&file->mutex);
+}
+
+/** Sorts the live slots by offset.
+ */
+static int DYFStoreSharedCompareOffsets(const void *a, const void *b)
+{
+    uint64_t x = ((const DYFStoreSharedSlot *)a)->offset;
+    uint64_t y = ((const DYFStoreSharedSlot *)b)->offset;
+    return x < y ? -1 : x > y;
+}
+
+/** Copies the live records into a log of the next generation, which replaces the current one. Called with the lock held.
+ */
+static void DYFStoreSharedCompact(DYFStoreSharedFile *file, DYFStoreSharedIndexHeader *header, DYFStoreSharedLog *log)
+{
+    uint32_t capacity = header->capacity;
+    DYFStoreSharedSlot *table = DYFStoreSharedTable(header, header->ringCapacity);
+    // The hash member holds the index of the slot here.
+    DYFStoreSharedSlot *live = malloc(sizeof(*live) * (header->count + 1));
+    if (!live) { return; }
+    uint32_t count = 0;
+    for (uint32_t idx = 0; idx < capacity; idx++) {
+        if (table[idx].hash > DYFStoreSharedDeletedSlot) {
+            live[count].hash = idx;
+            live[count].offset = table[idx].offset;
+            count++;
+        }
+    }
+    qsort(live, count, sizeof(*live), DYFStoreSharedCompareOffsets);
+    
+    size_t pathLength = strlen(file->logPath);
+    char *path = malloc(pathLength + 9);
+    int fd = path ? open(strcat(strcpy(path, file->logPath), ".compact"), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+    DYFStoreSharedLogHeader logHeader = {DYFStoreSharedLogMagic, DYFStoreSharedVersion, header->generation + 1, header->changeNumber, 0};
+    uint64_t length = sizeof(logHeader);
+    int failed = fd < 0 || DYFStoreSharedWriteFully(fd, &logHeader, sizeof(logHeader), 0) != 0;
+    
+    uint64_t *offsets = malloc(sizeof(uint64_t) * (count + 1));
+    failed = failed || !offsets;
+    for (uint32_t idx = 0; idx < count && !failed; idx++) {
+        DYFStoreSharedRecordHeader record;
+        if (DYFStoreSharedReadRecord(log->fd, live[idx].offset, header->logLength, &record, 0, NULL) != 0) {
+            failed = 1;
+            break;
+        }
+        size_t size = DYFStoreSharedRecordSize(record.length);
+        void *bytes = malloc(size);
+        failed = !bytes ||
+            DYFStoreSharedReadFully(log->fd, bytes, size, live[idx].offset) != 0 ||
+            DYFStoreSharedWriteFully(fd, bytes, size, length) != 0;
+        free(bytes);
+        offsets[idx] = length;
+        length += size;
+    }
+    logHeader.length = length;
+    failed = failed || DYFStoreSharedWriteFully(fd, &logHeader, sizeof(logHeader), 0) != 0 || fsync(fd) != 0;
+    
+    if (!failed) {
+        DYFStoreSharedWriteBegin(header);
+        if (rename(path, file->logPath) == 0) {
+            for (uint32_t idx = 0; idx < count; idx++) {
+                DYFStoreSharedStore(table[live[idx].hash].offset, offsets[idx]);
+            }
+            // The changes before the compaction point into the old log, so they are dropped and reported as a reset.
+            memset(DYFStoreSharedRing(header), 0, sizeof(DYFStoreSharedSlot) * header->ringCapacity);
+            header->generation = logHeader.generation;
+            header->logLength = length;
+            header->garbage = 0;
+        }
+        DYFStoreSharedWriteEnd(header);
+    } else if (path) {
+        unlink(path);
+    }
+    
+    if (fd >= 0) { close(fd); }
+    free(offsets);
+    free(path);
+    free(live);
+}
+
+/** Appends records to the log and applies them to the index under the lock.
+ 
+ @param kinds The kinds of the records.
+ @param identifiers The identifiers of the records.
+ @param records The records of the stores. Can be NULL.
+ @return 0, or -1 with errno set.
+ */
+static int DYFStoreSharedWrite(DYFStoreSharedFile *file, size_t count, const uint16_t *kinds,
+                               const char *const *identifiers, const size_t *identifierLengths,
+                               const void *const *records, const size_t *lengths)
+{
+    DYFStoreSharedIndexHeader *header = DYFStoreSharedLock(file);
+    if (!header) { return -1; }
+    DYFStoreSharedLog *log = DYFStoreSharedLogOfGeneration(file, header->generation);
+    if (!log) {
+        DYFStoreSharedUnlock(file);
+        errno = EIO;
+        return -1;
+    }
+    
+    // All records are written first, so that the index is updated in one step.
+    size_t total = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        size_t length = identifierLengths[idx] + (records ? lengths[idx] : 0);
+        if (identifierLengths[idx] > UINT16_MAX || length > UINT32_MAX) {
+            DYFStoreSharedUnlock(file);
+            errno = EINVAL;
+            return -1;
+        }
+        total += DYFStoreSharedRecordSize(length);
+    }
+    uint8_t *buffer = calloc(1, total + 1);
+    if (!buffer) {
+        DYFStoreSharedUnlock(file);
+        return -1;
+    }
+    
+    uint64_t start = header->logLength;
+    size_t position = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        size_t recordLength = records ? lengths[idx] : 0;
+        DYFStoreSharedRecordHeader record = {0};
+        record.length = (uint32_t)(identifierLengths[idx] + recordLength);
+        record.kind = kinds[idx];
+        record.identifierLength = (uint16_t)identifierLengths[idx];
+        record.pid = (uint32_t)getpid();
+        record.changeNumber = header->changeNumber + idx + 1;
+        
+        uint8_t *payload = buffer + position + sizeof(record);
+        if (identifierLengths[idx] > 0) { memcpy(payload, identifiers[idx], identifierLengths[idx]); }
+        if (recordLength > 0) { memcpy(payload + identifierLengths[idx], records[idx], recordLength); }
+        record.checksum = DYFStoreSharedChecksum(payload, record.length);
+        memcpy(buffer + position, &record, sizeof(record));
+        position += DYFStoreSharedRecordSize(record.length);
+    }
+    
+    if (DYFStoreSharedWriteFully(log->fd, buffer, total, start) != 0) {
+        free(buffer);
+        DYFStoreSharedUnlock(file);
+        return -1;
+    }
+    
+    DYFStoreSharedWriteBegin(header);
+    position = 0;
+    for (size_t idx = 0; idx < count && header; idx++) {
+        DYFStoreSharedRecordHeader record;
+        memcpy(&record, buffer + position, sizeof(record));
+        header = DYFStoreSharedApply(file, header, log->fd, &record, (const char *)buffer + position + sizeof(record), start + position);
+        position += DYFStoreSharedRecordSize(record.length);
+    }
+    free(buffer);
+    if (!header) {
+        // The sequence stays odd, so the next writer or reader repairs the index from the log.
+        DYFStoreSharedUnlock(file);
+        errno = EIO;
+        return -1;
+    }
+    DYFStoreSharedWriteEnd(header);
+    
+    if (header->garbage > DYFStoreSharedCompactionThreshold && header->garbage * 2 > header->logLength) {
+        DYFStoreSharedCompact(file, header, log);
+    }
+    DYFStoreSharedUnlock(file);
+    return 0;
+}
+
+// MARK: - Reading
+
+/** Waits until no writer updates the index, and returns its sequence. A writer that keeps it odd too long has died, so the lock is taken, which repairs the index.
+ */
+static DYFStoreSharedIndexHeader *DYFStoreSharedReadBegin(DYFStoreSharedFile *file, uint64_t *sequence)
+{
+    for (uint32_t spins = 0;; spins++) {
+        DYFStoreSharedIndexHeader *header = DYFStoreSharedMap(file, sizeof(DYFStoreSharedIndexHeader));
+        uint64_t value = header ? __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE) : 1;
+        if (header && header->magic == DYFStoreSharedIndexMagic && !(value & 1)) {
+            *sequence = value;
+            return header;
+        }
+        if (header && spins < DYFStoreSharedSpins) {
+            sched_yield();
+            continue;
+        }
+        if (!DYFStoreSharedLock(file)) { return NULL; }
+        DYFStoreSharedUnlock(file);
+        spins = 0;
+    }
+}
+
+/** Returns whether a writer changed the index since the read began.
+ */
+static inline int DYFStoreSharedReadChanged(DYFStoreSharedIndexHeader *header, uint64_t sequence)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&header->sequence, __ATOMIC_RELAXED) != sequence;
+}
+
+/** Reads the snapshot of the index needed by a reader: the mapping over the capacities read under the sequence, and the open log of its generation.
+ 
+ @return 1 if the snapshot can be read, 0 if it changed and must be retried, -1 on error.
+ */
+static int DYFStoreSharedReadSnapshot(DYFStoreSharedFile *file, DYFStoreSharedSnapshot *snapshot)
+{
+    DYFStoreSharedIndexHeader *h = DYFStoreSharedReadBegin(file, &snapshot->sequence);
+    if (!h) { return -1; }
+    uint32_t ringCapacity = DYFStoreSharedLoad(h->ringCapacity);
+    uint32_t capacity = DYFStoreSharedLoad(h->capacity);
+    uint64_t generation = DYFStoreSharedLoad(h->generation);
+    if (DYFStoreSharedReadChanged(h, snapshot->sequence)) { return 0; }
+    
+    h = DYFStoreSharedMap(file, DYFStoreSharedIndexSize(ringCapacity, capacity));
+    DYFStoreSharedLog *log = h ? DYFStoreSharedLogOfGeneration(file, generation) : NULL;
+    if (!h || !log) {
+        return h && DYFStoreSharedReadChanged(h, snapshot->sequence) ? 0 : -1;
+    }
+    snapshot->header = h;
+    snapshot->log = log;
+    snapshot->capacity = capacity;
+    snapshot->ringCapacity = ringCapacity;
+    return 1;
+}
+
+/** Looks up the offset of a record.
+ 
+ @return 1 if found, 0 if not, -1 on error.
+ */
+static int DYFStoreSharedLookUp(DYFStoreSharedFile *file, const char *identifier, size_t identifierLength,
+                                DYFStoreSharedLog **log, uint64_t *offset, uint64_t *logLength)
+{
+    uint64_t hash = DYFStoreSharedHash(identifier, identifierLength);
+    for (uint32_t attempt = 0; attempt < DYFStoreSharedRetries; attempt++) {
+        DYFStoreSharedSnapshot snapshot;
+        int status = DYFStoreSharedReadSnapshot(file, &snapshot);
+        if (status < 0) { return -1; }
+        if (status == 0) { continue; }
+        
+        DYFStoreSharedIndexHeader *header = snapshot.header;
+        uint32_t slot = 0;
+        int found = DYFStoreSharedFind(header, snapshot.capacity, snapshot.ringCapacity, snapshot.log->fd, identifier, identifierLength, hash, &slot);
+        if (found) {
+            *offset = DYFStoreSharedLoad(DYFStoreSharedTable(header, snapshot.ringCapacity)[slot].offset);
+        }
+        *logLength = DYFStoreSharedLoad(header->logLength);
+        *log = snapshot.log;
+        if (!DYFStoreSharedReadChanged(header, snapshot.sequence)) { return found; }
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+// MARK: - Public
+
+DYFStoreSharedFile *DYFStoreSharedFileOpen(const char *directory)
+{
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) { return NULL; }
+    
+    DYFStoreSharedFile *file = calloc(1, sizeof(*file));
+    if (!file) { return NULL; }
+    file->indexFd = -1;
+    file->indexPath = DYFStoreSharedPath(directory, "DYFStoreTransactions.index");
+    file->logPath = DYFStoreSharedPath(directory, "DYFStoreTransactions.log");
+    
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&file->mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    
+    if (file->indexPath && file->logPath) {
+        file->indexFd = open(file->indexPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    }
+    // Creates or repairs the files once, so that the readers find them ready.
+    if (file->indexFd < 0 || !DYFStoreSharedLock(file)) {
+        int error = errno;
+        DYFStoreSharedFileClose(file);
+        errno = error;
+        return NULL;
+    }
+    DYFStoreSharedUnlock(file);
+    return file;
+}
+
+void DYFStoreSharedFileClose(DYFStoreSharedFile *file)
+{
+    if (!file) { return; }
+    
+    for (DYFStoreSharedMapping *mapping = file->mapping, *next; mapping; mapping = next) {
+        next = mapping->next;
+        munmap(mapping->header, mapping->size);
+        free(mapping);
+    }
+    for (DYFStoreSharedLog *log = file->log, *next; log; log = next) {
+        next = log->next;
+        close(log->fd);
+        free(log);
+    }
+    if (file->indexFd >= 0) { close(file->indexFd); }
+    pthread_mutex_destroy(&file->mutex);
+    free(file->indexPath);
+    free(file->logPath);
+    free(file);
+}
+
+int DYFStoreSharedFileStore(DYFStoreSharedFile *file, const char *identifier, size_t identifierLength, const void *record, size_t length)
+{
+    if (identifierLength == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint16_t kind = DYFStoreSharedChangeStore;
+    return DYFStoreSharedWrite(file, 1, &kind, &identifier, &identifierLength, &record, &length);
+}
+
+int DYFStoreSharedFileStoreAll(DYFStoreSharedFile *file, const char *const *identifiers, const size_t *identifierLengths,
+                               const void *const *records, const size_t *lengths, size_t count)
+{
+    if (count == 0) { return 0; }
+    for (size_t idx = 0; idx < count; idx++) {
+        if (identifierLengths[idx] == 0) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    
+    uint16_t *kinds = malloc(sizeof(uint16_t) * count);
+    if (!kinds) { return -1; }
+    for (size_t idx = 0; idx < count; idx++) {
+        kinds[idx] = DYFStoreSharedChangeStore;
+    }
+    
+    int status = DYFStoreSharedWrite(file, count, kinds, identifiers, identifierLengths, records, lengths);
+    free(kinds);
+    return status;
+}
+
+long DYFStoreSharedFileRemove(DYFStoreSharedFile *file, const char *const *identifiers, const size_t *identifierLengths, size_t count)
+{
+    // Only the identifiers that are stored get a tombstone.
+    const char **present = malloc(sizeof(char *) * (count + 1));
+    size_t *presentLengths = malloc(sizeof(size_t) * (count + 1));
+    uint16_t *kinds = malloc(sizeof(uint16_t) * (count + 1));
+    if (!present || !presentLengths || !kinds) {
+        free(present);
+        free(presentLengths);
+        free(kinds);
+        return -1;
+    }
+    
+    size_t presentCount = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        if (identifierLengths[idx] > 0 && DYFStoreSharedFileContains(file, identifiers[idx], identifierLengths[idx]) == 1) {
+            present[presentCount] = identifiers[idx];
+            presentLengths[presentCount] = identifierLengths[idx];
+            kinds[presentCount] = DYFStoreSharedChangeRemove;
+            presentCount++;
+        }
+    }
+    
+    int status = presentCount > 0 ? DYFStoreSharedWrite(file, presentCount, kinds, present, presentLengths, NULL, NULL) : 0;
+    free(present);
+    free(presentLengths);
+    free(kinds);
+    return status == 0 ? (long)presentCount : -1;
+}
+
+int DYFStoreSharedFileRemoveAll(DYFStoreSharedFile *file)
+{
+    uint16_t kind = DYFStoreSharedChangeRemoveAll;
+    const char *identifier = "";
+    size_t identifierLength = 0;
+    return DYFStoreSharedWrite(file, 1, &kind, &identifier, &identifierLength, NULL, NULL);
+}
+
+int DYFStoreSharedFileContains(DYFStoreSharedFile *file, const char *identifier, size_t identifierLength)
+{
+    DYFStoreSharedLog *log = NULL;
+    uint64_t offset = 0;
+    uint64_t logLength = 0;
+    return DYFStoreSharedLookUp(file, identifier, identifierLength, &log, &offset, &logLength);
+}
+
+void *DYFStoreSharedFileCopyRecord(DYFStoreSharedFile *file, const char *identifier, size_t identifierLength, size_t *length)
+{
+    for (uint32_t attempt = 0; attempt < DYFStoreSharedRetries; attempt++) {
+        DYFStoreSharedLog *log = NULL;
+        uint64_t offset = 0;
+        uint64_t logLength = 0;
+        if (DYFStoreSharedLookUp(file, identifier, identifierLength, &log, &offset, &logLength) != 1) { return NULL; }
+        
+        // The committed part of a log never changes, so the record is read after the index.
+        DYFStoreSharedRecordHeader record;
+        char *payload = NULL;
+        if (DYFStoreSharedReadRecord(log->fd, offset, logLength, &record, 1, &payload) != 0) { continue; }
+        
+        size_t recordLength = record.length - record.identifierLength;
+        memmove(payload, payload + record.identifierLength, recordLength);
+        *length = recordLength;
+        return payload;
+    }
+    return NULL;
+}
+
+long DYFStoreSharedFileEnumerate(DYFStoreSharedFile *file,
+                                 void (*function)(const char *identifier, size_t identifierLength, const void *record, size_t length, void *context),
+                                 void *context)
+{
+    for (uint32_t attempt = 0; attempt < DYFStoreSharedRetries; attempt++) {
+        DYFStoreSharedSnapshot snapshot;
+        int status = DYFStoreSharedReadSnapshot(file, &snapshot);
+        if (status < 0) { return -1; }
+        if (status == 0) { continue; }
+        
+        DYFStoreSharedIndexHeader *header = snapshot.header;
+        DYFStoreSharedLog *log = snapshot.log;
+        uint64_t sequence = snapshot.sequence;
+        uint32_t capacity = snapshot.capacity;
+        // A count changed by a writer meanwhile can exceed the table, and the snapshot is retried anyway.
+        uint32_t count = DYFStoreSharedLoad(header->count);
+        count = count < capacity ? count : capacity;
+        uint64_t logLength = DYFStoreSharedLoad(header->logLength);
+        DYFStoreSharedSlot *table = DYFStoreSharedTable(header, snapshot.ringCapacity);
+        DYFStoreSharedSlot *live = malloc(sizeof(*live) * ((size_t)count + 1));
+        if (!live) { return -1; }
+        uint32_t liveCount = 0;
+        for (uint32_t idx = 0; idx < capacity && liveCount <= count; idx++) {
+            DYFStoreSharedSlot slot = {DYFStoreSharedLoad(table[idx].hash), DYFStoreSharedLoad(table[idx].offset)};
+            if (slot.hash > DYFStoreSharedDeletedSlot && liveCount < count) { live[liveCount++] = slot; }
+        }
+        if (DYFStoreSharedReadChanged(header, sequence)) {
+            free(live);
+            continue;
+        }
+        
+        qsort(live, liveCount, sizeof(*live), DYFStoreSharedCompareOffsets);
+        for (uint32_t idx = 0; idx < liveCount; idx++) {
+            DYFStoreSharedRecordHeader record;
+            char *payload = NULL;
+            if (DYFStoreSharedReadRecord(log->fd, live[idx].offset, logLength, &record, 1, &payload) != 0) { continue; }
+            function(payload, record.identifierLength, payload + record.identifierLength, record.length - record.identifierLength, context);
+            free(payload);
+        }
+        free(live);
+        return liveCount;
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+uint64_t DYFStoreSharedFileChangeNumber(DYFStoreSharedFile *file)
+{
+    for (;;) {
+        uint64_t sequence = 0;
+        DYFStoreSharedIndexHeader *header = DYFStoreSharedReadBegin(file, &sequence);
+        if (!header) { return 0; }
+        uint64_t changeNumber = DYFStoreSharedLoad(header->changeNumber);
+        if (!DYFStoreSharedReadChanged(header, sequence)) { return changeNumber; }
+    }
+}
+
+long DYFStoreSharedFileCopyChanges(DYFStoreSharedFile *file, uint64_t changeNumber, DYFStoreSharedChange **changes, int *reset, uint64_t *current)
+{
+    *changes = NULL;
+    *reset = 0;
+    
+    for (uint32_t attempt = 0; attempt < DYFStoreSharedRetries; attempt++) {
+        DYFStoreSharedSnapshot snapshot;
+        int status = DYFStoreSharedReadSnapshot(file, &snapshot);
+        if (status < 0) { return -1; }
+        if (status == 0) { continue; }
+        
+        DYFStoreSharedIndexHeader *header = snapshot.header;
+        DYFStoreSharedLog *log = snapshot.log;
+        uint64_t sequence = snapshot.sequence;
+        uint64_t latest = DYFStoreSharedLoad(header->changeNumber);
+        uint64_t logLength = DYFStoreSharedLoad(header->logLength);
+        uint32_t ringCapacity = snapshot.ringCapacity;
+        DYFStoreSharedSlot *ring = DYFStoreSharedRing(header);
+        
+        // The store was recreated, or more changes were made than the ring keeps.
+        int incomplete = latest < changeNumber || latest - changeNumber > ringCapacity;
+        size_t count = incomplete ? 0 : (size_t)(latest - changeNumber);
+        uint64_t *offsets = malloc(sizeof(uint64_t) * (count + 1));
+        if (!offsets) { return -1; }
+        for (size_t idx = 0; idx < count && !incomplete; idx++) {
+            uint64_t number = changeNumber + idx + 1;
+            DYFStoreSharedSlot *entry = &ring[number % ringCapacity];
+            offsets[idx] = DYFStoreSharedLoad(entry->offset);
+            // A compaction cleared the ring.
+            incomplete = DYFStoreSharedLoad(entry->hash) != number;
+        }
+        if (DYFStoreSharedReadChanged(header, sequence)) {
+            free(offsets);
+            continue;
+        }
+        *current = latest;
+        if (incomplete) {
+            free(offsets);
+            *reset = 1;
+            return 0;
+        }
+        
+        DYFStoreSharedChange *result = calloc(count + 1, sizeof(*result));
+        int failed = !result;
+        for (size_t idx = 0; idx < count && !failed; idx++) {
+            DYFStoreSharedRecordHeader record;
+            char *identifier = NULL;
+            failed = DYFStoreSharedReadRecord(log->fd, offsets[idx], logLength, &record, 0, &identifier) != 0;
+            if (failed) { break; }
+            result[idx].changeNumber = record.changeNumber;
+            result[idx].kind = (DYFStoreSharedChangeKind)record.kind;
+            result[idx].pid = record.pid;
+            result[idx].identifier = record.identifierLength > 0 ? identifier : NULL;
+            result[idx].identifierLength = record.identifierLength;
+            if (!result[idx].identifier) { free(identifier); }
+        }
+        free(offsets);
+        if (failed) {
+            DYFStoreSharedFileFreeChanges(result, count);
+            return -1;
+        }
+        *changes = result;
+        return (long)count;
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+void DYFStoreSharedFileFreeChanges(DYFStoreSharedChange *changes, size_t count)
+{
+    if (!changes) { return; }
+    for (size_t idx = 0; idx < count; idx++) {
+        free(changes[idx].identifier);
+    }
+    free(changes);
+}
@@ -0,0 +1,150 @@
+//
+//  DYFStoreSharedFile.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#ifndef DYFStoreSharedFile_h
+#define DYFStoreSharedFile_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A transaction store in a directory that several processes open at once, e.g. an app and its extensions in a shared container. It is plain POSIX, so it runs on Linux as well.
+ 
+ The records are appended to a log, "DYFStoreTransactions.log". A memory-mapped index, "DYFStoreTransactions.index", maps the hash of every transaction identifier to its record, and keeps a ring of the latest changes.
+ 
+ Writers take an exclusive `flock` on the index. Readers take no lock: the index is guarded by a sequence number that is odd while a writer updates it, and a reader retries if the number changed while it read. A reader that sees a writer die in the middle of an update repairs the index from the log.
+ 
+ When the replaced and removed records take more than half of the log, it is compacted into a new log, which replaces the old one by rename. The generation of the log tells the readers to reopen it.
+ */
+typedef struct DYFStoreSharedFile DYFStoreSharedFile;
+
+/** The kinds of change.
+ */
+typedef enum {
+    /** A record was stored or replaced. */
+    DYFStoreSharedChangeStore = 1,
+    /** A record was removed. */
+    DYFStoreSharedChangeRemove = 2,
+    /** All records were removed. */
+    DYFStoreSharedChangeRemoveAll = 3
+} DYFStoreSharedChangeKind;
+
+/** A change of the store.
+ */
+typedef struct {
+    /** The number of the change. The numbers of the changes increase by one. */
+    uint64_t changeNumber;
+    /** The kind of the change. */
+    DYFStoreSharedChangeKind kind;
+    /** The process that made the change. */
+    uint32_t pid;
+    /** The transaction identifier, not terminated. NULL for `DYFStoreSharedChangeRemoveAll`. */
+    char *identifier;
+    /** The length of the identifier. */
+    size_t identifierLength;
+} DYFStoreSharedChange;
+
+/** Opens the store in a directory, which is created if needed.
+ 
+ @param directory The path of the directory.
+ @return The store, or NULL with errno set.
+ */
+DYFStoreSharedFile *DYFStoreSharedFileOpen(const char *directory);
+
+/** Closes the store.
+ */
+void DYFStoreSharedFileClose(DYFStoreSharedFile *file);
+
+/** Stores a record, replacing the record with the same identifier.
+ 
+ @return 0, or -1 with errno set.
+ */
+int DYFStoreSharedFileStore(DYFStoreSharedFile *file, const char *identifier, size_t identifierLength, const void *record, size_t length);
+
+/** Stores records under one lock, replacing the records with the same identifiers.
+ 
+ @return 0, or -1 with errno set.
+ */
+int DYFStoreSharedFileStoreAll(DYFStoreSharedFile *file, const char *const *identifiers, const size_t *identifierLengths,
+                               const void *const *records, const size_t *lengths, size_t count);
+
+/** Removes the records with the given identifiers under one lock.
+ 
+ @return The number of records removed, or -1 with errno set.
+ */
+long DYFStoreSharedFileRemove(DYFStoreSharedFile *file, const char *const *identifiers, const size_t *identifierLengths, size_t count);
+
+/** Removes all records.
+ 
+ @return 0, or -1 with errno set.
+ */
+int DYFStoreSharedFileRemoveAll(DYFStoreSharedFile *file);
+
+/** Returns whether a record is stored. Takes no lock.
+ */
+int DYFStoreSharedFileContains(DYFStoreSharedFile *file, const char *identifier, size_t identifierLength);
+
+/** Copies a record. Takes no lock.
+ 
+ @param length Receives the length of the record.
+ @return The record, to be released with `free`, or NULL if it is not stored.
+ */
+void *DYFStoreSharedFileCopyRecord(DYFStoreSharedFile *file, const char *identifier, size_t identifierLength, size_t *length);
+
+/** Calls a function with every record of a consistent snapshot, in the order they were last stored. Takes no lock.
+ 
+ @return The number of records, or -1 with errno set.
+ */
+long DYFStoreSharedFileEnumerate(DYFStoreSharedFile *file,
+                                 void (*function)(const char *identifier, size_t identifierLength, const void *record, size_t length, void *context),
+                                 void *context);
+
+/** Returns the number of the latest change. Takes no lock.
+ */
+uint64_t DYFStoreSharedFileChangeNumber(DYFStoreSharedFile *file);
+
+/** Copies the changes made after a change number. Takes no lock.
+ 
+ Only the latest changes are kept. If some of the changes after `changeNumber` were dropped, or the log was compacted since, `reset` is set and the caller should reload everything.
+ 
+ @param changeNumber The number of the last change the caller knows.
+ @param changes Receives the changes, to be released with `DYFStoreSharedFileFreeChanges`.
+ @param reset Receives 1 if the changes are incomplete.
+ @param current Receives the number of the latest change.
+ @return The number of changes, or -1 with errno set.
+ */
+long DYFStoreSharedFileCopyChanges(DYFStoreSharedFile *file, uint64_t changeNumber, DYFStoreSharedChange **changes, int *reset, uint64_t *current);
+
+/** Releases the changes returned by `DYFStoreSharedFileCopyChanges`.
+ */
+void DYFStoreSharedFileFreeChanges(DYFStoreSharedChange *changes, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DYFStoreSharedFile_h */
@@ -0,0 +1,163 @@
+//
+//  DYFStoreSimulatedPaymentBackend.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "DYFStorePaymentBackend.h"
+
+/** Uses enumeration to inicate the outcome of a simulated transaction.
+ */
+typedef NS_ENUM(NSUInteger, DYFStoreSimulatedOutcome)
+{
+    /** The payment is purchased. */
+    DYFStoreSimulatedOutcomePurchase,
+    /** The payment fails with `SKErrorUnknown`. */
+    DYFStoreSimulatedOutcomeFail,
+    /** The user cancels the payment. */
+    DYFStoreSimulatedOutcomeCancel,
+    /** The payment is deferred, e.g. Ask to Buy. */
+    DYFStoreSimulatedOutcomeDefer,
+    /** The transaction restores a previous purchase. */
+    DYFStoreSimulatedOutcomeRestore,
+    /** The payment is purchased and carries hosted content to download. */
+    DYFStoreSimulatedOutcomeDownload
+};
+
+/** Describes one transaction in a scripted transaction stream.
+ */
+@interface DYFStoreSimulatedStep : NSObject
+
+/** The outcome of the transaction.
+ */
+@property (nonatomic, assign) DYFStoreSimulatedOutcome outcome;
+
+/** The identifier of the product being paid for.
+ */
+@property (nonatomic, copy) NSString *productIdentifier;
+
+/** An opaque identifier for the user’s account on your system.
+ */
+@property (nonatomic, copy) NSString *userIdentifier;
+
+/** The number of items. The default value is 1.
+ */
+@property (nonatomic, assign) NSInteger quantity;
+
+/** The number of hosted contents attached to the transaction. Only valid if the outcome is DYFStoreSimulatedOutcomeDownload, the default value is 1.
+ */
+@property (nonatomic, assign) NSUInteger numberOfDownloads;
+
+/** Creates a step with an outcome and a product identifier.
+
+ @param outcome The outcome of the transaction.
+ @param productIdentifier The identifier of the product being paid for.
+ @return A `DYFStoreSimulatedStep` object.
+ */
++ (instancetype)stepWithOutcome:(DYFStoreSimulatedOutcome)outcome productIdentifier:(NSString *)productIdentifier;
+
+@end
+
+/** A deterministic, in-memory stand-in for StoreKit. Transaction identifiers and dates are derived from `seed` and a counter, so the same script always produces the same stream.
+ */
+@interface DYFStoreSimulatedPaymentBackend : NSObject <DYFStorePaymentBackend>
+
+/** The seed that transaction identifiers are derived from. The default value is 0.
+ */
+@property (nonatomic, assign) uint64_t seed;
+
+/** The queue on which asynchronous callbacks are delivered. The default is the main queue.
+ */
+@property (nonatomic, strong) dispatch_queue_t callbackQueue;
+
+/** The maximum number of transactions passed to a single `paymentQueue:updatedTransactions:` callback. The default value is 1.
+ */
+@property (nonatomic, assign) NSUInteger batchSize;
+
+/** The rate at which transactions are delivered. The default value is 0, which delivers as fast as the observers process them.
+ */
+@property (nonatomic, assign) double transactionsPerSecond;
+
+/** Whether a purchasing update is delivered before the final state of each non-restored transaction. The default value is YES.
+ */
+@property (nonatomic, assign) BOOL deliversPurchasingUpdates;
+
+/** The outcomes applied, in turn, to payments added with `addPayment:`. The default is a single DYFStoreSimulatedOutcomePurchase.
+ */
+@property (nonatomic, copy) NSArray<NSNumber *> *outcomeScript;
+
+/** Whether the device is allowed to make payments. The default value is YES.
+ */
+@property (nonatomic, assign) BOOL paymentsAllowed;
+
+/** Whether the receipt refresh request fails. The default value is NO.
+ */
+@property (nonatomic, assign) BOOL receiptRefreshFails;
+
+/** The delay in seconds before a products request or a receipt refresh request responds, so that timeouts and cancellation can be exercised. The default value is 0.
+ */
+@property (nonatomic, assign) NSTimeInterval requestLatency;
+
+/** Whether restoring completed transactions fails. The default value is NO.
+ */
+@property (nonatomic, assign) BOOL restoreFails;
+
+/** The number of payments that have been added with `addPayment:`.
+ */
+@property (nonatomic, assign, readonly) NSUInteger addedPaymentCount;
+
+/** The number of transactions that have been finished.
+ */
+@property (nonatomic, assign, readonly) NSUInteger finishedTransactionCount;
+
+/** The transactions that have been delivered in a final state but not finished yet.
+ */
+@property (nonatomic, copy, readonly) NSArray<SKPaymentTransaction *> *unfinishedTransactions;
+
+/** Registers a product that the simulated products request recognizes.
+
+ @param productIdentifier The identifier of the product.
+ @param price The price of the product.
+ */
+- (void)registerProductWithIdentifier:(NSString *)productIdentifier price:(NSDecimalNumber *)price;
+
+/** Builds the transactions of a script in their final state without delivering them.
+
+ @param steps The scripted steps.
+ @return An array of `SKPaymentTransaction` objects, one for each step.
+ */
+- (NSArray<SKPaymentTransaction *> *)transactionsForSteps:(NSArray<DYFStoreSimulatedStep *> *)steps;
+
+/** Delivers a batch of transactions to the observers on the calling thread, then flushes the downloads and removals requested while they were processed.
+
+ @param transactions The transactions to deliver.
+ */
+- (void)deliverTransactions:(NSArray<SKPaymentTransaction *> *)transactions;
+
+/** Replays a script on the calling thread in batches of `batchSize`, paced by `transactionsPerSecond`.
+
+ @param steps The scripted steps.
+ */
+- (void)replaySteps:(NSArray<DYFStoreSimulatedStep *> *)steps;
+
+@end
@@ -0,0 +1,764 @@
+//
+//  DYFStoreSimulatedPaymentBackend.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreSimulatedPaymentBackend.h"
+
+// The reference date of the simulated transactions, 2014-11-04 00:00:00 UTC.
+static const NSTimeInterval DYFStoreSimulatedReferenceDate = 1415059200;
+
+#pragma mark - Simulated StoreKit Objects
+
+@interface DYFStoreSimulatedProduct : SKProduct
+@property (nonatomic, copy) NSString *simProductIdentifier;
+@property (nonatomic, strong) NSDecimalNumber *simPrice;
+@end
+
+@implementation DYFStoreSimulatedProduct
+
+- (NSString *)productIdentifier
+{
+    return self.simProductIdentifier;
+}
+
+- (NSDecimalNumber *)price
+{
+    return self.simPrice;
+}
+
+- (NSLocale *)priceLocale
+{
+    return [NSLocale localeWithLocaleIdentifier:@"en_US"];
+}
+
+- (NSString *)localizedTitle
+{
+    return self.simProductIdentifier;
+}
+
+- (NSString *)localizedDescription
+{
+    return self.simProductIdentifier;
+}
+
+@end
+
+@interface DYFStoreSimulatedTransaction : SKPaymentTransaction
+@property (nonatomic, assign) SKPaymentTransactionState simState;
+@property (nonatomic, assign) SKPaymentTransactionState simFinalState;
+@property (nonatomic, copy) NSString *simTransactionIdentifier;
+@property (nonatomic, strong) NSDate *simTransactionDate;
+@property (nonatomic, strong) SKPayment *simPayment;
+@property (nonatomic, strong) NSError *simError;
+@property (nonatomic, strong) SKPaymentTransaction *simOriginalTransaction;
+@property (nonatomic, copy) NSArray<SKDownload *> *simDownloads;
+@end
+
+@implementation DYFStoreSimulatedTransaction
+
+- (SKPaymentTransactionState)transactionState
+{
+    return self.simState;
+}
+
+- (NSString *)transactionIdentifier
+{
+    // StoreKit only provides an identifier once the transaction left the purchasing state.
+    return self.simState == SKPaymentTransactionStatePurchasing ? nil : self.simTransactionIdentifier;
+}
+
+- (NSDate *)transactionDate
+{
+    return self.simState == SKPaymentTransactionStatePurchasing ? nil : self.simTransactionDate;
+}
+
+- (SKPayment *)payment
+{
+    return self.simPayment;
+}
+
+- (NSError *)error
+{
+    return self.simState == SKPaymentTransactionStateFailed ? self.simError : nil;
+}
+
+- (SKPaymentTransaction *)originalTransaction
+{
+    return self.simOriginalTransaction;
+}
+
+- (NSArray<SKDownload *> *)downloads
+{
+    return self.simDownloads;
+}
+
+@end
+
+@interface DYFStoreSimulatedDownload : SKDownload
+@property (nonatomic, assign) SKDownloadState simState;
+@property (nonatomic, assign) float simProgress;
+@property (nonatomic, copy) NSString *simContentIdentifier;
+@property (nonatomic, weak) SKPaymentTransaction *simTransaction;
+@end
+
+@implementation DYFStoreSimulatedDownload
+
+- (SKDownloadState)state
+{
+    return self.simState;
+}
+
+- (SKDownloadState)downloadState
+{
+    return self.simState;
+}
+
+- (float)progress
+{
+    return self.simProgress;
+}
+
+- (NSString *)contentIdentifier
+{
+    return self.simContentIdentifier;
+}
+
+- (NSURL *)contentURL
+{
+    if (self.simState != SKDownloadStateFinished) { return nil; }
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:self.simContentIdentifier];
+    return [NSURL fileURLWithPath:path];
+}
+
+- (NSError *)error
+{
+    return nil;
+}
+
+- (SKPaymentTransaction *)transaction
+{
+    return self.simTransaction;
+}
+
+@end
+
+@interface DYFStoreSimulatedProductsResponse : SKProductsResponse
+@property (nonatomic, copy) NSArray<SKProduct *> *simProducts;
+@property (nonatomic, copy) NSArray<NSString *> *simInvalidProductIdentifiers;
+@end
+
+@implementation DYFStoreSimulatedProductsResponse
+
+- (NSArray<SKProduct *> *)products
+{
+    return self.simProducts;
+}
+
+- (NSArray<NSString *> *)invalidProductIdentifiers
+{
+    return self.simInvalidProductIdentifiers;
+}
+
+@end
+
+/** The queue passed to the observers. It forwards to the backend, so that an observer which uses the queue of a callback drives the simulation instead of the real queue.
+ */
+@interface DYFStoreSimulatedPaymentQueue : SKPaymentQueue
+@property (nonatomic, weak) DYFStoreSimulatedPaymentBackend *backend;
+@end
+
+@implementation DYFStoreSimulatedPaymentQueue
+
+- (void)addPayment:(SKPayment *)payment
+{
+    [self.backend addPayment:payment];
+}
+
+- (void)restoreCompletedTransactions
+{
+    [self.backend restoreCompletedTransactionsWithApplicationUsername:nil];
+}
+
+- (void)restoreCompletedTransactionsWithApplicationUsername:(NSString *)username
+{
+    [self.backend restoreCompletedTransactionsWithApplicationUsername:username];
+}
+
+- (void)finishTransaction:(SKPaymentTransaction *)transaction
+{
+    [self.backend finishTransaction:transaction];
+}
+
+- (void)startDownloads:(NSArray<SKDownload *> *)downloads
+{
+    [self.backend startDownloads:downloads];
+}
+
+- (void)addTransactionObserver:(id<SKPaymentTransactionObserver>)observer
+{
+    [self.backend addTransactionObserver:observer];
+}
+
+- (void)removeTransactionObserver:(id<SKPaymentTransactionObserver>)observer
+{
+    [self.backend removeTransactionObserver:observer];
+}
+
+- (NSArray<SKPaymentTransaction *> *)transactions
+{
+    return [self.backend unfinishedTransactions];
+}
+
+@end
+
+@interface DYFStoreSimulatedPaymentBackend ()
+@property (nonatomic, strong) DYFStoreSimulatedPaymentQueue *paymentQueue;
+@property (nonatomic, strong) NSHashTable<id<SKPaymentTransactionObserver>> *observers;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, DYFStoreSimulatedProduct *> *products;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, SKPaymentTransaction *> *unfinished;
+@property (nonatomic, strong) NSMutableArray<SKPaymentTransaction *> *purchaseHistory;
+@property (nonatomic, strong) NSMutableArray<SKDownload *> *pendingDownloads;
+@property (nonatomic, strong) NSMutableArray<SKPaymentTransaction *> *pendingRemovals;
+@property (nonatomic, assign) NSUInteger transactionCounter;
+@property (nonatomic, assign) NSUInteger outcomeCursor;
+@property (nonatomic, assign) NSUInteger deliveryDepth;
+@property (nonatomic, assign, readwrite) NSUInteger addedPaymentCount;
+@property (nonatomic, assign, readwrite) NSUInteger finishedTransactionCount;
+- (NSArray<SKProduct *> *)productsForIdentifiers:(NSSet<NSString *> *)identifiers invalidIdentifiers:(NSArray<NSString *> **)invalidIdentifiers;
+@end
+
+@interface DYFStoreSimulatedProductsRequest : SKProductsRequest
+@property (nonatomic, weak) DYFStoreSimulatedPaymentBackend *backend;
+@property (nonatomic, copy) NSSet<NSString *> *simProductIdentifiers;
+@property (nonatomic, assign) BOOL cancelled;
+@end
+
+@implementation DYFStoreSimulatedProductsRequest
+
+- (void)start
+{
+    DYFStoreSimulatedPaymentBackend *backend = self.backend;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(backend.requestLatency * NSEC_PER_SEC)), backend.callbackQueue, ^{
+        if (self.cancelled) { return; }
+
+        NSArray *invalidIdentifiers = nil;
+        DYFStoreSimulatedProductsResponse *response = [[DYFStoreSimulatedProductsResponse alloc] init];
+        response.simProducts = [backend productsForIdentifiers:self.simProductIdentifiers invalidIdentifiers:&invalidIdentifiers];
+        response.simInvalidProductIdentifiers = invalidIdentifiers;
+
+        id<SKProductsRequestDelegate> delegate = self.delegate;
+        [delegate productsRequest:self didReceiveResponse:response];
+        if ([delegate respondsToSelector:@selector(requestDidFinish:)]) {
+            [delegate requestDidFinish:self];
+        }
+    });
+}
+
+- (void)cancel
+{
+    self.cancelled = YES;
+}
+
+@end
+
+@interface DYFStoreSimulatedReceiptRefreshRequest : SKReceiptRefreshRequest
+@property (nonatomic, weak) DYFStoreSimulatedPaymentBackend *backend;
+@property (nonatomic, assign) BOOL cancelled;
+@end
+
+@implementation DYFStoreSimulatedReceiptRefreshRequest
+
+- (void)start
+{
+    DYFStoreSimulatedPaymentBackend *backend = self.backend;
+    BOOL fails = backend.receiptRefreshFails;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(backend.requestLatency * NSEC_PER_SEC)), backend.callbackQueue, ^{
+        if (self.cancelled) { return; }
+
+        id<SKRequestDelegate> delegate = self.delegate;
+        if (fails) {
+            NSError *error = [NSError errorWithDomain:SKErrorDomain code:SKErrorUnknown userInfo:nil];
+            if ([delegate respondsToSelector:@selector(request:didFailWithError:)]) {
+                [delegate request:self didFailWithError:error];
+            }
+        } else if ([delegate respondsToSelector:@selector(requestDidFinish:)]) {
+            [delegate requestDidFinish:self];
+        }
+    });
+}
+
+- (void)cancel
+{
+    self.cancelled = YES;
+}
+
+@end
+
+#pragma mark - DYFStoreSimulatedStep
+
+@implementation DYFStoreSimulatedStep
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _quantity = 1;
+        _numberOfDownloads = 1;
+    }
+    return self;
+}
+
++ (instancetype)stepWithOutcome:(DYFStoreSimulatedOutcome)outcome productIdentifier:(NSString *)productIdentifier
+{
+    DYFStoreSimulatedStep *step = [[self alloc] init];
+    step.outcome = outcome;
+    step.productIdentifier = productIdentifier;
+    return step;
+}
+
+@end
+
+#pragma mark - DYFStoreSimulatedPaymentBackend
+
+@implementation DYFStoreSimulatedPaymentBackend
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _callbackQueue = dispatch_get_main_queue();
+        _batchSize = 1;
+        _deliversPurchasingUpdates = YES;
+        _outcomeScript = @[@(DYFStoreSimulatedOutcomePurchase)];
+        _paymentsAllowed = YES;
+        _observers = [NSHashTable weakObjectsHashTable];
+        _products = [NSMutableDictionary dictionary];
+        _unfinished = [NSMutableDictionary dictionary];
+        _purchaseHistory = [NSMutableArray array];
+        _pendingDownloads = [NSMutableArray array];
+        _pendingRemovals = [NSMutableArray array];
+        _paymentQueue = [[DYFStoreSimulatedPaymentQueue alloc] init];
+        _paymentQueue.backend = self;
+    }
+    return self;
+}
+
+- (NSArray<SKPaymentTransaction *> *)unfinishedTransactions
+{
+    @synchronized (self) {
+        return self.unfinished.allValues;
+    }
+}
+
+- (void)registerProductWithIdentifier:(NSString *)productIdentifier price:(NSDecimalNumber *)price
+{
+    if (!productIdentifier) { return; }
+
+    DYFStoreSimulatedProduct *product = [[DYFStoreSimulatedProduct alloc] init];
+    product.simProductIdentifier = productIdentifier;
+    product.simPrice = price ?: [NSDecimalNumber zero];
+    @synchronized (self) {
+        self.products[productIdentifier] = product;
+    }
+}
+
+- (NSArray<SKProduct *> *)productsForIdentifiers:(NSSet<NSString *> *)identifiers invalidIdentifiers:(NSArray<NSString *> **)invalidIdentifiers
+{
+    NSMutableArray *products = [NSMutableArray array];
+    NSMutableArray *invalids = [NSMutableArray array];
+
+    @synchronized (self) {
+        // Sorts the identifiers so that the response order does not depend on the hash order of the set.
+        NSArray *sortedIdentifiers = [identifiers.allObjects sortedArrayUsingSelector:@selector(compare:)];
+        for (NSString *identifier in sortedIdentifiers) {
+            SKProduct *product = self.products[identifier];
+            if (product) {
+                [products addObject:product];
+            } else {
+                [invalids addObject:identifier];
+            }
+        }
+    }
+
+    if (invalidIdentifiers) {
+        *invalidIdentifiers = invalids;
+    }
+    return products;
+}
+
+#pragma mark - Transactions
+
+/** Creates the next transaction of the stream in its final state.
+ */
+- (DYFStoreSimulatedTransaction *)nextTransactionWithPayment:(SKPayment *)payment
+                                                     outcome:(DYFStoreSimulatedOutcome)outcome
+                                           numberOfDownloads:(NSUInteger)numberOfDownloads
+{
+    NSUInteger counter;
+    @synchronized (self) {
+        counter = ++self.transactionCounter;
+    }
+
+    DYFStoreSimulatedTransaction *transaction = [[DYFStoreSimulatedTransaction alloc] init];
+    transaction.simPayment = payment;
+    transaction.simTransactionIdentifier = [NSString stringWithFormat:@"1%04llu%011lu", self.seed % 10000, (unsigned long)counter];
+    transaction.simTransactionDate = [NSDate dateWithTimeIntervalSince1970:DYFStoreSimulatedReferenceDate + counter];
+
+    switch (outcome) {
+        case DYFStoreSimulatedOutcomePurchase:
+            transaction.simFinalState = SKPaymentTransactionStatePurchased;
+            break;
+        case DYFStoreSimulatedOutcomeFail:
+            transaction.simFinalState = SKPaymentTransactionStateFailed;
+            transaction.simError = [NSError errorWithDomain:SKErrorDomain code:SKErrorUnknown userInfo:nil];
+            break;
+        case DYFStoreSimulatedOutcomeCancel:
+            transaction.simFinalState = SKPaymentTransactionStateFailed;
+            transaction.simError = [NSError errorWithDomain:SKErrorDomain code:SKErrorPaymentCancelled userInfo:nil];
+            break;
+        case DYFStoreSimulatedOutcomeDefer:
+            transaction.simFinalState = SKPaymentTransactionStateDeferred;
+            break;
+        case DYFStoreSimulatedOutcomeRestore: {
+            transaction.simFinalState = SKPaymentTransactionStateRestored;
+            DYFStoreSimulatedTransaction *original = [[DYFStoreSimulatedTransaction alloc] init];
+            original.simPayment = payment;
+            original.simState = SKPaymentTransactionStatePurchased;
+            original.simTransactionIdentifier = [NSString stringWithFormat:@"2%04llu%011lu", self.seed % 10000, (unsigned long)counter];
+            original.simTransactionDate = [NSDate dateWithTimeIntervalSince1970:DYFStoreSimulatedReferenceDate];
+            transaction.simOriginalTransaction = original;
+            break;
+        }
+        case DYFStoreSimulatedOutcomeDownload: {
+            transaction.simFinalState = SKPaymentTransactionStatePurchased;
+            NSMutableArray *downloads = [NSMutableArray arrayWithCapacity:numberOfDownloads];
+            for (NSUInteger idx = 0; idx < numberOfDownloads; idx++) {
+                DYFStoreSimulatedDownload *download = [[DYFStoreSimulatedDownload alloc] init];
+                download.simState = SKDownloadStateWaiting;
+                download.simContentIdentifier = [NSString stringWithFormat:@"%@.content.%lu", payment.productIdentifier, (unsigned long)idx];
+                download.simTransaction = transaction;
+                [downloads addObject:download];
+            }
+            transaction.simDownloads = downloads;
+            break;
+        }
+    }
+
+    transaction.simState = transaction.simFinalState;
+    return transaction;
+}
+
+- (NSArray<SKPaymentTransaction *> *)transactionsForSteps:(NSArray<DYFStoreSimulatedStep *> *)steps
+{
+    NSMutableArray *transactions = [NSMutableArray arrayWithCapacity:steps.count];
+    for (DYFStoreSimulatedStep *step in steps) {
+        SKMutablePayment *payment = [[SKMutablePayment alloc] init];
+        payment.productIdentifier = step.productIdentifier;
+        payment.quantity = step.quantity;
+        payment.applicationUsername = step.userIdentifier;
+
+        [transactions addObject:[self nextTransactionWithPayment:payment
+                                                         outcome:step.outcome
+                                               numberOfDownloads:step.numberOfDownloads]];
+    }
+    return transactions;
+}
+
+- (NSArray<id<SKPaymentTransactionObserver>> *)currentObservers
+{
+    @synchronized (self) {
+        return self.observers.allObjects;
+    }
+}
+
+- (void)deliverTransactions:(NSArray<SKPaymentTransaction *> *)transactions
+{
+    if (transactions.count == 0) { return; }
+
+    @synchronized (self) {
+        for (SKPaymentTransaction *transaction in transactions) {
+            SKPaymentTransactionState state = transaction.transactionState;
+            if (state == SKPaymentTransactionStatePurchasing ||
+                state == SKPaymentTransactionStateDeferred) {
+                continue;
+            }
+            self.unfinished[transaction.transactionIdentifier] = transaction;
+            if (state == SKPaymentTransactionStatePurchased) {
+                [self.purchaseHistory addObject:transaction];
+            }
+        }
+    }
+
+    @synchronized (self) {
+        self.deliveryDepth++;
+    }
+    for (id<SKPaymentTransactionObserver> observer in [self currentObservers]) {
+        [observer paymentQueue:self.paymentQueue updatedTransactions:transactions];
+    }
+    BOOL outermost;
+    @synchronized (self) {
+        outermost = --self.deliveryDepth == 0;
+    }
+
+    if (outermost) {
+        [self flushPendingCallbacks];
+    }
+}
+
+/** Delivers the downloads started and the transactions finished while a batch was being processed.
+ */
+- (void)flushPendingCallbacks
+{
+    NSArray *downloads;
+    NSArray *removals;
+    @synchronized (self) {
+        downloads = [self.pendingDownloads copy];
+        removals = [self.pendingRemovals copy];
+        [self.pendingDownloads removeAllObjects];
+        [self.pendingRemovals removeAllObjects];
+    }
+
+    NSArray *observers = [self currentObservers];
+
+    if (downloads.count > 0) {
+        for (DYFStoreSimulatedDownload *download in downloads) {
+            download.simState = SKDownloadStateActive;
+            download.simProgress = 0.5;
+        }
+        for (id<SKPaymentTransactionObserver> observer in observers) {
+            if ([observer respondsToSelector:@selector(paymentQueue:updatedDownloads:)]) {
+                [observer paymentQueue:self.paymentQueue updatedDownloads:downloads];
+            }
+        }
+
+        for (DYFStoreSimulatedDownload *download in downloads) {
+            download.simState = SKDownloadStateFinished;
+            download.simProgress = 1.0;
+        }
+        for (id<SKPaymentTransactionObserver> observer in observers) {
+            if ([observer respondsToSelector:@selector(paymentQueue:updatedDownloads:)]) {
+                [observer paymentQueue:self.paymentQueue updatedDownloads:downloads];
+            }
+        }
+
+        // Finishing the downloaded transactions may have queued removals.
+        @synchronized (self) {
+            removals = [removals arrayByAddingObjectsFromArray:self.pendingRemovals];
+            [self.pendingRemovals removeAllObjects];
+        }
+    }
+
+    if (removals.count > 0) {
+        for (id<SKPaymentTransactionObserver> observer in observers) {
+            if ([observer respondsToSelector:@selector(paymentQueue:removedTransactions:)]) {
+                [observer paymentQueue:self.paymentQueue removedTransactions:removals];
+            }
+        }
+    }
+}
+
+- (void)replaySteps:(NSArray<DYFStoreSimulatedStep *> *)steps
+{
+    NSArray<SKPaymentTransaction *> *transactions = [self transactionsForSteps:steps];
+    NSUInteger batchSize = MAX(self.batchSize, 1);
+    double rate = self.transactionsPerSecond;
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+
+    for (NSUInteger location = 0; location < transactions.count; location += batchSize) {
+        NSRange range = NSMakeRange(location, MIN(batchSize, transactions.count - location));
+        NSArray *batch = [transactions subarrayWithRange:range];
+
+        if (self.deliversPurchasingUpdates) {
+            NSMutableArray *purchasing = [NSMutableArray arrayWithCapacity:batch.count];
+            for (DYFStoreSimulatedTransaction *transaction in batch) {
+                if (transaction.simFinalState != SKPaymentTransactionStateRestored) {
+                    transaction.simState = SKPaymentTransactionStatePurchasing;
+                    [purchasing addObject:transaction];
+                }
+            }
+            [self deliverTransactions:purchasing];
+            for (DYFStoreSimulatedTransaction *transaction in batch) {
+                transaction.simState = transaction.simFinalState;
+            }
+        }
+
+        [self deliverTransactions:batch];
+
+        if (rate > 0) {
+            CFAbsoluteTime deadline = startTime + NSMaxRange(range) / rate;
+            CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+            if (deadline > now) {
+                [NSThread sleepForTimeInterval:deadline - now];
+            }
+        }
+    }
+}
+
+#pragma mark - DYFStorePaymentBackend
+
+- (BOOL)canMakePayments
+{
+    return self.paymentsAllowed;
+}
+
+- (void)addTransactionObserver:(id<SKPaymentTransactionObserver>)observer
+{
+    @synchronized (self) {
+        [self.observers addObject:observer];
+    }
+}
+
+- (void)removeTransactionObserver:(id<SKPaymentTransactionObserver>)observer
+{
+    @synchronized (self) {
+        [self.observers removeObject:observer];
+    }
+}
+
+- (void)addPayment:(SKPayment *)payment
+{
+    if (!payment) { return; }
+
+    DYFStoreSimulatedOutcome outcome;
+    @synchronized (self) {
+        NSArray *script = self.outcomeScript.count > 0 ? self.outcomeScript : @[@(DYFStoreSimulatedOutcomePurchase)];
+        outcome = [script[self.outcomeCursor % script.count] unsignedIntegerValue];
+        self.outcomeCursor++;
+        self.addedPaymentCount++;
+    }
+
+    DYFStoreSimulatedTransaction *transaction = [self nextTransactionWithPayment:[payment copy]
+                                                                        outcome:outcome
+                                                              numberOfDownloads:1];
+    dispatch_async(self.callbackQueue, ^{
+        transaction.simState = SKPaymentTransactionStatePurchasing;
+        [self deliverTransactions:@[transaction]];
+
+        dispatch_async(self.callbackQueue, ^{
+            transaction.simState = transaction.simFinalState;
+            [self deliverTransactions:@[transaction]];
+        });
+    });
+}
+
+- (void)restoreCompletedTransactionsWithApplicationUsername:(NSString *)username
+{
+    NSArray *history;
+    @synchronized (self) {
+        history = [self.purchaseHistory copy];
+    }
+
+    dispatch_async(self.callbackQueue, ^{
+        if (self.restoreFails) {
+            NSError *error = [NSError errorWithDomain:SKErrorDomain code:SKErrorUnknown userInfo:nil];
+            for (id<SKPaymentTransactionObserver> observer in [self currentObservers]) {
+                if ([observer respondsToSelector:@selector(paymentQueue:restoreCompletedTransactionsFailedWithError:)]) {
+                    [observer paymentQueue:self.paymentQueue restoreCompletedTransactionsFailedWithError:error];
+                }
+            }
+            return;
+        }
+
+        NSMutableArray *restored = [NSMutableArray arrayWithCapacity:history.count];
+        for (SKPaymentTransaction *original in history) {
+            NSString *applicationUsername = original.payment.applicationUsername;
+            if (username.length > 0 && ![applicationUsername isEqualToString:username]) {
+                continue;
+            }
+            DYFStoreSimulatedTransaction *transaction = [self nextTransactionWithPayment:original.payment
+                                                                                outcome:DYFStoreSimulatedOutcomeRestore
+                                                                      numberOfDownloads:0];
+            transaction.simOriginalTransaction = original;
+            [restored addObject:transaction];
+        }
+
+        NSUInteger batchSize = MAX(self.batchSize, 1);
+        for (NSUInteger location = 0; location < restored.count; location += batchSize) {
+            NSRange range = NSMakeRange(location, MIN(batchSize, restored.count - location));
+            [self deliverTransactions:[restored subarrayWithRange:range]];
+        }
+
+        for (id<SKPaymentTransactionObserver> observer in [self currentObservers]) {
+            if ([observer respondsToSelector:@selector(paymentQueueRestoreCompletedTransactionsFinished:)]) {
+                [observer paymentQueueRestoreCompletedTransactionsFinished:self.paymentQueue];
+            }
+        }
+    });
+}
+
+- (void)finishTransaction:(SKPaymentTransaction *)transaction
+{
+    if (!transaction) { return; }
+
+    BOOL flushNow = NO;
+    @synchronized (self) {
+        NSString *identifier = transaction.transactionIdentifier;
+        if (identifier && self.unfinished[identifier]) {
+            [self.unfinished removeObjectForKey:identifier];
+        }
+        self.finishedTransactionCount++;
+        [self.pendingRemovals addObject:transaction];
+        flushNow = self.deliveryDepth == 0;
+    }
+
+    if (flushNow) {
+        dispatch_async(self.callbackQueue, ^{
+            [self flushPendingCallbacks];
+        });
+    }
+}
+
+- (void)startDownloads:(NSArray<SKDownload *> *)downloads
+{
+    if (downloads.count == 0) { return; }
+
+    BOOL flushNow = NO;
+    @synchronized (self) {
+        [self.pendingDownloads addObjectsFromArray:downloads];
+        flushNow = self.deliveryDepth == 0;
+    }
+
+    if (flushNow) {
+        dispatch_async(self.callbackQueue, ^{
+            [self flushPendingCallbacks];
+        });
+    }
+}
+
+- (SKProductsRequest *)productsRequestWithProductIdentifiers:(NSSet<NSString *> *)productIdentifiers
+{
+    DYFStoreSimulatedProductsRequest *request = [[DYFStoreSimulatedProductsRequest alloc] initWithProductIdentifiers:productIdentifiers];
+    request.backend = self;
+    request.simProductIdentifiers = productIdentifiers;
+    return request;
+}
+
+- (SKReceiptRefreshRequest *)receiptRefreshRequestWithReceiptProperties:(NSDictionary *)properties
+{
+    DYFStoreSimulatedReceiptRefreshRequest *request = [[DYFStoreSimulatedReceiptRefreshRequest alloc] initWithReceiptProperties:properties];
+    request.backend = self;
+    return request;
+}
+
+@end
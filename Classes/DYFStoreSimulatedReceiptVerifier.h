@@ -0,0 +1,64 @@
+//
+//  DYFStoreSimulatedReceiptVerifier.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "DYFStoreVerificationCoordinator.h"
+
+/** A local stand-in for a receipt verification server. Its receipts are JSON arrays of in-app purchase entries, which it answers in the shape of the App Store's verifyReceipt response after a fixed latency.
+ */
+@interface DYFStoreSimulatedReceiptVerifier : NSObject <DYFStoreReceiptVerifying>
+
+/** The time taken by each request. The default value is 0.05 seconds.
+ */
+@property (nonatomic, assign) NSTimeInterval latency;
+
+/** The queue on which the completions are called. The default is a global queue.
+ */
+@property (nonatomic, strong) dispatch_queue_t callbackQueue;
+
+/** Whether the requests fail with a network error. The default value is NO.
+ */
+@property (nonatomic, assign) BOOL networkFails;
+
+/** The number of upcoming requests that fail with a network error, e.g. to drive a retry scheduler. Counts down with every request. The default value is 0.
+ */
+@property (nonatomic, assign) NSUInteger failingRequestCount;
+
+/** The number of requests received so far.
+ */
+@property (nonatomic, assign, readonly) NSUInteger requestCount;
+
+/** Builds a receipt that lists the given transactions.
+ 
+ @param transactions The transactions that the receipt contains.
+ @return The receipt data.
+ */
++ (NSData *)receiptDataWithTransactions:(NSArray<DYFStoreTransaction *> *)transactions;
+
+/** Resets the request count to zero.
+ */
+- (void)resetRequestCount;
+
+@end
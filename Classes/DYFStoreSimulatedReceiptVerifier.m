@@ -0,0 +1,104 @@
+//
+//  DYFStoreSimulatedReceiptVerifier.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreSimulatedReceiptVerifier.h"
+#import "DYFStoreConverter.h"
+#import <stdatomic.h>
+
+@interface DYFStoreSimulatedReceiptVerifier ()
+{
+    _Atomic(NSUInteger) _requestCount;
+}
+@end
+
+@implementation DYFStoreSimulatedReceiptVerifier
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _latency = 0.05;
+        _callbackQueue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+    }
+    return self;
+}
+
++ (NSData *)receiptDataWithTransactions:(NSArray<DYFStoreTransaction *> *)transactions
+{
+    NSMutableArray *entries = [NSMutableArray arrayWithCapacity:transactions.count];
+    for (DYFStoreTransaction *transaction in transactions) {
+        NSMutableDictionary *entry = [NSMutableDictionary dictionary];
+        entry[@"quantity"] = @"1";
+        entry[@"product_id"] = transaction.productIdentifier;
+        entry[@"transaction_id"] = transaction.transactionIdentifier;
+        entry[@"original_transaction_id"] = transaction.originalTransactionIdentifier ?: transaction.transactionIdentifier;
+        entry[@"purchase_date_ms"] = transaction.transactionTimestamp ? [transaction.transactionTimestamp stringByAppendingString:@"000"] : nil;
+        [entries addObject:entry];
+    }
+    return [DYFStoreConverter jsonWithObject:entries];
+}
+
+- (NSUInteger)requestCount
+{
+    return atomic_load(&_requestCount);
+}
+
+- (void)resetRequestCount
+{
+    atomic_store(&_requestCount, 0);
+}
+
+- (void)verifyReceipt:(NSData *)receiptData completion:(DYFStoreReceiptVerificationCompletion)completion
+{
+    atomic_fetch_add(&_requestCount, 1);
+    
+    BOOL fails = self.networkFails;
+    @synchronized (self) {
+        if (self.failingRequestCount > 0) {
+            self.failingRequestCount--;
+            fails = YES;
+        }
+    }
+    
+    NSDictionary *response = nil;
+    NSError *error = nil;
+    if (fails) {
+        error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNotConnectedToInternet userInfo:nil];
+    } else {
+        // 21002: The data in the receipt-data property was malformed or missing.
+        NSArray *entries = [DYFStoreConverter jsonObjectWithData:receiptData];
+        if ([entries isKindOfClass:NSArray.class]) {
+            response = @{@"status": @0, @"environment": @"Sandbox", @"receipt": @{@"in_app": entries}};
+        } else {
+            response = @{@"status": @21002};
+        }
+    }
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.latency * NSEC_PER_SEC)), self.callbackQueue, ^{
+        completion(response, error);
+    });
+}
+
+@end
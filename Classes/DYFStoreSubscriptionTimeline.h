@@ -0,0 +1,161 @@
+//
+//  DYFStoreSubscriptionTimeline.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import <Foundation/Foundation.h>
+#import "DYFStoreClock.h"
+
+@class DYFStoreSubscriptionTimeline;
+
+/** Uses enumeration to inicate the status of a subscription group at a point in time.
+ */
+typedef NS_ENUM(NSInteger, DYFStoreSubscriptionStatus)
+{
+    /** Indicates that no period of the group has started yet. */
+    DYFStoreSubscriptionStatusNone,
+    /** Indicates that a period of the group covers the time. */
+    DYFStoreSubscriptionStatusActive,
+    /** Indicates that the last period has expired, but the billing grace period has not ended yet. */
+    DYFStoreSubscriptionStatusGracePeriod,
+    /** Indicates that the last period and its grace period have ended. */
+    DYFStoreSubscriptionStatusLapsed
+};
+
+/** The delegate of a subscription timeline.
+ */
+@protocol DYFStoreSubscriptionTimelineDelegate <NSObject>
+
+/** Tells the delegate that the status of a group has changed, either because periods were added or because the clock reached the end of a period.
+ 
+ @param timeline The subscription timeline.
+ @param status The new status.
+ @param group The subscription group.
+ */
+- (void)subscriptionTimeline:(DYFStoreSubscriptionTimeline *)timeline didChangeStatus:(DYFStoreSubscriptionStatus)status forGroup:(NSString *)group;
+
+@end
+
+/** Holds the purchase and expiry intervals of auto-renewable subscriptions, per subscription group, and answers their status at any time.
+ 
+ The intervals of a group are kept sorted and merged, so a status query is a binary search: O(log n) in the number of intervals. Instead of polling, the timeline computes when each group changes status next and schedules a single wake-up on its clock for the earliest one; only the groups that are due are evaluated again. All groups are evaluated again, and the wake-up rescheduled from the wall time, when the time changes significantly, e.g. after the device slept or the clock was set, and when the app enters the foreground.
+ */
+@interface DYFStoreSubscriptionTimeline : NSObject
+
+/** The delegate, called on the queue given at creation.
+ */
+@property (nonatomic, weak) id<DYFStoreSubscriptionTimelineDelegate> delegate;
+
+/** The clock the status changes are scheduled on.
+ */
+@property (nonatomic, strong, readonly) id<DYFStoreClock> clock;
+
+/** The billing grace period that follows the end of the last period of a group, in seconds. The default value is 0. A grace period expiration date from the pending renewal info takes precedence when it is later.
+ */
+@property (nonatomic, assign) NSTimeInterval gracePeriod;
+
+/** The subscription groups that have periods.
+ */
+@property (nonatomic, copy, readonly) NSArray<NSString *> *groups;
+
+/** Creates a timeline on the system clock that calls its delegate on the main queue.
+ */
+- (instancetype)init;
+
+/** Creates a timeline.
+ 
+ @param clock The clock the status changes are scheduled on.
+ @param queue The queue on which the delegate is called.
+ @return A `DYFStoreSubscriptionTimeline` object.
+ */
+- (instancetype)initWithClock:(id<DYFStoreClock>)clock queue:(dispatch_queue_t)queue;
+
+/** Evaluates all groups at the current time, tells the delegate about the changed ones, and reschedules the wake-up. Called when the time changes significantly and when the app enters the foreground.
+ */
+- (void)reevaluate;
+
+/** Assigns a product to a subscription group. Receipt entries with a "subscription_group_identifier" need no assignment. A product that is not assigned forms a group of its own.
+ 
+ @param group The subscription group.
+ @param productIdentifier A string used to identify a product.
+ */
+- (void)setGroup:(NSString *)group forProduct:(NSString *)productIdentifier;
+
+/** Returns the subscription group of a product.
+ 
+ @param productIdentifier A string used to identify a product.
+ @return The group.
+ */
+- (NSString *)groupForProduct:(NSString *)productIdentifier;
+
+/** Adds a period of a subscription. Adding the same transaction again replaces its period, e.g. after a cancellation.
+ 
+ @param productIdentifier A string used to identify a product.
+ @param transactionIdentifier The identifier of the transaction that bought the period.
+ @param startTime The start of the period, in seconds since 1970.
+ @param endTime The end of the period, exclusive, in seconds since 1970.
+ */
+- (void)addPeriodForProduct:(NSString *)productIdentifier
+      transactionIdentifier:(NSString *)transactionIdentifier
+                  startTime:(NSTimeInterval)startTime
+                    endTime:(NSTimeInterval)endTime;
+
+/** Adds the periods of receipt entries, either the "in_app" or the "latest_receipt_info" entries of a verified receipt, or entries of a locally parsed receipt with the same keys. Entries without an expiration date are not subscriptions and are ignored. A cancelled entry ends at its cancellation date.
+ 
+ @param entries The receipt entries.
+ */
+- (void)addReceiptEntries:(NSArray<NSDictionary *> *)entries;
+
+/** Adds the grace period expiration dates of the "pending_renewal_info" entries of a verified receipt.
+ 
+ @param entries The pending renewal info entries.
+ */
+- (void)addPendingRenewalInfo:(NSArray<NSDictionary *> *)entries;
+
+/** Returns the status of a group now.
+ 
+ @param group The subscription group.
+ @return The status.
+ */
+- (DYFStoreSubscriptionStatus)statusForGroup:(NSString *)group;
+
+/** Returns the status of a group at a time.
+ 
+ @param group The subscription group.
+ @param time The time, in seconds since 1970.
+ @return The status.
+ */
+- (DYFStoreSubscriptionStatus)statusForGroup:(NSString *)group atTime:(NSTimeInterval)time;
+
+/** Returns the time of the next status change of a group after a time.
+ 
+ @param group The subscription group.
+ @param time The time, in seconds since 1970.
+ @return The time, or DBL_MAX if the status does not change anymore.
+ */
+- (NSTimeInterval)nextChangeTimeForGroup:(NSString *)group afterTime:(NSTimeInterval)time;
+
+/** Removes all periods.
+ */
+- (void)removeAllPeriods;
+
+@end
@@ -0,0 +1,456 @@
+//
+//  DYFStoreSubscriptionTimeline.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import "DYFStoreSubscriptionTimeline.h"
+#import "DYFStore.h"
+#import <UIKit/UIKit.h>
+
+/** A half-open interval of time, in seconds since 1970.
+ */
+typedef struct {
+    NSTimeInterval start;
+    NSTimeInterval end;
+} DYFStoreInterval;
+
+/** The periods of one subscription group.
+ */
+@interface DYFStoreSubscriptionGroup : NSObject
+// The periods by transaction identifier, as `NSValue` objects of `DYFStoreInterval`.
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSValue *> *periods;
+// The union of the periods: disjoint intervals sorted by start, so their ends are sorted too.
+@property (nonatomic, strong) NSMutableData *intervals;
+// The grace period expiration date of the pending renewal, 0 if none.
+@property (nonatomic, assign) NSTimeInterval graceUntil;
+// The last status reported to the delegate, and when it changes next.
+@property (nonatomic, assign) DYFStoreSubscriptionStatus status;
+@property (nonatomic, assign) NSTimeInterval nextChange;
+@end
+
+@implementation DYFStoreSubscriptionGroup
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _periods = [NSMutableDictionary dictionary];
+        _intervals = [NSMutableData data];
+        _nextChange = DBL_MAX;
+    }
+    return self;
+}
+
+- (NSUInteger)count
+{
+    return self.intervals.length / sizeof(DYFStoreInterval);
+}
+
+- (const DYFStoreInterval *)items
+{
+    return self.intervals.bytes;
+}
+
+/** Merges an interval into the union, replacing the intervals it overlaps or touches.
+ */
+- (void)mergeInterval:(DYFStoreInterval)interval
+{
+    const DYFStoreInterval *items = self.items;
+    NSUInteger count = self.count;
+    
+    // The first interval that ends at or after the start of the new one.
+    NSUInteger lower = 0, upper = count;
+    while (lower < upper) {
+        NSUInteger mid = (lower + upper) / 2;
+        if (items[mid].end < interval.start) {
+            lower = mid + 1;
+        } else {
+            upper = mid;
+        }
+    }
+    
+    NSUInteger first = lower, last = lower;
+    while (last < count && items[last].start <= interval.end) {
+        interval.start = MIN(interval.start, items[last].start);
+        interval.end = MAX(interval.end, items[last].end);
+        last++;
+    }
+    
+    [self.intervals replaceBytesInRange:NSMakeRange(first * sizeof(DYFStoreInterval), (last - first) * sizeof(DYFStoreInterval))
+                              withBytes:&interval
+                                 length:sizeof(DYFStoreInterval)];
+}
+
+/** Adds the period of a transaction. A new transaction is merged in place; a transaction whose period changed rebuilds the union.
+ */
+- (void)setInterval:(DYFStoreInterval)interval forTransaction:(NSString *)transactionIdentifier
+{
+    NSValue *value = [NSValue valueWithBytes:&interval objCType:@encode(DYFStoreInterval)];
+    NSValue *previous = self.periods[transactionIdentifier];
+    self.periods[transactionIdentifier] = value;
+    
+    if (!previous) {
+        [self mergeInterval:interval];
+        return;
+    }
+    if ([previous isEqualToValue:value]) { return; }
+    
+    self.intervals.length = 0;
+    for (NSValue *period in self.periods.objectEnumerator) {
+        DYFStoreInterval item;
+        [period getValue:&item];
+        [self mergeInterval:item];
+    }
+}
+
+/** Returns the position of the last interval that starts at or before a time, or NSNotFound.
+ */
+- (NSUInteger)indexAtTime:(NSTimeInterval)time
+{
+    const DYFStoreInterval *items = self.items;
+    NSUInteger lower = 0, upper = self.count;
+    while (lower < upper) {
+        NSUInteger mid = (lower + upper) / 2;
+        if (items[mid].start <= time) {
+            lower = mid + 1;
+        } else {
+            upper = mid;
+        }
+    }
+    return lower == 0 ? NSNotFound : lower - 1;
+}
+
+- (NSTimeInterval)graceEndOfIndex:(NSUInteger)index gracePeriod:(NSTimeInterval)gracePeriod
+{
+    NSTimeInterval end = self.items[index].end + gracePeriod;
+    if (index + 1 == self.count) {
+        end = MAX(end, self.graceUntil);
+    }
+    return end;
+}
+
+- (DYFStoreSubscriptionStatus)statusAtTime:(NSTimeInterval)time gracePeriod:(NSTimeInterval)gracePeriod
+{
+    NSUInteger index = [self indexAtTime:time];
+    if (index == NSNotFound) { return DYFStoreSubscriptionStatusNone; }
+    
+    if (time < self.items[index].end) {
+        return DYFStoreSubscriptionStatusActive;
+    }
+    if (time < [self graceEndOfIndex:index gracePeriod:gracePeriod]) {
+        return DYFStoreSubscriptionStatusGracePeriod;
+    }
+    return DYFStoreSubscriptionStatusLapsed;
+}
+
+- (NSTimeInterval)nextChangeAfterTime:(NSTimeInterval)time gracePeriod:(NSTimeInterval)gracePeriod
+{
+    NSUInteger count = self.count;
+    if (count == 0) { return DBL_MAX; }
+    
+    NSUInteger index = [self indexAtTime:time];
+    if (index == NSNotFound) { return self.items[0].start; }
+    
+    NSTimeInterval next = index + 1 < count ? self.items[index + 1].start : DBL_MAX;
+    NSTimeInterval end = self.items[index].end;
+    NSTimeInterval graceEnd = [self graceEndOfIndex:index gracePeriod:gracePeriod];
+    if (time < end) {
+        return end;
+    }
+    if (time < graceEnd) {
+        return MIN(graceEnd, next);
+    }
+    return next;
+}
+
+@end
+
+@interface DYFStoreSubscriptionTimeline ()
+@property (nonatomic, strong) id<DYFStoreClock> clock;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSString *> *productGroups;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, DYFStoreSubscriptionGroup *> *groupTable;
+@property (nonatomic, assign) NSTimeInterval wakeTime;
+@property (nonatomic, assign) NSUInteger generation;
+@end
+
+@implementation DYFStoreSubscriptionTimeline
+
+- (instancetype)init
+{
+    return [self initWithClock:[[DYFStoreSystemClock alloc] init] queue:dispatch_get_main_queue()];
+}
+
+- (instancetype)initWithClock:(id<DYFStoreClock>)clock queue:(dispatch_queue_t)queue
+{
+    self = [super init];
+    if (self) {
+        _clock = clock ?: [[DYFStoreSystemClock alloc] init];
+        _queue = queue ?: dispatch_get_main_queue();
+        _productGroups = [NSMutableDictionary dictionary];
+        _groupTable = [NSMutableDictionary dictionary];
+        
+        // A wake-up scheduled before the device slept or the time was changed can be late or early, so the status is evaluated again on the wall time.
+        NSNotificationCenter *center = NSNotificationCenter.defaultCenter;
+        [center addObserver:self selector:@selector(reevaluate) name:UIApplicationSignificantTimeChangeNotification object:nil];
+        [center addObserver:self selector:@selector(reevaluate) name:UIApplicationWillEnterForegroundNotification object:nil];
+        [center addObserver:self selector:@selector(reevaluate) name:NSSystemClockDidChangeNotification object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [NSNotificationCenter.defaultCenter removeObserver:self];
+}
+
+- (NSArray<NSString *> *)groups
+{
+    @synchronized (self) {
+        return self.groupTable.allKeys;
+    }
+}
+
+- (void)setGroup:(NSString *)group forProduct:(NSString *)productIdentifier
+{
+    if (!productIdentifier) { return; }
+    @synchronized (self) {
+        self.productGroups[productIdentifier] = group;
+    }
+}
+
+- (NSString *)groupForProduct:(NSString *)productIdentifier
+{
+    @synchronized (self) {
+        return self.productGroups[productIdentifier ?: @""] ?: productIdentifier;
+    }
+}
+
+#pragma mark - Adding Periods
+
+/** Returns the group table entry, creating it. Must be called within `@synchronized (self)`.
+ */
+- (DYFStoreSubscriptionGroup *)entryForGroup:(NSString *)group
+{
+    DYFStoreSubscriptionGroup *entry = self.groupTable[group];
+    if (!entry) {
+        entry = [[DYFStoreSubscriptionGroup alloc] init];
+        self.groupTable[group] = entry;
+    }
+    return entry;
+}
+
+- (void)addPeriodForProduct:(NSString *)productIdentifier
+      transactionIdentifier:(NSString *)transactionIdentifier
+                  startTime:(NSTimeInterval)startTime
+                    endTime:(NSTimeInterval)endTime
+{
+    if (!productIdentifier || !transactionIdentifier) { return; }
+    
+    @synchronized (self) {
+        NSString *group = self.productGroups[productIdentifier] ?: productIdentifier;
+        DYFStoreInterval interval = {startTime, MAX(startTime, endTime)};
+        [[self entryForGroup:group] setInterval:interval forTransaction:transactionIdentifier];
+    }
+    [self evaluateGroupsDueBy:DBL_MAX];
+}
+
+/** Reads a date in milliseconds since 1970, which the App Store sends as a string.
+ */
+static NSTimeInterval DYFStoreReceiptTime(NSDictionary *entry, NSString *key)
+{
+    id value = entry[key];
+    if (![value isKindOfClass:NSString.class] && ![value isKindOfClass:NSNumber.class]) { return -1; }
+    return [value doubleValue] / 1000;
+}
+
+- (void)addReceiptEntries:(NSArray<NSDictionary *> *)entries
+{
+    @synchronized (self) {
+        for (NSDictionary *entry in entries) {
+            if (![entry isKindOfClass:NSDictionary.class]) { continue; }
+            
+            NSString *productIdentifier = entry[@"product_id"];
+            NSString *transactionIdentifier = entry[@"transaction_id"];
+            NSTimeInterval start = DYFStoreReceiptTime(entry, @"purchase_date_ms");
+            NSTimeInterval end = DYFStoreReceiptTime(entry, @"expires_date_ms");
+            if (![productIdentifier isKindOfClass:NSString.class] || ![transactionIdentifier isKindOfClass:NSString.class] || start < 0 || end < 0) {
+                continue;
+            }
+            
+            // A refunded period ends when it was cancelled.
+            NSTimeInterval cancellation = DYFStoreReceiptTime(entry, @"cancellation_date_ms");
+            if (cancellation >= 0) {
+                end = MIN(end, cancellation);
+            }
+            
+            NSString *group = entry[@"subscription_group_identifier"];
+            if ([group isKindOfClass:NSString.class]) {
+                self.productGroups[productIdentifier] = group;
+            } else {
+                group = self.productGroups[productIdentifier] ?: productIdentifier;
+            }
+            
+            DYFStoreInterval interval = {start, MAX(start, end)};
+            [[self entryForGroup:group] setInterval:interval forTransaction:transactionIdentifier];
+        }
+    }
+    [self evaluateGroupsDueBy:DBL_MAX];
+}
+
+- (void)addPendingRenewalInfo:(NSArray<NSDictionary *> *)entries
+{
+    @synchronized (self) {
+        for (NSDictionary *entry in entries) {
+            if (![entry isKindOfClass:NSDictionary.class]) { continue; }
+            
+            NSString *productIdentifier = entry[@"product_id"];
+            NSTimeInterval graceUntil = DYFStoreReceiptTime(entry, @"grace_period_expires_date_ms");
+            if (![productIdentifier isKindOfClass:NSString.class] || graceUntil < 0) { continue; }
+            
+            NSString *group = self.productGroups[productIdentifier] ?: productIdentifier;
+            [self entryForGroup:group].graceUntil = graceUntil;
+        }
+    }
+    [self evaluateGroupsDueBy:DBL_MAX];
+}
+
+- (void)removeAllPeriods
+{
+    @synchronized (self) {
+        [self.groupTable removeAllObjects];
+        // Drops the scheduled wake-up.
+        self.generation++;
+        self.wakeTime = 0;
+    }
+}
+
+#pragma mark - Queries
+
+- (DYFStoreSubscriptionStatus)statusForGroup:(NSString *)group
+{
+    return [self statusForGroup:group atTime:self.clock.now];
+}
+
+- (DYFStoreSubscriptionStatus)statusForGroup:(NSString *)group atTime:(NSTimeInterval)time
+{
+    @synchronized (self) {
+        DYFStoreSubscriptionGroup *entry = self.groupTable[group ?: @""];
+        return entry ? [entry statusAtTime:time gracePeriod:self.gracePeriod] : DYFStoreSubscriptionStatusNone;
+    }
+}
+
+- (NSTimeInterval)nextChangeTimeForGroup:(NSString *)group afterTime:(NSTimeInterval)time
+{
+    @synchronized (self) {
+        DYFStoreSubscriptionGroup *entry = self.groupTable[group ?: @""];
+        return entry ? [entry nextChangeAfterTime:time gracePeriod:self.gracePeriod] : DBL_MAX;
+    }
+}
+
+#pragma mark - Scheduling
+
+/** Evaluates the groups whose next change is due by a time, tells the delegate about the changed ones, and schedules a wake-up at the earliest next change.
+ 
+ @param dueTime The time up to which the groups are evaluated. DBL_MAX evaluates all of them, after periods were added.
+ */
+- (void)evaluateGroupsDueBy:(NSTimeInterval)dueTime
+{
+    NSMutableDictionary<NSString *, NSNumber *> *changes = [NSMutableDictionary dictionary];
+    NSTimeInterval earliest = DBL_MAX;
+    
+    @synchronized (self) {
+        NSTimeInterval now = self.clock.now;
+        NSTimeInterval gracePeriod = self.gracePeriod;
+        
+        for (NSString *group in self.groupTable) {
+            DYFStoreSubscriptionGroup *entry = self.groupTable[group];
+            if (entry.nextChange <= dueTime) {
+                DYFStoreSubscriptionStatus status = [entry statusAtTime:now gracePeriod:gracePeriod];
+                if (status != entry.status) {
+                    entry.status = status;
+                    changes[group] = @(status);
+                }
+                entry.nextChange = [entry nextChangeAfterTime:now gracePeriod:gracePeriod];
+            }
+            earliest = MIN(earliest, entry.nextChange);
+        }
+    }
+    
+    if (changes.count > 0) {
+        dispatch_async(self.queue, ^{
+            [changes enumerateKeysAndObjectsUsingBlock:^(NSString *group, NSNumber *status, BOOL *stop) {
+                DYFStoreLog(@"subscription group %@ changed to status %@", group, status);
+                [self.delegate subscriptionTimeline:self didChangeStatus:status.integerValue forGroup:group];
+            }];
+        });
+    }
+    
+    if (earliest < DBL_MAX) {
+        [self scheduleWakeUpAt:earliest];
+    }
+}
+
+- (void)reevaluate
+{
+    @synchronized (self) {
+        // Drops the scheduled wake-up, which the evaluation replaces.
+        self.generation++;
+        self.wakeTime = 0;
+    }
+    [self evaluateGroupsDueBy:DBL_MAX];
+}
+
+/** Schedules a wake-up at a time, unless one is scheduled earlier that is still ahead. A wake-up whose time has passed without it firing, e.g. while the device slept, is replaced.
+ */
+- (void)scheduleWakeUpAt:(NSTimeInterval)time
+{
+    NSUInteger generation;
+    NSTimeInterval delay;
+    
+    @synchronized (self) {
+        NSTimeInterval now = self.clock.now;
+        if (self.wakeTime > now && self.wakeTime <= time) { return; }
+        self.wakeTime = time;
+        generation = ++self.generation;
+        delay = MAX(time - now, 0);
+    }
+    
+    __weak typeof(self) weakSelf = self;
+    [self.clock performAfterDelay:delay onQueue:self.queue block:^{
+        [weakSelf wakeUp:generation];
+    }];
+}
+
+- (void)wakeUp:(NSUInteger)generation
+{
+    NSTimeInterval now;
+    @synchronized (self) {
+        // A later wake-up has replaced this one.
+        if (generation != self.generation) { return; }
+        self.wakeTime = 0;
+        now = self.clock.now;
+    }
+    [self evaluateGroupsDueBy:now];
+}
+
+@end
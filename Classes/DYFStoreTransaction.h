@@ -24,6 +24,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "DYFStoreFieldTable.h"
 
 /** The key UserDefaults and Keychain used.
  */
@@ -40,7 +41,7 @@ typedef NS_ENUM(NSUInteger, DYFStoreTransactionState)
     DYFStoreTransactionStateRestored
 };
 
-@interface DYFStoreTransaction : NSObject <NSCoding>
+@interface DYFStoreTransaction : NSObject <NSCoding, DYFStoreFieldMapping>
 
 /** The state of this transaction. 0: purchased, 1: restored.
  */
@@ -79,3 +80,36 @@ typedef NS_ENUM(NSUInteger, DYFStoreTransactionState)
 @property (nonatomic, copy) NSString *transactionReceipt;
 
 @end
+
+/** The compact part of a stored transaction that is needed to decide whether and when to process it, and to query the stored transactions. Reading the headers does not decode the records or their receipts.
+ */
+@interface DYFStoreTransactionHeader : NSObject
+
+/** The state of the transaction. 0: purchased, 1: restored.
+ */
+@property (nonatomic, assign) NSUInteger state;
+
+/** The unique server-provided identifier.
+ */
+@property (nonatomic, copy) NSString *transactionIdentifier;
+
+/** The identifier of the product.
+ */
+@property (nonatomic, copy) NSString *productIdentifier;
+
+/** An opaque identifier for the user’s account on your system.
+ */
+@property (nonatomic, copy) NSString *userIdentifier;
+
+/** The timestamp when the transaction was added to the server queue.
+ */
+@property (nonatomic, copy) NSString *transactionTimestamp;
+
+/** Creates the header of a transaction.
+ 
+ @param transaction An `DYFStoreTransaction` object.
+ @return A `DYFStoreTransactionHeader` object.
+ */
++ (instancetype)headerWithTransaction:(DYFStoreTransaction *)transaction;
+
+@end
@@ -24,12 +24,36 @@
 //
 
 #import "DYFStoreTransaction.h"
-#import "DYFRuntimeProvider.h"
 
 NSString *const DYFStoreTransactionsKey = @"DYFStoreTransactionsKey";
 
 @implementation DYFStoreTransaction
 
+DYFSTORE_FIELD_INTEGER(DYFStoreTransaction, state)
+DYFSTORE_FIELD_OBJECT(DYFStoreTransaction, productIdentifier, NSString)
+DYFSTORE_FIELD_OBJECT(DYFStoreTransaction, userIdentifier, NSString)
+DYFSTORE_FIELD_OBJECT(DYFStoreTransaction, originalTransactionTimestamp, NSString)
+DYFSTORE_FIELD_OBJECT(DYFStoreTransaction, originalTransactionIdentifier, NSString)
+DYFSTORE_FIELD_OBJECT(DYFStoreTransaction, transactionTimestamp, NSString)
+DYFSTORE_FIELD_OBJECT(DYFStoreTransaction, transactionIdentifier, NSString)
+DYFSTORE_FIELD_OBJECT(DYFStoreTransaction, transactionReceipt, NSString)
+
+static const DYFStoreField DYFStoreTransactionFields[] = {
+    DYFSTORE_FIELD(DYFStoreTransaction, state),
+    DYFSTORE_FIELD(DYFStoreTransaction, productIdentifier),
+    DYFSTORE_FIELD(DYFStoreTransaction, userIdentifier),
+    DYFSTORE_FIELD(DYFStoreTransaction, originalTransactionTimestamp),
+    DYFSTORE_FIELD(DYFStoreTransaction, originalTransactionIdentifier),
+    DYFSTORE_FIELD(DYFStoreTransaction, transactionTimestamp),
+    DYFSTORE_FIELD(DYFStoreTransaction, transactionIdentifier),
+    DYFSTORE_FIELD(DYFStoreTransaction, transactionReceipt)
+};
+
++ (DYFStoreFieldTable)fieldTable
+{
+    return DYFStoreFieldTableMake(DYFStoreTransactionFields);
+}
+
 /** The Secure Coding Guide should be consulted when writing methods that decode data.
  
  @return Must return YES on all classes that allow secure coding.
@@ -48,7 +72,7 @@ NSString *const DYFStoreTransactionsKey = @"DYFStoreTransactionsKey";
 {
     self = [super init];
     if (self) {
-        [DYFRuntimeProvider decode:aDecoder forObject:self];
+        DYFStoreFieldTableDecode(DYFStoreTransaction.fieldTable, self, aDecoder);
     }
     return self;
 }
@@ -59,7 +83,47 @@ NSString *const DYFStoreTransactionsKey = @"DYFStoreTransactionsKey";
  */
 - (void)encodeWithCoder:(NSCoder *)aCoder
 {
-    [DYFRuntimeProvider encode:aCoder forObject:self];
+    DYFStoreFieldTableEncode(DYFStoreTransaction.fieldTable, self, aCoder);
+}
+
+/** Returns an object initialized from a dictionary whose keys are the property names.
+ 
+ @param dictionary A dictionary of the properties.
+ @return An object initialized from the dictionary.
+ */
+- (instancetype)initWithDictionary:(NSDictionary *)dictionary
+{
+    if (![dictionary isKindOfClass:NSDictionary.class]) { return nil; }
+    
+    self = [super init];
+    if (self) {
+        DYFStoreFieldTableApplyDictionary(DYFStoreTransaction.fieldTable, self, dictionary);
+    }
+    return self;
+}
+
+/** Returns a dictionary whose keys are the property names.
+ 
+ @return A dictionary of the non-nil properties.
+ */
+- (NSDictionary *)dictionaryRepresentation
+{
+    return DYFStoreFieldTableDictionary(DYFStoreTransaction.fieldTable, self);
+}
+
+@end
+
+@implementation DYFStoreTransactionHeader
+
++ (instancetype)headerWithTransaction:(DYFStoreTransaction *)transaction
+{
+    DYFStoreTransactionHeader *header = [[self alloc] init];
+    header.state = transaction.state;
+    header.transactionIdentifier = transaction.transactionIdentifier;
+    header.productIdentifier = transaction.productIdentifier;
+    header.userIdentifier = transaction.userIdentifier;
+    header.transactionTimestamp = transaction.transactionTimestamp;
+    return header;
 }
 
 @end
@@ -0,0 +1,120 @@
+//
+//  DYFStoreTransactionIndex.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "DYFStoreTransaction.h"
+
+/** Describes the stored transactions to retrieve. The criteria that are set must all match.
+ */
+@interface DYFStoreTransactionQuery : NSObject
+
+/** Matches the transactions of an opaque identifier for the user’s account on your system.
+ */
+@property (nonatomic, copy) NSString *userIdentifier;
+
+/** Matches the transactions of a product.
+ */
+@property (nonatomic, copy) NSString *productIdentifier;
+
+/** Matches the transactions in a state, e.g. @(DYFStoreTransactionStateRestored).
+ */
+@property (nonatomic, strong) NSNumber *state;
+
+/** Matches the transactions whose timestamp is equal to or later than this one.
+ */
+@property (nonatomic, copy) NSString *sinceTimestamp;
+
+/** Matches the transactions whose timestamp is earlier than this one.
+ */
+@property (nonatomic, copy) NSString *beforeTimestamp;
+
+/** The maximum number of transactions to return, the earliest stored first. The default value is 0, which means no limit.
+ */
+@property (nonatomic, assign) NSUInteger limit;
+
+/** Creates a query that matches the transactions of a user.
+ 
+ @param userIdentifier An opaque identifier for the user’s account on your system.
+ @return A `DYFStoreTransactionQuery` object.
+ */
++ (instancetype)queryWithUserIdentifier:(NSString *)userIdentifier;
+
+@end
+
+/** The secondary indexes over the headers of the stored transactions: hashed indexes on the user identifier, the product identifier and the state, and an ordered index on the timestamp. The positions of the headers follow the order of the stored records.
+ 
+ It is maintained incrementally as records are appended and removed. It is not thread-safe.
+ */
+@interface DYFStoreTransactionIndex : NSObject
+
+/** The headers, in the order of the stored records.
+ */
+@property (nonatomic, copy, readonly) NSArray<DYFStoreTransactionHeader *> *headers;
+
+/** The number of headers.
+ */
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+/** Creates an index.
+ 
+ @param headers The headers, in the order of the stored records.
+ @return A `DYFStoreTransactionIndex` object.
+ */
+- (instancetype)initWithHeaders:(NSArray<DYFStoreTransactionHeader *> *)headers;
+
+/** Adds the header of a record that has been appended.
+ 
+ @param header A `DYFStoreTransactionHeader` object.
+ */
+- (void)addHeader:(DYFStoreTransactionHeader *)header;
+
+/** Removes the headers of records that have been removed. The positions of the following headers move up.
+ 
+ @param indexes The positions of the headers.
+ */
+- (void)removeHeadersAtIndexes:(NSIndexSet *)indexes;
+
+/** Returns the position of the first record with a given transaction identifier.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ @return The position, or NSNotFound.
+ */
+- (NSUInteger)indexOfTransaction:(NSString *)transactionIdentifier;
+
+/** Returns the positions of the records with the given transaction identifiers.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ @return The positions.
+ */
+- (NSIndexSet *)indexesOfTransactions:(NSArray<NSString *> *)transactionIdentifiers;
+
+/** Returns the positions of the records that match a query. The most selective criterion is looked up first, the others are checked against its candidates.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return The positions, at most `query.limit` of them.
+ */
+- (NSIndexSet *)indexesOfTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query;
+
+@end
@@ -0,0 +1,309 @@
+//
+//  DYFStoreTransactionIndex.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreTransactionIndex.h"
+
+@implementation DYFStoreTransactionQuery
+
++ (instancetype)queryWithUserIdentifier:(NSString *)userIdentifier
+{
+    DYFStoreTransactionQuery *query = [[self alloc] init];
+    query.userIdentifier = userIdentifier;
+    return query;
+}
+
+@end
+
+static inline double DYFStoreHeaderTime(DYFStoreTransactionHeader *header)
+{
+    return header.transactionTimestamp.doubleValue;
+}
+
+@interface DYFStoreTransactionIndex ()
+{
+    NSMutableArray<DYFStoreTransactionHeader *> *_headers;
+    // The position of every header, keyed by identity.
+    NSMapTable<DYFStoreTransactionHeader *, NSNumber *> *_positions;
+    NSMutableDictionary<NSString *, NSMutableArray<DYFStoreTransactionHeader *> *> *_identifiers;
+    NSMutableDictionary<NSString *, NSMutableSet<DYFStoreTransactionHeader *> *> *_users;
+    NSMutableDictionary<NSString *, NSMutableSet<DYFStoreTransactionHeader *> *> *_products;
+    NSMutableDictionary<NSNumber *, NSMutableSet<DYFStoreTransactionHeader *> *> *_states;
+    // The headers sorted by timestamp.
+    NSMutableArray<DYFStoreTransactionHeader *> *_timeline;
+}
+@end
+
+@implementation DYFStoreTransactionIndex
+
+- (instancetype)init
+{
+    return [self initWithHeaders:@[]];
+}
+
+- (instancetype)initWithHeaders:(NSArray<DYFStoreTransactionHeader *> *)headers
+{
+    self = [super init];
+    if (self) {
+        _headers = [NSMutableArray arrayWithCapacity:headers.count];
+        _positions = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                           valueOptions:NSPointerFunctionsStrongMemory];
+        _identifiers = [NSMutableDictionary dictionaryWithCapacity:headers.count];
+        _users = [NSMutableDictionary dictionary];
+        _products = [NSMutableDictionary dictionary];
+        _states = [NSMutableDictionary dictionary];
+        
+        for (DYFStoreTransactionHeader *header in headers) {
+            [self addHeader:header sorted:NO];
+        }
+        
+        // Sorting once is cheaper than inserting every header in order.
+        _timeline = [[headers sortedArrayWithOptions:NSSortStable usingComparator:^NSComparisonResult(DYFStoreTransactionHeader *h1, DYFStoreTransactionHeader *h2) {
+            double t1 = DYFStoreHeaderTime(h1), t2 = DYFStoreHeaderTime(h2);
+            return t1 < t2 ? NSOrderedAscending : (t1 > t2 ? NSOrderedDescending : NSOrderedSame);
+        }] mutableCopy];
+    }
+    return self;
+}
+
+- (NSArray<DYFStoreTransactionHeader *> *)headers
+{
+    return [_headers copy];
+}
+
+- (NSUInteger)count
+{
+    return _headers.count;
+}
+
+#pragma mark - Maintenance
+
+static void DYFStoreIndexAdd(NSMutableDictionary *index, id key, DYFStoreTransactionHeader *header)
+{
+    if (!key) { return; }
+    NSMutableSet *set = index[key];
+    if (!set) {
+        set = [NSMutableSet set];
+        index[key] = set;
+    }
+    [set addObject:header];
+}
+
+static void DYFStoreIndexRemove(NSMutableDictionary *index, id key, DYFStoreTransactionHeader *header)
+{
+    if (!key) { return; }
+    NSMutableSet *set = index[key];
+    [set removeObject:header];
+    if (set.count == 0) {
+        [index removeObjectForKey:key];
+    }
+}
+
+/** Returns the position of the first header in the timeline whose timestamp is not earlier than a time.
+ */
+- (NSUInteger)lowerBoundOfTime:(double)time
+{
+    NSUInteger low = 0, high = _timeline.count;
+    while (low < high) {
+        NSUInteger mid = low + (high - low) / 2;
+        if (DYFStoreHeaderTime(_timeline[mid]) < time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+- (void)addHeader:(DYFStoreTransactionHeader *)header sorted:(BOOL)sorted
+{
+    if (!header) { return; }
+    
+    [_positions setObject:@(_headers.count) forKey:header];
+    [_headers addObject:header];
+    
+    if (header.transactionIdentifier) {
+        NSMutableArray *headers = _identifiers[header.transactionIdentifier];
+        if (!headers) {
+            headers = [NSMutableArray arrayWithCapacity:1];
+            _identifiers[header.transactionIdentifier] = headers;
+        }
+        [headers addObject:header];
+    }
+    DYFStoreIndexAdd(_users, header.userIdentifier, header);
+    DYFStoreIndexAdd(_products, header.productIdentifier, header);
+    DYFStoreIndexAdd(_states, @(header.state), header);
+    
+    if (sorted) {
+        // After the headers with the same timestamp, so equal timestamps keep the stored order.
+        double time = DYFStoreHeaderTime(header);
+        NSUInteger position = [self lowerBoundOfTime:time];
+        while (position < _timeline.count && DYFStoreHeaderTime(_timeline[position]) == time) {
+            position++;
+        }
+        [_timeline insertObject:header atIndex:position];
+    }
+}
+
+- (void)addHeader:(DYFStoreTransactionHeader *)header
+{
+    [self addHeader:header sorted:YES];
+}
+
+- (void)removeHeadersAtIndexes:(NSIndexSet *)indexes
+{
+    if (indexes.count == 0) { return; }
+    
+    NSArray<DYFStoreTransactionHeader *> *removed = [_headers objectsAtIndexes:indexes];
+    for (DYFStoreTransactionHeader *header in removed) {
+        if (header.transactionIdentifier) {
+            NSMutableArray *headers = _identifiers[header.transactionIdentifier];
+            [headers removeObjectIdenticalTo:header];
+            if (headers.count == 0) {
+                [_identifiers removeObjectForKey:header.transactionIdentifier];
+            }
+        }
+        DYFStoreIndexRemove(_users, header.userIdentifier, header);
+        DYFStoreIndexRemove(_products, header.productIdentifier, header);
+        DYFStoreIndexRemove(_states, @(header.state), header);
+        
+        double time = DYFStoreHeaderTime(header);
+        for (NSUInteger position = [self lowerBoundOfTime:time]; position < _timeline.count; position++) {
+            if (_timeline[position] == header) {
+                [_timeline removeObjectAtIndex:position];
+                break;
+            }
+        }
+    }
+    
+    [_headers removeObjectsAtIndexes:indexes];
+    
+    // The positions after the first removed header have moved up.
+    for (NSUInteger position = indexes.firstIndex; position < _headers.count; position++) {
+        [_positions setObject:@(position) forKey:_headers[position]];
+    }
+    for (DYFStoreTransactionHeader *header in removed) {
+        [_positions removeObjectForKey:header];
+    }
+}
+
+#pragma mark - Lookup
+
+- (NSUInteger)indexOfTransaction:(NSString *)transactionIdentifier
+{
+    DYFStoreTransactionHeader *header = transactionIdentifier ? _identifiers[transactionIdentifier].firstObject : nil;
+    if (!header) { return NSNotFound; }
+    return [[_positions objectForKey:header] unsignedIntegerValue];
+}
+
+- (NSIndexSet *)indexesOfTransactions:(NSArray<NSString *> *)transactionIdentifiers
+{
+    NSMutableIndexSet *indexes = [NSMutableIndexSet indexSet];
+    for (NSString *transactionIdentifier in transactionIdentifiers) {
+        if (![transactionIdentifier isKindOfClass:NSString.class]) { continue; }
+        for (DYFStoreTransactionHeader *header in _identifiers[transactionIdentifier]) {
+            [indexes addIndex:[[_positions objectForKey:header] unsignedIntegerValue]];
+        }
+    }
+    return indexes;
+}
+
+- (NSIndexSet *)indexesOfTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query
+{
+    NSMutableArray<NSSet<DYFStoreTransactionHeader *> *> *sets = [NSMutableArray arrayWithCapacity:3];
+    if (query.userIdentifier) {
+        [sets addObject:_users[query.userIdentifier] ?: [NSSet set]];
+    }
+    if (query.productIdentifier) {
+        [sets addObject:_products[query.productIdentifier] ?: [NSSet set]];
+    }
+    if (query.state) {
+        [sets addObject:_states[@(query.state.unsignedIntegerValue)] ?: [NSSet set]];
+    }
+    
+    BOOL ranged = query.sinceTimestamp || query.beforeTimestamp;
+    double since = query.sinceTimestamp ? query.sinceTimestamp.doubleValue : -DBL_MAX;
+    double before = query.beforeTimestamp ? query.beforeTimestamp.doubleValue : DBL_MAX;
+    NSRange range = NSMakeRange(0, _timeline.count);
+    if (ranged) {
+        NSUInteger lower = query.sinceTimestamp ? [self lowerBoundOfTime:since] : 0;
+        NSUInteger upper = query.beforeTimestamp ? [self lowerBoundOfTime:before] : _timeline.count;
+        range = NSMakeRange(lower, upper > lower ? upper - lower : 0);
+    }
+    
+    // Drives the lookup with the smallest candidate list.
+    id<NSFastEnumeration> driver = nil;
+    NSUInteger driverCount = NSUIntegerMax;
+    NSSet *driverSet = nil;
+    for (NSSet *set in sets) {
+        if (set.count < driverCount) {
+            driver = set;
+            driverSet = set;
+            driverCount = set.count;
+        }
+    }
+    BOOL rangeDrives = NO;
+    if (ranged && range.length < driverCount) {
+        driver = [_timeline subarrayWithRange:range];
+        driverSet = nil;
+        driverCount = range.length;
+        rangeDrives = YES;
+    }
+    
+    NSMutableIndexSet *indexes = [NSMutableIndexSet indexSet];
+    if (!driver) {
+        [indexes addIndexesInRange:NSMakeRange(0, _headers.count)];
+    } else {
+        for (DYFStoreTransactionHeader *header in driver) {
+            BOOL matches = YES;
+            for (NSSet *set in sets) {
+                if (set != driverSet && ![set containsObject:header]) {
+                    matches = NO;
+                    break;
+                }
+            }
+            if (matches && ranged && !rangeDrives) {
+                double time = DYFStoreHeaderTime(header);
+                matches = time >= since && time < before;
+            }
+            if (matches) {
+                [indexes addIndex:[[_positions objectForKey:header] unsignedIntegerValue]];
+            }
+        }
+    }
+    
+    if (query.limit > 0 && indexes.count > query.limit) {
+        __block NSUInteger remaining = query.limit;
+        NSMutableIndexSet *limited = [NSMutableIndexSet indexSet];
+        [indexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+            [limited addIndex:idx];
+            *stop = --remaining == 0;
+        }];
+        return limited;
+    }
+    
+    return indexes;
+}
+
+@end
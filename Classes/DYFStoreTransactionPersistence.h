@@ -0,0 +1,116 @@
+//
+//  DYFStoreTransactionPersistence.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "DYFStoreTransaction.h"
+#import "DYFStoreTransactionIndex.h"
+#import "DYFStoreBulkDecoder.h"
+
+/** The methods shared by the transaction persisters.
+ */
+@protocol DYFStoreTransactionPersistence <NSObject>
+
+/** Returns a Boolean value that indicates whether a transaction is stored with a given transaction ientifier.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ @return True if a transaction is stored, otherwise false.
+ */
+- (BOOL)containsTransaction:(NSString *)transactionIdentifier;
+
+/** Stores an `DYFStoreTransaction` object.
+ 
+ @param transaction An `DYFStoreTransaction` object.
+ */
+- (void)storeTransaction:(DYFStoreTransaction *)transaction;
+
+/** Stores the `DYFStoreTransaction` objects, reading and writing the storage once, e.g. for the transactions of a restore.
+ 
+ @param transactions The `DYFStoreTransaction` objects.
+ */
+- (void)storeTransactions:(NSArray<DYFStoreTransaction *> *)transactions;
+
+/** Retrieves an array whose elements are the stored `DYFStoreTransaction` objects. The records of a large store are decoded in parallel, see `DYFStoreBulkDecoder`.
+ 
+ @return An array whose elements are the `DYFStoreTransaction` objects, in the order they were stored.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactions;
+
+/** Enumerates the stored `DYFStoreTransaction` objects, in the order they were stored, as soon as they are decoded, without building one array of them.
+ 
+ @param block The block called on the calling thread for each transaction. Set `stop` to YES to stop decoding.
+ */
+- (void)enumerateTransactionsUsingBlock:(void (^)(DYFStoreTransaction *transaction, BOOL *stop))block;
+
+/** Retrieves the headers of the stored transactions, in the order they were stored, without decoding the full records. Use it at launch to find the unfinished transactions cheaply.
+ 
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeaders;
+
+/** Retrieves the `DYFStoreTransaction` objects with the given transaction identifiers, decoding only their records.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ @return An array whose elements are the `DYFStoreTransaction` objects, in the order they were stored.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
+/** Retrieves the headers of the stored transactions that match a query, looked up through the secondary indexes.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects, in the order they were stored.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeadersMatchingQuery:(DYFStoreTransactionQuery *)query;
+
+/** Retrieves the `DYFStoreTransaction` objects that match a query, decoding only their records.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return An array whose elements are the `DYFStoreTransaction` objects, in the order they were stored.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query;
+
+/** Retrieves an `DYFStoreTransaction` object with a given transaction ientifier.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ @return An `DYFStoreTransaction` object.
+ */
+- (DYFStoreTransaction *)retrieveTransaction:(NSString *)transactionIdentifier;
+
+/** Removes an `DYFStoreTransaction` object with a given transaction ientifier.
+ 
+ @param transactionIdentifier The unique server-provided identifier.
+ */
+- (void)removeTransaction:(NSString *)transactionIdentifier;
+
+/** Removes the `DYFStoreTransaction` objects with the given transaction identifiers, reading and writing the storage once.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ */
+- (void)removeTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
+/** Removes all transactions.
+ */
+- (void)removeTransactions;
+
+@end
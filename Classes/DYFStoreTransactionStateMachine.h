@@ -0,0 +1,171 @@
+//
+//  DYFStoreTransactionStateMachine.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <StoreKit/StoreKit.h>
+
+/** Uses enumeration to inicate the phase of a transaction in the state machine.
+ */
+typedef NS_ENUM(uint8_t, DYFStoreTransactionPhase)
+{
+    /** The transaction has not been seen. */
+    DYFStoreTransactionPhaseNone,
+    /** The transaction is being processed by the App Store. */
+    DYFStoreTransactionPhasePurchasing,
+    /** The App Store successfully processed the payment. */
+    DYFStoreTransactionPhasePurchased,
+    /** The transaction failed, or its downloads did. */
+    DYFStoreTransactionPhaseFailed,
+    /** The transaction restores a previous purchase. */
+    DYFStoreTransactionPhaseRestored,
+    /** The transaction is pending external action such as Ask to Buy. */
+    DYFStoreTransactionPhaseDeferred,
+    /** The hosted content of the transaction is being downloaded. */
+    DYFStoreTransactionPhaseDownloading,
+    /** All the hosted content of the transaction was downloaded. */
+    DYFStoreTransactionPhaseDownloaded,
+    /** The transaction was finished. */
+    DYFStoreTransactionPhaseFinished,
+    /** The number of phases. */
+    DYFStoreTransactionPhaseCount,
+    /** The input was illegal in the phase of the transaction, or repeated it. The phase is unchanged. */
+    DYFStoreTransactionPhaseRejected = 0xFF
+};
+
+/** Uses enumeration to inicate what happens to a transaction. The first inputs are the values of `SKPaymentTransactionState`.
+ */
+typedef NS_ENUM(uint8_t, DYFStoreTransactionInput)
+{
+    /** The payment queue updated the transaction to SKPaymentTransactionStatePurchasing. */
+    DYFStoreTransactionInputPurchasing = SKPaymentTransactionStatePurchasing,
+    /** The payment queue updated the transaction to SKPaymentTransactionStatePurchased. */
+    DYFStoreTransactionInputPurchased = SKPaymentTransactionStatePurchased,
+    /** The payment queue updated the transaction to SKPaymentTransactionStateFailed. */
+    DYFStoreTransactionInputFailed = SKPaymentTransactionStateFailed,
+    /** The payment queue updated the transaction to SKPaymentTransactionStateRestored. */
+    DYFStoreTransactionInputRestored = SKPaymentTransactionStateRestored,
+    /** The payment queue updated the transaction to SKPaymentTransactionStateDeferred. */
+    DYFStoreTransactionInputDeferred = 4,
+    /** The downloads of the transaction were started. */
+    DYFStoreTransactionInputDownloadStarted,
+    /** All the downloads of the transaction finished. */
+    DYFStoreTransactionInputDownloadFinished,
+    /** All the downloads of the transaction are complete, and one of them failed or was cancelled. */
+    DYFStoreTransactionInputDownloadFailed,
+    /** The transaction is finished. */
+    DYFStoreTransactionInputFinish,
+    /** The number of inputs. */
+    DYFStoreTransactionInputCount
+};
+
+/** A transition of a transaction.
+ */
+typedef struct {
+    /** The input applied to the transaction. */
+    DYFStoreTransactionInput input;
+    /** The phase of the transaction before the input. */
+    DYFStoreTransactionPhase from;
+    /** The phase of the transaction after the input. */
+    DYFStoreTransactionPhase to;
+} DYFStoreTransactionTransition;
+
+/** The transitions accepted from one batch of updated transactions, in the order of the batch.
+ */
+@interface DYFStoreTransactionBatch : NSObject
+
+/** The transactions whose updates were accepted.
+ */
+@property (nonatomic, copy, readonly) NSArray<SKPaymentTransaction *> *transactions;
+
+/** The number of accepted transitions.
+ */
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+/** The number of updates that were rejected as illegal or duplicate.
+ */
+@property (nonatomic, assign, readonly) NSUInteger rejectedCount;
+
+/** Returns the transition of the transaction at the index of `transactions`.
+ 
+ @param index An index less than `count`.
+ @return A `DYFStoreTransactionTransition` struct.
+ */
+- (DYFStoreTransactionTransition)transitionAtIndex:(NSUInteger)index;
+
+@end
+
+/** Tracks the phase of every transaction through an explicit transition table:
+ 
+ purchasing → purchased | failed | deferred, deferred → purchasing | purchased | failed, purchased | restored → downloading → downloaded | failed, and any of purchased, failed, restored, downloading or downloaded → finished.
+ 
+ An input missing from the table is rejected without changing the phase, which covers the updates redelivered by the payment queue, the updates of finished transactions and the transactions finished twice. The transactions are tracked by their identifier, or by the object while they are purchasing and have none. The identifiers of the most recently finished transactions are kept, see `finishedCapacity`. The state machine is thread-safe.
+ */
+@interface DYFStoreTransactionStateMachine : NSObject
+
+/** The number of tracked transactions, including the finished ones that are remembered.
+ */
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+/** The number of finished transactions that are remembered, so that a redelivery of one is rejected as a duplicate. The ones that finished first are forgotten beyond it. The default value is 1024.
+ 
+ This bounds the memory of a long-running app. The trade-off is that a transaction redelivered after it was forgotten is no longer known as finished, and is accepted and processed again. The payment queue no longer delivers a transaction once it has finished, so only a stale redelivery, far behind the more recent ones, can be affected.
+ */
+@property (nonatomic, assign) NSUInteger finishedCapacity;
+
+/** Returns the phase that an input leads to, looked up in the transition table.
+ 
+ @param phase The phase of a transaction.
+ @param input An input.
+ @return The next phase, or DYFStoreTransactionPhaseRejected.
+ */
++ (DYFStoreTransactionPhase)phaseFromPhase:(DYFStoreTransactionPhase)phase input:(DYFStoreTransactionInput)input;
+
+/** Applies the states of a batch of updated transactions in one pass.
+ 
+ @param transactions The transactions updated by the payment queue.
+ @return A `DYFStoreTransactionBatch` object of the accepted transitions.
+ */
+- (DYFStoreTransactionBatch *)applyTransactions:(NSArray<SKPaymentTransaction *> *)transactions;
+
+/** Applies an input to a transaction.
+ 
+ @param input An input.
+ @param transaction An `SKPaymentTransaction` object.
+ @return The new phase of the transaction, or DYFStoreTransactionPhaseRejected.
+ */
+- (DYFStoreTransactionPhase)applyInput:(DYFStoreTransactionInput)input toTransaction:(SKPaymentTransaction *)transaction;
+
+/** Returns the phase of a transaction.
+ 
+ @param transaction An `SKPaymentTransaction` object.
+ @return The phase of the transaction, DYFStoreTransactionPhaseNone if it is not tracked.
+ */
+- (DYFStoreTransactionPhase)phaseOfTransaction:(SKPaymentTransaction *)transaction;
+
+/** Forgets all the transactions, e.g. before the payment queue delivers the unfinished transactions again.
+ */
+- (void)reset;
+
+@end
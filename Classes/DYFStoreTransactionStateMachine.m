@@ -0,0 +1,247 @@
+//
+//  DYFStoreTransactionStateMachine.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreTransactionStateMachine.h"
+
+#define XX DYFStoreTransactionPhaseRejected
+#define PG DYFStoreTransactionPhasePurchasing
+#define PD DYFStoreTransactionPhasePurchased
+#define FA DYFStoreTransactionPhaseFailed
+#define RS DYFStoreTransactionPhaseRestored
+#define DF DYFStoreTransactionPhaseDeferred
+#define DL DYFStoreTransactionPhaseDownloading
+#define DD DYFStoreTransactionPhaseDownloaded
+#define FN DYFStoreTransactionPhaseFinished
+
+/** The transition table, indexed by the phase and the input. The columns are purchasing, purchased, failed, restored, deferred, download started, download finished, download failed and finish.
+ */
+static const DYFStoreTransactionPhase DYFStoreTransactionTable[DYFStoreTransactionPhaseCount][DYFStoreTransactionInputCount] = {
+    [DYFStoreTransactionPhaseNone]        = {PG, PD, FA, RS, DF, XX, XX, XX, FN},
+    [DYFStoreTransactionPhasePurchasing]  = {XX, PD, FA, XX, DF, XX, XX, XX, XX},
+    [DYFStoreTransactionPhasePurchased]   = {XX, XX, XX, XX, XX, DL, XX, XX, FN},
+    [DYFStoreTransactionPhaseFailed]      = {XX, XX, XX, XX, XX, XX, XX, XX, FN},
+    [DYFStoreTransactionPhaseRestored]    = {XX, XX, XX, XX, XX, DL, XX, XX, FN},
+    [DYFStoreTransactionPhaseDeferred]    = {PG, PD, FA, XX, XX, XX, XX, XX, XX},
+    [DYFStoreTransactionPhaseDownloading] = {XX, XX, XX, XX, XX, XX, DD, FA, FN},
+    [DYFStoreTransactionPhaseDownloaded]  = {XX, XX, XX, XX, XX, XX, XX, XX, FN},
+    [DYFStoreTransactionPhaseFinished]    = {XX, XX, XX, XX, XX, XX, XX, XX, XX},
+};
+
+#undef XX
+#undef PG
+#undef PD
+#undef FA
+#undef RS
+#undef DF
+#undef DL
+#undef DD
+#undef FN
+
+@interface DYFStoreTransactionBatch ()
+@property (nonatomic, strong) NSMutableArray<SKPaymentTransaction *> *acceptedTransactions;
+/** The `DYFStoreTransactionTransition` structs of the accepted transactions. */
+@property (nonatomic, strong) NSMutableData *transitions;
+@property (nonatomic, assign) NSUInteger rejectedCount;
+@end
+
+@implementation DYFStoreTransactionBatch
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+{
+    self = [super init];
+    if (self) {
+        _acceptedTransactions = [NSMutableArray arrayWithCapacity:capacity];
+        _transitions = [NSMutableData dataWithCapacity:capacity * sizeof(DYFStoreTransactionTransition)];
+    }
+    return self;
+}
+
+- (NSArray<SKPaymentTransaction *> *)transactions
+{
+    return [self.acceptedTransactions copy];
+}
+
+- (NSUInteger)count
+{
+    return self.acceptedTransactions.count;
+}
+
+- (DYFStoreTransactionTransition)transitionAtIndex:(NSUInteger)index
+{
+    NSParameterAssert(index < self.count);
+    return ((const DYFStoreTransactionTransition *)self.transitions.bytes)[index];
+}
+
+- (void)addTransaction:(SKPaymentTransaction *)transaction transition:(DYFStoreTransactionTransition)transition
+{
+    [self.acceptedTransactions addObject:transaction];
+    [self.transitions appendBytes:&transition length:sizeof(transition)];
+}
+
+@end
+
+@interface DYFStoreTransactionStateMachine ()
+/** The phases of the transactions that have an identifier. */
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *identifiedPhases;
+/** The phases of the purchasing transactions that have no identifier yet, which are held weakly. */
+@property (nonatomic, strong) NSMapTable<SKPaymentTransaction *, NSNumber *> *anonymousPhases;
+/** The identifiers of the finished transactions, in the order they finished. */
+@property (nonatomic, strong) NSMutableOrderedSet<NSString *> *finishedIdentifiers;
+@end
+
+@implementation DYFStoreTransactionStateMachine
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _identifiedPhases = [NSMutableDictionary dictionary];
+        _anonymousPhases = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality
+                                                 valueOptions:NSPointerFunctionsStrongMemory];
+        _finishedIdentifiers = [NSMutableOrderedSet orderedSet];
+        _finishedCapacity = 1024;
+    }
+    return self;
+}
+
++ (DYFStoreTransactionPhase)phaseFromPhase:(DYFStoreTransactionPhase)phase input:(DYFStoreTransactionInput)input
+{
+    if (phase >= DYFStoreTransactionPhaseCount || input >= DYFStoreTransactionInputCount) {
+        return DYFStoreTransactionPhaseRejected;
+    }
+    return DYFStoreTransactionTable[phase][input];
+}
+
+- (NSUInteger)count
+{
+    @synchronized (self) {
+        return self.identifiedPhases.count + self.anonymousPhases.count;
+    }
+}
+
+- (DYFStoreTransactionBatch *)applyTransactions:(NSArray<SKPaymentTransaction *> *)transactions
+{
+    DYFStoreTransactionBatch *batch = [[DYFStoreTransactionBatch alloc] initWithCapacity:transactions.count];
+    
+    @synchronized (self) {
+        for (SKPaymentTransaction *transaction in transactions) {
+            SKPaymentTransactionState state = transaction.transactionState;
+            DYFStoreTransactionTransition transition;
+            transition.input = state <= DYFStoreTransactionInputDeferred ? (DYFStoreTransactionInput)state : DYFStoreTransactionInputCount;
+            transition.to = [self applyInput:transition.input toTransaction:transaction fromPhase:&transition.from];
+            
+            if (transition.to == DYFStoreTransactionPhaseRejected) {
+                batch.rejectedCount++;
+            } else {
+                [batch addTransaction:transaction transition:transition];
+            }
+        }
+    }
+    
+    return batch;
+}
+
+- (DYFStoreTransactionPhase)applyInput:(DYFStoreTransactionInput)input toTransaction:(SKPaymentTransaction *)transaction
+{
+    if (!transaction) { return DYFStoreTransactionPhaseRejected; }
+    
+    @synchronized (self) {
+        DYFStoreTransactionPhase from;
+        return [self applyInput:input toTransaction:transaction fromPhase:&from];
+    }
+}
+
+/** Applies an input to a transaction. The caller holds the lock.
+ */
+- (DYFStoreTransactionPhase)applyInput:(DYFStoreTransactionInput)input toTransaction:(SKPaymentTransaction *)transaction fromPhase:(DYFStoreTransactionPhase *)from
+{
+    NSString *identifier = transaction.transactionIdentifier;
+    NSNumber *phase = identifier ? self.identifiedPhases[identifier] : nil;
+    BOOL anonymous = NO;
+    if (!phase) {
+        // A purchasing transaction gets its identifier when it is purchased.
+        phase = [self.anonymousPhases objectForKey:transaction];
+        anonymous = phase != nil;
+    }
+    
+    *from = phase.unsignedCharValue;
+    DYFStoreTransactionPhase to = [self.class phaseFromPhase:*from input:input];
+    if (to == DYFStoreTransactionPhaseRejected) {
+        return to;
+    }
+    
+    if (identifier) {
+        self.identifiedPhases[identifier] = @(to);
+        if (anonymous) {
+            [self.anonymousPhases removeObjectForKey:transaction];
+        }
+        if (to == DYFStoreTransactionPhaseFinished) {
+            [self rememberFinishedIdentifier:identifier];
+        }
+    } else if (to == DYFStoreTransactionPhaseFinished) {
+        [self.anonymousPhases removeObjectForKey:transaction];
+    } else {
+        [self.anonymousPhases setObject:@(to) forKey:transaction];
+    }
+    
+    return to;
+}
+
+/** Remembers a finished transaction, and forgets the ones that finished first beyond `finishedCapacity`. The caller holds the lock.
+ */
+- (void)rememberFinishedIdentifier:(NSString *)identifier
+{
+    [self.finishedIdentifiers addObject:identifier];
+    
+    NSUInteger count = self.finishedIdentifiers.count;
+    if (count <= self.finishedCapacity) { return; }
+    
+    NSRange evicted = NSMakeRange(0, count - self.finishedCapacity);
+    [self.identifiedPhases removeObjectsForKeys:[self.finishedIdentifiers objectsAtIndexes:[NSIndexSet indexSetWithIndexesInRange:evicted]]];
+    [self.finishedIdentifiers removeObjectsInRange:evicted];
+}
+
+- (DYFStoreTransactionPhase)phaseOfTransaction:(SKPaymentTransaction *)transaction
+{
+    if (!transaction) { return DYFStoreTransactionPhaseNone; }
+    
+    @synchronized (self) {
+        NSString *identifier = transaction.transactionIdentifier;
+        NSNumber *phase = identifier ? self.identifiedPhases[identifier] : nil;
+        phase = phase ?: [self.anonymousPhases objectForKey:transaction];
+        return phase.unsignedCharValue;
+    }
+}
+
+- (void)reset
+{
+    @synchronized (self) {
+        [self.identifiedPhases removeAllObjects];
+        [self.anonymousPhases removeAllObjects];
+        [self.finishedIdentifiers removeAllObjects];
+    }
+}
+
+@end
@@ -24,11 +24,19 @@
 //
 
 #import <Foundation/Foundation.h>
-#import "DYFStoreTransaction.h"
+#import "DYFStoreTransactionPersistence.h"
+
+/** The key of the compact header index that is stored next to `DYFStoreTransactionsKey`: one line per record, in the same order as the records.
+ */
+FOUNDATION_EXPORT NSString *const DYFStoreTransactionHeadersKey;
 
 /** The transaction persistence using the UserDefaults.
  */
-@interface DYFStoreUserDefaultsPersistence : NSObject
+@interface DYFStoreUserDefaultsPersistence : NSObject <DYFStoreTransactionPersistence>
+
+/** Discards the in-memory index that the persisters of the process share, so that the next access reads the header index from the user defaults again, as after a relaunch.
+ */
++ (void)discardIndex;
 
 /** Returns a Boolean value that indicates whether a transaction is present in shared preferences search list with a given transaction ientifier.
  
@@ -49,6 +57,33 @@
  */
 - (NSArray<DYFStoreTransaction *> *)retrieveTransactions;
 
+/** Retrieves the headers of the transactions from the shared preferences search list, without decoding the full records. The headers come from a compact index that is stored next to the records.
+ 
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeaders;
+
+/** Retrieves the `DYFStoreTransaction` objects from the shared preferences search list with the given transaction identifiers, decoding only their records.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
+/** Retrieves the headers of the transactions stored in the shared preferences search list that match a query.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return An array whose elements are the `DYFStoreTransactionHeader` objects.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeadersMatchingQuery:(DYFStoreTransactionQuery *)query;
+
+/** Retrieves the `DYFStoreTransaction` objects stored in the shared preferences search list that match a query.
+ 
+ @param query A `DYFStoreTransactionQuery` object.
+ @return An array whose elements are the `DYFStoreTransaction` objects.
+ */
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query;
+
 /** Retrieves an `DYFStoreTransaction` object from the shared preferences search list with a given transaction ientifier.
  
  @param transactionIdentifier The unique server-provided identifier.
@@ -62,6 +97,12 @@
  */
 - (void)removeTransaction:(NSString *)transactionIdentifier;
 
+/** Removes the `DYFStoreTransaction` objects from the shared preferences search list with the given transaction identifiers, reading and writing it once.
+ 
+ @param transactionIdentifiers The unique server-provided identifiers.
+ */
+- (void)removeTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers;
+
 /** Removes all transactions from the shared preferences search list.
  */
 - (void)removeTransactions;
@@ -25,13 +25,123 @@
 
 #import "DYFStoreUserDefaultsPersistence.h"
 #import "DYFStoreConverter.h"
+#import "DYFStoreMetrics.h"
 
 /** Returns the shared defaults `UserDefaults` object.
  */
 #define UserDefaults NSUserDefaults.standardUserDefaults
 
+NSString *const DYFStoreTransactionHeadersKey = @"DYFStoreTransactionHeadersKey";
+
+// Separates the fields of a header line. Neither it nor the newline occurs in identifiers and timestamps, and both are removed if they do.
+static const char DYFStoreHeaderSeparator = '\x1f';
+
+// The number of fields of a header line: identifier, state, product identifier, user identifier and timestamp.
+#define DYFSTORE_HEADER_FIELDS 5
+
+static void DYFStoreAppendHeaderField(NSMutableData *index, NSString *field, char terminator)
+{
+    const char *run = field.UTF8String ?: "";
+    const char *p = run;
+    for (; *p; p++) {
+        if (*p == DYFStoreHeaderSeparator || *p == '\n') {
+            [index appendBytes:run length:p - run];
+            run = p + 1;
+        }
+    }
+    [index appendBytes:run length:p - run];
+    [index appendBytes:&terminator length:1];
+}
+
+/** Appends the line of a header to the index.
+ */
+static void DYFStoreAppendHeaderLine(NSMutableData *index, DYFStoreTransactionHeader *header)
+{
+    char state[24];
+    snprintf(state, sizeof(state), "%lu", (unsigned long)header.state);
+    
+    DYFStoreAppendHeaderField(index, header.transactionIdentifier, DYFStoreHeaderSeparator);
+    [index appendBytes:state length:strlen(state)];
+    [index appendBytes:&DYFStoreHeaderSeparator length:1];
+    DYFStoreAppendHeaderField(index, header.productIdentifier, DYFStoreHeaderSeparator);
+    DYFStoreAppendHeaderField(index, header.userIdentifier, DYFStoreHeaderSeparator);
+    DYFStoreAppendHeaderField(index, header.transactionTimestamp, '\n');
+}
+
+static NSString *DYFStoreHeaderString(const char *bytes, const char *end)
+{
+    if (end <= bytes) { return nil; }
+    return [[NSString alloc] initWithBytes:bytes length:end - bytes encoding:NSUTF8StringEncoding];
+}
+
+/** Parses the header index.
+ 
+ @return The headers, or nil if the index has another format or is truncated.
+ */
+static NSMutableArray<DYFStoreTransactionHeader *> *DYFStoreParseHeaderIndex(NSData *index)
+{
+    NSMutableArray *headers = [NSMutableArray array];
+    const char *p = index.bytes;
+    const char *end = p + index.length;
+    
+    while (p < end) {
+        const char *lineEnd = memchr(p, '\n', end - p) ?: end;
+        
+        // fields[i] is the start of field i, fields[DYFSTORE_HEADER_FIELDS] is one past the end of the line.
+        const char *fields[DYFSTORE_HEADER_FIELDS + 1];
+        fields[0] = p;
+        int count = 1;
+        for (const char *c = p; c < lineEnd; c++) {
+            if (*c != DYFStoreHeaderSeparator) { continue; }
+            if (count == DYFSTORE_HEADER_FIELDS) { return nil; }
+            fields[count++] = c + 1;
+        }
+        if (count != DYFSTORE_HEADER_FIELDS) { return nil; }
+        fields[DYFSTORE_HEADER_FIELDS] = lineEnd + 1;
+        
+        DYFStoreTransactionHeader *header = [[DYFStoreTransactionHeader alloc] init];
+        header.transactionIdentifier = DYFStoreHeaderString(fields[0], fields[1] - 1);
+        header.state = (NSUInteger)strtoul(fields[1], NULL, 10);
+        header.productIdentifier = DYFStoreHeaderString(fields[2], fields[3] - 1);
+        header.userIdentifier = DYFStoreHeaderString(fields[3], fields[4] - 1);
+        header.transactionTimestamp = DYFStoreHeaderString(fields[4], lineEnd);
+        [headers addObject:header];
+        
+        p = lineEnd + 1;
+    }
+    
+    return headers;
+}
+
+static NSMutableData *DYFStoreHeaderIndexData(NSArray<DYFStoreTransactionHeader *> *headers)
+{
+    NSMutableData *index = [NSMutableData dataWithCapacity:headers.count * 80];
+    for (DYFStoreTransactionHeader *header in headers) {
+        DYFStoreAppendHeaderLine(index, header);
+    }
+    return index;
+}
+
+/** Decodes an archived record, on any thread.
+ */
+static DYFStoreBulkDecodeBlock const DYFStoreDecodeArchivedRecord = ^id (NSData *record) {
+    return [DYFStoreConverter decodeObject:record];
+};
+
+// The index of the records, shared by all persisters of the process, and the stored header index it matches. Only accessed within `@synchronized (DYFStoreUserDefaultsPersistence.class)`.
+static DYFStoreTransactionIndex *DYFStoreSharedIndex;
+static NSData *DYFStoreSharedIndexData;
+
 @implementation DYFStoreUserDefaultsPersistence
 
++ (void)discardIndex
+{
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        DYFStoreSharedIndex = nil;
+        DYFStoreSharedIndexData = nil;
+    }
+}
+
 /** Loads an array whose elements are the `Data` objects from the keychain.
  
  @return An array whose elements are the `Data` objects.
@@ -42,101 +152,250 @@
     return array;
 }
 
-- (BOOL)containsTransaction:(NSString *)transactionIdentifier
+/** Returns the index of the records. The shared index is reused as long as the stored header index has not been changed by someone else. The header index is rebuilt from the records once if it is missing or does not match them, e.g. for records stored by an older version. Must be called within `@synchronized (DYFStoreUserDefaultsPersistence.class)`.
+ 
+ @param records The stored records.
+ @return A `DYFStoreTransactionIndex` object with one header per record.
+ */
+- (DYFStoreTransactionIndex *)indexForRecords:(NSArray<NSData *> *)records
 {
-    NSArray *array = [self loadDataFromUserDefaults];
-    if (!array) { return NO; }
+    NSData *data = [UserDefaults dataForKey:DYFStoreTransactionHeadersKey];
+    if (DYFStoreSharedIndex && DYFStoreSharedIndex.count == records.count &&
+        (data == DYFStoreSharedIndexData || [data isEqualToData:DYFStoreSharedIndexData])) {
+        return DYFStoreSharedIndex;
+    }
     
-    NSMutableArray *arr = [NSMutableArray arrayWithArray:array];
-    for (int idx = 0; idx < arr.count; idx++) {
-        NSData *data = arr[idx];
-        DYFStoreTransaction *transaction = [DYFStoreConverter decodeObject:data];
-        NSString *identifier = transaction.transactionIdentifier;
-        if ([identifier isEqualToString:transactionIdentifier]) {
-            return YES;
-        }
+    NSMutableArray *headers = DYFStoreParseHeaderIndex(data);
+    if (!headers || headers.count != records.count) {
+        // A record that cannot be decoded keeps an empty header, so that the headers still line up with the records.
+        headers = [[DYFStoreBulkDecoder.sharedDecoder decodeRecords:records usingBlock:^id (NSData *record) {
+            DYFStoreTransaction *transaction = [DYFStoreConverter decodeObject:record];
+            return transaction ? [DYFStoreTransactionHeader headerWithTransaction:transaction] : [[DYFStoreTransactionHeader alloc] init];
+        }] mutableCopy];
+        data = DYFStoreHeaderIndexData(headers);
+        [UserDefaults setObject:data forKey:DYFStoreTransactionHeadersKey];
     }
     
-    return NO;
+    DYFStoreSharedIndex = [[DYFStoreTransactionIndex alloc] initWithHeaders:headers];
+    DYFStoreSharedIndexData = data;
+    return DYFStoreSharedIndex;
+}
+
+/** Writes the records and the header index. Must be called within `@synchronized (DYFStoreUserDefaultsPersistence.class)`.
+ */
+- (void)saveRecords:(NSArray<NSData *> *)records indexData:(NSData *)indexData
+{
+    [UserDefaults setObject:records forKey:DYFStoreTransactionsKey];
+    [UserDefaults setObject:indexData forKey:DYFStoreTransactionHeadersKey];
+    [UserDefaults synchronize];
+    DYFStoreSharedIndexData = indexData;
+}
+
+- (BOOL)containsTransaction:(NSString *)transactionIdentifier
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        NSArray *array = [self loadDataFromUserDefaults];
+        if (!array) { return NO; }
+        
+        return [[self indexForRecords:array] indexOfTransaction:transactionIdentifier] != NSNotFound;
+    }
 }
 
 - (void)storeTransaction:(DYFStoreTransaction *)transaction
 {
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceStore);
     NSData *data = [DYFStoreConverter encodeObject:transaction];
     if (!data) { return; }
     
-    NSMutableArray *transactions;
-    NSArray *array = [self loadDataFromUserDefaults];
-    if (!array) {
-        transactions = [NSMutableArray arrayWithCapacity:0];
-    } else {
-        transactions = [NSMutableArray arrayWithArray:array];
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        NSArray *array = [self loadDataFromUserDefaults] ?: @[];
+        DYFStoreTransactionIndex *index = [self indexForRecords:array];
+        DYFStoreTransactionHeader *header = [DYFStoreTransactionHeader headerWithTransaction:transaction];
+        
+        NSMutableArray *transactions = [NSMutableArray arrayWithArray:array];
+        [transactions addObject:data];
+        NSMutableData *indexData = [NSMutableData dataWithData:DYFStoreSharedIndexData ?: [NSData data]];
+        DYFStoreAppendHeaderLine(indexData, header);
+        
+        [self saveRecords:transactions indexData:indexData];
+        [index addHeader:header];
     }
-    [transactions addObject:data];
+}
+
+- (void)storeTransactions:(NSArray<DYFStoreTransaction *> *)transactions
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceStore);
+    NSMutableArray<NSData *> *records = [NSMutableArray arrayWithCapacity:transactions.count];
+    NSMutableArray<DYFStoreTransactionHeader *> *headers = [NSMutableArray arrayWithCapacity:transactions.count];
+    for (DYFStoreTransaction *transaction in transactions) {
+        NSData *data = [DYFStoreConverter encodeObject:transaction];
+        if (!data) { continue; }
+        [records addObject:data];
+        [headers addObject:[DYFStoreTransactionHeader headerWithTransaction:transaction]];
+    }
+    if (records.count == 0) { return; }
     
-    [UserDefaults setObject:transactions forKey:DYFStoreTransactionsKey];
-    [UserDefaults synchronize];
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        NSArray *array = [self loadDataFromUserDefaults] ?: @[];
+        DYFStoreTransactionIndex *index = [self indexForRecords:array];
+        
+        NSMutableArray *arr = [NSMutableArray arrayWithCapacity:array.count + records.count];
+        [arr addObjectsFromArray:array];
+        [arr addObjectsFromArray:records];
+        NSMutableData *indexData = [NSMutableData dataWithData:DYFStoreSharedIndexData ?: [NSData data]];
+        for (DYFStoreTransactionHeader *header in headers) {
+            DYFStoreAppendHeaderLine(indexData, header);
+        }
+        
+        [self saveRecords:arr indexData:indexData];
+        for (DYFStoreTransactionHeader *header in headers) {
+            [index addHeader:header];
+        }
+    }
 }
 
 - (NSArray<DYFStoreTransaction *> *)retrieveTransactions
 {
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
     NSArray *array = [self loadDataFromUserDefaults];
     if (!array) { return nil; }
     
-    NSMutableArray *transactions = [NSMutableArray array];
-    for (NSData *data in array) {
-        DYFStoreTransaction *transaction = [DYFStoreConverter decodeObject:data];
-        if (transaction) {
-            [transactions addObject:transaction];
-        }
+    return [DYFStoreBulkDecoder.sharedDecoder decodeRecords:array usingBlock:DYFStoreDecodeArchivedRecord];
+}
+
+- (void)enumerateTransactionsUsingBlock:(void (^)(DYFStoreTransaction *transaction, BOOL *stop))block
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSArray *array = [self loadDataFromUserDefaults];
+    if (!array) { return; }
+    
+    [DYFStoreBulkDecoder.sharedDecoder enumerateRecords:array decode:DYFStoreDecodeArchivedRecord usingBlock:block];
+}
+
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeaders
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        NSArray *array = [self loadDataFromUserDefaults];
+        if (!array) { return nil; }
+        
+        return [self indexForRecords:array].headers;
+    }
+}
+
+/** Decodes the records at the given positions, outside of the lock.
+ */
+- (NSArray<DYFStoreTransaction *> *)transactionsAtIndexes:(NSIndexSet *)indexes ofRecords:(NSArray<NSData *> *)records
+{
+    return [DYFStoreBulkDecoder.sharedDecoder decodeRecords:[records objectsAtIndexes:indexes] usingBlock:DYFStoreDecodeArchivedRecord];
+}
+
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSArray *array;
+    NSIndexSet *indexes;
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        array = [self loadDataFromUserDefaults];
+        if (!array || transactionIdentifiers.count == 0) { return @[]; }
+        
+        indexes = [[self indexForRecords:array] indexesOfTransactions:transactionIdentifiers];
     }
     
-    return transactions;
+    return [self transactionsAtIndexes:indexes ofRecords:array];
 }
 
-- (DYFStoreTransaction *)retrieveTransaction:(NSString *)transactionIdentifier
+- (NSArray<DYFStoreTransactionHeader *> *)retrieveTransactionHeadersMatchingQuery:(DYFStoreTransactionQuery *)query
 {
-    NSArray *array = [self retrieveTransactions];
-    if (!array) { return nil; }
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        NSArray *array = [self loadDataFromUserDefaults];
+        if (!array) { return @[]; }
+        
+        DYFStoreTransactionIndex *index = [self indexForRecords:array];
+        NSIndexSet *indexes = [index indexesOfTransactionsMatchingQuery:query];
+        return [index.headers objectsAtIndexes:indexes];
+    }
+}
+
+- (NSArray<DYFStoreTransaction *> *)retrieveTransactionsMatchingQuery:(DYFStoreTransactionQuery *)query
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSArray *array;
+    NSIndexSet *indexes;
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        array = [self loadDataFromUserDefaults];
+        if (!array) { return @[]; }
+        
+        indexes = [[self indexForRecords:array] indexesOfTransactionsMatchingQuery:query];
+    }
     
-    for (DYFStoreTransaction *transaction in array) {
-        NSString *identifier = transaction.transactionIdentifier;
-        if ([identifier isEqualToString:transactionIdentifier]) {
-            return transaction;
-        }
+    return [self transactionsAtIndexes:indexes ofRecords:array];
+}
+
+- (DYFStoreTransaction *)retrieveTransaction:(NSString *)transactionIdentifier
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRetrieve);
+    NSArray *array;
+    NSUInteger index;
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        array = [self loadDataFromUserDefaults];
+        if (!array) { return nil; }
+        
+        index = [[self indexForRecords:array] indexOfTransaction:transactionIdentifier];
+        if (index == NSNotFound) { return nil; }
     }
     
-    return nil;
+    return [DYFStoreConverter decodeObject:array[index]];
 }
 
 - (void)removeTransaction:(NSString *)transactionIdentifier
 {
-    NSArray *array = [self loadDataFromUserDefaults];
-    if (!array) { return; }
-    
-    NSMutableArray *arr = [NSMutableArray arrayWithArray:array];
-    int index = -1;
-    for (int idx = 0; idx < arr.count; idx++) {
-        NSData *data = arr[idx];
-        DYFStoreTransaction *transaction = [DYFStoreConverter decodeObject:data];
-        NSString *identifier = transaction.transactionIdentifier;
-        if ([identifier isEqualToString:transactionIdentifier]) {
-            index = idx;
-            break;
-        }
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRemove);
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        NSArray *array = [self loadDataFromUserDefaults];
+        if (!array) { return; }
+        
+        DYFStoreTransactionIndex *index = [self indexForRecords:array];
+        NSUInteger position = [index indexOfTransaction:transactionIdentifier];
+        if (position == NSNotFound) { return; }
+        
+        NSMutableArray *arr = [NSMutableArray arrayWithArray:array];
+        [arr removeObjectAtIndex:position];
+        [index removeHeadersAtIndexes:[NSIndexSet indexSetWithIndex:position]];
+        [self saveRecords:arr indexData:DYFStoreHeaderIndexData(index.headers)];
     }
-    
-    if (index >= 0) {
-        [arr removeObjectAtIndex:index];
-        [UserDefaults setObject:arr forKey:DYFStoreTransactionsKey];
-        [UserDefaults synchronize];
+}
+
+- (void)removeTransactionsWithIdentifiers:(NSArray<NSString *> *)transactionIdentifiers
+{
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRemove);
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        NSArray *array = [self loadDataFromUserDefaults];
+        if (!array || transactionIdentifiers.count == 0) { return; }
+        
+        DYFStoreTransactionIndex *index = [self indexForRecords:array];
+        NSIndexSet *positions = [index indexesOfTransactions:transactionIdentifiers];
+        if (positions.count == 0) { return; }
+        
+        NSMutableArray *arr = [NSMutableArray arrayWithArray:array];
+        [arr removeObjectsAtIndexes:positions];
+        [index removeHeadersAtIndexes:positions];
+        [self saveRecords:arr indexData:DYFStoreHeaderIndexData(index.headers)];
     }
 }
 
 - (void)removeTransactions
 {
-    [UserDefaults removeObjectForKey:DYFStoreTransactionsKey];
-    [UserDefaults synchronize];
+    DYFStoreMetricsScope(DYFStoreMetricPersistenceRemove);
+    @synchronized (DYFStoreUserDefaultsPersistence.class) {
+        [UserDefaults removeObjectForKey:DYFStoreTransactionsKey];
+        [UserDefaults removeObjectForKey:DYFStoreTransactionHeadersKey];
+        [UserDefaults synchronize];
+        DYFStoreSharedIndex = nil;
+        DYFStoreSharedIndexData = nil;
+    }
 }
 
 @end
@@ -0,0 +1,125 @@
+//
+//  DYFStoreVerificationCache.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** A cached outcome of verifying a transaction against a receipt.
+ */
+@interface DYFStoreVerificationCacheEntry : NSObject
+
+/** The status of the receipt, 0 if it is valid.
+ */
+@property (nonatomic, assign, readonly) NSInteger status;
+
+/** Whether the transaction was found in a valid receipt.
+ */
+@property (nonatomic, assign, readonly, getter=isVerified) BOOL verified;
+
+/** The in-app purchase entry of the transaction in the response, if verified.
+ */
+@property (nonatomic, copy, readonly) NSDictionary *receiptEntry;
+
+/** The date after which the entry is no longer used.
+ */
+@property (nonatomic, copy, readonly) NSDate *expirationDate;
+
+@end
+
+/** Remembers the outcomes of receipt verification, keyed by the digest of the receipt and the transaction identifier, so that a transaction already settled against a receipt is not sent to the server again, e.g. after a retry, a restore or a relaunch.
+ 
+ The entries are kept in memory and written to a file by `synchronize`. Entries of older receipts are dropped when the App Store receipt changes, see `invalidateWithReceiptDigest:`.
+ */
+@interface DYFStoreVerificationCache : NSObject
+
+/** The path of the file the entries are written to.
+ */
+@property (nonatomic, copy, readonly) NSString *path;
+
+/** How long a verified outcome is used. The default value is 7 days.
+ */
+@property (nonatomic, assign) NSTimeInterval verifiedLifetime;
+
+/** How long a rejected outcome is used. The default value is 1 hour.
+ */
+@property (nonatomic, assign) NSTimeInterval rejectedLifetime;
+
+/** The number of entries that have not expired.
+ */
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+/** Creates a cache whose file is "DYFStoreVerificationCache.json" in the caches directory.
+ */
+- (instancetype)init;
+
+/** Creates a cache.
+ 
+ @param path The path of the file the entries are read from and written to.
+ @return A `DYFStoreVerificationCache` object.
+ */
+- (instancetype)initWithPath:(NSString *)path;
+
+/** Returns the digest that identifies a receipt. The digest is computed on every call; use the `digest` of a `DYFStoreReceiptHandle` object, which is made once per receipt.
+ 
+ @param receipt The base64 encoded receipt.
+ @return The SHA-256 digest of the receipt.
+ */
++ (NSString *)digestOfReceipt:(NSString *)receipt;
+
+/** Returns the outcome for a transaction.
+ 
+ @param digest The digest of the receipt.
+ @param transactionIdentifier The unique server-provided identifier.
+ @return A `DYFStoreVerificationCacheEntry` object, or nil if there is none or it has expired.
+ */
+- (DYFStoreVerificationCacheEntry *)entryForReceiptDigest:(NSString *)digest transactionIdentifier:(NSString *)transactionIdentifier;
+
+/** Records the outcome for a transaction. The expiration date follows from `verifiedLifetime` or `rejectedLifetime`.
+ 
+ @param status The status of the receipt, 0 if it is valid.
+ @param receiptEntry The in-app purchase entry of the transaction. Nil if the transaction was rejected.
+ @param digest The digest of the receipt.
+ @param transactionIdentifier The unique server-provided identifier.
+ */
+- (void)setStatus:(NSInteger)status
+     receiptEntry:(NSDictionary *)receiptEntry
+  forReceiptDigest:(NSString *)digest
+transactionIdentifier:(NSString *)transactionIdentifier;
+
+/** Tells the cache the current App Store receipt. If it differs from the last one, the entries of all other receipts are dropped.
+ 
+ @param digest The digest of the receipt, e.g. the `digest` of its `DYFStoreReceiptHandle` object.
+ @return YES if the receipt changed.
+ */
+- (BOOL)invalidateWithReceiptDigest:(NSString *)digest;
+
+/** Removes all entries.
+ */
+- (void)removeAllEntries;
+
+/** Writes the entries to the file if they have changed.
+ */
+- (void)synchronize;
+
+@end
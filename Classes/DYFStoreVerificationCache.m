@@ -0,0 +1,251 @@
+//
+//  DYFStoreVerificationCache.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreVerificationCache.h"
+#import "DYFStore.h"
+#import "DYFStoreDigest.h"
+#import "DYFStoreConverter.h"
+#import "DYFStoreJSONWriter.h"
+
+// The version of the file format.
+static const NSInteger DYFStoreVerificationCacheVersion = 1;
+
+@interface DYFStoreVerificationCacheEntry ()
+@property (nonatomic, assign) NSInteger status;
+@property (nonatomic, copy) NSDictionary *receiptEntry;
+@property (nonatomic, copy) NSDate *expirationDate;
+@end
+
+@implementation DYFStoreVerificationCacheEntry
+
+- (BOOL)isVerified
+{
+    return self.status == 0 && self.receiptEntry != nil;
+}
+
+@end
+
+@interface DYFStoreVerificationCache ()
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, copy) NSString *receiptDigest;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, DYFStoreVerificationCacheEntry *> *entries;
+@property (nonatomic, assign) BOOL loaded;
+@property (nonatomic, assign) BOOL dirty;
+@end
+
+@implementation DYFStoreVerificationCache
+
+- (instancetype)init
+{
+    NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+    return [self initWithPath:[caches stringByAppendingPathComponent:@"DYFStoreVerificationCache.json"]];
+}
+
+- (instancetype)initWithPath:(NSString *)path
+{
+    self = [super init];
+    if (self) {
+        _path = [path copy];
+        _verifiedLifetime = 7 * 24 * 3600;
+        _rejectedLifetime = 3600;
+        _entries = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
++ (NSString *)digestOfReceipt:(NSString *)receipt
+{
+    if (receipt.length == 0) { return nil; }
+    
+    return DYFStoreDigestSHA256(receipt);
+}
+
+/** Joins the two parts of a key. A digest never contains the separator.
+ */
+static inline NSString *DYFStoreVerificationCacheKey(NSString *digest, NSString *transactionIdentifier)
+{
+    return [NSString stringWithFormat:@"%@:%@", digest, transactionIdentifier];
+}
+
+/** Reads the file once, on first use, and drops the expired entries.
+ */
+- (void)loadIfNeeded
+{
+    if (self.loaded) { return; }
+    self.loaded = YES;
+    
+    NSData *data = [NSData dataWithContentsOfFile:self.path];
+    NSDictionary *object = data ? [DYFStoreConverter jsonObjectWithData:data] : nil;
+    if (![object isKindOfClass:NSDictionary.class] ||
+        [object[@"version"] integerValue] != DYFStoreVerificationCacheVersion) {
+        return;
+    }
+    
+    NSString *receiptDigest = object[@"receipt"];
+    self.receiptDigest = [receiptDigest isKindOfClass:NSString.class] ? receiptDigest : nil;
+    
+    NSDictionary *entries = object[@"entries"];
+    if (![entries isKindOfClass:NSDictionary.class]) { return; }
+    
+    NSTimeInterval now = NSDate.date.timeIntervalSince1970;
+    [entries enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSDictionary *obj, BOOL *stop) {
+        if (![obj isKindOfClass:NSDictionary.class]) { return; }
+        
+        NSTimeInterval expiration = [obj[@"expires"] doubleValue];
+        if (expiration <= now) {
+            self.dirty = YES;
+            return;
+        }
+        
+        DYFStoreVerificationCacheEntry *entry = [[DYFStoreVerificationCacheEntry alloc] init];
+        entry.status = [obj[@"status"] integerValue];
+        entry.receiptEntry = [obj[@"entry"] isKindOfClass:NSDictionary.class] ? obj[@"entry"] : nil;
+        entry.expirationDate = [NSDate dateWithTimeIntervalSince1970:expiration];
+        self.entries[key] = entry;
+    }];
+}
+
+- (NSUInteger)count
+{
+    @synchronized (self) {
+        [self loadIfNeeded];
+        return self.entries.count;
+    }
+}
+
+- (DYFStoreVerificationCacheEntry *)entryForReceiptDigest:(NSString *)digest transactionIdentifier:(NSString *)transactionIdentifier
+{
+    if (!digest || !transactionIdentifier) { return nil; }
+    
+    @synchronized (self) {
+        [self loadIfNeeded];
+        
+        NSString *key = DYFStoreVerificationCacheKey(digest, transactionIdentifier);
+        DYFStoreVerificationCacheEntry *entry = self.entries[key];
+        if (entry && entry.expirationDate.timeIntervalSinceNow <= 0) {
+            [self.entries removeObjectForKey:key];
+            self.dirty = YES;
+            return nil;
+        }
+        return entry;
+    }
+}
+
+- (void)setStatus:(NSInteger)status
+     receiptEntry:(NSDictionary *)receiptEntry
+  forReceiptDigest:(NSString *)digest
+transactionIdentifier:(NSString *)transactionIdentifier
+{
+    if (!digest || !transactionIdentifier) { return; }
+    
+    DYFStoreVerificationCacheEntry *entry = [[DYFStoreVerificationCacheEntry alloc] init];
+    entry.status = status;
+    entry.receiptEntry = status == 0 ? receiptEntry : nil;
+    NSTimeInterval lifetime = entry.isVerified ? self.verifiedLifetime : self.rejectedLifetime;
+    entry.expirationDate = [NSDate dateWithTimeIntervalSinceNow:lifetime];
+    
+    @synchronized (self) {
+        [self loadIfNeeded];
+        self.entries[DYFStoreVerificationCacheKey(digest, transactionIdentifier)] = entry;
+        self.dirty = YES;
+    }
+}
+
+- (BOOL)invalidateWithReceiptDigest:(NSString *)digest
+{
+    if (!digest) { return NO; }
+    
+    @synchronized (self) {
+        [self loadIfNeeded];
+        if ([digest isEqualToString:self.receiptDigest]) {
+            return NO;
+        }
+        
+        NSString *prefix = [digest stringByAppendingString:@":"];
+        NSArray *keys = [self.entries.allKeys filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(NSString *key, NSDictionary *bindings) {
+            return ![key hasPrefix:prefix];
+        }]];
+        [self.entries removeObjectsForKeys:keys];
+        
+        self.receiptDigest = digest;
+        self.dirty = YES;
+        DYFStoreLog(@"receipt changed, dropped %zi cached verifications", keys.count);
+        
+        return YES;
+    }
+}
+
+- (void)removeAllEntries
+{
+    @synchronized (self) {
+        self.loaded = YES;
+        [self.entries removeAllObjects];
+        self.dirty = YES;
+    }
+}
+
+- (void)synchronize
+{
+    NSData *data = nil;
+    
+    @synchronized (self) {
+        if (!self.dirty) { return; }
+        self.dirty = NO;
+        
+        DYFStoreJSONWriter *writer = [[DYFStoreJSONWriter alloc] init];
+        [writer beginObject];
+        [writer writeKey:@"version"];
+        [writer writeNumber:@(DYFStoreVerificationCacheVersion)];
+        if (self.receiptDigest) {
+            [writer writeKey:@"receipt"];
+            [writer writeString:self.receiptDigest];
+        }
+        [writer writeKey:@"entries"];
+        [writer beginObject];
+        [self.entries enumerateKeysAndObjectsUsingBlock:^(NSString *key, DYFStoreVerificationCacheEntry *entry, BOOL *stop) {
+            [writer writeKey:key];
+            [writer beginObject];
+            [writer writeKey:@"status"];
+            [writer writeNumber:@(entry.status)];
+            [writer writeKey:@"expires"];
+            [writer writeNumber:@(entry.expirationDate.timeIntervalSince1970)];
+            if (entry.receiptEntry) {
+                [writer writeKey:@"entry"];
+                [writer writeObject:entry.receiptEntry];
+            }
+            [writer endObject];
+        }];
+        [writer endObject];
+        [writer endObject];
+        
+        data = writer.failed ? nil : writer.data;
+    }
+    
+    if (![data writeToFile:self.path atomically:YES]) {
+        DYFStoreLog(@"failed to write the verification cache");
+    }
+}
+
+@end
@@ -0,0 +1,178 @@
+//
+//  DYFStoreVerificationCoordinator.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "DYFStoreTransactionPersistence.h"
+#import "DYFStoreVerificationCache.h"
+
+@class DYFStore;
+@class DYFStoreVerificationCoordinator;
+
+/** Calls back with the parsed response of the verification server, or an error. An error whose code is 21000 or greater is a receipt status of the App Store and means the receipt is invalid; any other error means it could not be verified now.
+ */
+typedef void (^DYFStoreReceiptVerificationCompletion)(NSDictionary *response, NSError *error);
+
+/** Verifies a receipt, e.g. by uploading it to your server.
+ */
+@protocol DYFStoreReceiptVerifying <NSObject>
+
+/** Verifies a receipt. The completion can be called on any queue.
+ 
+ @param receiptData The receipt data.
+ @param completion The block called with the response.
+ */
+- (void)verifyReceipt:(NSData *)receiptData completion:(DYFStoreReceiptVerificationCompletion)completion;
+
+@end
+
+/** The outcome of one verification pass.
+ */
+@interface DYFStoreVerificationResult : NSObject
+
+/** The transactions whose identifiers were found in a valid receipt. They have been finished and removed.
+ */
+@property (nonatomic, copy, readonly) NSArray<DYFStoreTransaction *> *verifiedTransactions;
+
+/** The transactions whose receipt is invalid. They have been finished and removed.
+ */
+@property (nonatomic, copy, readonly) NSArray<DYFStoreTransaction *> *rejectedTransactions;
+
+/** The transactions that could not be verified, e.g. because of the network or because the receipt does not list them yet. They are kept.
+ */
+@property (nonatomic, copy, readonly) NSArray<DYFStoreTransaction *> *unresolvedTransactions;
+
+/** The receipt entries of the verified transactions, keyed by transaction identifier.
+ */
+@property (nonatomic, copy, readonly) NSDictionary<NSString *, NSDictionary *> *receiptEntries;
+
+/** Returns whether the pass found a user entitled to a product: a transaction of the product was verified for the user, or a valid receipt verified for one of the user's transactions lists an uncancelled purchase of it, e.g. a restore or an earlier purchase.
+ 
+ @param productIdentifier A string used to identify a product.
+ @param userIdentifier An opaque identifier for the user’s account on your system. Nil for the purchases made without one.
+ @return YES if the user is still entitled to the product.
+ */
+- (BOOL)entitlesProduct:(NSString *)productIdentifier toUser:(NSString *)userIdentifier;
+
+/** The number of verification requests that were sent.
+ */
+@property (nonatomic, assign, readonly) NSUInteger requestCount;
+
+/** The number of transactions settled from the cache.
+ */
+@property (nonatomic, assign, readonly) NSUInteger cacheHitCount;
+
+/** The number of pending transactions that the scheduler held back from the pass.
+ */
+@property (nonatomic, assign, readonly) NSUInteger deferredCount;
+
+/** The last error that left transactions unresolved.
+ */
+@property (nonatomic, strong, readonly) NSError *error;
+
+@end
+
+/** The delegate of a verification coordinator.
+ */
+@protocol DYFStoreVerificationCoordinatorDelegate <NSObject>
+
+/** Tells the delegate that a verification pass has finished.
+ 
+ @param coordinator The verification coordinator.
+ @param result The outcome of the pass.
+ */
+- (void)verificationCoordinator:(DYFStoreVerificationCoordinator *)coordinator didFinishWithResult:(DYFStoreVerificationResult *)result;
+
+@end
+
+/** Decides which pending transactions a pass verifies, and learns how they were settled. Its methods are called on the coordinator's private queue.
+ */
+@protocol DYFStoreVerificationScheduling <NSObject>
+
+/** Asks which of the pending transactions to verify now. Only the records of the returned headers are decoded.
+ 
+ @param coordinator The verification coordinator.
+ @param headers The headers of the pending transactions.
+ @return The headers of the transactions to verify in this pass.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)verificationCoordinator:(DYFStoreVerificationCoordinator *)coordinator transactionsToVerify:(NSArray<DYFStoreTransactionHeader *> *)headers;
+
+/** Tells the scheduler the outcome of a pass, after the settled transactions have been removed and before the delegate is called.
+ 
+ @param coordinator The verification coordinator.
+ @param result The outcome of the pass.
+ */
+- (void)verificationCoordinator:(DYFStoreVerificationCoordinator *)coordinator didSettleWithResult:(DYFStoreVerificationResult *)result;
+
+@end
+
+/** Verifies the pending transactions of a persister in batches: one request per distinct receipt, whose response entries are mapped back to every transaction that carries that receipt. The settled transactions are then finished and removed in bulk.
+ */
+@interface DYFStoreVerificationCoordinator : NSObject
+
+/** The persister whose transactions are verified.
+ */
+@property (nonatomic, strong, readonly) id<DYFStoreTransactionPersistence> persister;
+
+/** The object that verifies the receipts.
+ */
+@property (nonatomic, strong, readonly) id<DYFStoreReceiptVerifying> verifier;
+
+/** The cache that is consulted before a receipt is sent, and that records the outcomes of the requests. The default is nil.
+ */
+@property (nonatomic, strong) DYFStoreVerificationCache *cache;
+
+/** The store whose payment transactions are finished. The default is `DYFStore.defaultStore`. When nil, transactions are only removed from the persister.
+ */
+@property (nonatomic, weak) DYFStore *store;
+
+/** The maximum number of verification requests in flight. The default value is 4.
+ */
+@property (nonatomic, assign) NSUInteger maxConcurrentRequests;
+
+/** The queue on which transactions are finished and the delegate is called. The default is the main queue.
+ */
+@property (nonatomic, strong) dispatch_queue_t callbackQueue;
+
+/** The delegate of the coordinator.
+ */
+@property (nonatomic, weak) id<DYFStoreVerificationCoordinatorDelegate> delegate;
+
+/** The scheduler that decides which transactions are verified, e.g. a `DYFStoreRetryScheduler`. When nil, every pass verifies all pending transactions.
+ */
+@property (nonatomic, weak) id<DYFStoreVerificationScheduling> scheduler;
+
+/** Creates a coordinator.
+ 
+ @param persister The persister whose transactions are verified.
+ @param verifier The object that verifies the receipts.
+ @return A `DYFStoreVerificationCoordinator` object.
+ */
+- (instancetype)initWithPersister:(id<DYFStoreTransactionPersistence>)persister verifier:(id<DYFStoreReceiptVerifying>)verifier;
+
+/** Schedules a verification pass of all pending transactions. Calls made before the pass starts are coalesced into it, calls made while a pass is running schedule a single pass after it.
+ */
+- (void)setNeedsVerification;
+
+@end
@@ -0,0 +1,414 @@
+//
+//  DYFStoreVerificationCoordinator.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "DYFStoreVerificationCoordinator.h"
+#import "DYFStore.h"
+
+@interface DYFStoreVerificationResult ()
+@property (nonatomic, strong) NSMutableArray<DYFStoreTransaction *> *verified;
+@property (nonatomic, strong) NSMutableArray<DYFStoreTransaction *> *rejected;
+@property (nonatomic, strong) NSMutableArray<DYFStoreTransaction *> *unresolved;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSDictionary *> *entries;
+/** The products the pass found each user entitled to, keyed by user identifier, "" for none. */
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableSet<NSString *> *> *entitledProducts;
+@property (nonatomic, assign) NSUInteger requestCount;
+@property (nonatomic, assign) NSUInteger cacheHitCount;
+@property (nonatomic, assign) NSUInteger deferredCount;
+@property (nonatomic, strong) NSError *error;
+- (void)entitleProduct:(NSString *)productIdentifier toUser:(NSString *)userIdentifier;
+@end
+
+@implementation DYFStoreVerificationResult
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _verified = [NSMutableArray array];
+        _rejected = [NSMutableArray array];
+        _unresolved = [NSMutableArray array];
+        _entries = [NSMutableDictionary dictionary];
+        _entitledProducts = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSArray<DYFStoreTransaction *> *)verifiedTransactions
+{
+    return [self.verified copy];
+}
+
+- (NSArray<DYFStoreTransaction *> *)rejectedTransactions
+{
+    return [self.rejected copy];
+}
+
+- (NSArray<DYFStoreTransaction *> *)unresolvedTransactions
+{
+    return [self.unresolved copy];
+}
+
+- (NSDictionary<NSString *, NSDictionary *> *)receiptEntries
+{
+    return [self.entries copy];
+}
+
+- (void)entitleProduct:(NSString *)productIdentifier toUser:(NSString *)userIdentifier
+{
+    if (!productIdentifier) { return; }
+    
+    NSString *key = userIdentifier ?: @"";
+    NSMutableSet *products = self.entitledProducts[key];
+    if (!products) {
+        products = [NSMutableSet set];
+        self.entitledProducts[key] = products;
+    }
+    [products addObject:productIdentifier];
+}
+
+- (BOOL)entitlesProduct:(NSString *)productIdentifier toUser:(NSString *)userIdentifier
+{
+    if (!productIdentifier) { return NO; }
+    return [self.entitledProducts[userIdentifier ?: @""] containsObject:productIdentifier];
+}
+
+@end
+
+/** Returns the in-app purchase entries of a verifyReceipt response, keyed by transaction identifier. Original transaction identifiers map to their latest entry too.
+ */
+static NSDictionary<NSString *, NSDictionary *> *DYFStoreReceiptEntries(NSDictionary *response)
+{
+    NSMutableDictionary *entries = [NSMutableDictionary dictionary];
+    NSMutableArray *lists = [NSMutableArray arrayWithCapacity:2];
+    
+    id receipt = response[@"receipt"];
+    if ([receipt isKindOfClass:NSDictionary.class] && [receipt[@"in_app"] isKindOfClass:NSArray.class]) {
+        [lists addObject:receipt[@"in_app"]];
+    }
+    if ([response[@"latest_receipt_info"] isKindOfClass:NSArray.class]) {
+        [lists addObject:response[@"latest_receipt_info"]];
+    }
+    
+    for (NSArray *list in lists) {
+        for (NSDictionary *entry in list) {
+            if (![entry isKindOfClass:NSDictionary.class]) { continue; }
+            
+            id transactionId = entry[@"transaction_id"];
+            id originalTransactionId = entry[@"original_transaction_id"];
+            if ([originalTransactionId isKindOfClass:NSString.class] && !entries[originalTransactionId]) {
+                entries[originalTransactionId] = entry;
+            }
+            if ([transactionId isKindOfClass:NSString.class]) {
+                entries[transactionId] = entry;
+            }
+        }
+    }
+    
+    return entries;
+}
+
+/** The state of one verification pass. It is only touched on the work queue.
+ */
+@interface DYFStoreVerificationPass : NSObject
+@property (nonatomic, strong) NSMutableArray<NSString *> *receipts;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableArray<DYFStoreTransaction *> *> *groups;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSString *> *digests;
+@property (nonatomic, assign) NSUInteger nextIndex;
+@property (nonatomic, assign) NSUInteger inFlight;
+@property (nonatomic, strong) DYFStoreVerificationResult *result;
+@end
+
+@implementation DYFStoreVerificationPass
+@end
+
+@interface DYFStoreVerificationCoordinator ()
+@property (nonatomic, strong) id<DYFStoreTransactionPersistence> persister;
+@property (nonatomic, strong) id<DYFStoreReceiptVerifying> verifier;
+@property (nonatomic, strong) dispatch_queue_t workQueue;
+
+@property (nonatomic, assign) BOOL scheduled;
+@property (nonatomic, assign) BOOL running;
+@property (nonatomic, assign) BOOL needsRerun;
+@end
+
+@implementation DYFStoreVerificationCoordinator
+
+- (instancetype)initWithPersister:(id<DYFStoreTransactionPersistence>)persister verifier:(id<DYFStoreReceiptVerifying>)verifier
+{
+    self = [super init];
+    if (self) {
+        _persister = persister;
+        _verifier = verifier;
+        _store = DYFStore.defaultStore;
+        _maxConcurrentRequests = 4;
+        _callbackQueue = dispatch_get_main_queue();
+        _workQueue = dispatch_queue_create("com.dyfstore.verification", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)setNeedsVerification
+{
+    @synchronized (self) {
+        if (self.running) {
+            self.needsRerun = YES;
+            return;
+        }
+        if (self.scheduled) { return; }
+        self.scheduled = YES;
+    }
+    
+    // Deferring the pass to the next turn of the callback queue lets a burst of calls, e.g. from restored transactions, share it.
+    dispatch_async(self.callbackQueue, ^{
+        dispatch_async(self.workQueue, ^{
+            [self startPass];
+        });
+    });
+}
+
+- (void)startPass
+{
+    @synchronized (self) {
+        self.scheduled = NO;
+        self.running = YES;
+    }
+    
+    DYFStoreVerificationPass *pass = [[DYFStoreVerificationPass alloc] init];
+    pass.receipts = [NSMutableArray array];
+    pass.groups = [NSMutableDictionary dictionary];
+    pass.digests = [NSMutableDictionary dictionary];
+    pass.result = [[DYFStoreVerificationResult alloc] init];
+    
+    // The headers are enough to decide, so only the records that are verified in this pass are decoded.
+    NSArray<DYFStoreTransaction *> *transactions;
+    id<DYFStoreVerificationScheduling> scheduler = self.scheduler;
+    if (scheduler) {
+        DYFStoreWarmUp *warmUp = self.store.warmUp;
+        NSArray<DYFStoreTransactionHeader *> *headers = (warmUp ? [warmUp transactionHeadersOfPersister:self.persister] : [self.persister retrieveTransactionHeaders]) ?: @[];
+        NSArray<DYFStoreTransactionHeader *> *due = [scheduler verificationCoordinator:self transactionsToVerify:headers];
+        pass.result.deferredCount = headers.count - MIN(due.count, headers.count);
+        transactions = [self.persister retrieveTransactionsWithIdentifiers:[due valueForKey:@"transactionIdentifier"]];
+    } else {
+        transactions = [self.persister retrieveTransactions] ?: @[];
+    }
+    
+    // Groups the transactions by receipt, so that each receipt is sent once.
+    for (DYFStoreTransaction *transaction in transactions) {
+        NSString *receipt = transaction.transactionReceipt;
+        if (receipt.length == 0) {
+            [pass.result.unresolved addObject:transaction];
+            continue;
+        }
+        NSMutableArray *group = pass.groups[receipt];
+        if (!group) {
+            group = [NSMutableArray array];
+            pass.groups[receipt] = group;
+            [pass.receipts addObject:receipt];
+        }
+        [group addObject:transaction];
+    }
+    
+    if (self.cache) {
+        [self settleCachedTransactions:pass];
+    }
+    
+    [self continuePass:pass];
+}
+
+/** Settles the transactions whose outcome is cached, and drops the receipts that have nothing left to verify.
+ */
+- (void)settleCachedTransactions:(DYFStoreVerificationPass *)pass
+{
+    DYFStoreVerificationResult *result = pass.result;
+    NSMutableArray<NSString *> *receipts = [NSMutableArray arrayWithCapacity:pass.receipts.count];
+    
+    for (NSString *receipt in pass.receipts) {
+        NSString *digest = [DYFStoreReceiptHandle handleWithBase64EncodedString:receipt].digest;
+        pass.digests[receipt] = digest;
+        
+        NSMutableArray<DYFStoreTransaction *> *misses = [NSMutableArray array];
+        for (DYFStoreTransaction *transaction in pass.groups[receipt]) {
+            DYFStoreVerificationCacheEntry *entry = [self.cache entryForReceiptDigest:digest transactionIdentifier:transaction.transactionIdentifier];
+            if (!entry) {
+                DYFStoreMetricsCount(DYFStoreCounterVerificationCacheMisses);
+                [misses addObject:transaction];
+                continue;
+            }
+            
+            DYFStoreMetricsCount(DYFStoreCounterVerificationCacheHits);
+            result.cacheHitCount++;
+            if (entry.isVerified) {
+                [result.verified addObject:transaction];
+                [result entitleProduct:transaction.productIdentifier toUser:transaction.userIdentifier];
+                result.entries[transaction.transactionIdentifier] = entry.receiptEntry;
+            } else {
+                [result.rejected addObject:transaction];
+            }
+        }
+        
+        if (misses.count > 0) {
+            pass.groups[receipt] = misses;
+            [receipts addObject:receipt];
+        } else {
+            DYFStoreMetricsCount(DYFStoreCounterVerificationRequestsAvoided);
+            [pass.groups removeObjectForKey:receipt];
+        }
+    }
+    
+    pass.receipts = receipts;
+}
+
+/** Sends the requests of the remaining receipts, at most `maxConcurrentRequests` at a time, and finishes the pass once all responses are in.
+ */
+- (void)continuePass:(DYFStoreVerificationPass *)pass
+{
+    if (pass.nextIndex >= pass.receipts.count && pass.inFlight == 0) {
+        [self finishPass:pass];
+        return;
+    }
+    
+    while (pass.nextIndex < pass.receipts.count && pass.inFlight < MAX(self.maxConcurrentRequests, 1)) {
+        NSString *receipt = pass.receipts[pass.nextIndex++];
+        pass.inFlight++;
+        pass.result.requestCount++;
+        
+        // The mapped receipt is sent if its handle is alive, otherwise the string is decoded once.
+        [self.verifier verifyReceipt:[DYFStoreReceiptHandle handleWithBase64EncodedString:receipt].data completion:^(NSDictionary *response, NSError *error) {
+            dispatch_async(self.workQueue, ^{
+                pass.inFlight--;
+                [self settleTransactions:pass.groups[receipt] response:response error:error result:pass.result];
+                [self cacheTransactions:pass.groups[receipt] digest:pass.digests[receipt] response:response error:error result:pass.result];
+                [self continuePass:pass];
+            });
+        }];
+    }
+}
+
+- (void)settleTransactions:(NSArray<DYFStoreTransaction *> *)transactions
+                  response:(NSDictionary *)response
+                     error:(NSError *)error
+                    result:(DYFStoreVerificationResult *)result
+{
+    NSInteger status = error ? error.code : [response[@"status"] integerValue];
+    
+    if (error && status < 21000) {
+        // Not verified this time, e.g. the network is unreachable.
+        [result.unresolved addObjectsFromArray:transactions];
+        result.error = error;
+        return;
+    }
+    if (status != 0) {
+        [result.rejected addObjectsFromArray:transactions];
+        return;
+    }
+    
+    NSDictionary *entries = DYFStoreReceiptEntries(response);
+    
+    // The receipt is valid, so every uncancelled purchase it lists entitles the users whose transactions carry it.
+    for (NSDictionary *entry in entries.allValues) {
+        id productIdentifier = entry[@"product_id"];
+        if (![productIdentifier isKindOfClass:NSString.class] || entry[@"cancellation_date"]) { continue; }
+        for (DYFStoreTransaction *transaction in transactions) {
+            [result entitleProduct:productIdentifier toUser:transaction.userIdentifier];
+        }
+    }
+    
+    for (DYFStoreTransaction *transaction in transactions) {
+        NSDictionary *entry = entries[transaction.transactionIdentifier ?: @""];
+        if (!entry && transaction.originalTransactionIdentifier) {
+            entry = entries[transaction.originalTransactionIdentifier];
+        }
+        
+        if (entry) {
+            [result.verified addObject:transaction];
+            [result entitleProduct:transaction.productIdentifier toUser:transaction.userIdentifier];
+            result.entries[transaction.transactionIdentifier] = entry;
+        } else {
+            // The receipt predates the transaction. A refreshed receipt will list it.
+            [result.unresolved addObject:transaction];
+        }
+    }
+}
+
+/** Records the settled outcomes of a response. Transactions left unresolved are not cached, so they are sent again.
+ */
+- (void)cacheTransactions:(NSArray<DYFStoreTransaction *> *)transactions
+                   digest:(NSString *)digest
+                 response:(NSDictionary *)response
+                    error:(NSError *)error
+                   result:(DYFStoreVerificationResult *)result
+{
+    if (!self.cache || !digest) { return; }
+    
+    NSInteger status = error ? error.code : [response[@"status"] integerValue];
+    if (error && status < 21000) { return; }
+    
+    for (DYFStoreTransaction *transaction in transactions) {
+        NSDictionary *entry = result.entries[transaction.transactionIdentifier ?: @""];
+        if (status == 0 && !entry) { continue; }
+        
+        [self.cache setStatus:status receiptEntry:entry forReceiptDigest:digest transactionIdentifier:transaction.transactionIdentifier];
+    }
+}
+
+- (void)finishPass:(DYFStoreVerificationPass *)pass
+{
+    DYFStoreVerificationResult *result = pass.result;
+    [self.cache synchronize];
+    
+    NSMutableArray<DYFStoreTransaction *> *settled = [NSMutableArray arrayWithArray:result.verified];
+    [settled addObjectsFromArray:result.rejected];
+    
+    NSMutableArray<NSString *> *identifiers = [NSMutableArray arrayWithCapacity:settled.count * 2];
+    for (DYFStoreTransaction *transaction in settled) {
+        !transaction.transactionIdentifier ?: [identifiers addObject:transaction.transactionIdentifier];
+        !transaction.originalTransactionIdentifier ?: [identifiers addObject:transaction.originalTransactionIdentifier];
+    }
+    [self.persister removeTransactionsWithIdentifiers:identifiers];
+    [self.scheduler verificationCoordinator:self didSettleWithResult:result];
+    
+    dispatch_async(self.callbackQueue, ^{
+        // The payment transactions are looked up once for the whole pass, e.g. the hundreds of transactions of a restore.
+        NSMutableArray<NSString *> *finished = [NSMutableArray arrayWithCapacity:settled.count];
+        for (DYFStoreTransaction *transaction in settled) {
+            !transaction.transactionIdentifier ?: [finished addObject:transaction.transactionIdentifier];
+        }
+        [self.store finishTransactionsWithIdentifiers:finished];
+        
+        [self.delegate verificationCoordinator:self didFinishWithResult:result];
+        
+        BOOL rerun;
+        @synchronized (self) {
+            self.running = NO;
+            rerun = self.needsRerun;
+            self.needsRerun = NO;
+        }
+        if (rerun) {
+            [self setNeedsVerification];
+        }
+    });
+}
+
+@end
@@ -0,0 +1,113 @@
+//
+//  DYFStoreWarmUp.h
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import <Foundation/Foundation.h>
+#import "DYFStoreTransactionPersistence.h"
+#import "DYFStoreReceiptHandle.h"
+
+@class DYFStore;
+
+/** Uses enumeration to inicate a stage of the warm-up.
+ */
+typedef NS_ENUM(NSUInteger, DYFStoreWarmUpStage)
+{
+    /** Prefetches the products into the catalog. */
+    DYFStoreWarmUpStageProducts,
+    /** Maps the receipt, encodes it and digests it. */
+    DYFStoreWarmUpStageReceipt,
+    /** Loads the index of the persisted transactions. */
+    DYFStoreWarmUpStagePersistence,
+    /** The number of stages. */
+    DYFStoreWarmUpStageCount
+};
+
+/** Does the work of the first purchase ahead of time, when the transaction observer is added, so that the first purchase tap has nothing left to wait for.
+ 
+ The products are prefetched into the catalog, the receipt at `receiptURL` is mapped and digested, and the index of the persisted transactions is loaded, on a low-priority background queue. The report tells the time every stage took and the time it saved on the critical path, which is counted when the result of the stage is consumed.
+ */
+@interface DYFStoreWarmUp : NSObject
+
+/** The product identifiers to prefetch.
+ */
+@property (nonatomic, copy, readonly) NSArray<NSString *> *productIdentifiers;
+
+/** The persister whose index is loaded. Can be nil.
+ */
+@property (nonatomic, strong, readonly) id<DYFStoreTransactionPersistence> persister;
+
+/** How long the prefetched products answer `requestProductWithIdentifiers:success:failure:` in place of a request, in seconds. The default is 300.
+ */
+@property (nonatomic, assign) NSTimeInterval productsMaxAge;
+
+/** The block to be called on the main queue when all stages have finished. It takes the report, in which no time is saved yet, as no result has been consumed.
+ */
+@property (nonatomic, copy) void (^completion)(NSDictionary *report);
+
+/** The block to be called on the main queue when the result of a finished stage is consumed. It takes the stage and the report with the time saved so far.
+ */
+@property (nonatomic, copy) void (^consumption)(DYFStoreWarmUpStage stage, NSDictionary *report);
+
+/** Creates a warm-up.
+ 
+ @param productIdentifiers The product identifiers to prefetch. Can be nil.
+ @param persister The persister whose index is loaded. Can be nil.
+ @return A `DYFStoreWarmUp` object.
+ */
+- (instancetype)initWithProductIdentifiers:(NSArray<NSString *> *)productIdentifiers persister:(id<DYFStoreTransactionPersistence>)persister;
+
+/** Starts the stages. Called by `addPaymentTransactionObserver` when the warm-up is set on the store. Does nothing after the first call.
+ 
+ @param store The store whose catalog is filled.
+ */
+- (void)startWithStore:(DYFStore *)store;
+
+/** Returns whether the prefetched products can answer a products request, and counts it as saved time if they can.
+ 
+ @param identifiers The requested product identifiers.
+ @return YES if all of them were prefetched within `productsMaxAge`.
+ */
+- (BOOL)consumeProductsWithIdentifiers:(NSSet<NSString *> *)identifiers;
+
+/** Returns the handle of the receipt at `receiptURL`. The warm handle, whose encoding and digest are made, is returned if the file did not change since, otherwise the file is mapped again.
+ 
+ @return A `DYFStoreReceiptHandle` object, or nil if there is no receipt.
+ */
+- (DYFStoreReceiptHandle *)receipt;
+
+/** Returns the headers of the transactions of a persister. If it is the warmed persister, whose index is loaded, the first read is counted as a hit that saved the time of the cold load minus that of this one.
+ 
+ @param persister The persister to read.
+ @return The `DYFStoreTransactionHeader` objects.
+ */
+- (NSArray<DYFStoreTransactionHeader *> *)transactionHeadersOfPersister:(id<DYFStoreTransactionPersistence>)persister;
+
+/** Returns the live report of the stages.
+ 
+ The report is of the form {stage: {"finished", "duration_ms", "saved_ms", "hits"}}, where the stage is "products", "receipt" or "persistence", and can be serialized as JSON.
+ 
+ @return The report.
+ */
+- (NSDictionary *)report;
+
+@end
@@ -0,0 +1,241 @@
+//
+//  DYFStoreWarmUp.m
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#import "DYFStoreWarmUp.h"
+#import "DYFStore.h"
+
+/** The time a stage took and saved.
+ */
+typedef struct {
+    BOOL finished;
+    uint64_t duration;
+    uint64_t saved;
+    NSUInteger hits;
+} DYFStoreWarmUpStageState;
+
+@interface DYFStoreWarmUp ()
+@property (nonatomic, assign) BOOL started;
+@property (nonatomic, copy) NSSet<NSString *> *prefetchedIdentifiers;
+@property (nonatomic, assign) uint64_t productsTime;
+@property (nonatomic, strong) DYFStoreReceiptHandle *receiptHandle;
+@end
+
+@implementation DYFStoreWarmUp
+{
+    DYFStoreWarmUpStageState _stages[DYFStoreWarmUpStageCount];
+}
+
+- (instancetype)init
+{
+    return [self initWithProductIdentifiers:nil persister:nil];
+}
+
+- (instancetype)initWithProductIdentifiers:(NSArray<NSString *> *)productIdentifiers persister:(id<DYFStoreTransactionPersistence>)persister
+{
+    self = [super init];
+    if (self) {
+        _productIdentifiers = [productIdentifiers copy] ?: @[];
+        _persister = persister;
+        _productsMaxAge = 300;
+    }
+    return self;
+}
+
+- (void)startWithStore:(DYFStore *)store
+{
+    @synchronized (self) {
+        if (self.started) { return; }
+        self.started = YES;
+    }
+    
+    DYFStoreLog(@"warming up %zi products", self.productIdentifiers.count);
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        // The products request is sent first, as its round trip is the longest, and runs while the other stages do.
+        if (self.productIdentifiers.count > 0) {
+            uint64_t start = DYFStoreMetricsNow();
+            [store prefetchProductsWithIdentifiers:self.productIdentifiers completion:^(DYFStoreCatalogChangeset *changeset, NSError *error) {
+                @synchronized (self) {
+                    if (!error) {
+                        self.prefetchedIdentifiers = [NSSet setWithArray:self.productIdentifiers];
+                        self.productsTime = DYFStoreMetricsNow();
+                    }
+                }
+                [self finishStage:DYFStoreWarmUpStageProducts duration:DYFStoreMetricsNow() - start saved:0];
+            }];
+        } else {
+            [self finishStage:DYFStoreWarmUpStageProducts duration:0 saved:0];
+        }
+        
+        [self warmUpReceipt];
+        [self warmUpPersistence];
+    });
+}
+
+/** Maps, encodes and digests the receipt.
+ */
+- (void)warmUpReceipt
+{
+    uint64_t start = DYFStoreMetricsNow();
+    DYFStoreReceiptHandle *handle = [DYFStoreReceiptHandle appStoreReceipt];
+    [handle digest];
+    
+    @synchronized (self) {
+        self.receiptHandle = handle;
+    }
+    [self finishStage:DYFStoreWarmUpStageReceipt duration:DYFStoreMetricsNow() - start saved:0];
+}
+
+/** Loads the index of the persisted transactions, which stays loaded for the first read of the headers.
+ */
+- (void)warmUpPersistence
+{
+    if (!self.persister) {
+        [self finishStage:DYFStoreWarmUpStagePersistence duration:0 saved:0];
+        return;
+    }
+    
+    uint64_t start = DYFStoreMetricsNow();
+    @autoreleasepool {
+        [self.persister retrieveTransactionHeaders];
+    }
+    [self finishStage:DYFStoreWarmUpStagePersistence duration:DYFStoreMetricsNow() - start saved:0];
+}
+
+- (void)finishStage:(DYFStoreWarmUpStage)stage duration:(uint64_t)duration saved:(uint64_t)saved
+{
+    BOOL finished = YES;
+    @synchronized (self) {
+        _stages[stage].finished = YES;
+        _stages[stage].duration = duration;
+        _stages[stage].saved += saved;
+        for (NSUInteger idx = 0; idx < DYFStoreWarmUpStageCount; idx++) {
+            finished = finished && _stages[idx].finished;
+        }
+    }
+    
+    DYFStoreLog(@"warm-up stage %zi took %.3f ms", stage, duration / 1e6);
+    if (!finished) { return; }
+    
+    NSDictionary *report = [self report];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        !self.completion ?: self.completion(report);
+    });
+}
+
+/** Counts a use of the result of a stage, which saved some time on the critical path, and calls the consumption block with the report.
+ */
+- (void)recordHitOfStage:(DYFStoreWarmUpStage)stage saved:(uint64_t)saved
+{
+    @synchronized (self) {
+        _stages[stage].saved += saved;
+        _stages[stage].hits++;
+    }
+    
+    void (^consumption)(DYFStoreWarmUpStage, NSDictionary *) = self.consumption;
+    if (!consumption) { return; }
+    NSDictionary *report = [self report];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        consumption(stage, report);
+    });
+}
+
+- (BOOL)consumeProductsWithIdentifiers:(NSSet<NSString *> *)identifiers
+{
+    uint64_t saved = 0;
+    @synchronized (self) {
+        if (!self.prefetchedIdentifiers || ![identifiers isSubsetOfSet:self.prefetchedIdentifiers]) {
+            return NO;
+        }
+        if ((DYFStoreMetricsNow() - self.productsTime) / 1e9 > self.productsMaxAge) {
+            return NO;
+        }
+        // The prefetched products answer in place of a request, which would have taken as long as the prefetch.
+        saved = _stages[DYFStoreWarmUpStageProducts].duration;
+    }
+    
+    [self recordHitOfStage:DYFStoreWarmUpStageProducts saved:saved];
+    return YES;
+}
+
+#pragma mark - Receipt
+
+- (DYFStoreReceiptHandle *)receipt
+{
+    DYFStoreReceiptHandle *handle = [DYFStoreReceiptHandle appStoreReceipt];
+    uint64_t saved = 0;
+    BOOL hit = NO;
+    @synchronized (self) {
+        // The warm handle has its encoding and digest made, which took the time of the stage.
+        hit = handle && handle == self.receiptHandle;
+        saved = _stages[DYFStoreWarmUpStageReceipt].duration;
+    }
+    
+    !hit ?: [self recordHitOfStage:DYFStoreWarmUpStageReceipt saved:saved];
+    return handle;
+}
+
+#pragma mark - Persistence
+
+- (NSArray<DYFStoreTransactionHeader *> *)transactionHeadersOfPersister:(id<DYFStoreTransactionPersistence>)persister
+{
+    uint64_t start = DYFStoreMetricsNow();
+    NSArray<DYFStoreTransactionHeader *> *headers = [persister retrieveTransactionHeaders];
+    uint64_t warm = DYFStoreMetricsNow() - start;
+    
+    uint64_t cold = 0;
+    BOOL hit = NO;
+    @synchronized (self) {
+        // Only the first read would have loaded the index cold.
+        hit = persister && persister == self.persister && _stages[DYFStoreWarmUpStagePersistence].finished && _stages[DYFStoreWarmUpStagePersistence].hits == 0;
+        cold = _stages[DYFStoreWarmUpStagePersistence].duration;
+    }
+    
+    !hit ?: [self recordHitOfStage:DYFStoreWarmUpStagePersistence saved:cold > warm ? cold - warm : 0];
+    return headers;
+}
+
+#pragma mark - Report
+
+- (NSDictionary *)report
+{
+    static NSArray *names;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        names = @[@"products", @"receipt", @"persistence"];
+    });
+    
+    NSMutableDictionary *report = [NSMutableDictionary dictionaryWithCapacity:DYFStoreWarmUpStageCount];
+    @synchronized (self) {
+        for (NSUInteger idx = 0; idx < DYFStoreWarmUpStageCount; idx++) {
+            DYFStoreWarmUpStageState state = _stages[idx];
+            report[names[idx]] = @{@"finished": @(state.finished),
+                                   @"duration_ms": @(state.duration / 1e6),
+                                   @"saved_ms": @(state.saved / 1e6),
+                                   @"hits": @(state.hits)};
+        }
+    }
+    return report;
+}
+
+@end
@@ -7,6 +7,20 @@
 
 #import "AppDelegate.h"
 #import "SKIAPManager.h"
+#import "SKStoreLoadBenchmark.h"
+#import "SKStoreMicroBenchmark.h"
+#import "SKVerificationBenchmark.h"
+#import "SKStartupBenchmark.h"
+#import "SKQueryBenchmark.h"
+#import "SKReceiptBatchBenchmark.h"
+#import "SKCatalogBenchmark.h"
+#import "SKReceiptHandleBenchmark.h"
+#import "SKAdmissionBenchmark.h"
+#import "SKBulkDecodeBenchmark.h"
+#import "SKRestoreBenchmark.h"
+#import "SKPersistenceBenchmark.h"
+#import "SKStateMachineBenchmark.h"
+#import "SKRetryBenchmark.h"
 
 @interface AppDelegate () <DYFStoreAppStorePaymentDelegate>
 
@@ -17,11 +31,123 @@
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions {
     
     [self displayStartupPage];
+    
+    // Launch with one of the arguments of `benchmarks`, e.g. "-DYFStoreLoadBenchmark", to run a benchmark instead of the store.
+    if ([self runBenchmarkOfArguments:NSProcessInfo.processInfo.arguments]) {
+        return YES;
+    }
+    
     [self initIAPSDK];
     
     return YES;
 }
 
+/** Maps the launch arguments to the benchmark classes and their runners. A runner returns the report of its benchmark. A benchmark that gates on a baseline also returns its "regressions", and the app then exits with a failing status if there are any.
+ */
+- (NSDictionary<NSString *, NSArray *> *)benchmarks
+{
+    return @{
+        // Drives the store with the simulated payment backend.
+        @"-DYFStoreLoadBenchmark": @[SKStoreLoadBenchmark.class, ^NSDictionary *{
+            return [SKStoreLoadBenchmark runWithTransactionCount:100000 batchSize:16];
+        }],
+        // Measures the hot paths against the checked-in baseline.
+        @"-DYFStoreMicroBenchmark": @[SKStoreMicroBenchmark.class, ^NSDictionary *{
+            NSDictionary *result = [SKStoreMicroBenchmark run];
+            // The report has the format of SKBenchmarkBaseline.json. Copy it into the project to record a new baseline.
+            NSData *data = [NSJSONSerialization dataWithJSONObject:result[@"report"] options:NSJSONWritingPrettyPrinted error:nil];
+            NSString *documents = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES).firstObject;
+            [data writeToFile:[documents stringByAppendingPathComponent:@"SKBenchmarkReport.json"] atomically:YES];
+            NSArray *unrecorded = result[@"unrecorded"];
+            if (unrecorded.count > 0) {
+                NSLog(@"[SKStoreMicroBenchmark] not recorded in the baseline, unchecked: %@", [unrecorded componentsJoinedByString:@", "]);
+            }
+            for (NSString *regression in result[@"regressions"]) {
+                NSLog(@"[SKStoreMicroBenchmark] regression: %@", regression);
+            }
+            return result;
+        }],
+        // Measures finding the unfinished transactions with 1k and 50k records.
+        @"-DYFStoreStartupBenchmark": @[SKStartupBenchmark.class, ^NSDictionary *{
+            return [SKStartupBenchmark run];
+        }],
+        // Measures indexed queries over 100k records.
+        @"-DYFStoreQueryBenchmark": @[SKQueryBenchmark.class, ^NSDictionary *{
+            return [SKQueryBenchmark run];
+        }],
+        // Measures the throughput of the batch receipt validator over the cores.
+        @"-DYFStoreReceiptBatchBenchmark": @[SKReceiptBatchBenchmark.class, ^NSDictionary *{
+            return [SKReceiptBatchBenchmark run];
+        }],
+        // Measures the diff of 10k-product responses with 1% churn.
+        @"-DYFStoreCatalogBenchmark": @[SKCatalogBenchmark.class, ^NSDictionary *{
+            return [SKCatalogBenchmark run];
+        }],
+        // Measures the copies and the peak memory of taking a receipt to the verifier.
+        @"-DYFStoreReceiptHandleBenchmark": @[SKReceiptHandleBenchmark.class, ^NSDictionary *{
+            return [SKReceiptHandleBenchmark run];
+        }],
+        // Counts the payments added for repeated taps and retries.
+        @"-DYFStoreAdmissionBenchmark": @[SKAdmissionBenchmark.class, ^NSDictionary *{
+            return [SKAdmissionBenchmark runWithUserCount:1000 tapCount:3];
+        }],
+        // Measures decoding 50k records at 1 to 16 threads.
+        @"-DYFStoreBulkDecodeBenchmark": @[SKBulkDecodeBenchmark.class, ^NSDictionary *{
+            return [SKBulkDecodeBenchmark run];
+        }],
+        // Compares processing a 500-item restore per transaction and together.
+        @"-DYFStoreRestoreBenchmark": @[SKRestoreBenchmark.class, ^NSDictionary *{
+            return [SKRestoreBenchmark run];
+        }],
+        // Compares the user defaults, keychain and SQLite persisters.
+        @"-DYFStorePersistenceBenchmark": @[SKPersistenceBenchmark.class, ^NSDictionary *{
+            return [SKPersistenceBenchmark run];
+        }],
+        // Drives the transaction state machine with mixed-state batches of 10k transactions.
+        @"-DYFStoreStateMachineBenchmark": @[SKStateMachineBenchmark.class, ^NSDictionary *{
+            return [SKStateMachineBenchmark run];
+        }],
+        // Checks the retry scheduler on a simulated clock against a failing network.
+        @"-DYFStoreRetryBenchmark": @[SKRetryBenchmark.class, ^NSDictionary *{
+            return [SKRetryBenchmark run];
+        }],
+        // Compares per-transaction and batched receipt verification.
+        @"-DYFStoreVerificationBenchmark": @[SKVerificationBenchmark.class, ^NSDictionary *{
+            return [SKVerificationBenchmark runWithTransactionCount:200 receiptCount:20 latency:0.05];
+        }]
+    };
+}
+
+/** Runs the benchmark of the first launch argument that names one, and logs its report.
+ 
+ @param arguments The launch arguments.
+ @return YES if a benchmark was started.
+ */
+- (BOOL)runBenchmarkOfArguments:(NSArray<NSString *> *)arguments
+{
+    NSDictionary<NSString *, NSArray *> *benchmarks = [self benchmarks];
+    for (NSString *argument in arguments) {
+        NSArray *benchmark = benchmarks[argument];
+        if (!benchmark) { continue; }
+        
+        NSString *name = NSStringFromClass(benchmark[0]);
+        NSDictionary *(^runner)(void) = benchmark[1];
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            NSDictionary *report = runner();
+            NSData *data = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:nil];
+            NSLog(@"[%@] %@", name, [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]);
+            
+            // Lets the script that launched the gate tell a regression from a pass.
+            NSArray *regressions = report[@"regressions"];
+            if (regressions) {
+                exit(regressions.count > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+            }
+        });
+        return YES;
+    }
+    return NO;
+}
+
 - (void)displayStartupPage
 {
     [NSThread sleepForTimeInterval:2.0];
@@ -29,8 +155,29 @@
 
 - (void)initIAPSDK
 {
+    // Writes the store log that has not been formatted yet to Caches/DYFStoreCrash.log if the app crashes.
+    NSString *cachesDirectory = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+    [DYFStoreLogger installCrashDumpToPath:[cachesDirectory stringByAppendingPathComponent:@"DYFStoreCrash.log"]];
+    
+    // Journals the transaction lifecycle to Application Support/DYFStoreKit.journal, which Tools/DYFStoreJournalReplay.c reads.
+    NSString *supportDirectory = NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES).firstObject;
+    [NSFileManager.defaultManager createDirectoryAtPath:supportDirectory withIntermediateDirectories:YES attributes:nil error:nil];
+    [DYFStore.defaultStore startJournalAtPath:[supportDirectory stringByAppendingPathComponent:@"DYFStoreKit.journal"] capacity:65536];
+    
     [SKIAPManager.shared addStoreObserver];
     
+    // Prepares the products of the store screen, the receipt and the persisted transactions in the background, as soon as the observer is added.
+    NSArray *productIds = @[@"com.hncs.szj.coin42", @"com.hncs.szj.coin210", @"com.hncs.szj.coin686", @"com.hncs.szj.coin1386",
+                            @"com.hncs.szj.coin2086", @"com.hncs.szj.coin4886", @"com.hncs.szj.vip1", @"com.hncs.szj.vip2"];
+    DYFStoreWarmUp *warmUp = [[DYFStoreWarmUp alloc] initWithProductIdentifiers:productIds persister:[[DYFStoreUserDefaultsPersistence alloc] init]];
+    warmUp.completion = ^(NSDictionary *report) {
+        DYFStoreLog(@"warm-up finished: %@", report);
+    };
+    warmUp.consumption = ^(DYFStoreWarmUpStage stage, NSDictionary *report) {
+        DYFStoreLog(@"warm-up result consumed: %@", report);
+    };
+    DYFStore.defaultStore.warmUp = warmUp;
+    
     // Adds an observer that responds to updated transactions to the payment queue.
     // If an application quits when transactions are still being processed, those transactions are not lost. The next time the application launches, the payment queue will resume processing the transactions. Your application should always expect to be notified of completed transactions.
     // If more than one transaction observer is attached to the payment queue, no guarantees are made as to the order they will be called in. It is recommended that you use a single observer to process and finish the transaction.
@@ -0,0 +1,22 @@
+//
+//  SKAdmissionBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Simulates double taps and retry loops on the purchase buttons, and counts the payments that reach the simulated payment queue with the payment admission of the store.
+ */
+@interface SKAdmissionBenchmark : NSObject
+
+/** Runs the benchmark and returns a report with the payments added, coalesced and rate limited, and the latency percentiles of the purchase calls.
+ 
+ @param userCount The number of users that purchase a product, e.g. 1000.
+ @param tapCount The number of times each user taps the purchase button, e.g. 3.
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)runWithUserCount:(NSUInteger)userCount tapCount:(NSUInteger)tapCount;
+
+@end
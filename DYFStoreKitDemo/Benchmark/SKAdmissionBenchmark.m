@@ -0,0 +1,133 @@
+//
+//  SKAdmissionBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKAdmissionBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreSimulatedPaymentBackend.h"
+#import "SKBenchmark.h"
+
+// The number of payments admitted per minute in the rate limited pass.
+static const NSUInteger SKAdmissionRateLimit = 10;
+
+@implementation SKAdmissionBenchmark
+
+/** Waits for the futures to finish, and returns the number of them that failed with an error code of the store.
+ */
++ (NSUInteger)waitForFutures:(NSArray<DYFStoreFuture *> *)futures failingWithCode:(NSInteger)code
+{
+    dispatch_group_t group = dispatch_group_create();
+    __block NSUInteger failures = 0;
+    
+    for (DYFStoreFuture *future in futures) {
+        dispatch_group_enter(group);
+        [future whenFinished:^(id result, NSError *error) {
+            if ([error.domain isEqualToString:DYFStoreErrorDomain] && error.code == code) {
+                failures++;
+            }
+            dispatch_group_leave(group);
+        }];
+    }
+    dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 30 * NSEC_PER_SEC));
+    
+    return failures;
+}
+
++ (void)finishDeliveredTransactions:(DYFStoreSimulatedPaymentBackend *)backend store:(DYFStore *)store
+{
+    dispatch_sync(dispatch_get_main_queue(), ^{
+        for (SKPaymentTransaction *transaction in backend.unfinishedTransactions) {
+            [store finishTransaction:transaction];
+        }
+        [store.purchasedTranscations removeAllObjects];
+    });
+}
+
++ (NSDictionary *)runWithUserCount:(NSUInteger)userCount tapCount:(NSUInteger)tapCount
+{
+    tapCount = MAX(tapCount, 1);
+    NSArray *productIds = @[@"com.dyf.storekit.gold", @"com.dyf.storekit.vip.month", @"com.dyf.storekit.noads"];
+    
+    DYFStore *store = DYFStore.defaultStore;
+    id<DYFStorePaymentBackend> previousBackend = store.paymentBackend;
+    DYFStorePaymentAdmission *previousAdmission = store.paymentAdmission;
+    
+    DYFStoreSimulatedPaymentBackend *backend = [[DYFStoreSimulatedPaymentBackend alloc] init];
+    backend.seed = 45;
+    for (NSString *productId in productIds) {
+        [backend registerProductWithIdentifier:productId price:[NSDecimalNumber decimalNumberWithString:@"0.99"]];
+    }
+    store.paymentBackend = backend;
+    [store addPaymentTransactionObserver];
+    
+    // The products must be known to the store before they are purchased.
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [[store futureForProductsWithIdentifiers:productIds] whenFinished:^(id result, NSError *error) {
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC));
+    
+    // The first pass coalesces the taps of each user onto one payment.
+    store.paymentAdmission = [[DYFStorePaymentAdmission alloc] initWithClock:nil];
+    NSUInteger attempts = userCount * tapCount;
+    uint64_t *latencies = calloc(MAX(attempts, 1), sizeof(uint64_t));
+    NSMutableArray<DYFStoreFuture *> *futures = [NSMutableArray arrayWithCapacity:attempts];
+    
+    for (NSUInteger idx = 0; idx < attempts; idx++) {
+        NSUInteger user = idx / tapCount;
+        NSString *userId = [NSString stringWithFormat:@"user-%lu", (unsigned long)user];
+        
+        uint64_t begin = SKBenchmarkNow();
+        DYFStoreFuture *future = [store futureForPurchaseOfProduct:productIds[user % productIds.count] userIdentifier:userId quantity:1];
+        latencies[idx] = SKBenchmarkNow() - begin;
+        [futures addObject:future];
+    }
+    [self waitForFutures:futures failingWithCode:DYFStoreErrorCodePaymentRateLimited];
+    NSUInteger paymentsAdded = backend.addedPaymentCount;
+    [self finishDeliveredTransactions:backend store:store];
+    
+    // The second pass retries one product as fast as possible under a rate limit, one second apart on a simulated clock.
+    DYFStoreSimulatedClock *clock = [[DYFStoreSimulatedClock alloc] initWithTime:0];
+    DYFStorePaymentAdmission *admission = [[DYFStorePaymentAdmission alloc] initWithClock:clock];
+    admission.coalescesPayments = NO;
+    admission.maximumPaymentsPerInterval = SKAdmissionRateLimit;
+    admission.rateLimitInterval = 60;
+    store.paymentAdmission = admission;
+    
+    NSUInteger retries = userCount;
+    [futures removeAllObjects];
+    for (NSUInteger idx = 0; idx < retries; idx++) {
+        [futures addObject:[store futureForPurchaseOfProduct:productIds.firstObject userIdentifier:@"user-retry" quantity:1]];
+        [clock advanceBy:1];
+    }
+    NSUInteger rateLimited = [self waitForFutures:futures failingWithCode:DYFStoreErrorCodePaymentRateLimited];
+    [self finishDeliveredTransactions:backend store:store];
+    
+    [store removePaymentTransactionObserver];
+    store.paymentBackend = previousBackend;
+    store.paymentAdmission = previousAdmission;
+    
+    uint64_t p50 = SKBenchmarkPercentile(latencies, attempts, 0.50);
+    uint64_t p90 = SKBenchmarkPercentile(latencies, attempts, 0.90);
+    uint64_t p99 = SKBenchmarkPercentile(latencies, attempts, 0.99);
+    uint64_t max = attempts > 0 ? latencies[attempts - 1] : 0;
+    
+    NSDictionary *report = @{@"attempts": @(attempts),
+                             @"payments_added": @(paymentsAdded),
+                             @"coalesced": @(attempts - MIN(paymentsAdded, attempts)),
+                             @"retries": @(retries),
+                             @"rate_limited": @(rateLimited),
+                             @"rate_limit_per_minute": @(SKAdmissionRateLimit),
+                             @"latency_ns": @{@"p50": @(p50),
+                                              @"p90": @(p90),
+                                              @"p99": @(p99),
+                                              @"max": @(max)}};
+    free(latencies);
+    
+    return report;
+}
+
+@end
@@ -0,0 +1,95 @@
+//
+//  SKBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class DYFStoreTransaction;
+
+typedef void (^SKBenchmarkBlock)(void);
+typedef void (^SKBenchmarkRunBlock)(NSUInteger run);
+
+/** The number of distinct products of the fixture transactions.
+ */
+FOUNDATION_EXPORT const NSUInteger SKBenchmarkProducts;
+
+/** The timestamp of the first fixture transaction. The following ones are one second apart.
+ */
+FOUNDATION_EXPORT const NSUInteger SKBenchmarkEpoch;
+
+/** Returns the current monotonic time in nanoseconds.
+ */
+FOUNDATION_EXPORT uint64_t SKBenchmarkNow(void);
+
+/** Sorts the samples in place and returns the value at the given percentile, e.g. 0.99.
+ */
+FOUNDATION_EXPORT uint64_t SKBenchmarkPercentile(uint64_t *samples, NSUInteger count, double percentile);
+
+/** Times a block a number of runs, each in its own autorelease pool, and returns the median in milliseconds.
+ 
+ @param runs The number of timed runs.
+ @param setUp The block called before every run, outside of the measured time. Can be `nil`.
+ @param block The measured block, which is passed the index of the run.
+ */
+FOUNDATION_EXPORT double SKBenchmarkMedianMilliseconds(NSUInteger runs, SKBenchmarkRunBlock setUp, SKBenchmarkRunBlock block);
+
+/** Returns the transaction at a given index of the fixed dataset shared by the benchmarks.
+ 
+ Every fifth transaction is restored and refers to an original transaction, the others are purchased. The products are "com.dyf.storekit.product.<index % SKBenchmarkProducts>", the users "user-<index % users>", and the identifiers "1000000" followed by the index on nine digits.
+ 
+ @param index The index of the transaction.
+ @param users The number of distinct users.
+ @param receipt The receipt of the transaction. Can be `nil`.
+ */
+FOUNDATION_EXPORT DYFStoreTransaction *SKBenchmarkTransaction(NSUInteger index, NSUInteger users, NSString *receipt);
+
+/** Runs a set of named cases with warmup and repeated, individually timed runs.
+ */
+@interface SKBenchmark : NSObject
+
+/** The number of untimed runs of every case. The default value is 5.
+ */
+@property (nonatomic, assign) NSUInteger warmupRuns;
+
+/** The number of timed runs of every case. The default value is 30.
+ */
+@property (nonatomic, assign) NSUInteger runs;
+
+/** Adds a case.
+ 
+ @param name The unique name of the case.
+ @param iterations The number of times `body` is invoked per timed run. The time of a run is divided by it.
+ @param setUp The block called before every run, outside of the measured time. Can be `nil`.
+ @param body The measured block.
+ */
+- (void)addCaseWithName:(NSString *)name
+             iterations:(NSUInteger)iterations
+                  setUp:(SKBenchmarkBlock)setUp
+                   body:(SKBenchmarkBlock)body;
+
+/** Runs all cases in the order they were added.
+ 
+ @return A report of the form {"cases": {name: {"median_ns", "p99_ns", "runs"}}}, which can be serialized as JSON.
+ */
+- (NSDictionary *)run;
+
+/** Compares a report against a baseline of the same form, which also holds a "tolerance" ratio (0.15 by default).
+ 
+ @param report A report returned by `run`.
+ @param baseline A baseline, usually a previously recorded report.
+ @return The descriptions of the cases whose median or p99 exceeds the baseline by more than the tolerance. Cases without a recorded baseline are not regressions, see `unrecordedCasesInReport:againstBaseline:`.
+ */
++ (NSArray<NSString *> *)regressionsInReport:(NSDictionary *)report againstBaseline:(NSDictionary *)baseline;
+
+/** Returns the cases of a report that the baseline has not recorded, i.e. that are missing from it or lack a positive median or p99. They cannot be checked until the baseline is recorded again.
+ 
+ @param report A report returned by `run`.
+ @param baseline A baseline, usually a previously recorded report.
+ @return The names of the unrecorded cases, sorted.
+ */
++ (NSArray<NSString *> *)unrecordedCasesInReport:(NSDictionary *)report againstBaseline:(NSDictionary *)baseline;
+
+@end
@@ -0,0 +1,193 @@
+//
+//  SKBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKBenchmark.h"
+#import <mach/mach_time.h>
+#import "DYFStore.h"
+
+const NSUInteger SKBenchmarkProducts = 20;
+const NSUInteger SKBenchmarkEpoch = 1415059200;
+
+uint64_t SKBenchmarkNow(void)
+{
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+}
+
+static int SKBenchmarkCompare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+uint64_t SKBenchmarkPercentile(uint64_t *samples, NSUInteger count, double percentile)
+{
+    if (count == 0) { return 0; }
+    qsort(samples, count, sizeof(uint64_t), SKBenchmarkCompare);
+    NSUInteger index = MIN((NSUInteger)(percentile * count), count - 1);
+    return samples[index];
+}
+
+double SKBenchmarkMedianMilliseconds(NSUInteger runs, SKBenchmarkRunBlock setUp, SKBenchmarkRunBlock block)
+{
+    if (runs == 0) { return 0; }
+    uint64_t samples[runs];
+    for (NSUInteger run = 0; run < runs; run++) {
+        !setUp ?: setUp(run);
+        uint64_t start = SKBenchmarkNow();
+        @autoreleasepool {
+            block(run);
+        }
+        samples[run] = SKBenchmarkNow() - start;
+    }
+    return SKBenchmarkPercentile(samples, runs, 0.5) / 1e6;
+}
+
+DYFStoreTransaction *SKBenchmarkTransaction(NSUInteger index, NSUInteger users, NSString *receipt)
+{
+    DYFStoreTransaction *transaction = [[DYFStoreTransaction alloc] init];
+    transaction.state = index % 5 == 0 ? DYFStoreTransactionStateRestored : DYFStoreTransactionStatePurchased;
+    transaction.productIdentifier = [NSString stringWithFormat:@"com.dyf.storekit.product.%lu", (unsigned long)(index % SKBenchmarkProducts)];
+    transaction.userIdentifier = [NSString stringWithFormat:@"user-%lu", (unsigned long)(index % MAX(users, 1))];
+    transaction.transactionIdentifier = [NSString stringWithFormat:@"1000000%09lu", (unsigned long)index];
+    transaction.transactionTimestamp = [NSString stringWithFormat:@"%lu", (unsigned long)(SKBenchmarkEpoch + index)];
+    if (transaction.state == DYFStoreTransactionStateRestored) {
+        transaction.originalTransactionIdentifier = [NSString stringWithFormat:@"2000000%09lu", (unsigned long)index];
+        transaction.originalTransactionTimestamp = [NSString stringWithFormat:@"%lu", (unsigned long)SKBenchmarkEpoch];
+    }
+    transaction.transactionReceipt = receipt;
+    return transaction;
+}
+
+@interface SKBenchmarkCase : NSObject
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, assign) NSUInteger iterations;
+@property (nonatomic, copy) SKBenchmarkBlock setUp;
+@property (nonatomic, copy) SKBenchmarkBlock body;
+@end
+
+@implementation SKBenchmarkCase
+
+@end
+
+@interface SKBenchmark ()
+@property (nonatomic, strong) NSMutableArray<SKBenchmarkCase *> *cases;
+@end
+
+@implementation SKBenchmark
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _warmupRuns = 5;
+        _runs = 30;
+        _cases = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)addCaseWithName:(NSString *)name
+             iterations:(NSUInteger)iterations
+                  setUp:(SKBenchmarkBlock)setUp
+                   body:(SKBenchmarkBlock)body
+{
+    SKBenchmarkCase *aCase = [[SKBenchmarkCase alloc] init];
+    aCase.name = name;
+    aCase.iterations = MAX(iterations, 1);
+    aCase.setUp = setUp;
+    aCase.body = body;
+    [self.cases addObject:aCase];
+}
+
+/** Runs a case once and returns the time per iteration in nanoseconds.
+ */
+- (uint64_t)runCase:(SKBenchmarkCase *)aCase
+{
+    @autoreleasepool {
+        !aCase.setUp ?: aCase.setUp();
+        
+        uint64_t begin = SKBenchmarkNow();
+        for (NSUInteger idx = 0; idx < aCase.iterations; idx++) {
+            aCase.body();
+        }
+        return (SKBenchmarkNow() - begin) / aCase.iterations;
+    }
+}
+
+- (NSDictionary *)run
+{
+    NSMutableDictionary *results = [NSMutableDictionary dictionaryWithCapacity:self.cases.count];
+    NSUInteger runs = MAX(self.runs, 1);
+    uint64_t *samples = calloc(runs, sizeof(uint64_t));
+    
+    for (SKBenchmarkCase *aCase in self.cases) {
+        for (NSUInteger idx = 0; idx < self.warmupRuns; idx++) {
+            [self runCase:aCase];
+        }
+        for (NSUInteger idx = 0; idx < runs; idx++) {
+            samples[idx] = [self runCase:aCase];
+        }
+        
+        uint64_t median = SKBenchmarkPercentile(samples, runs, 0.50);
+        uint64_t p99 = SKBenchmarkPercentile(samples, runs, 0.99);
+        results[aCase.name] = @{@"median_ns": @(median), @"p99_ns": @(p99), @"runs": @(runs)};
+    }
+    
+    free(samples);
+    
+    return @{@"cases": results};
+}
+
+/** Returns the baseline of a case if it is recorded, i.e. has a positive median and p99.
+ */
++ (NSDictionary *)recordedCaseNamed:(NSString *)name inBaseline:(NSDictionary *)baseline
+{
+    NSDictionary *expected = baseline[@"cases"][name];
+    if (![expected isKindOfClass:NSDictionary.class]) { return nil; }
+    if ([expected[@"median_ns"] doubleValue] <= 0 || [expected[@"p99_ns"] doubleValue] <= 0) { return nil; }
+    return expected;
+}
+
++ (NSArray<NSString *> *)regressionsInReport:(NSDictionary *)report againstBaseline:(NSDictionary *)baseline
+{
+    NSMutableArray *regressions = [NSMutableArray array];
+    double tolerance = baseline[@"tolerance"] ? [baseline[@"tolerance"] doubleValue] : 0.15;
+    
+    NSDictionary *cases = report[@"cases"];
+    for (NSString *name in [cases.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        NSDictionary *expected = [self recordedCaseNamed:name inBaseline:baseline];
+        if (!expected) { continue; }
+        
+        for (NSString *metric in @[@"median_ns", @"p99_ns"]) {
+            double limit = [expected[metric] doubleValue] * (1 + tolerance);
+            double actual = [cases[name][metric] doubleValue];
+            if (actual > limit) {
+                [regressions addObject:[NSString stringWithFormat:@"%@ %@: %.0f > %.0f", name, metric, actual, limit]];
+            }
+        }
+    }
+    
+    return regressions;
+}
+
++ (NSArray<NSString *> *)unrecordedCasesInReport:(NSDictionary *)report againstBaseline:(NSDictionary *)baseline
+{
+    NSMutableArray *unrecorded = [NSMutableArray array];
+    NSDictionary *cases = report[@"cases"];
+    for (NSString *name in [cases.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        if (![self recordedCaseNamed:name inBaseline:baseline]) {
+            [unrecorded addObject:name];
+        }
+    }
+    return unrecorded;
+}
+
+@end
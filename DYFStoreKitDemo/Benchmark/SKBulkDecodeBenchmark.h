@@ -0,0 +1,28 @@
+//
+//  SKBulkDecodeBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Measures how decoding the records of a large store scales with the number of worker threads of `DYFStoreBulkDecoder`, for archived records as the user defaults persister stores them and JSON records as the shared container persister stores them.
+ */
+@interface SKBulkDecodeBenchmark : NSObject
+
+/** Runs the benchmark with 50,000 records at 1, 2, 4, 8 and 16 threads.
+ 
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)run;
+
+/** Runs the benchmark with a number of records.
+ 
+ @param count The number of records.
+ @param threadCounts The numbers of worker threads to measure.
+ @return The median milliseconds of the bulk decode, the speedup over one thread, and the milliseconds of the streaming enumeration to its first and last transaction, for every number of threads.
+ */
++ (NSDictionary *)runWithRecordCount:(NSUInteger)count threadCounts:(NSArray<NSNumber *> *)threadCounts;
+
+@end
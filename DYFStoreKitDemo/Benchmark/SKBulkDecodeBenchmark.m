@@ -0,0 +1,102 @@
+//
+//  SKBulkDecodeBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKBulkDecodeBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreConverter.h"
+#import "DYFStoreBulkDecoder.h"
+#import "SKBenchmark.h"
+
+// The number of distinct users of the records.
+static const NSUInteger SKBulkDecodeBenchmarkUsers = 100;
+
+// The number of timed runs of every measurement.
+static const NSUInteger SKBulkDecodeBenchmarkRuns = 5;
+
+@implementation SKBulkDecodeBenchmark
+
+/** Measures one record format at every number of threads.
+ */
++ (NSArray *)measureRecords:(NSArray *)records decode:(DYFStoreBulkDecodeBlock)decode threadCounts:(NSArray<NSNumber *> *)threadCounts
+{
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:threadCounts.count];
+    double baseline = 0;
+    
+    for (NSNumber *threads in threadCounts) {
+        DYFStoreBulkDecoder *decoder = [[DYFStoreBulkDecoder alloc] init];
+        decoder.concurrency = threads.unsignedIntegerValue;
+        decoder.parallelThreshold = 0;
+        
+        uint64_t bulk[SKBulkDecodeBenchmarkRuns], first[SKBulkDecodeBenchmarkRuns], last[SKBulkDecodeBenchmarkRuns];
+        __block NSUInteger decoded = 0;
+        for (NSUInteger run = 0; run < SKBulkDecodeBenchmarkRuns; run++) {
+            @autoreleasepool {
+                uint64_t start = SKBenchmarkNow();
+                decoded = [decoder decodeRecords:records usingBlock:decode].count;
+                bulk[run] = SKBenchmarkNow() - start;
+            }
+            
+            @autoreleasepool {
+                __block uint64_t firstAt = 0;
+                uint64_t start = SKBenchmarkNow();
+                [decoder enumerateRecords:records decode:decode usingBlock:^(id object, BOOL *stop) {
+                    if (firstAt == 0) { firstAt = SKBenchmarkNow(); }
+                }];
+                last[run] = SKBenchmarkNow() - start;
+                first[run] = firstAt > 0 ? firstAt - start : 0;
+            }
+        }
+        
+        double bulkMs = SKBenchmarkPercentile(bulk, SKBulkDecodeBenchmarkRuns, 0.5) / 1e6;
+        if (baseline == 0) { baseline = bulkMs; }
+        [results addObject:@{@"threads": threads,
+                             @"decoded": @(decoded),
+                             @"bulk_ms": @(bulkMs),
+                             @"speedup": @(bulkMs > 0 ? baseline / bulkMs : 0),
+                             @"stream_first_ms": @(SKBenchmarkPercentile(first, SKBulkDecodeBenchmarkRuns, 0.5) / 1e6),
+                             @"stream_last_ms": @(SKBenchmarkPercentile(last, SKBulkDecodeBenchmarkRuns, 0.5) / 1e6)}];
+    }
+    
+    return results;
+}
+
++ (NSDictionary *)runWithRecordCount:(NSUInteger)count threadCounts:(NSArray<NSNumber *> *)threadCounts
+{
+    // A short receipt keeps 50,000 records at about 40 megabytes.
+    NSMutableData *receiptData = [NSMutableData dataWithLength:384];
+    arc4random_buf(receiptData.mutableBytes, receiptData.length);
+    NSString *receipt = receiptData.base64EncodedString;
+    
+    NSMutableArray *archived = [NSMutableArray arrayWithCapacity:count];
+    NSMutableArray *json = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        @autoreleasepool {
+            DYFStoreTransaction *transaction = SKBenchmarkTransaction(idx, SKBulkDecodeBenchmarkUsers, receipt);
+            [archived addObject:[DYFStoreConverter encodeObject:transaction]];
+            [json addObject:[DYFStoreConverter jsonWithObject:[transaction dictionaryRepresentation]]];
+        }
+    }
+    
+    NSArray *archiveResults = [self measureRecords:archived decode:^id (NSData *record) {
+        return [DYFStoreConverter decodeObject:record];
+    } threadCounts:threadCounts];
+    NSArray *jsonResults = [self measureRecords:json decode:^id (NSData *record) {
+        return [[DYFStoreTransaction alloc] initWithDictionary:[DYFStoreConverter jsonObjectWithData:record]];
+    } threadCounts:threadCounts];
+    
+    return @{@"records": @(count),
+             @"processors": @(NSProcessInfo.processInfo.activeProcessorCount),
+             @"archive": archiveResults,
+             @"json": jsonResults};
+}
+
++ (NSDictionary *)run
+{
+    return [self runWithRecordCount:50000 threadCounts:@[@1, @2, @4, @8, @16]];
+}
+
+@end
@@ -0,0 +1,28 @@
+//
+//  SKCatalogBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Measures the cost of applying products responses to the catalog as diffs, against rebuilding the display model of every product.
+ */
+@interface SKCatalogBenchmark : NSObject
+
+/** Runs the benchmark with a catalog of 10,000 products, of which 1% change between responses.
+ 
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)run;
+
+/** Runs the benchmark with a catalog of a number of products.
+ 
+ @param count The number of products.
+ @param churn The fraction of the products that are added, updated or removed between responses.
+ @return The median milliseconds of every case and the size of the changeset.
+ */
++ (NSDictionary *)runWithProductCount:(NSUInteger)count churn:(double)churn;
+
+@end
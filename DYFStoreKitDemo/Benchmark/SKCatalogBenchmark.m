@@ -0,0 +1,151 @@
+//
+//  SKCatalogBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKCatalogBenchmark.h"
+#import "DYFStore.h"
+#import "SKBenchmark.h"
+
+// The number of timed runs of every case.
+static const NSUInteger SKCatalogBenchmarkRuns = 21;
+
+/** A product that is not received from the App Store.
+ */
+@interface SKCatalogBenchmarkProduct : SKProduct
+@property (nonatomic, copy) NSString *benchmarkIdentifier;
+@property (nonatomic, strong) NSDecimalNumber *benchmarkPrice;
+@property (nonatomic, copy) NSString *benchmarkTitle;
+@end
+
+@implementation SKCatalogBenchmarkProduct
+
+- (NSString *)productIdentifier
+{
+    return self.benchmarkIdentifier;
+}
+
+- (NSDecimalNumber *)price
+{
+    return self.benchmarkPrice;
+}
+
+- (NSLocale *)priceLocale
+{
+    static NSLocale *locale;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        locale = [NSLocale localeWithLocaleIdentifier:@"en_US"];
+    });
+    return locale;
+}
+
+- (NSString *)localizedTitle
+{
+    return self.benchmarkTitle;
+}
+
+- (NSString *)localizedDescription
+{
+    return self.benchmarkTitle;
+}
+
+@end
+
+@implementation SKCatalogBenchmark
+
++ (SKProduct *)productAtIndex:(NSUInteger)index cents:(NSUInteger)cents
+{
+    SKCatalogBenchmarkProduct *product = [[SKCatalogBenchmarkProduct alloc] init];
+    product.benchmarkIdentifier = [NSString stringWithFormat:@"com.dyf.storekit.product.%lu", (unsigned long)index];
+    product.benchmarkPrice = [NSDecimalNumber decimalNumberWithMantissa:cents exponent:-2 isNegative:NO];
+    product.benchmarkTitle = [NSString stringWithFormat:@"Product %lu", (unsigned long)index];
+    return product;
+}
+
+/** Builds what a store screen displays of a product, the way the demo does.
+ */
++ (NSDictionary *)modelOfProduct:(SKProduct *)product
+{
+    return @{@"identifier": product.productIdentifier,
+             @"name": product.localizedTitle,
+             @"price": [DYFStore.defaultStore localizedPriceOfProduct:product] ?: @""};
+}
+
++ (NSDictionary *)runWithProductCount:(NSUInteger)count churn:(double)churn
+{
+    // The second response removes the first third of the churned products, updates the price of the second third, and adds the last third.
+    NSUInteger changed = MAX((NSUInteger)(count * churn), 3) / 3;
+    NSMutableArray *first = [NSMutableArray arrayWithCapacity:count];
+    NSMutableArray *firstAgain = [NSMutableArray arrayWithCapacity:count];
+    NSMutableArray *second = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        [first addObject:[self productAtIndex:idx cents:99 + idx % 10 * 100]];
+        [firstAgain addObject:[self productAtIndex:idx cents:99 + idx % 10 * 100]];
+        if (idx < changed) { continue; }
+        // Every response carries new product objects, even for the unchanged products.
+        [second addObject:idx < 2 * changed ? [self productAtIndex:idx cents:49] : [self productAtIndex:idx cents:99 + idx % 10 * 100]];
+    }
+    for (NSUInteger idx = count; idx < count + changed; idx++) {
+        [second addObject:[self productAtIndex:idx cents:199]];
+    }
+    NSArray *responses = @[first, second];
+    
+    // Alternates between the responses, so that every run applies the changes in one direction.
+    DYFStoreCatalog *catalog = [[DYFStoreCatalog alloc] init];
+    [catalog applyProducts:first invalidIdentifiers:nil requestedIdentifiers:nil];
+    __block DYFStoreCatalogChangeset *changeset = nil;
+    double diff = SKBenchmarkMedianMilliseconds(SKCatalogBenchmarkRuns, nil, ^(NSUInteger run) {
+        changeset = [catalog applyProducts:responses[(run + 1) % 2] invalidIdentifiers:nil requestedIdentifiers:nil];
+    });
+    NSUInteger added = changeset.addedProducts.count;
+    NSUInteger updated = changeset.updatedProducts.count;
+    NSUInteger removed = changeset.removedProductIdentifiers.count;
+    
+    // Equal products again, as when the store screen is reopened.
+    DYFStoreCatalog *unchangedCatalog = [[DYFStoreCatalog alloc] init];
+    [unchangedCatalog applyProducts:first invalidIdentifiers:nil requestedIdentifiers:nil];
+    double unchanged = SKBenchmarkMedianMilliseconds(SKCatalogBenchmarkRuns, nil, ^(NSUInteger run) {
+        [unchangedCatalog applyProducts:firstAgain invalidIdentifiers:nil requestedIdentifiers:nil];
+    });
+    
+    // Rebuilds the model of every product from every response.
+    double rebuild = SKBenchmarkMedianMilliseconds(SKCatalogBenchmarkRuns, nil, ^(NSUInteger run) {
+        NSMutableArray *models = [NSMutableArray arrayWithCapacity:count];
+        for (SKProduct *product in responses[(run + 1) % 2]) {
+            [models addObject:[self modelOfProduct:product]];
+        }
+    });
+    
+    // Applies the diff and rebuilds the models of the added and updated products only.
+    DYFStoreCatalog *incrementalCatalog = [[DYFStoreCatalog alloc] init];
+    NSMutableDictionary *models = [NSMutableDictionary dictionaryWithCapacity:count];
+    for (SKProduct *product in first) {
+        models[product.productIdentifier] = [self modelOfProduct:product];
+    }
+    [incrementalCatalog applyProducts:first invalidIdentifiers:nil requestedIdentifiers:nil];
+    double incremental = SKBenchmarkMedianMilliseconds(SKCatalogBenchmarkRuns, nil, ^(NSUInteger run) {
+        DYFStoreCatalogChangeset *changes = [incrementalCatalog applyProducts:responses[(run + 1) % 2] invalidIdentifiers:nil requestedIdentifiers:nil];
+        [models removeObjectsForKeys:changes.removedProductIdentifiers];
+        for (SKProduct *product in [changes.addedProducts arrayByAddingObjectsFromArray:changes.updatedProducts]) {
+            models[product.productIdentifier] = [self modelOfProduct:product];
+        }
+    });
+    
+    return @{@"diff_ms": @(diff),
+             @"unchanged_diff_ms": @(unchanged),
+             @"rebuild_models_ms": @(rebuild),
+             @"incremental_models_ms": @(incremental),
+             @"added": @(added),
+             @"updated": @(updated),
+             @"removed": @(removed)};
+}
+
++ (NSDictionary *)run
+{
+    return @{@"10000": [self runWithProductCount:10000 churn:0.01]};
+}
+
+@end
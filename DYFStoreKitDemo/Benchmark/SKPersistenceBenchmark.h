@@ -0,0 +1,27 @@
+//
+//  SKPersistenceBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Compares the transaction persisters head to head: the user defaults, the keychain when DYFKeychain is linked, and SQLite.
+ */
+@interface SKPersistenceBenchmark : NSObject
+
+/** Runs the benchmark with 100, 1,000 and 10,000 stored transactions. The keychain is measured up to 1,000.
+ 
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)run;
+
+/** Runs the benchmark with a number of stored transactions.
+ 
+ @param count The number of stored transactions.
+ @return The milliseconds of every operation for every persister, and of migrating the transactions from the user defaults to SQLite.
+ */
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count;
+
+@end
@@ -0,0 +1,152 @@
+//
+//  SKPersistenceBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKPersistenceBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreUserDefaultsPersistence.h"
+#import "DYFStoreKeychainPersistence.h"
+#import "DYFStoreSQLitePersistence.h"
+#import "SKBenchmark.h"
+
+// The number of single stores, lookups and removals timed on top of the stored transactions.
+static const NSUInteger SKPersistenceBenchmarkOperations = 100;
+
+// The number of distinct users of the transactions.
+static const NSUInteger SKPersistenceBenchmarkUsers = 100;
+
+@implementation SKPersistenceBenchmark
+
+/** Times a single run of a block.
+ */
++ (double)millisecondsOfBlock:(SKBenchmarkBlock)block
+{
+    return SKBenchmarkMedianMilliseconds(1, nil, ^(NSUInteger run) {
+        block();
+    });
+}
+
+/** Times the operations of a persister, starting from an empty store.
+ */
++ (NSDictionary *)measurePersister:(id<DYFStoreTransactionPersistence>)persister transactions:(NSArray<DYFStoreTransaction *> *)transactions receipt:(NSString *)receipt
+{
+    NSUInteger count = transactions.count;
+    NSUInteger operations = SKPersistenceBenchmarkOperations;
+    [persister removeTransactions];
+    
+    double batchStore = [self millisecondsOfBlock:^{
+        [persister storeTransactions:transactions];
+    }];
+    
+    // One by one on top of the stored transactions, as purchases are stored.
+    double singleStores = [self millisecondsOfBlock:^{
+        for (NSUInteger idx = 0; idx < operations; idx++) {
+            [persister storeTransaction:SKBenchmarkTransaction(count + idx, SKPersistenceBenchmarkUsers, receipt)];
+        }
+    }];
+    
+    __block NSUInteger found = 0;
+    double lookups = [self millisecondsOfBlock:^{
+        for (NSUInteger idx = 0; idx < operations; idx++) {
+            NSUInteger index = (NSUInteger)arc4random_uniform((uint32_t)count);
+            found += [persister retrieveTransaction:transactions[index].transactionIdentifier] ? 1 : 0;
+        }
+    }];
+    
+    __block NSUInteger retrieved = 0;
+    double retrieveAll = [self millisecondsOfBlock:^{
+        retrieved = [persister retrieveTransactions].count;
+    }];
+    
+    __block NSUInteger matches = 0;
+    double query = [self millisecondsOfBlock:^{
+        matches = [persister retrieveTransactionsMatchingQuery:[DYFStoreTransactionQuery queryWithUserIdentifier:@"user-42"]].count;
+    }];
+    
+    NSMutableArray *identifiers = [NSMutableArray arrayWithCapacity:operations];
+    for (NSUInteger idx = 0; idx < operations; idx++) {
+        [identifiers addObject:transactions[idx * count / operations].transactionIdentifier];
+    }
+    double removals = [self millisecondsOfBlock:^{
+        for (NSString *identifier in identifiers) {
+            [persister removeTransaction:identifier];
+        }
+    }];
+    
+    [persister removeTransactions];
+    
+    return @{@"batch_store_ms": @(batchStore),
+             @"single_stores_ms": @(singleStores),
+             @"lookups_ms": @(lookups),
+             @"retrieve_all_ms": @(retrieveAll),
+             @"query_by_user_ms": @(query),
+             @"single_removals_ms": @(removals),
+             @"found": @(found),
+             @"retrieved": @(retrieved),
+             @"matches": @(matches)};
+}
+
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count
+{
+    NSMutableData *receiptData = [NSMutableData dataWithLength:384];
+    arc4random_buf(receiptData.mutableBytes, receiptData.length);
+    NSString *receipt = receiptData.base64EncodedString;
+    
+    NSMutableArray<DYFStoreTransaction *> *transactions = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        [transactions addObject:SKBenchmarkTransaction(idx, SKPersistenceBenchmarkUsers, receipt)];
+    }
+    
+    NSURL *databaseURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"SKPersistenceBenchmark.sqlite"]];
+    DYFStoreSQLitePersistence *sqlite = [[DYFStoreSQLitePersistence alloc] initWithDatabaseURL:databaseURL];
+    DYFStoreUserDefaultsPersistence *userDefaults = [[DYFStoreUserDefaultsPersistence alloc] init];
+    
+    NSMutableDictionary *report = [NSMutableDictionary dictionary];
+    report[@"user_defaults"] = [self measurePersister:userDefaults transactions:transactions receipt:receipt];
+#if __has_include(<DYFKeychain/DYFKeychain.h>)
+    if (count <= 1000) {
+        report[@"keychain"] = [self measurePersister:[[DYFStoreKeychainPersistence alloc] init] transactions:transactions receipt:receipt];
+    }
+#endif
+    report[@"sqlite"] = [self measurePersister:sqlite transactions:transactions receipt:receipt];
+    
+    [userDefaults storeTransactions:transactions];
+    __block NSInteger migrated = 0;
+    double migration = [self millisecondsOfBlock:^{
+        migrated = [sqlite migrateTransactionsFromPersister:userDefaults];
+    }];
+    report[@"migration_from_user_defaults"] = @{@"ms": @(migration), @"migrated": @(migrated)};
+    [sqlite removeTransactions];
+    
+    return report;
+}
+
++ (NSDictionary *)run
+{
+    // The user defaults and the keychain are shared with the app. Saves and restores their transactions around the run.
+    DYFStoreUserDefaultsPersistence *userDefaults = [[DYFStoreUserDefaultsPersistence alloc] init];
+    NSArray *savedTransactions = [userDefaults retrieveTransactions];
+#if __has_include(<DYFKeychain/DYFKeychain.h>)
+    DYFStoreKeychainPersistence *keychain = [[DYFStoreKeychainPersistence alloc] init];
+    NSArray *savedKeychainTransactions = [keychain retrieveTransactions];
+#endif
+    
+    NSMutableDictionary *report = [NSMutableDictionary dictionary];
+    for (NSNumber *count in @[@100, @1000, @10000]) {
+        report[count.stringValue] = [self runWithTransactionCount:count.unsignedIntegerValue];
+    }
+    
+    [userDefaults removeTransactions];
+    !savedTransactions ?: [userDefaults storeTransactions:savedTransactions];
+#if __has_include(<DYFKeychain/DYFKeychain.h>)
+    [keychain removeTransactions];
+    !savedKeychainTransactions ?: [keychain storeTransactions:savedKeychainTransactions];
+#endif
+    
+    return report;
+}
+
+@end
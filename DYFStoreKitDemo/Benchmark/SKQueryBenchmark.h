@@ -0,0 +1,27 @@
+//
+//  SKQueryBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Measures the latency of queries over the persisted transactions through the secondary indexes, against decoding every record and filtering them.
+ */
+@interface SKQueryBenchmark : NSObject
+
+/** Runs the benchmark with 100,000 persisted transactions.
+ 
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)run;
+
+/** Runs the benchmark with a number of persisted transactions.
+ 
+ @param count The number of persisted transactions.
+ @return The milliseconds of building the index, and the median milliseconds and the number of results of every query.
+ */
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count;
+
+@end
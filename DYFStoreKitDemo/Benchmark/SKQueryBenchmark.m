@@ -0,0 +1,118 @@
+//
+//  SKQueryBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKQueryBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreConverter.h"
+#import "DYFStoreUserDefaultsPersistence.h"
+#import "SKBenchmark.h"
+
+// The number of timed runs of every indexed query.
+static const NSUInteger SKQueryBenchmarkRuns = 51;
+
+// The number of timed runs of the full decode, which takes seconds at 100,000 records.
+static const NSUInteger SKQueryBenchmarkScanRuns = 3;
+
+// The number of distinct users of the records.
+static const NSUInteger SKQueryBenchmarkUsers = 1000;
+
+@implementation SKQueryBenchmark
+
+/** Times a query through the indexes and, for reference, the same query by decoding and filtering every record.
+ */
++ (NSDictionary *)measureQuery:(DYFStoreTransactionQuery *)query persister:(DYFStoreUserDefaultsPersistence *)persister
+{
+    __block NSUInteger indexedResults = 0;
+    double indexed = SKBenchmarkMedianMilliseconds(SKQueryBenchmarkRuns, nil, ^(NSUInteger run) {
+        indexedResults = [persister retrieveTransactionsMatchingQuery:query].count;
+    });
+    
+    __block NSUInteger scanResults = 0;
+    double scan = SKBenchmarkMedianMilliseconds(SKQueryBenchmarkScanRuns, nil, ^(NSUInteger run) {
+        NSMutableArray *matches = [NSMutableArray array];
+        for (DYFStoreTransaction *transaction in [persister retrieveTransactions]) {
+            double time = transaction.transactionTimestamp.doubleValue;
+            if ((query.userIdentifier && ![transaction.userIdentifier isEqualToString:query.userIdentifier]) ||
+                (query.productIdentifier && ![transaction.productIdentifier isEqualToString:query.productIdentifier]) ||
+                (query.state && transaction.state != query.state.unsignedIntegerValue) ||
+                (query.sinceTimestamp && time < query.sinceTimestamp.doubleValue) ||
+                (query.beforeTimestamp && time >= query.beforeTimestamp.doubleValue)) {
+                continue;
+            }
+            [matches addObject:transaction];
+            if (query.limit > 0 && matches.count == query.limit) { break; }
+        }
+        scanResults = matches.count;
+    });
+    
+    return @{@"indexed_ms": @(indexed),
+             @"scan_ms": @(scan),
+             @"results": @(indexedResults),
+             @"scan_results": @(scanResults)};
+}
+
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count
+{
+    DYFStoreUserDefaultsPersistence *persister = [[DYFStoreUserDefaultsPersistence alloc] init];
+    
+    NSMutableData *receiptData = [NSMutableData dataWithLength:384];
+    arc4random_buf(receiptData.mutableBytes, receiptData.length);
+    NSString *receipt = receiptData.base64EncodedString;
+    
+    // The records are written at once rather than stored one by one, then the index is built from them.
+    NSMutableArray *records = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        [records addObject:[DYFStoreConverter encodeObject:SKBenchmarkTransaction(idx, SKQueryBenchmarkUsers, receipt)]];
+    }
+    [NSUserDefaults.standardUserDefaults setObject:records forKey:DYFStoreTransactionsKey];
+    [NSUserDefaults.standardUserDefaults removeObjectForKey:DYFStoreTransactionHeadersKey];
+    [persister retrieveTransactionHeaders];
+    [NSUserDefaults.standardUserDefaults synchronize];
+    records = nil;
+    
+    // Loading the index from the stored header index, as at launch.
+    [DYFStoreUserDefaultsPersistence discardIndex];
+    uint64_t start = SKBenchmarkNow();
+    [persister retrieveTransactionHeaders];
+    double load = (SKBenchmarkNow() - start) / 1e6;
+    
+    DYFStoreTransactionQuery *byUser = [DYFStoreTransactionQuery queryWithUserIdentifier:@"user-42"];
+    
+    DYFStoreTransactionQuery *byProductAndState = [[DYFStoreTransactionQuery alloc] init];
+    byProductAndState.productIdentifier = @"com.dyf.storekit.product.5";
+    byProductAndState.state = @(DYFStoreTransactionStateRestored);
+    
+    DYFStoreTransactionQuery *byRecentTime = [[DYFStoreTransactionQuery alloc] init];
+    byRecentTime.sinceTimestamp = [NSString stringWithFormat:@"%lu", (unsigned long)(SKBenchmarkEpoch + count - count / 100)];
+    byRecentTime.limit = 50;
+    
+    return @{@"index_load_ms": @(load),
+             @"user": [self measureQuery:byUser persister:persister],
+             @"product_and_state": [self measureQuery:byProductAndState persister:persister],
+             @"recent_time_range_limit_50": [self measureQuery:byRecentTime persister:persister]};
+}
+
++ (NSDictionary *)run
+{
+    // The persister shares its storage with the app. Saves and restores it around the run.
+    NSUserDefaults *userDefaults = NSUserDefaults.standardUserDefaults;
+    id savedRecords = [userDefaults objectForKey:DYFStoreTransactionsKey];
+    id savedHeaders = [userDefaults objectForKey:DYFStoreTransactionHeadersKey];
+    
+    NSDictionary *report = @{@"100000": [self runWithTransactionCount:100000]};
+    
+    [userDefaults removeObjectForKey:DYFStoreTransactionsKey];
+    [userDefaults removeObjectForKey:DYFStoreTransactionHeadersKey];
+    !savedRecords ?: [userDefaults setObject:savedRecords forKey:DYFStoreTransactionsKey];
+    !savedHeaders ?: [userDefaults setObject:savedHeaders forKey:DYFStoreTransactionHeadersKey];
+    [userDefaults synchronize];
+    [DYFStoreUserDefaultsPersistence discardIndex];
+    
+    return report;
+}
+
+@end
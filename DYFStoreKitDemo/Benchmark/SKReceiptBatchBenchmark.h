@@ -0,0 +1,28 @@
+//
+//  SKReceiptBatchBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Measures the throughput of the batch receipt validator over synthetic receipts, at increasing numbers of workers.
+ */
+@interface SKReceiptBatchBenchmark : NSObject
+
+/** Runs the benchmark with 20,000 receipts of 8 purchases each.
+ 
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)run;
+
+/** Runs the benchmark.
+ 
+ @param receiptCount The number of receipts.
+ @param purchaseCount The number of in-app purchases of every receipt.
+ @return The receipts per second and the speedup over one worker of every concurrency, and the receipts per second of writing the records at full concurrency.
+ */
++ (NSDictionary *)runWithReceiptCount:(NSUInteger)receiptCount purchaseCount:(NSUInteger)purchaseCount;
+
+@end
@@ -0,0 +1,183 @@
+//
+//  SKReceiptBatchBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKReceiptBatchBenchmark.h"
+#import "DYFStoreReceiptBatchValidator.h"
+
+// The size of the stand-in for the certificates and the signature, which real receipts carry too.
+static const NSUInteger SKReceiptBatchBenchmarkSignatureLength = 3072;
+
+static NSString *const SKReceiptBatchBenchmarkBundleIdentifier = @"com.dyf.storekit.demo";
+
+@implementation SKReceiptBatchBenchmark
+
+#pragma mark - Synthetic Receipts
+
+/** Encodes a DER element.
+ */
+static NSData *SKDER(uint8_t tag, NSData *contents)
+{
+    NSMutableData *data = [NSMutableData dataWithBytes:&tag length:1];
+    NSUInteger length = contents.length;
+    if (length < 0x80) {
+        uint8_t l = (uint8_t)length;
+        [data appendBytes:&l length:1];
+    } else {
+        uint8_t bytes[5];
+        int count = 0;
+        for (NSUInteger rest = length; rest > 0; rest >>= 8) { count++; }
+        bytes[0] = 0x80 | count;
+        for (int idx = 0; idx < count; idx++) {
+            bytes[1 + idx] = (length >> (8 * (count - 1 - idx))) & 0xff;
+        }
+        [data appendBytes:bytes length:1 + count];
+    }
+    [data appendData:contents];
+    return data;
+}
+
+static NSData *SKDERInteger(int64_t value)
+{
+    uint8_t bytes[9];
+    int count = 0;
+    // The minimal two's complement.
+    do {
+        bytes[8 - count++] = value & 0xff;
+        value >>= 8;
+    } while (!((value == 0 && !(bytes[9 - count] & 0x80)) || (value == -1 && (bytes[9 - count] & 0x80))));
+    return SKDER(0x02, [NSData dataWithBytes:bytes + 9 - count length:count]);
+}
+
+static NSData *SKDERString(uint8_t tag, NSString *string)
+{
+    return SKDER(tag, [string dataUsingEncoding:NSUTF8StringEncoding]);
+}
+
+static NSData *SKDERConcat(NSArray<NSData *> *elements)
+{
+    NSMutableData *data = [NSMutableData data];
+    for (NSData *element in elements) {
+        [data appendData:element];
+    }
+    return data;
+}
+
+static NSData *SKReceiptAttribute(int64_t type, NSData *value)
+{
+    return SKDER(0x30, SKDERConcat(@[SKDERInteger(type), SKDERInteger(1), SKDER(0x04, value)]));
+}
+
+static NSString *SKReceiptDate(NSTimeInterval time)
+{
+    static NSDateFormatter *formatter;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        formatter = [[NSDateFormatter alloc] init];
+        formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        formatter.timeZone = [NSTimeZone timeZoneWithAbbreviation:@"UTC"];
+        formatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss'Z'";
+    });
+    return [formatter stringFromDate:[NSDate dateWithTimeIntervalSince1970:time]];
+}
+
++ (NSData *)receiptAtIndex:(NSUInteger)index purchaseCount:(NSUInteger)purchaseCount signature:(NSData *)signature
+{
+    NSMutableArray *attributes = [NSMutableArray arrayWithCapacity:purchaseCount + 2];
+    [attributes addObject:SKReceiptAttribute(2, SKDERString(0x0c, SKReceiptBatchBenchmarkBundleIdentifier))];
+    [attributes addObject:SKReceiptAttribute(3, SKDERString(0x0c, @"1.0"))];
+    
+    for (NSUInteger purchase = 0; purchase < purchaseCount; purchase++) {
+        NSUInteger serial = index * purchaseCount + purchase;
+        NSTimeInterval time = 1415059200 + serial * 60;
+        NSString *transactionIdentifier = [NSString stringWithFormat:@"1000000%09lu", (unsigned long)serial];
+        NSData *inApp = SKDER(0x31, SKDERConcat(@[
+            SKReceiptAttribute(1701, SKDERInteger(1)),
+            SKReceiptAttribute(1702, SKDERString(0x0c, [NSString stringWithFormat:@"com.dyf.storekit.product.%lu", (unsigned long)(purchase % 20)])),
+            SKReceiptAttribute(1703, SKDERString(0x0c, transactionIdentifier)),
+            SKReceiptAttribute(1704, SKDERString(0x16, SKReceiptDate(time))),
+            SKReceiptAttribute(1705, SKDERString(0x0c, transactionIdentifier)),
+            SKReceiptAttribute(1706, SKDERString(0x16, SKReceiptDate(time))),
+            SKReceiptAttribute(1708, SKDERString(0x16, SKReceiptDate(time + 30 * 24 * 3600)))
+        ]));
+        [attributes addObject:SKReceiptAttribute(17, inApp)];
+    }
+    
+    static const uint8_t signedDataOID[] = {0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x07, 0x02};
+    static const uint8_t dataOID[] = {0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x07, 0x01};
+    NSData *payload = SKDER(0x31, SKDERConcat(attributes));
+    NSData *encapsulated = SKDER(0x30, SKDERConcat(@[SKDER(0x06, [NSData dataWithBytes:dataOID length:sizeof(dataOID)]),
+                                                     SKDER(0xa0, SKDER(0x04, payload))]));
+    NSData *signedData = SKDER(0x30, SKDERConcat(@[SKDERInteger(1), SKDER(0x31, [NSData data]), encapsulated, SKDER(0x31, SKDER(0x04, signature))]));
+    return SKDER(0x30, SKDERConcat(@[SKDER(0x06, [NSData dataWithBytes:signedDataOID length:sizeof(signedDataOID)]), SKDER(0xa0, signedData)]));
+}
+
+#pragma mark - Running
+
++ (NSDictionary *)runWithReceiptCount:(NSUInteger)receiptCount purchaseCount:(NSUInteger)purchaseCount
+{
+    NSMutableData *signature = [NSMutableData dataWithLength:SKReceiptBatchBenchmarkSignatureLength];
+    arc4random_buf(signature.mutableBytes, signature.length);
+    
+    // Writes the receipts as newline-delimited base64, as a server would receive them.
+    NSString *inputPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"SKReceiptBatchBenchmark.txt"];
+    NSString *outputPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"SKReceiptBatchBenchmark.jsonl"];
+    NSMutableData *lines = [NSMutableData data];
+    for (NSUInteger idx = 0; idx < receiptCount; idx++) {
+        @autoreleasepool {
+            NSData *receipt = [self receiptAtIndex:idx purchaseCount:purchaseCount signature:signature];
+            [lines appendData:[receipt base64EncodedDataWithOptions:0]];
+            [lines appendBytes:"\n" length:1];
+        }
+    }
+    [lines writeToFile:inputPath atomically:YES];
+    lines = nil;
+    
+    NSUInteger processors = NSProcessInfo.processInfo.activeProcessorCount;
+    NSMutableArray<NSNumber *> *concurrencies = [NSMutableArray array];
+    for (NSUInteger concurrency = 1; concurrency < processors; concurrency *= 2) {
+        [concurrencies addObject:@(concurrency)];
+    }
+    [concurrencies addObject:@(processors)];
+    
+    DYFStoreReceiptBatchValidator *validator = [[DYFStoreReceiptBatchValidator alloc] init];
+    validator.bundleIdentifier = SKReceiptBatchBenchmarkBundleIdentifier;
+    
+    // Warms up the file cache and the code.
+    [validator validateLinesOfFileAtPath:inputPath handler:nil error:nil];
+    
+    NSMutableDictionary *decode = [NSMutableDictionary dictionary];
+    double single = 0;
+    for (NSNumber *concurrency in concurrencies) {
+        validator.concurrency = concurrency.unsignedIntegerValue;
+        DYFStoreReceiptBatchSummary *summary = [validator validateLinesOfFileAtPath:inputPath handler:nil error:nil];
+        double throughput = summary.receiptCount / summary.duration;
+        single = single > 0 ? single : throughput;
+        decode[concurrency.stringValue] = @{@"receipts_per_s": @(throughput),
+                                            @"speedup": @(throughput / single),
+                                            @"failures": @(summary.failureCount)};
+    }
+    
+    validator.concurrency = processors;
+    DYFStoreReceiptBatchSummary *written = [validator writeRecordsForLinesOfFileAtPath:inputPath toPath:outputPath error:nil];
+    NSDictionary *attributes = [NSFileManager.defaultManager attributesOfItemAtPath:outputPath error:nil];
+    
+    [NSFileManager.defaultManager removeItemAtPath:inputPath error:nil];
+    [NSFileManager.defaultManager removeItemAtPath:outputPath error:nil];
+    
+    return @{@"processors": @(processors),
+             @"decode": decode,
+             @"write_records": @{@"receipts_per_s": @(written.receiptCount / written.duration),
+                                 @"transactions": @(written.transactionCount),
+                                 @"output_bytes": @(attributes.fileSize)}};
+}
+
++ (NSDictionary *)run
+{
+    return [self runWithReceiptCount:20000 purchaseCount:8];
+}
+
+@end
@@ -0,0 +1,27 @@
+//
+//  SKReceiptHandleBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Measures the copies, the peak memory and the time of taking a receipt from its file to the verifier, through a `DYFStoreReceiptHandle` against reading and converting it at every stage.
+ */
+@interface SKReceiptHandleBenchmark : NSObject
+
+/** Runs the benchmark with receipts of 64 KB, 1 MB and 8 MB.
+ 
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)run;
+
+/** Runs the benchmark with a receipt of a given size.
+ 
+ @param length The size of the receipt in bytes.
+ @return The copies, the bytes copied, the peak memory growth and the median milliseconds of both paths.
+ */
++ (NSDictionary *)runWithReceiptLength:(NSUInteger)length;
+
+@end
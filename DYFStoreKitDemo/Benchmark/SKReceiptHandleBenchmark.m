@@ -0,0 +1,136 @@
+//
+//  SKReceiptHandleBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKReceiptHandleBenchmark.h"
+#import <mach/mach.h>
+#import "DYFStore.h"
+#import "SKBenchmark.h"
+
+// The number of timed runs of every path.
+static const NSUInteger SKReceiptHandleBenchmarkRuns = 11;
+
+/** Returns the physical footprint of the process in bytes, which leaves out the clean pages of mapped files.
+ */
+static uint64_t SKReceiptHandleBenchmarkFootprint(void)
+{
+    task_vm_info_data_t info;
+    mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+    if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.phys_footprint;
+}
+
+/** Tracks the largest footprint growth of a path.
+ */
+typedef struct {
+    uint64_t base;
+    uint64_t peak;
+} SKReceiptHandleBenchmarkMemory;
+
+static inline void SKReceiptHandleBenchmarkSample(SKReceiptHandleBenchmarkMemory *memory)
+{
+    uint64_t footprint = SKReceiptHandleBenchmarkFootprint();
+    memory->peak = MAX(memory->peak, footprint > memory->base ? footprint - memory->base : 0);
+}
+
+@implementation SKReceiptHandleBenchmark
+
++ (NSUInteger)receiptCopies
+{
+    return [[DYFStoreMetrics snapshot][@"counters"][@"receiptCopies"] unsignedIntegerValue];
+}
+
+/** Takes the receipt the way it was taken before the handle: read at the purchase, encoded for the persister, decoded for the log, and decoded again for the verifier.
+ */
++ (NSDictionary *)measureReadingFileAtPath:(NSString *)path
+{
+    uint64_t samples[SKReceiptHandleBenchmarkRuns];
+    SKReceiptHandleBenchmarkMemory memory = {0, 0};
+    NSUInteger bytesCopied = 0;
+    
+    for (NSUInteger run = 0; run < SKReceiptHandleBenchmarkRuns; run++) {
+        @autoreleasepool {
+            memory.base = SKReceiptHandleBenchmarkFootprint();
+            uint64_t start = SKBenchmarkNow();
+            
+            NSData *data = [NSData dataWithContentsOfFile:path];
+            SKReceiptHandleBenchmarkSample(&memory);
+            NSString *receipt = [data base64EncodedStringWithOptions:kNilOptions];
+            SKReceiptHandleBenchmarkSample(&memory);
+            NSData *logged = [[NSData alloc] initWithBase64EncodedString:receipt options:kNilOptions];
+            SKReceiptHandleBenchmarkSample(&memory);
+            NSData *sent = [[NSData alloc] initWithBase64EncodedString:receipt options:kNilOptions];
+            SKReceiptHandleBenchmarkSample(&memory);
+            
+            samples[run] = SKBenchmarkNow() - start;
+            bytesCopied = data.length + receipt.length + logged.length + sent.length;
+        }
+    }
+    
+    return @{@"copies": @4,
+             @"bytes_copied": @(bytesCopied),
+             @"peak_memory_bytes": @(memory.peak),
+             @"median_ms": @(SKBenchmarkPercentile(samples, SKReceiptHandleBenchmarkRuns, 0.5) / 1e6)};
+}
+
+/** Takes the receipt through a handle: mapped, encoded once for the persister, and found again by its encoding for the verifier.
+ */
++ (NSDictionary *)measureHandleOfFileAtPath:(NSString *)path
+{
+    uint64_t samples[SKReceiptHandleBenchmarkRuns];
+    SKReceiptHandleBenchmarkMemory memory = {0, 0};
+    NSUInteger copies = 0;
+    NSUInteger bytesCopied = 0;
+    
+    for (NSUInteger run = 0; run < SKReceiptHandleBenchmarkRuns; run++) {
+        @autoreleasepool {
+            NSUInteger startCopies = [self receiptCopies];
+            memory.base = SKReceiptHandleBenchmarkFootprint();
+            uint64_t start = SKBenchmarkNow();
+            
+            DYFStoreReceiptHandle *handle = [DYFStoreReceiptHandle handleWithContentsOfFile:path];
+            SKReceiptHandleBenchmarkSample(&memory);
+            NSString *receipt = handle.base64EncodedString;
+            SKReceiptHandleBenchmarkSample(&memory);
+            NSData *sent = [DYFStoreReceiptHandle handleWithBase64EncodedString:receipt].data;
+            SKReceiptHandleBenchmarkSample(&memory);
+            
+            samples[run] = SKBenchmarkNow() - start;
+            copies = [self receiptCopies] - startCopies;
+            bytesCopied = receipt.length + (sent == handle.data ? 0 : sent.length);
+        }
+    }
+    
+    return @{@"copies": @(copies),
+             @"bytes_copied": @(bytesCopied),
+             @"peak_memory_bytes": @(memory.peak),
+             @"median_ms": @(SKBenchmarkPercentile(samples, SKReceiptHandleBenchmarkRuns, 0.5) / 1e6)};
+}
+
++ (NSDictionary *)runWithReceiptLength:(NSUInteger)length
+{
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    arc4random_buf(data.mutableBytes, length);
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"SKReceiptHandleBenchmark-%lu", (unsigned long)length]];
+    [data writeToFile:path atomically:YES];
+    data = nil;
+    
+    NSDictionary *report = @{@"read": [self measureReadingFileAtPath:path],
+                             @"handle": [self measureHandleOfFileAtPath:path]};
+    [NSFileManager.defaultManager removeItemAtPath:path error:nil];
+    return report;
+}
+
++ (NSDictionary *)run
+{
+    return @{@"65536": [self runWithReceiptLength:64 * 1024],
+             @"1048576": [self runWithReceiptLength:1024 * 1024],
+             @"8388608": [self runWithReceiptLength:8 * 1024 * 1024]};
+}
+
+@end
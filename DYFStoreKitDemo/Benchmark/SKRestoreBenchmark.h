@@ -0,0 +1,27 @@
+//
+//  SKRestoreBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Restores the purchases of the simulated payment backend and processes them, one notification, persistence write and finish per transaction as before, and together once the restore session completes.
+ */
+@interface SKRestoreBenchmark : NSObject
+
+/** Runs the benchmark with 500 restored transactions.
+ 
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)run;
+
+/** Runs the benchmark with a number of restored transactions.
+ 
+ @param count The number of purchases to restore.
+ @return The median milliseconds from the restore request to the last transaction finished, the notifications posted and the persistence writes, per transaction and aggregated.
+ */
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count;
+
+@end
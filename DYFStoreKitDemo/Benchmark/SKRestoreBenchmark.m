@@ -0,0 +1,158 @@
+//
+//  SKRestoreBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKRestoreBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreSimulatedPaymentBackend.h"
+#import "DYFStoreUserDefaultsPersistence.h"
+#import "SKBenchmark.h"
+
+// The number of timed runs of every measurement.
+static const NSUInteger SKRestoreBenchmarkRuns = 5;
+
+@implementation SKRestoreBenchmark
+
++ (DYFStoreTransaction *)transactionWithInfo:(DYFStoreNotificationInfo *)info
+{
+    DYFStoreTransaction *transaction = [[DYFStoreTransaction alloc] init];
+    transaction.state = DYFStoreTransactionStateRestored;
+    transaction.productIdentifier = info.productIdentifier;
+    transaction.userIdentifier = info.userIdentifier;
+    transaction.transactionIdentifier = info.transactionIdentifier;
+    transaction.transactionTimestamp = info.transactionDate.timestamp;
+    transaction.originalTransactionTimestamp = info.originalTransactionDate.timestamp;
+    transaction.originalTransactionIdentifier = info.originalTransactionIdentifier;
+    return transaction;
+}
+
+/** Restores the purchases once and processes them.
+ 
+ @param aggregated Whether the transactions are processed together when the session completes.
+ @return The milliseconds, the notifications and the persistence writes of the run.
+ */
++ (NSDictionary *)restoreOnceWithStore:(DYFStore *)store aggregated:(BOOL)aggregated
+{
+    DYFStoreUserDefaultsPersistence *persister = [[DYFStoreUserDefaultsPersistence alloc] init];
+    [persister removeTransactions];
+    store.aggregatesRestoredTransactions = aggregated;
+    
+    __block NSUInteger notifications = 0;
+    __block NSUInteger writes = 0;
+    __block uint64_t start = 0;
+    __block uint64_t elapsed = 0;
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    
+    // As the sample did before: every notification stores its transaction and finishes it.
+    id purchased = [NSNotificationCenter.defaultCenter addObserverForName:DYFStorePurchasedNotification object:nil queue:nil usingBlock:^(NSNotification *note) {
+        DYFStoreNotificationInfo *info = note.object;
+        if (info.state != DYFStorePurchaseStateRestored) { return; }
+        notifications++;
+        
+        if (![persister containsTransaction:info.transactionIdentifier]) {
+            [persister storeTransaction:[self transactionWithInfo:info]];
+            writes++;
+        }
+        [store finishTransaction:[store extractRestoredTransaction:info.transactionIdentifier]];
+    }];
+    
+    id completed = [NSNotificationCenter.defaultCenter addObserverForName:DYFStoreRestoreCompletedNotification object:nil queue:nil usingBlock:^(NSNotification *note) {
+        DYFStoreRestoreSession *session = note.object;
+        notifications++;
+        
+        if (aggregated) {
+            NSMutableArray *transactions = [NSMutableArray arrayWithCapacity:session.infos.count];
+            NSMutableArray *identifiers = [NSMutableArray arrayWithCapacity:session.infos.count];
+            for (DYFStoreNotificationInfo *info in session.infos) {
+                [transactions addObject:[self transactionWithInfo:info]];
+                !info.transactionIdentifier ?: [identifiers addObject:info.transactionIdentifier];
+            }
+            [persister storeTransactions:transactions];
+            writes++;
+            [store finishTransactionsWithIdentifiers:identifiers];
+        }
+        
+        elapsed = SKBenchmarkNow() - start;
+        dispatch_semaphore_signal(done);
+    }];
+    
+    dispatch_async(dispatch_get_main_queue(), ^{
+        start = SKBenchmarkNow();
+        [store restoreTransactions];
+    });
+    dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 60 * NSEC_PER_SEC));
+    
+    [NSNotificationCenter.defaultCenter removeObserver:purchased];
+    [NSNotificationCenter.defaultCenter removeObserver:completed];
+    dispatch_sync(dispatch_get_main_queue(), ^{
+        [store.restoredTranscations removeAllObjects];
+    });
+    [persister removeTransactions];
+    
+    return @{@"ms": @(elapsed / 1e6), @"notifications": @(notifications), @"writes": @(writes)};
+}
+
++ (NSDictionary *)measureWithStore:(DYFStore *)store aggregated:(BOOL)aggregated
+{
+    uint64_t samples[SKRestoreBenchmarkRuns];
+    NSDictionary *run = nil;
+    for (NSUInteger idx = 0; idx < SKRestoreBenchmarkRuns; idx++) {
+        @autoreleasepool {
+            run = [self restoreOnceWithStore:store aggregated:aggregated];
+            samples[idx] = (uint64_t)([run[@"ms"] doubleValue] * 1e6);
+        }
+    }
+    
+    return @{@"median_ms": @(SKBenchmarkPercentile(samples, SKRestoreBenchmarkRuns, 0.5) / 1e6),
+             @"notifications": run[@"notifications"],
+             @"persistence_writes": run[@"writes"]};
+}
+
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count
+{
+    DYFStore *store = DYFStore.defaultStore;
+    id<DYFStorePaymentBackend> previousBackend = store.paymentBackend;
+    BOOL previousAggregates = store.aggregatesRestoredTransactions;
+    
+    // The purchases are delivered before the store observes the backend, so that only the restores reach it.
+    DYFStoreSimulatedPaymentBackend *backend = [[DYFStoreSimulatedPaymentBackend alloc] init];
+    backend.seed = 47;
+    backend.batchSize = 32;
+    NSMutableArray *steps = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        NSString *productId = [NSString stringWithFormat:@"com.dyf.storekit.product.%lu", (unsigned long)idx];
+        [steps addObject:[DYFStoreSimulatedStep stepWithOutcome:DYFStoreSimulatedOutcomePurchase productIdentifier:productId]];
+    }
+    NSArray<SKPaymentTransaction *> *purchases = [backend transactionsForSteps:steps];
+    [backend deliverTransactions:purchases];
+    for (SKPaymentTransaction *transaction in purchases) {
+        [backend finishTransaction:transaction];
+    }
+    
+    store.paymentBackend = backend;
+    [store addPaymentTransactionObserver];
+    
+    NSUInteger finishedBefore = backend.finishedTransactionCount;
+    NSDictionary *perTransaction = [self measureWithStore:store aggregated:NO];
+    NSDictionary *aggregated = [self measureWithStore:store aggregated:YES];
+    NSUInteger finished = backend.finishedTransactionCount - finishedBefore;
+    
+    [store removePaymentTransactionObserver];
+    store.paymentBackend = previousBackend;
+    store.aggregatesRestoredTransactions = previousAggregates;
+    
+    return @{@"transactions": @(count),
+             @"finished": @(finished),
+             @"per_transaction": perTransaction,
+             @"aggregated": aggregated};
+}
+
++ (NSDictionary *)run
+{
+    return [self runWithTransactionCount:500];
+}
+
+@end
@@ -0,0 +1,28 @@
+//
+//  SKRetryBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Checks the retry scheduler on a simulated clock against a verifier whose network fails: the backoff of every attempt, giving up after the last one, not retrying the exhausted transactions when the network comes back, and retrying them on `retryNow`.
+ */
+@interface SKRetryBenchmark : NSObject
+
+/** Runs the check with 8 transactions and 6 attempts.
+ 
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)run;
+
+/** Runs the check.
+ 
+ @param count The number of pending transactions.
+ @param maxAttempts The number of attempts after which the scheduler gives up.
+ @return Whether the check passed, the descriptions of its failures, the number of requests and the simulated seconds it took.
+ */
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count maxAttempts:(NSUInteger)maxAttempts;
+
+@end
@@ -0,0 +1,194 @@
+//
+//  SKRetryBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKRetryBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreSQLitePersistence.h"
+#import "DYFStoreSimulatedReceiptVerifier.h"
+#import "DYFStoreRetryScheduler.h"
+
+// How long a pass may take on the real clock before the check fails.
+static const NSTimeInterval SKRetryPassTimeout = 5;
+
+@interface SKRetryBenchmark () <DYFStoreVerificationCoordinatorDelegate, DYFStoreRetrySchedulerDelegate>
+@property (nonatomic, strong) dispatch_semaphore_t passFinished;
+@property (nonatomic, strong) dispatch_semaphore_t gaveUp;
+@property (nonatomic, strong) DYFStoreVerificationResult *result;
+@property (nonatomic, copy) NSArray<NSString *> *exhausted;
+@end
+
+@implementation SKRetryBenchmark
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _passFinished = dispatch_semaphore_create(0);
+        _gaveUp = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
++ (NSArray<DYFStoreTransaction *> *)transactionsWithCount:(NSUInteger)count
+{
+    NSMutableArray *transactions = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        DYFStoreTransaction *transaction = [[DYFStoreTransaction alloc] init];
+        transaction.state = DYFStoreTransactionStatePurchased;
+        transaction.productIdentifier = @"com.dyf.storekit.gold";
+        transaction.userIdentifier = @"user-34";
+        transaction.transactionIdentifier = [NSString stringWithFormat:@"%lu", (unsigned long)(300000 + idx)];
+        transaction.originalTransactionIdentifier = transaction.transactionIdentifier;
+        transaction.transactionTimestamp = [NSString stringWithFormat:@"%lu", (unsigned long)(1600000000 + idx)];
+        [transactions addObject:transaction];
+    }
+    
+    NSString *receipt = [DYFStoreSimulatedReceiptVerifier receiptDataWithTransactions:transactions].base64EncodedString;
+    for (DYFStoreTransaction *transaction in transactions) {
+        transaction.transactionReceipt = receipt;
+    }
+    return transactions;
+}
+
+/** Waits for the coordinator to finish a pass, and returns its result, or nil if no pass finished in time.
+ */
+- (DYFStoreVerificationResult *)waitForPassWithTimeout:(NSTimeInterval)timeout
+{
+    if (dispatch_semaphore_wait(self.passFinished, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC))) != 0) {
+        return nil;
+    }
+    return self.result;
+}
+
+- (void)verificationCoordinator:(DYFStoreVerificationCoordinator *)coordinator didFinishWithResult:(DYFStoreVerificationResult *)result
+{
+    self.result = result;
+    dispatch_semaphore_signal(self.passFinished);
+}
+
+- (void)retryScheduler:(DYFStoreRetryScheduler *)scheduler didGiveUpOnTransactions:(NSArray<NSString *> *)transactionIdentifiers
+{
+    self.exhausted = transactionIdentifiers;
+    dispatch_semaphore_signal(self.gaveUp);
+}
+
++ (NSDictionary *)run
+{
+    return [self runWithTransactionCount:8 maxAttempts:6];
+}
+
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count maxAttempts:(NSUInteger)maxAttempts
+{
+    // The scheduler persists its state in the user defaults, which the check puts back afterwards.
+    NSUserDefaults *defaults = NSUserDefaults.standardUserDefaults;
+    id savedState = [defaults objectForKey:DYFStoreRetryStateKey];
+    [defaults removeObjectForKey:DYFStoreRetryStateKey];
+    
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"SKRetryBenchmark.sqlite"];
+    for (NSString *suffix in @[@"", @"-wal", @"-shm"]) {
+        [NSFileManager.defaultManager removeItemAtPath:[path stringByAppendingString:suffix] error:nil];
+    }
+    DYFStoreSQLitePersistence *persister = [[DYFStoreSQLitePersistence alloc] initWithDatabaseURL:[NSURL fileURLWithPath:path]];
+    NSArray<DYFStoreTransaction *> *transactions = [self transactionsWithCount:count];
+    [persister storeTransactions:transactions];
+    NSArray<NSString *> *identifiers = [transactions valueForKey:@"transactionIdentifier"];
+    
+    DYFStoreSimulatedReceiptVerifier *verifier = [[DYFStoreSimulatedReceiptVerifier alloc] init];
+    verifier.latency = 0;
+    verifier.networkFails = YES;
+    
+    SKRetryBenchmark *check = [[self alloc] init];
+    DYFStoreVerificationCoordinator *coordinator = [[DYFStoreVerificationCoordinator alloc] initWithPersister:persister verifier:verifier];
+    coordinator.store = nil;
+    coordinator.callbackQueue = dispatch_queue_create("com.dyf.storekit.benchmark.retry", DISPATCH_QUEUE_SERIAL);
+    coordinator.delegate = check;
+    
+    // Without jitter, every transaction is due at the same time, so one wake-up retries them all.
+    NSTimeInterval start = 1600000000;
+    DYFStoreSimulatedClock *clock = [[DYFStoreSimulatedClock alloc] initWithTime:start];
+    DYFStoreRetryScheduler *scheduler = [[DYFStoreRetryScheduler alloc] initWithCoordinator:coordinator clock:clock];
+    scheduler.store = nil;
+    scheduler.delegate = check;
+    scheduler.jitter = 0;
+    scheduler.maxAttempts = maxAttempts;
+    
+    NSMutableArray<NSString *> *failures = [NSMutableArray array];
+    
+    // The transactions have never been attempted, so resuming verifies them at once.
+    [scheduler resume];
+    for (NSUInteger attempt = 1; attempt <= maxAttempts; attempt++) {
+        DYFStoreVerificationResult *result = [check waitForPassWithTimeout:SKRetryPassTimeout];
+        if (!result) {
+            [failures addObject:[NSString stringWithFormat:@"attempt %zi did not run", attempt]];
+            break;
+        }
+        if (result.unresolvedTransactions.count != count) {
+            [failures addObject:[NSString stringWithFormat:@"attempt %zi left %zi of %zi transactions unresolved", attempt, result.unresolvedTransactions.count, count]];
+        }
+        
+        NSTimeInterval expected = attempt < maxAttempts ? clock.now + [scheduler delayForAttempt:attempt] : DBL_MAX;
+        for (NSString *identifier in identifiers) {
+            NSUInteger attempts = [scheduler attemptCountForTransaction:identifier];
+            NSTimeInterval next = [scheduler nextAttemptTimeForTransaction:identifier];
+            if (attempts != attempt || next != expected) {
+                [failures addObject:[NSString stringWithFormat:@"after attempt %zi, %@ has %zi attempts, next at %+.0f s instead of %+.0f s", attempt, identifier, attempts, next - clock.now, expected - clock.now]];
+                break;
+            }
+        }
+        if (attempt == maxAttempts) { break; }
+        
+        // The wake-up of the next attempt runs within the advance, and starts the pass.
+        [clock advanceBy:[scheduler delayForAttempt:attempt]];
+    }
+    
+    if (dispatch_semaphore_wait(check.gaveUp, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(SKRetryPassTimeout * NSEC_PER_SEC))) != 0 ||
+        check.exhausted.count != count) {
+        [failures addObject:[NSString stringWithFormat:@"gave up on %zi of %zi transactions", check.exhausted.count, count]];
+    }
+    if (clock.pendingCount != 0) {
+        [failures addObject:[NSString stringWithFormat:@"%zi wake-ups are scheduled after giving up", clock.pendingCount]];
+    }
+    
+    // The network coming back drains the pending work only, which the exhausted transactions are not part of.
+    NSUInteger requests = verifier.requestCount;
+    [scheduler networkDidBecomeReachable];
+    if ([check waitForPassWithTimeout:0.5] || verifier.requestCount != requests) {
+        [failures addObject:@"the network coming back retried the exhausted transactions"];
+    }
+    
+    // An explicit retry does, and settles them.
+    verifier.networkFails = NO;
+    [scheduler retryNow];
+    DYFStoreVerificationResult *result = [check waitForPassWithTimeout:SKRetryPassTimeout];
+    if (result.verifiedTransactions.count != count) {
+        [failures addObject:[NSString stringWithFormat:@"retryNow verified %zi of %zi transactions", result.verifiedTransactions.count, count]];
+    }
+    if ([scheduler attemptCountForTransaction:identifiers.firstObject] != 0 || [persister retrieveTransactionHeaders].count != 0) {
+        [failures addObject:@"the verified transactions were not forgotten"];
+    }
+    
+    NSDictionary *report = @{@"transactions": @(count),
+                             @"max_attempts": @(maxAttempts),
+                             @"requests": @(verifier.requestCount),
+                             @"simulated_s": @(clock.now - start),
+                             @"passed": @(failures.count == 0),
+                             @"failures": failures};
+    
+    // Puts back what the app had stored before the run.
+    if (savedState) {
+        [defaults setObject:savedState forKey:DYFStoreRetryStateKey];
+    } else {
+        [defaults removeObjectForKey:DYFStoreRetryStateKey];
+    }
+    for (NSString *suffix in @[@"", @"-wal", @"-shm"]) {
+        [NSFileManager.defaultManager removeItemAtPath:[path stringByAppendingString:suffix] error:nil];
+    }
+    
+    return report;
+}
+
+@end
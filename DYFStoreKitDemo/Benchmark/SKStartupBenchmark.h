@@ -0,0 +1,27 @@
+//
+//  SKStartupBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Measures how long finding the unfinished transactions at launch takes, by decoding every record as before and by reading the header index.
+ */
+@interface SKStartupBenchmark : NSObject
+
+/** Runs the benchmark with 1,000 and 50,000 persisted transactions.
+ 
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)run;
+
+/** Runs the benchmark with a number of persisted transactions.
+ 
+ @param count The number of persisted transactions.
+ @return The median milliseconds of the full decode, of the header read, and of the header read plus decoding the records of a first pass.
+ */
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count;
+
+@end
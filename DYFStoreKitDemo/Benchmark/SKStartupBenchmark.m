@@ -0,0 +1,96 @@
+//
+//  SKStartupBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKStartupBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreConverter.h"
+#import "DYFStoreUserDefaultsPersistence.h"
+#import "SKBenchmark.h"
+
+// The number of distinct users of the records.
+static const NSUInteger SKStartupBenchmarkUsers = 100;
+
+// The number of timed runs of every measurement.
+static const NSUInteger SKStartupBenchmarkRuns = 7;
+
+// The number of records a first verification pass decodes, see `DYFStoreRetryScheduler.maxTransactionsPerPass`.
+static const NSUInteger SKStartupBenchmarkFirstPass = 32;
+
+@implementation SKStartupBenchmark
+
+/** Times a block several times, each after dropping the in-memory user defaults and index, as after a relaunch.
+ */
++ (double)medianMillisecondsOfBlock:(SKBenchmarkBlock)block
+{
+    return SKBenchmarkMedianMilliseconds(SKStartupBenchmarkRuns, ^(NSUInteger run) {
+        [NSUserDefaults resetStandardUserDefaults];
+        [DYFStoreUserDefaultsPersistence discardIndex];
+    }, ^(NSUInteger run) {
+        block();
+    });
+}
+
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count
+{
+    DYFStoreUserDefaultsPersistence *persister = [[DYFStoreUserDefaultsPersistence alloc] init];
+    
+    // A short receipt keeps 50,000 records at about 40 megabytes.
+    NSMutableData *receiptData = [NSMutableData dataWithLength:384];
+    arc4random_buf(receiptData.mutableBytes, receiptData.length);
+    NSString *receipt = receiptData.base64EncodedString;
+    
+    // The records are written at once rather than stored one by one, then the index is built from them.
+    NSMutableArray *records = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        [records addObject:[DYFStoreConverter encodeObject:SKBenchmarkTransaction(idx, SKStartupBenchmarkUsers, receipt)]];
+    }
+    [NSUserDefaults.standardUserDefaults setObject:records forKey:DYFStoreTransactionsKey];
+    [NSUserDefaults.standardUserDefaults removeObjectForKey:DYFStoreTransactionHeadersKey];
+    [persister retrieveTransactionHeaders];
+    [NSUserDefaults.standardUserDefaults synchronize];
+    records = nil;
+    
+    double fullDecode = [self medianMillisecondsOfBlock:^{
+        [persister retrieveTransactions];
+    }];
+    double headers = [self medianMillisecondsOfBlock:^{
+        [persister retrieveTransactionHeaders];
+    }];
+    double firstPass = [self medianMillisecondsOfBlock:^{
+        NSArray<DYFStoreTransactionHeader *> *all = [persister retrieveTransactionHeaders];
+        NSArray *due = [all subarrayWithRange:NSMakeRange(0, MIN(all.count, SKStartupBenchmarkFirstPass))];
+        [persister retrieveTransactionsWithIdentifiers:[due valueForKey:@"transactionIdentifier"]];
+    }];
+    
+    return @{@"full_decode_ms": @(fullDecode),
+             @"headers_ms": @(headers),
+             @"headers_and_first_pass_ms": @(firstPass)};
+}
+
++ (NSDictionary *)run
+{
+    // The persister shares its storage with the app. Saves and restores it around the run.
+    NSUserDefaults *userDefaults = NSUserDefaults.standardUserDefaults;
+    id savedRecords = [userDefaults objectForKey:DYFStoreTransactionsKey];
+    id savedHeaders = [userDefaults objectForKey:DYFStoreTransactionHeadersKey];
+    
+    NSMutableDictionary *report = [NSMutableDictionary dictionary];
+    for (NSNumber *count in @[@1000, @50000]) {
+        report[count.stringValue] = [self runWithTransactionCount:count.unsignedIntegerValue];
+    }
+    
+    userDefaults = NSUserDefaults.standardUserDefaults;
+    [userDefaults removeObjectForKey:DYFStoreTransactionsKey];
+    [userDefaults removeObjectForKey:DYFStoreTransactionHeadersKey];
+    !savedRecords ?: [userDefaults setObject:savedRecords forKey:DYFStoreTransactionsKey];
+    !savedHeaders ?: [userDefaults setObject:savedHeaders forKey:DYFStoreTransactionHeadersKey];
+    [userDefaults synchronize];
+    
+    return report;
+}
+
+@end
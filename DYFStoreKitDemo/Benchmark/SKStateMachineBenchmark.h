@@ -0,0 +1,27 @@
+//
+//  SKStateMachineBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Drives the transaction state machine with mixed-state batches of the simulated payment backend: on its own, and through the store with a notification per transaction and one per callback.
+ */
+@interface SKStateMachineBenchmark : NSObject
+
+/** Runs the benchmark with batches of 10k transactions.
+ 
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)run;
+
+/** Runs the benchmark with batches of a number of transactions.
+ 
+ @param count The number of transactions in a batch.
+ @return The median nanoseconds per transaction of the state machine applying a batch at once, one transaction at a time and a redelivered batch, and the median milliseconds and the notifications of the store processing the batches.
+ */
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count;
+
+@end
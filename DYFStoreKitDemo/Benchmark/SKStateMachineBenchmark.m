@@ -0,0 +1,198 @@
+//
+//  SKStateMachineBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKStateMachineBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreSimulatedPaymentBackend.h"
+#import "SKBenchmark.h"
+
+// The number of timed runs of every measurement.
+static const NSUInteger SKStateMachineBenchmarkRuns = 5;
+
+@implementation SKStateMachineBenchmark
+
+/** Builds a mixed, deterministic script: 60% purchases, 10% failures, 10% cancellations, 10% deferrals, 8% restores and 2% downloads.
+ */
++ (NSArray<DYFStoreSimulatedStep *> *)scriptWithCount:(NSUInteger)count
+{
+    NSArray *productIds = @[@"com.dyf.storekit.gold", @"com.dyf.storekit.vip.month", @"com.dyf.storekit.noads"];
+    NSMutableArray *steps = [NSMutableArray arrayWithCapacity:count];
+    
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        NSUInteger slot = idx % 50;
+        DYFStoreSimulatedOutcome outcome;
+        if (slot < 30) {
+            outcome = DYFStoreSimulatedOutcomePurchase;
+        } else if (slot < 35) {
+            outcome = DYFStoreSimulatedOutcomeFail;
+        } else if (slot < 40) {
+            outcome = DYFStoreSimulatedOutcomeCancel;
+        } else if (slot < 45) {
+            outcome = DYFStoreSimulatedOutcomeDefer;
+        } else if (slot < 49) {
+            outcome = DYFStoreSimulatedOutcomeRestore;
+        } else {
+            outcome = DYFStoreSimulatedOutcomeDownload;
+        }
+        
+        DYFStoreSimulatedStep *step = [DYFStoreSimulatedStep stepWithOutcome:outcome productIdentifier:productIds[idx % productIds.count]];
+        step.userIdentifier = [NSString stringWithFormat:@"user-%lu", (unsigned long)(idx % 1000)];
+        [steps addObject:step];
+    }
+    
+    return steps;
+}
+
+/** Measures the state machine alone. Every tenth update of the batch repeats the previous one, as a payment queue delivering a transaction twice in one callback.
+ */
++ (NSDictionary *)measureStateMachineWithTransactionCount:(NSUInteger)count
+{
+    DYFStoreSimulatedPaymentBackend *backend = [[DYFStoreSimulatedPaymentBackend alloc] init];
+    backend.seed = 50;
+    NSArray<SKPaymentTransaction *> *transactions = [backend transactionsForSteps:[self scriptWithCount:count]];
+    NSMutableArray<SKPaymentTransaction *> *mixed = [NSMutableArray arrayWithCapacity:transactions.count];
+    for (NSUInteger idx = 0; idx < transactions.count; idx++) {
+        [mixed addObject:idx % 10 == 9 ? transactions[idx - 1] : transactions[idx]];
+    }
+    
+    uint64_t batched[SKStateMachineBenchmarkRuns];
+    uint64_t single[SKStateMachineBenchmarkRuns];
+    uint64_t redelivered[SKStateMachineBenchmarkRuns];
+    NSUInteger accepted = 0;
+    NSUInteger rejected = 0;
+    
+    for (NSUInteger run = 0; run < SKStateMachineBenchmarkRuns; run++) {
+        @autoreleasepool {
+            DYFStoreTransactionStateMachine *machine = [[DYFStoreTransactionStateMachine alloc] init];
+            uint64_t begin = SKBenchmarkNow();
+            DYFStoreTransactionBatch *batch = [machine applyTransactions:mixed];
+            batched[run] = SKBenchmarkNow() - begin;
+            accepted = batch.count;
+            rejected = batch.rejectedCount;
+            
+            // Every update of the same batch again is a duplicate.
+            begin = SKBenchmarkNow();
+            [machine applyTransactions:mixed];
+            redelivered[run] = SKBenchmarkNow() - begin;
+            
+            // The same updates one call each, as a callback that takes the lock per transaction would.
+            [machine reset];
+            begin = SKBenchmarkNow();
+            for (SKPaymentTransaction *transaction in mixed) {
+                [machine applyInput:(DYFStoreTransactionInput)transaction.transactionState toTransaction:transaction];
+            }
+            single[run] = SKBenchmarkNow() - begin;
+        }
+    }
+    
+    double n = MAX(mixed.count, 1);
+    return @{@"batch_ns_per_transaction": @(SKBenchmarkPercentile(batched, SKStateMachineBenchmarkRuns, 0.5) / n),
+             @"single_ns_per_transaction": @(SKBenchmarkPercentile(single, SKStateMachineBenchmarkRuns, 0.5) / n),
+             @"redelivered_ns_per_transaction": @(SKBenchmarkPercentile(redelivered, SKStateMachineBenchmarkRuns, 0.5) / n),
+             @"accepted": @(accepted),
+             @"rejected": @(rejected)};
+}
+
+/** Replays a batch through the store, purchasing updates first, then delivers the unfinished transactions again, as the payment queue does after the app relaunched.
+ 
+ @param batches Whether the notifications are only reported by the notification of their callback.
+ @return The milliseconds, the notifications and the rejected updates of the run.
+ */
++ (NSDictionary *)deliverOnceWithTransactionCount:(NSUInteger)count batches:(BOOL)batches
+{
+    DYFStore *store = DYFStore.defaultStore;
+    id<DYFStorePaymentBackend> previousBackend = store.paymentBackend;
+    BOOL previousBatches = store.batchesTransactionNotifications;
+    BOOL previousHostedContentSupported = store.hostedContentSupported;
+    
+    DYFStoreSimulatedPaymentBackend *backend = [[DYFStoreSimulatedPaymentBackend alloc] init];
+    backend.seed = 50;
+    backend.batchSize = count;
+    backend.deliversPurchasingUpdates = YES;
+    store.hostedContentSupported = YES;
+    store.batchesTransactionNotifications = batches;
+    store.paymentBackend = backend;
+    [store addPaymentTransactionObserver];
+    
+    __block NSUInteger purchasedNotifications = 0;
+    __block NSUInteger changedNotifications = 0;
+    __block NSUInteger rejected = 0;
+    id purchased = [NSNotificationCenter.defaultCenter addObserverForName:DYFStorePurchasedNotification object:nil queue:nil usingBlock:^(NSNotification *note) {
+        purchasedNotifications++;
+    }];
+    id changed = [NSNotificationCenter.defaultCenter addObserverForName:DYFStoreTransactionsChangedNotification object:nil queue:nil usingBlock:^(NSNotification *note) {
+        DYFStoreTransactionBatch *batch = note.object;
+        changedNotifications++;
+        rejected += batch.rejectedCount;
+    }];
+    
+    NSArray<DYFStoreSimulatedStep *> *steps = [self scriptWithCount:count];
+    uint64_t begin = SKBenchmarkNow();
+    [backend replaySteps:steps];
+    uint64_t replayed = SKBenchmarkNow() - begin;
+    
+    NSArray<SKPaymentTransaction *> *unfinished = backend.unfinishedTransactions;
+    begin = SKBenchmarkNow();
+    [backend deliverTransactions:unfinished];
+    uint64_t redelivered = SKBenchmarkNow() - begin;
+    
+    [NSNotificationCenter.defaultCenter removeObserver:purchased];
+    [NSNotificationCenter.defaultCenter removeObserver:changed];
+    for (SKPaymentTransaction *transaction in backend.unfinishedTransactions) {
+        [store finishTransaction:transaction];
+    }
+    [store.purchasedTranscations removeAllObjects];
+    [store.restoredTranscations removeAllObjects];
+    [store removePaymentTransactionObserver];
+    store.paymentBackend = previousBackend;
+    store.batchesTransactionNotifications = previousBatches;
+    store.hostedContentSupported = previousHostedContentSupported;
+    
+    return @{@"replay_ms": @(replayed / 1e6),
+             @"redelivery_ms": @(redelivered / 1e6),
+             @"redelivered": @(unfinished.count),
+             @"purchased_notifications": @(purchasedNotifications),
+             @"batch_notifications": @(changedNotifications),
+             @"rejected": @(rejected)};
+}
+
++ (NSDictionary *)measureStoreWithTransactionCount:(NSUInteger)count batches:(BOOL)batches
+{
+    uint64_t replayed[SKStateMachineBenchmarkRuns];
+    uint64_t redelivered[SKStateMachineBenchmarkRuns];
+    NSDictionary *run = nil;
+    for (NSUInteger idx = 0; idx < SKStateMachineBenchmarkRuns; idx++) {
+        @autoreleasepool {
+            run = [self deliverOnceWithTransactionCount:count batches:batches];
+            replayed[idx] = (uint64_t)([run[@"replay_ms"] doubleValue] * 1e6);
+            redelivered[idx] = (uint64_t)([run[@"redelivery_ms"] doubleValue] * 1e6);
+        }
+    }
+    
+    return @{@"replay_median_ms": @(SKBenchmarkPercentile(replayed, SKStateMachineBenchmarkRuns, 0.5) / 1e6),
+             @"redelivery_median_ms": @(SKBenchmarkPercentile(redelivered, SKStateMachineBenchmarkRuns, 0.5) / 1e6),
+             @"redelivered": run[@"redelivered"],
+             @"purchased_notifications": run[@"purchased_notifications"],
+             @"batch_notifications": run[@"batch_notifications"],
+             @"rejected": run[@"rejected"]};
+}
+
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count
+{
+    count = MAX(count, 1);
+    return @{@"transactions": @(count),
+             @"state_machine": [self measureStateMachineWithTransactionCount:count],
+             @"per_transaction_notifications": [self measureStoreWithTransactionCount:count batches:NO],
+             @"batched_notifications": [self measureStoreWithTransactionCount:count batches:YES]};
+}
+
++ (NSDictionary *)run
+{
+    return [self runWithTransactionCount:10000];
+}
+
+@end
@@ -0,0 +1,22 @@
+//
+//  SKStoreLoadBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Drives a scripted transaction stream through `paymentQueue:updatedTransactions:` of the store, using the simulated payment backend.
+ */
+@interface SKStoreLoadBenchmark : NSObject
+
+/** Runs the benchmark and returns a report with the throughput and the latency percentiles of the callbacks.
+ 
+ @param count The number of transactions to drive, e.g. 100000.
+ @param batchSize The number of transactions passed to a single callback.
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count batchSize:(NSUInteger)batchSize;
+
+@end
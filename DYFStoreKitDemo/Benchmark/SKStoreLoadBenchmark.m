@@ -0,0 +1,122 @@
+//
+//  SKStoreLoadBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKStoreLoadBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreSimulatedPaymentBackend.h"
+#import "SKBenchmark.h"
+
+// The number of batches after which the delivered transactions are finished, outside of the measured time.
+static const NSUInteger SKStoreLoadFinishInterval = 64;
+
+@implementation SKStoreLoadBenchmark
+
+/** Builds a mixed, deterministic script: 70% purchases, 10% failures, 5% cancellations, 5% deferrals, 8% restores and 2% downloads.
+ */
++ (NSArray<DYFStoreSimulatedStep *> *)scriptWithCount:(NSUInteger)count
+{
+    NSArray *productIds = @[@"com.dyf.storekit.gold", @"com.dyf.storekit.vip.month", @"com.dyf.storekit.noads"];
+    NSMutableArray *steps = [NSMutableArray arrayWithCapacity:count];
+    
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        NSUInteger slot = idx % 100;
+        DYFStoreSimulatedOutcome outcome;
+        if (slot < 70) {
+            outcome = DYFStoreSimulatedOutcomePurchase;
+        } else if (slot < 80) {
+            outcome = DYFStoreSimulatedOutcomeFail;
+        } else if (slot < 85) {
+            outcome = DYFStoreSimulatedOutcomeCancel;
+        } else if (slot < 90) {
+            outcome = DYFStoreSimulatedOutcomeDefer;
+        } else if (slot < 98) {
+            outcome = DYFStoreSimulatedOutcomeRestore;
+        } else {
+            outcome = DYFStoreSimulatedOutcomeDownload;
+        }
+        
+        DYFStoreSimulatedStep *step = [DYFStoreSimulatedStep stepWithOutcome:outcome productIdentifier:productIds[idx % productIds.count]];
+        step.userIdentifier = [NSString stringWithFormat:@"user-%lu", (unsigned long)(idx % 1000)];
+        [steps addObject:step];
+    }
+    
+    return steps;
+}
+
++ (void)finishDeliveredTransactions:(DYFStoreSimulatedPaymentBackend *)backend store:(DYFStore *)store
+{
+    for (SKPaymentTransaction *transaction in backend.unfinishedTransactions) {
+        [store finishTransaction:transaction];
+    }
+    [store.purchasedTranscations removeAllObjects];
+    [store.restoredTranscations removeAllObjects];
+}
+
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count batchSize:(NSUInteger)batchSize
+{
+    batchSize = MAX(batchSize, 1);
+    
+    DYFStore *store = DYFStore.defaultStore;
+    id<DYFStorePaymentBackend> previousBackend = store.paymentBackend;
+    BOOL previousHostedContentSupported = store.hostedContentSupported;
+    
+    DYFStoreSimulatedPaymentBackend *backend = [[DYFStoreSimulatedPaymentBackend alloc] init];
+    backend.seed = 26;
+    backend.batchSize = batchSize;
+    store.hostedContentSupported = YES;
+    store.paymentBackend = backend;
+    [store addPaymentTransactionObserver];
+    
+    // Transactions are built up front so that only the callbacks are measured.
+    NSArray<SKPaymentTransaction *> *transactions = [backend transactionsForSteps:[self scriptWithCount:count]];
+    NSUInteger batchCount = (transactions.count + batchSize - 1) / batchSize;
+    uint64_t *latencies = calloc(MAX(batchCount, 1), sizeof(uint64_t));
+    uint64_t total = 0;
+    
+    for (NSUInteger batch = 0; batch < batchCount; batch++) {
+        NSRange range = NSMakeRange(batch * batchSize, MIN(batchSize, transactions.count - batch * batchSize));
+        NSArray *slice = [transactions subarrayWithRange:range];
+        
+        @autoreleasepool {
+            uint64_t begin = SKBenchmarkNow();
+            [backend deliverTransactions:slice];
+            uint64_t elapsed = SKBenchmarkNow() - begin;
+            latencies[batch] = elapsed;
+            total += elapsed;
+            
+            if ((batch + 1) % SKStoreLoadFinishInterval == 0) {
+                [self finishDeliveredTransactions:backend store:store];
+            }
+        }
+    }
+    
+    [self finishDeliveredTransactions:backend store:store];
+    [store removePaymentTransactionObserver];
+    store.paymentBackend = previousBackend;
+    store.hostedContentSupported = previousHostedContentSupported;
+    
+    uint64_t p50 = SKBenchmarkPercentile(latencies, batchCount, 0.50);
+    uint64_t p90 = SKBenchmarkPercentile(latencies, batchCount, 0.90);
+    uint64_t p99 = SKBenchmarkPercentile(latencies, batchCount, 0.99);
+    uint64_t p999 = SKBenchmarkPercentile(latencies, batchCount, 0.999);
+    uint64_t max = batchCount > 0 ? latencies[batchCount - 1] : 0;
+    
+    NSDictionary *report = @{@"transactions": @(transactions.count),
+                             @"batch_size": @(batchSize),
+                             @"total_ms": @(total / 1e6),
+                             @"throughput_tps": @(total > 0 ? transactions.count / (total / 1e9) : 0),
+                             @"latency_ns": @{@"p50": @(p50),
+                                              @"p90": @(p90),
+                                              @"p99": @(p99),
+                                              @"p999": @(p999),
+                                              @"max": @(max)}};
+    free(latencies);
+    
+    return report;
+}
+
+@end
@@ -0,0 +1,27 @@
+//
+//  SKStoreMicroBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "SKBenchmark.h"
+
+/** Microbenchmarks of the converter, the categories, `DYFCryptoSHA256` and the persisters on fixed datasets.
+ */
+@interface SKStoreMicroBenchmark : NSObject
+
+/** Creates a benchmark with all cases added.
+ 
+ @return An `SKBenchmark` object that is ready to run.
+ */
++ (SKBenchmark *)benchmark;
+
+/** Runs all cases and compares the report against `SKBenchmarkBaseline.json` in the main bundle.
+ 
+ @return A dictionary with the "report", the "regressions" found and the "unrecorded" cases that the baseline has no numbers for.
+ */
++ (NSDictionary *)run;
+
+@end
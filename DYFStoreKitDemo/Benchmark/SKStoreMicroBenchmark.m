@@ -0,0 +1,327 @@
+//
+//  SKStoreMicroBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKStoreMicroBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreConverter.h"
+#import "DYFStoreJSONWriter.h"
+#import "DYFRuntimeProvider.h"
+#import "DYFStoreUserDefaultsPersistence.h"
+#if __has_include(<DYFKeychain/DYFKeychain.h>)
+#import "DYFStoreKeychainPersistence.h"
+#endif
+
+// The record counts at which the persisters are measured.
+#define SKStoreMicroBenchmarkRecordCounts @[@10, @100, @1000]
+
+// The number of distinct users of the records.
+static const NSUInteger SKStoreMicroBenchmarkUsers = 100;
+
+@implementation SKStoreMicroBenchmark
+
+#pragma mark - Fixtures
+
+/** Returns a fixed pseudo receipt of a given length.
+ */
++ (NSData *)receiptDataWithLength:(NSUInteger)length
+{
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    uint8_t *bytes = data.mutableBytes;
+    for (NSUInteger idx = 0; idx < length; idx++) {
+        bytes[idx] = (uint8_t)((idx * 31 + 7) & 0xFF);
+    }
+    return data;
+}
+
++ (NSDictionary *)dictionaryWithTransaction:(DYFStoreTransaction *)transaction
+{
+    NSMutableDictionary *dict = [NSMutableDictionary dictionary];
+    dict[@"state"] = @(transaction.state);
+    dict[@"productIdentifier"] = transaction.productIdentifier;
+    dict[@"userIdentifier"] = transaction.userIdentifier;
+    dict[@"transactionIdentifier"] = transaction.transactionIdentifier;
+    dict[@"transactionTimestamp"] = transaction.transactionTimestamp;
+    dict[@"originalTransactionIdentifier"] = transaction.originalTransactionIdentifier;
+    dict[@"originalTransactionTimestamp"] = transaction.originalTransactionTimestamp;
+    dict[@"transactionReceipt"] = transaction.transactionReceipt;
+    return dict;
+}
+
+#pragma mark - Cases
+
++ (void)addConverterCases:(SKBenchmark *)benchmark receipt:(NSString *)receipt
+{
+    DYFStoreTransaction *transaction = SKBenchmarkTransaction(1, SKStoreMicroBenchmarkUsers, receipt);
+    NSData *archive = [DYFStoreConverter encodeObject:transaction];
+    
+    [benchmark addCaseWithName:@"converter.encodeObject" iterations:100 setUp:nil body:^{
+        [DYFStoreConverter encodeObject:transaction];
+    }];
+    [benchmark addCaseWithName:@"converter.decodeObject" iterations:100 setUp:nil body:^{
+        [DYFStoreConverter decodeObject:archive];
+    }];
+    
+    for (NSNumber *count in @[@100, @1000]) {
+        NSMutableArray *records = [NSMutableArray arrayWithCapacity:count.unsignedIntegerValue];
+        for (NSUInteger idx = 0; idx < count.unsignedIntegerValue; idx++) {
+            [records addObject:[self dictionaryWithTransaction:SKBenchmarkTransaction(idx, SKStoreMicroBenchmarkUsers, receipt)]];
+        }
+        NSData *json = [DYFStoreConverter jsonWithObject:records];
+        
+        [benchmark addCaseWithName:[NSString stringWithFormat:@"converter.jsonWithObject.%@", count] iterations:1 setUp:nil body:^{
+            [DYFStoreConverter jsonWithObject:records];
+        }];
+        [benchmark addCaseWithName:[NSString stringWithFormat:@"converter.jsonObjectWithData.%@", count] iterations:1 setUp:nil body:^{
+            [DYFStoreConverter jsonObjectWithData:json];
+        }];
+    }
+}
+
+/** Compares the streaming JSON API with `NSJSONSerialization` on a 10k-record array, looking up and appending the last record.
+ */
++ (void)addStreamingJSONCases:(SKBenchmark *)benchmark
+{
+    // A short receipt keeps the array at a few megabytes.
+    NSString *receipt = [self receiptDataWithLength:384].base64EncodedString;
+    NSUInteger count = 10000;
+    NSMutableArray *records = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        [records addObject:[self dictionaryWithTransaction:SKBenchmarkTransaction(idx, SKStoreMicroBenchmarkUsers, receipt)]];
+    }
+    NSData *json = [DYFStoreConverter jsonWithObject:records];
+    NSString *lastIdentifier = records.lastObject[@"transactionIdentifier"];
+    NSDictionary *record = [self dictionaryWithTransaction:SKBenchmarkTransaction(count, SKStoreMicroBenchmarkUsers, receipt)];
+    
+    [benchmark addCaseWithName:@"json.find.NSJSONSerialization.10000" iterations:1 setUp:nil body:^{
+        for (NSDictionary *dict in [DYFStoreConverter jsonObjectWithData:json]) {
+            if ([dict[@"transactionIdentifier"] isEqualToString:lastIdentifier]) { break; }
+        }
+    }];
+    [benchmark addCaseWithName:@"json.find.DYFStoreJSONReader.10000" iterations:1 setUp:nil body:^{
+        [DYFStoreConverter objectInJSONArray:json whereKey:@"transactionIdentifier" equalsString:lastIdentifier];
+    }];
+    [benchmark addCaseWithName:@"json.append.NSJSONSerialization.10000" iterations:1 setUp:nil body:^{
+        NSMutableArray *array = [DYFStoreConverter jsonObjectWithData:json options:NSJSONReadingMutableContainers];
+        [array addObject:record];
+        [DYFStoreConverter jsonWithObject:array];
+    }];
+    [benchmark addCaseWithName:@"json.append.DYFStoreJSONWriter.10000" iterations:1 setUp:nil body:^{
+        [DYFStoreConverter jsonArray:json byAppendingObject:record];
+    }];
+    [benchmark addCaseWithName:@"json.write.NSJSONSerialization.10000" iterations:1 setUp:nil body:^{
+        [DYFStoreConverter jsonWithObject:records];
+    }];
+    [benchmark addCaseWithName:@"json.write.DYFStoreJSONWriter.10000" iterations:1 setUp:nil body:^{
+        DYFStoreJSONWriter *writer = [[DYFStoreJSONWriter alloc] initWithData:[NSMutableData dataWithCapacity:json.length]];
+        [writer beginArray];
+        for (NSDictionary *dict in records) {
+            [writer writeObject:dict];
+        }
+        [writer endArray];
+    }];
+}
+
+/** Compares the static field tables with the reflection of `DYFRuntimeProvider`, per object.
+ */
++ (void)addMappingCases:(SKBenchmark *)benchmark receipt:(NSString *)receipt
+{
+    DYFStoreTransaction *transaction = SKBenchmarkTransaction(5, SKStoreMicroBenchmarkUsers, receipt);
+    NSDictionary *dict = [transaction dictionaryRepresentation];
+    
+    [benchmark addCaseWithName:@"mapping.runtime.asDictionaryWithObject" iterations:1000 setUp:nil body:^{
+        [DYFRuntimeProvider asDictionaryWithObject:transaction];
+    }];
+    [benchmark addCaseWithName:@"mapping.table.dictionaryRepresentation" iterations:1000 setUp:nil body:^{
+        [transaction dictionaryRepresentation];
+    }];
+    [benchmark addCaseWithName:@"mapping.runtime.asObjectWithDictionary" iterations:1000 setUp:nil body:^{
+        [DYFRuntimeProvider asObjectWithDictionary:dict forClass:DYFStoreTransaction.class];
+    }];
+    [benchmark addCaseWithName:@"mapping.table.initWithDictionary" iterations:1000 setUp:nil body:^{
+        (void)[[DYFStoreTransaction alloc] initWithDictionary:dict];
+    }];
+    [benchmark addCaseWithName:@"mapping.runtime.encode" iterations:100 setUp:nil body:^{
+        NSKeyedArchiver *archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:[NSMutableData data]];
+        [DYFRuntimeProvider encode:archiver forObject:transaction];
+        [archiver finishEncoding];
+    }];
+    [benchmark addCaseWithName:@"mapping.table.encode" iterations:100 setUp:nil body:^{
+        NSKeyedArchiver *archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:[NSMutableData data]];
+        [transaction encodeWithCoder:archiver];
+        [archiver finishEncoding];
+    }];
+}
+
++ (void)addCategoryCases:(SKBenchmark *)benchmark receiptData:(NSData *)receiptData
+{
+    NSString *receipt = receiptData.base64EncodedString;
+    NSData *encodedData = receiptData.base64Encode;
+    NSString *text = @"The quick brown fox jumps over the lazy dog, 2014-11-04 00:00:00";
+    NSString *encodedText = text.base64Encode;
+    
+    [benchmark addCaseWithName:@"NSData.base64Encode.8k" iterations:100 setUp:nil body:^{
+        [receiptData base64Encode];
+    }];
+    [benchmark addCaseWithName:@"NSData.base64EncodedString.8k" iterations:100 setUp:nil body:^{
+        [receiptData base64EncodedString];
+    }];
+    [benchmark addCaseWithName:@"NSData.base64Decode.8k" iterations:100 setUp:nil body:^{
+        [encodedData base64Decode];
+    }];
+    [benchmark addCaseWithName:@"NSString.base64DecodedData.8k" iterations:100 setUp:nil body:^{
+        [receipt base64DecodedData];
+    }];
+    [benchmark addCaseWithName:@"NSString.base64Encode.64" iterations:1000 setUp:nil body:^{
+        [text base64Encode];
+    }];
+    [benchmark addCaseWithName:@"NSString.base64Decode.64" iterations:1000 setUp:nil body:^{
+        [encodedText base64Decode];
+    }];
+    [benchmark addCaseWithName:@"DYFCryptoSHA256.64" iterations:1000 setUp:nil body:^{
+        DYFCryptoSHA256(text);
+    }];
+    [benchmark addCaseWithName:@"DYFCryptoSHA256.8k" iterations:100 setUp:nil body:^{
+        DYFCryptoSHA256(receipt);
+    }];
+}
+
+/** Compares the cost paid by the calling thread for a typical `DYFStoreLog` entry and the same entry through `NSLog`.
+ */
++ (void)addLoggerCases:(SKBenchmark *)benchmark
+{
+    NSString *transactionId = @"1000000000000001";
+    NSInteger quantity = 1;
+    
+    // Drains before every run, so the entries are recorded rather than dropped.
+    [benchmark addCaseWithName:@"log.DYFStoreLog" iterations:256 setUp:^{
+        [DYFStoreLogger drain];
+    } body:^{
+        DYFStoreLog(@"index: %zi, transactionId: %@", quantity, transactionId);
+    }];
+    [benchmark addCaseWithName:@"log.NSLog" iterations:16 setUp:nil body:^{
+        NSLog(@"%s [Line: %d] [DYFStore] index: %zi, transactionId: %@", __PRETTY_FUNCTION__, __LINE__, quantity, transactionId);
+    }];
+}
+
+/** Adds the store, retrieve, contains and remove cases of a persister, which responds to the methods of `DYFStoreUserDefaultsPersistence`.
+ */
++ (void)addPersisterCases:(SKBenchmark *)benchmark
+                   prefix:(NSString *)prefix
+                persister:(id)persister
+                  receipt:(NSString *)receipt
+{
+    for (NSNumber *count in SKStoreMicroBenchmarkRecordCounts) {
+        NSUInteger n = count.unsignedIntegerValue;
+        DYFStoreTransaction *extra = SKBenchmarkTransaction(n, SKStoreMicroBenchmarkUsers, receipt);
+        NSString *firstId = SKBenchmarkTransaction(0, SKStoreMicroBenchmarkUsers, nil).transactionIdentifier;
+        NSString *lastId = SKBenchmarkTransaction(n - 1, SKStoreMicroBenchmarkUsers, nil).transactionIdentifier;
+        
+        // Fills the persister with exactly `n` records, the first time a case at this count runs.
+        __block BOOL filled = NO;
+        SKBenchmarkBlock fill = ^{
+            if (filled) { return; }
+            [persister removeTransactions];
+            for (NSUInteger idx = 0; idx < n; idx++) {
+                [persister storeTransaction:SKBenchmarkTransaction(idx, SKStoreMicroBenchmarkUsers, receipt)];
+            }
+            filled = YES;
+        };
+        
+        [benchmark addCaseWithName:[NSString stringWithFormat:@"%@.store.%@", prefix, count] iterations:1 setUp:^{
+            fill();
+            [persister removeTransaction:extra.transactionIdentifier];
+        } body:^{
+            [persister storeTransaction:extra];
+        }];
+        [benchmark addCaseWithName:[NSString stringWithFormat:@"%@.retrieveTransactions.%@", prefix, count] iterations:1 setUp:^{
+            fill();
+            [persister removeTransaction:extra.transactionIdentifier];
+        } body:^{
+            [persister retrieveTransactions];
+        }];
+        [benchmark addCaseWithName:[NSString stringWithFormat:@"%@.retrieveTransaction.%@", prefix, count] iterations:1 setUp:fill body:^{
+            [persister retrieveTransaction:lastId];
+        }];
+        [benchmark addCaseWithName:[NSString stringWithFormat:@"%@.containsTransaction.%@", prefix, count] iterations:1 setUp:fill body:^{
+            [persister containsTransaction:lastId];
+        }];
+        [benchmark addCaseWithName:[NSString stringWithFormat:@"%@.remove.%@", prefix, count] iterations:1 setUp:^{
+            fill();
+            [persister removeTransaction:firstId];
+            [persister storeTransaction:SKBenchmarkTransaction(0, SKStoreMicroBenchmarkUsers, receipt)];
+        } body:^{
+            // The record was appended last, so the remove scans every record.
+            [persister removeTransaction:firstId];
+        }];
+    }
+}
+
++ (SKBenchmark *)benchmark
+{
+    SKBenchmark *benchmark = [[SKBenchmark alloc] init];
+    NSData *receiptData = [self receiptDataWithLength:8 * 1024];
+    NSString *receipt = receiptData.base64EncodedString;
+    
+    [self addConverterCases:benchmark receipt:receipt];
+    [self addStreamingJSONCases:benchmark];
+    [self addMappingCases:benchmark receipt:receipt];
+    [self addCategoryCases:benchmark receiptData:receiptData];
+    [self addLoggerCases:benchmark];
+    [self addPersisterCases:benchmark
+                     prefix:@"userdefaults"
+                  persister:[[DYFStoreUserDefaultsPersistence alloc] init]
+                    receipt:receipt];
+#if __has_include(<DYFKeychain/DYFKeychain.h>)
+    [self addPersisterCases:benchmark
+                     prefix:@"keychain"
+                  persister:[[DYFStoreKeychainPersistence alloc] init]
+                    receipt:receipt];
+#endif
+    
+    return benchmark;
+}
+
++ (NSDictionary *)run
+{
+    // The persisters share their storage with the app. Saves and restores it around the run.
+    NSUserDefaults *userDefaults = NSUserDefaults.standardUserDefaults;
+    id savedRecords = [userDefaults objectForKey:DYFStoreTransactionsKey];
+    id savedHeaders = [userDefaults objectForKey:DYFStoreTransactionHeadersKey];
+#if __has_include(<DYFKeychain/DYFKeychain.h>)
+    DYFStoreKeychainPersistence *keychainPersister = [[DYFStoreKeychainPersistence alloc] init];
+    NSArray *savedKeychainRecords = [keychainPersister retrieveTransactions];
+#endif
+    
+    NSDictionary *report = [[self benchmark] run];
+    
+    if (savedRecords) {
+        [userDefaults setObject:savedRecords forKey:DYFStoreTransactionsKey];
+    } else {
+        [userDefaults removeObjectForKey:DYFStoreTransactionsKey];
+    }
+    if (savedHeaders) {
+        [userDefaults setObject:savedHeaders forKey:DYFStoreTransactionHeadersKey];
+    } else {
+        [userDefaults removeObjectForKey:DYFStoreTransactionHeadersKey];
+    }
+    [userDefaults synchronize];
+#if __has_include(<DYFKeychain/DYFKeychain.h>)
+    [keychainPersister removeTransactions];
+    for (DYFStoreTransaction *transaction in savedKeychainRecords) {
+        [keychainPersister storeTransaction:transaction];
+    }
+#endif
+    
+    NSString *path = [NSBundle.mainBundle pathForResource:@"SKBenchmarkBaseline" ofType:@"json"];
+    NSDictionary *baseline = [DYFStoreConverter jsonObjectWithData:[NSData dataWithContentsOfFile:path]];
+    NSArray *regressions = [SKBenchmark regressionsInReport:report againstBaseline:baseline];
+    NSArray *unrecorded = [SKBenchmark unrecordedCasesInReport:report againstBaseline:baseline];
+    
+    return @{@"report": report, @"regressions": regressions, @"unrecorded": unrecorded};
+}
+
+@end
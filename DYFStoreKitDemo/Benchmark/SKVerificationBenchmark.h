@@ -0,0 +1,23 @@
+//
+//  SKVerificationBenchmark.h
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Compares verifying pending transactions one request at a time with `DYFStoreVerificationCoordinator`, without and with a warm verification cache, against the simulated receipt verifier.
+ */
+@interface SKVerificationBenchmark : NSObject
+
+/** Runs both approaches on the same pending transactions and returns the number of requests and the wall time of each.
+ 
+ @param count The number of pending transactions, e.g. 200.
+ @param receiptCount The number of distinct receipts that the transactions carry.
+ @param latency The time taken by each simulated request.
+ @return A report which can be serialized as JSON.
+ */
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count receiptCount:(NSUInteger)receiptCount latency:(NSTimeInterval)latency;
+
+@end
@@ -0,0 +1,153 @@
+//
+//  SKVerificationBenchmark.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+
+#import "SKVerificationBenchmark.h"
+#import "DYFStore.h"
+#import "DYFStoreUserDefaultsPersistence.h"
+#import "DYFStoreSimulatedReceiptVerifier.h"
+#import "DYFStoreVerificationCoordinator.h"
+#import "SKBenchmark.h"
+
+@interface SKVerificationBenchmark () <DYFStoreVerificationCoordinatorDelegate>
+@property (nonatomic, strong) dispatch_semaphore_t finished;
+@property (nonatomic, strong) DYFStoreVerificationResult *result;
+@end
+
+@implementation SKVerificationBenchmark
+
+/** Builds transactions that share `receiptCount` receipts, as happens when several purchases are pending at the same time.
+ */
++ (NSArray<DYFStoreTransaction *> *)transactionsWithCount:(NSUInteger)count receiptCount:(NSUInteger)receiptCount
+{
+    receiptCount = MAX(MIN(receiptCount, count), 1);
+    NSMutableArray *transactions = [NSMutableArray arrayWithCapacity:count];
+    
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        DYFStoreTransaction *transaction = [[DYFStoreTransaction alloc] init];
+        transaction.state = DYFStoreTransactionStatePurchased;
+        transaction.productIdentifier = @"com.dyf.storekit.gold";
+        transaction.userIdentifier = @"user-32";
+        transaction.transactionIdentifier = [NSString stringWithFormat:@"%lu", (unsigned long)(100000 + idx)];
+        transaction.originalTransactionIdentifier = transaction.transactionIdentifier;
+        transaction.transactionTimestamp = [NSString stringWithFormat:@"%lu", (unsigned long)(1600000000 + idx)];
+        [transactions addObject:transaction];
+    }
+    
+    // Every receipt lists all transactions that were made before it was issued.
+    NSUInteger share = (count + receiptCount - 1) / receiptCount;
+    for (NSUInteger start = 0; start < count; start += share) {
+        NSUInteger end = MIN(start + share, count);
+        NSData *receipt = [DYFStoreSimulatedReceiptVerifier receiptDataWithTransactions:[transactions subarrayWithRange:NSMakeRange(0, end)]];
+        NSString *base64 = receipt.base64EncodedString;
+        for (NSUInteger idx = start; idx < end; idx++) {
+            transactions[idx].transactionReceipt = base64;
+        }
+    }
+    
+    return transactions;
+}
+
++ (void)storeTransactions:(NSArray<DYFStoreTransaction *> *)transactions persister:(DYFStoreUserDefaultsPersistence *)persister
+{
+    [persister removeTransactions];
+    for (DYFStoreTransaction *transaction in transactions) {
+        [persister storeTransaction:transaction];
+    }
+}
+
+/** The flow of the sample before batching: one request per transaction, each followed by its own removal.
+ */
++ (NSDictionary *)runSequentialWithPersister:(DYFStoreUserDefaultsPersistence *)persister verifier:(DYFStoreSimulatedReceiptVerifier *)verifier
+{
+    [verifier resetRequestCount];
+    __block NSUInteger verified = 0;
+    uint64_t start = SKBenchmarkNow();
+    
+    for (DYFStoreTransaction *transaction in [persister retrieveTransactions]) {
+        dispatch_semaphore_t done = dispatch_semaphore_create(0);
+        [verifier verifyReceipt:transaction.transactionReceipt.base64DecodedData completion:^(NSDictionary *response, NSError *error) {
+            if (!error && [response[@"status"] integerValue] == 0) {
+                verified++;
+            }
+            dispatch_semaphore_signal(done);
+        }];
+        dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+        [persister removeTransaction:transaction.transactionIdentifier];
+    }
+    
+    double milliseconds = (SKBenchmarkNow() - start) / 1e6;
+    return @{@"requests": @(verifier.requestCount),
+             @"verified": @(verified),
+             @"wall_ms": @(milliseconds)};
+}
+
+- (NSDictionary *)runBatchedWithPersister:(DYFStoreUserDefaultsPersistence *)persister verifier:(DYFStoreSimulatedReceiptVerifier *)verifier cache:(DYFStoreVerificationCache *)cache
+{
+    [verifier resetRequestCount];
+    
+    DYFStoreVerificationCoordinator *coordinator = [[DYFStoreVerificationCoordinator alloc] initWithPersister:persister verifier:verifier];
+    coordinator.store = nil;
+    coordinator.cache = cache;
+    coordinator.callbackQueue = dispatch_queue_create("com.dyf.storekit.benchmark.verification", DISPATCH_QUEUE_SERIAL);
+    coordinator.delegate = self;
+    self.finished = dispatch_semaphore_create(0);
+    
+    uint64_t start = SKBenchmarkNow();
+    [coordinator setNeedsVerification];
+    dispatch_semaphore_wait(self.finished, DISPATCH_TIME_FOREVER);
+    double milliseconds = (SKBenchmarkNow() - start) / 1e6;
+    
+    return @{@"requests": @(self.result.requestCount),
+             @"verified": @(self.result.verifiedTransactions.count),
+             @"unresolved": @(self.result.unresolvedTransactions.count),
+             @"cache_hits": @(self.result.cacheHitCount),
+             @"wall_ms": @(milliseconds)};
+}
+
+- (void)verificationCoordinator:(DYFStoreVerificationCoordinator *)coordinator didFinishWithResult:(DYFStoreVerificationResult *)result
+{
+    self.result = result;
+    dispatch_semaphore_signal(self.finished);
+}
+
++ (NSDictionary *)runWithTransactionCount:(NSUInteger)count receiptCount:(NSUInteger)receiptCount latency:(NSTimeInterval)latency
+{
+    DYFStoreUserDefaultsPersistence *persister = [[DYFStoreUserDefaultsPersistence alloc] init];
+    NSArray<DYFStoreTransaction *> *saved = [persister retrieveTransactions];
+    NSArray<DYFStoreTransaction *> *transactions = [self transactionsWithCount:count receiptCount:receiptCount];
+    
+    DYFStoreSimulatedReceiptVerifier *verifier = [[DYFStoreSimulatedReceiptVerifier alloc] init];
+    verifier.latency = latency;
+    
+    [self storeTransactions:transactions persister:persister];
+    NSDictionary *sequential = [self runSequentialWithPersister:persister verifier:verifier];
+    
+    [self storeTransactions:transactions persister:persister];
+    NSDictionary *batched = [[[self alloc] init] runBatchedWithPersister:persister verifier:verifier cache:nil];
+    
+    // The first pass fills the cache, the measured one stands for a retry or a relaunch with the same receipts.
+    NSString *cachePath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"SKVerificationBenchmarkCache.json"];
+    [NSFileManager.defaultManager removeItemAtPath:cachePath error:nil];
+    DYFStoreVerificationCache *cache = [[DYFStoreVerificationCache alloc] initWithPath:cachePath];
+    [self storeTransactions:transactions persister:persister];
+    [[[self alloc] init] runBatchedWithPersister:persister verifier:verifier cache:cache];
+    [self storeTransactions:transactions persister:persister];
+    NSDictionary *cached = [[[self alloc] init] runBatchedWithPersister:persister verifier:verifier cache:cache];
+    [NSFileManager.defaultManager removeItemAtPath:cachePath error:nil];
+    
+    // Puts back what the app had stored before the run.
+    [self storeTransactions:saved ?: @[] persister:persister];
+    
+    return @{@"transactions": @(count),
+             @"receipts": @(receiptCount),
+             @"latency_ms": @(latency * 1000),
+             @"sequential": sequential,
+             @"batched": batched,
+             @"cached": cached};
+}
+
+@end
@@ -6,6 +6,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import <StoreKit/StoreKit.h>
 
 @interface SKStoreProduct : NSObject
 
@@ -29,4 +30,12 @@
  */
 @property (nonatomic, copy) NSString *localizedDescription;
 
+/** Creates a model that shows the given product.
+ */
++ (instancetype)productWithProduct:(SKProduct *)product;
+
+/** Updates the model with the price, name and description of the given product.
+ */
+- (void)updateWithProduct:(SKProduct *)product;
+
 @end
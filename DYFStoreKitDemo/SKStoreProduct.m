@@ -6,7 +6,22 @@
 //
 
 #import "SKStoreProduct.h"
+#import "DYFStore.h"
 
 @implementation SKStoreProduct
 
++ (instancetype)productWithProduct:(SKProduct *)product {
+    SKStoreProduct *p = [[SKStoreProduct alloc] init];
+    p.identifier = product.productIdentifier;
+    [p updateWithProduct:product];
+    return p;
+}
+
+- (void)updateWithProduct:(SKProduct *)product {
+    self.name = product.localizedTitle;
+    self.price = [product.price stringValue];
+    self.localePrice = [DYFStore.defaultStore localizedPriceOfProduct:product];
+    self.localizedDescription = product.localizedDescription;
+}
+
 @end
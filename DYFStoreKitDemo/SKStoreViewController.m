@@ -25,6 +25,56 @@
     [super viewDidLoad];
     self.navigationItem.title = NSLocalizedString(@"Store", @"");
     [self addRightBarButtonItem];
+    [self addCatalogObserver];
+}
+
+- (void)addCatalogObserver {
+    [NSNotificationCenter.defaultCenter addObserver:self selector:@selector(catalogDidChange:) name:DYFStoreCatalogChangedNotification object:nil];
+}
+
+- (void)catalogDidChange:(NSNotification *)notification {
+    DYFStoreCatalogChangeset *changeset = notification.object;
+    
+    NSMutableDictionary<NSString *, NSNumber *> *indexes = [NSMutableDictionary dictionaryWithCapacity:self.dataArray.count];
+    [self.dataArray enumerateObjectsUsingBlock:^(SKStoreProduct *obj, NSUInteger idx, BOOL *stop) {
+        indexes[obj.identifier] = @(idx);
+    }];
+    
+    // Updates the shown rows in place, they keep their positions.
+    NSMutableArray<NSIndexPath *> *reloadedRows = [NSMutableArray array];
+    for (SKProduct *product in changeset.updatedProducts) {
+        NSNumber *index = indexes[product.productIdentifier];
+        if (!index) { continue; }
+        [self.dataArray[index.unsignedIntegerValue] updateWithProduct:product];
+        [reloadedRows addObject:[NSIndexPath indexPathForRow:index.integerValue inSection:0]];
+    }
+    
+    NSMutableIndexSet *removedIndexes = [NSMutableIndexSet indexSet];
+    NSMutableArray<NSIndexPath *> *deletedRows = [NSMutableArray array];
+    for (NSString *identifier in changeset.removedProductIdentifiers) {
+        NSNumber *index = indexes[identifier];
+        if (!index) { continue; }
+        [removedIndexes addIndex:index.unsignedIntegerValue];
+        [deletedRows addObject:[NSIndexPath indexPathForRow:index.integerValue inSection:0]];
+    }
+    [self.dataArray removeObjectsAtIndexes:removedIndexes];
+    
+    NSMutableArray<NSIndexPath *> *insertedRows = [NSMutableArray array];
+    for (SKProduct *product in changeset.addedProducts) {
+        if (indexes[product.productIdentifier]) { continue; }
+        [insertedRows addObject:[NSIndexPath indexPathForRow:self.dataArray.count inSection:0]];
+        [self.dataArray addObject:[SKStoreProduct productWithProduct:product]];
+    }
+    
+    if (reloadedRows.count == 0 && deletedRows.count == 0 && insertedRows.count == 0) {
+        return;
+    }
+    
+    [self.storeTableView beginUpdates];
+    [self.storeTableView reloadRowsAtIndexPaths:reloadedRows withRowAnimation:UITableViewRowAnimationNone];
+    [self.storeTableView deleteRowsAtIndexPaths:deletedRows withRowAnimation:UITableViewRowAnimationFade];
+    [self.storeTableView insertRowsAtIndexPaths:insertedRows withRowAnimation:UITableViewRowAnimationFade];
+    [self.storeTableView endUpdates];
 }
 
 - (void)addRightBarButtonItem {
@@ -83,6 +133,7 @@
 }
 
 - (void)dealloc {
+    [NSNotificationCenter.defaultCenter removeObserver:self name:DYFStoreCatalogChangedNotification object:nil];
     DYFStoreLog();
 }
 
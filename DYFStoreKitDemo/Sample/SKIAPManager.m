@@ -24,13 +24,24 @@
 //
 
 #import "SKIAPManager.h"
+#import "SKReceiptVerifierAdapter.h"
+#import "DYFStoreRetryScheduler.h"
+#import "DYFStoreSubscriptionTimeline.h"
+#import <SystemConfiguration/SystemConfiguration.h>
 
-@interface SKIAPManager () <DYFStoreReceiptVerifierDelegate>
+@interface SKIAPManager () <DYFStoreVerificationCoordinatorDelegate, DYFStoreRetrySchedulerDelegate, DYFStoreSubscriptionTimelineDelegate>
 
 @property (nonatomic, strong) DYFStoreNotificationInfo *purchaseInfo;
 @property (nonatomic, strong) DYFStoreNotificationInfo *downloadInfo;
 
-@property (nonatomic, strong) DYFStoreReceiptVerifier *receiptVerifier;
+@property (nonatomic, strong) DYFStoreVerificationCoordinator *verificationCoordinator;
+@property (nonatomic, strong) DYFStoreRetryScheduler *retryScheduler;
+@property (nonatomic, strong) DYFStoreSubscriptionTimeline *subscriptionTimeline;
+@property (nonatomic, assign) SCNetworkReachabilityRef reachability;
+// Whether a purchase waits for the receipt to be refreshed before it is stored.
+@property (nonatomic, assign) BOOL waitsForReceipt;
+// The purchased or restored transactions to store once the receipt is available, of every batch that arrived meanwhile.
+@property (nonatomic, strong) NSMutableArray<DYFStoreNotificationInfo *> *pendingInfos;
 
 @end
 
@@ -61,6 +72,7 @@ static SKIAPManager *_instance = nil;
 
 - (void)setup
 {
+    self.pendingInfos = [NSMutableArray array];
     //[self addStoreObserver];
 }
 
@@ -91,6 +103,45 @@ static SKIAPManager *_instance = nil;
 {
     [NSNotificationCenter.defaultCenter addObserver:self selector:@selector(processPurchaseNotification:) name:DYFStorePurchasedNotification object:nil];
     [NSNotificationCenter.defaultCenter addObserver:self selector:@selector(processDownloadNotification:) name:DYFStoreDownloadedNotification object:nil];
+    // The restored transactions are stored, verified and finished together once the restore completes.
+    [NSNotificationCenter.defaultCenter addObserver:self selector:@selector(processRestoreNotification:) name:DYFStoreRestoreCompletedNotification object:nil];
+    DYFStore.defaultStore.aggregatesRestoredTransactions = YES;
+    
+    // Answers "does the user own this product?" from the snapshot of the last run. The first run builds it from the persisted transactions.
+    DYFStoreEntitlements *entitlements = [[DYFStoreEntitlements alloc] init];
+    if (entitlements.productCount == 0) {
+        [entitlements grantTransactions:[[[DYFStoreUserDefaultsPersistence alloc] init] retrieveTransactions]];
+        [entitlements synchronize];
+    }
+    DYFStore.defaultStore.entitlements = entitlements;
+    
+    // Resumes the retries of the transactions that were left unverified before the app quit.
+    [self.retryScheduler resume];
+    [self startMonitoringReachability];
+}
+
+static void SKReachabilityCallback(SCNetworkReachabilityRef target, SCNetworkReachabilityFlags flags, void *info)
+{
+    BOOL reachable = (flags & kSCNetworkReachabilityFlagsReachable) && !(flags & kSCNetworkReachabilityFlagsConnectionRequired);
+    if (reachable) {
+        SKIAPManager *manager = (__bridge SKIAPManager *)info;
+        [manager.retryScheduler networkDidBecomeReachable];
+    }
+}
+
+- (void)startMonitoringReachability
+{
+    if (self.reachability) { return; }
+    
+    SCNetworkReachabilityRef reachability = SCNetworkReachabilityCreateWithName(kCFAllocatorDefault, "buy.itunes.apple.com");
+    if (!reachability) { return; }
+    
+    // The manager is a singleton, so it outlives the callback.
+    SCNetworkReachabilityContext context = {0, (__bridge void *)self, NULL, NULL, NULL};
+    if (SCNetworkReachabilitySetCallback(reachability, SKReachabilityCallback, &context)) {
+        SCNetworkReachabilitySetDispatchQueue(reachability, dispatch_get_main_queue());
+    }
+    self.reachability = reachability;
 }
 
 - (void)removeStoreObserver
@@ -101,6 +152,9 @@ static SKIAPManager *_instance = nil;
     [NSNotificationCenter.defaultCenter removeObserver:self
                                                   name:DYFStoreDownloadedNotification
                                                 object:nil];
+    [NSNotificationCenter.defaultCenter removeObserver:self
+                                                  name:DYFStoreRestoreCompletedNotification
+                                                object:nil];
 }
 
 - (void)processPurchaseNotification:(NSNotification *)notification
@@ -132,6 +186,32 @@ static SKIAPManager *_instance = nil;
     }
 }
 
+- (void)processRestoreNotification:(NSNotification *)notification
+{
+    [self sk_hideLoading];
+    DYFStoreRestoreSession *session = notification.object;
+    DYFStoreLog(@"restored: %zi, duplicates: %zi, error: %@", session.infos.count, session.duplicateCount, session.error);
+    
+    // The failure has been noticed by the DYFStorePurchaseStateRestoreFailed notification.
+    if (session.error && session.infos.count == 0) { return; }
+    
+    DYFStoreUserDefaultsPersistence *persister = [[DYFStoreUserDefaultsPersistence alloc] init];
+    NSMutableArray<DYFStoreNotificationInfo *> *infos = [NSMutableArray arrayWithCapacity:session.infos.count];
+    for (DYFStoreNotificationInfo *info in session.infos) {
+        if (![persister containsTransaction:info.transactionIdentifier]) {
+            [infos addObject:info];
+        }
+    }
+    
+    if (infos.count > 0) {
+        [self storeTransactionsWithInfos:infos];
+    } else if (session.infos.count > 0) {
+        [self verifyPendingTransactions];
+    } else {
+        [self sendNotice:@"There are no purchases to restore"];
+    }
+}
+
 - (void)processDownloadNotification:(NSNotification *)notification
 {
     self.downloadInfo = notification.object;
@@ -163,12 +243,11 @@ static SKIAPManager *_instance = nil;
     
     NSString *identifier = info.transactionIdentifier;
     if (![persister containsTransaction:identifier]) {
-        [self storeReceipt];
+        [self storeTransactionsWithInfos:@[info]];
         return;
     }
     
     DYFStoreTransaction *tx = [persister retrieveTransaction:identifier];
-    NSData *receiptData = tx.transactionReceipt.base64DecodedData;
     DYFStoreLog(@"transaction.state: %zi", tx.state);
     DYFStoreLog(@"transaction.productIdentifier: %@", tx.productIdentifier);
     DYFStoreLog(@"transaction.userIdentifier: %@", tx.userIdentifier);
@@ -176,23 +255,47 @@ static SKIAPManager *_instance = nil;
     DYFStoreLog(@"transaction.transactionTimestamp: %@", tx.transactionTimestamp);
     DYFStoreLog(@"transaction.originalTransactionIdentifier: %@", tx.originalTransactionIdentifier);
     DYFStoreLog(@"transaction.originalTransactionTimestamp: %@", tx.originalTransactionTimestamp);
-    DYFStoreLog(@"transaction.transactionReceipt: %@", receiptData);
-    [self verifyReceipt:receiptData];
+    DYFStoreLog(@"transaction.transactionReceipt: %zi characters", tx.transactionReceipt.length);
+    [self verifyPendingTransactions];
 }
 
-- (void)storeReceipt
+/** Stores the purchased or restored transactions with the receipt, read once for all of them, and verifies them.
+ */
+- (void)storeTransactionsWithInfos:(NSArray<DYFStoreNotificationInfo *> *)infos
 {
-    DYFStoreLog();
-    NSURL *receiptURL = DYFStore.receiptURL;
-    NSData *data = [NSData dataWithContentsOfURL:receiptURL];
-    if (!data || data.length == 0) {
-        [self refreshReceipt];
+    DYFStoreLog(@"transactions: %zi, pending: %zi", infos.count, self.pendingInfos.count);
+    if (infos.count == 0 && self.pendingInfos.count == 0) { return; }
+    // The receipt is mapped rather than read. The warm-up has mapped and encoded it at launch, and maps it again only if a purchase changed it.
+    DYFStoreWarmUp *warmUp = DYFStore.defaultStore.warmUp;
+    DYFStoreReceiptHandle *receipt = warmUp ? warmUp.receipt : DYFStoreReceiptHandle.appStoreReceipt;
+    if (receipt.length == 0) {
+        // A batch that arrives while the receipt is refreshed waits for the same refresh.
+        [self.pendingInfos addObjectsFromArray:infos];
+        if (!self.waitsForReceipt) {
+            [self refreshReceipt];
+        }
         return;
     }
+    if (self.pendingInfos.count > 0) {
+        infos = [self.pendingInfos arrayByAddingObjectsFromArray:infos];
+        [self.pendingInfos removeAllObjects];
+    }
+    
+    // The encoding is kept by the handle, so the verification finds the mapped receipt instead of decoding it.
+    NSString *base64Receipt = receipt.base64EncodedString;
+    NSMutableArray<DYFStoreTransaction *> *transactions = [NSMutableArray arrayWithCapacity:infos.count];
+    for (DYFStoreNotificationInfo *info in infos) {
+        [transactions addObject:[self transactionWithInfo:info receipt:base64Receipt]];
+    }
     
-    DYFStoreNotificationInfo *info = self.purchaseInfo;
     DYFStoreUserDefaultsPersistence *persister = [[DYFStoreUserDefaultsPersistence alloc] init];
+    [persister storeTransactions:transactions];
     
+    [self verifyPendingTransactions];
+}
+
+- (DYFStoreTransaction *)transactionWithInfo:(DYFStoreNotificationInfo *)info receipt:(NSString *)receipt
+{
     DYFStoreTransaction *transaction = [[DYFStoreTransaction alloc] init];
     if (info.state == DYFStorePurchaseStateSucceeded) {
         transaction.state = DYFStoreTransactionStatePurchased;
@@ -206,11 +309,8 @@ static SKIAPManager *_instance = nil;
     transaction.transactionTimestamp = info.transactionDate.timestamp;
     transaction.originalTransactionTimestamp = info.originalTransactionDate.timestamp;
     transaction.originalTransactionIdentifier = info.originalTransactionIdentifier;
-    
-    transaction.transactionReceipt = data.base64EncodedString;
-    [persister storeTransaction:transaction];
-    
-    [self verifyReceipt:data];
+    transaction.transactionReceipt = receipt;
+    return transaction;
 }
 
 - (void)refreshReceipt
@@ -218,8 +318,10 @@ static SKIAPManager *_instance = nil;
     DYFStoreLog();
     [self sk_showLoading:@"Refresh receipt..."];
     
+    self.waitsForReceipt = YES;
     [DYFStore.defaultStore refreshReceiptOnSuccess:^{
-        [self storeReceipt];
+        self.waitsForReceipt = NO;
+        [self storeTransactionsWithInfos:@[]];
     } failure:^(NSError *error) {
         [self failToRefreshReceipt];
     }];
@@ -230,119 +332,155 @@ static SKIAPManager *_instance = nil;
     DYFStoreLog();
     [self sk_hideLoading];
     
+    // The scheduler keeps refreshing in the background and stores the purchase once it succeeds.
+    [self.retryScheduler scheduleReceiptRefresh];
+    [self sk_showTipsMessage:@"Fail to refresh receipt! It will be retried automatically."];
+}
+
+- (void)retrySchedulerDidRefreshReceipt:(DYFStoreRetryScheduler *)scheduler
+{
+    if (self.waitsForReceipt) {
+        self.waitsForReceipt = NO;
+        [self storeTransactionsWithInfos:@[]];
+    }
+}
+
+- (void)retryScheduler:(DYFStoreRetryScheduler *)scheduler didGiveUpOnTransactions:(NSArray<NSString *> *)transactionIdentifiers
+{
+    DYFStoreLog(@"gave up on transactions: %@", transactionIdentifiers);
+    
+    // After several attempts, let the user decide.
     [self sk_showAlertWithTitle:NSLocalizedStringFromTable(@"Notification", nil, @"")
-                        message:@"Fail to refresh receipt! Please check if your device can access the internet."
+                        message:@"Fail to verify receipt! Please check if your device can access the internet."
               cancelButtonTitle:@"Cancel"
-                         cancel:^(UIAlertAction *action) {}
+                         cancel:NULL
              confirmButtonTitle:NSLocalizedStringFromTable(@"Retry", nil, @"")
                         execute:^(UIAlertAction *action) {
-        [self refreshReceipt];
+        [self retryToVerifyReceipt];
     }];
 }
 
-// It is better to use your own server to obtain the parameters uploaded from the client to verify the receipt from the app store server (C -> Uploaded Parameters -> S -> App Store S -> S -> Receive And Parse Data -> C).
+/** Verifies the pending transactions in one pass, which sends each distinct receipt once.
+ */
+- (DYFStoreVerificationCoordinator *)verificationCoordinator
+{
+    if (!_verificationCoordinator) {
+        DYFStoreUserDefaultsPersistence *persister = [[DYFStoreUserDefaultsPersistence alloc] init];
+        SKReceiptVerifierAdapter *verifier = [[SKReceiptVerifierAdapter alloc] init];
+        // Only used for receipts that contain auto-renewable subscriptions.
+        //verifier.sharedSecret = @"A43512564ACBEF687924646CAFEFBDCAEDF4155125657";
+        _verificationCoordinator = [[DYFStoreVerificationCoordinator alloc] initWithPersister:persister verifier:verifier];
+        _verificationCoordinator.delegate = self;
+        
+        // Retries, restores and relaunches settle the transactions already verified against the same receipt without a request.
+        DYFStoreVerificationCache *cache = [[DYFStoreVerificationCache alloc] init];
+        _verificationCoordinator.cache = cache;
+        DYFStore.defaultStore.verificationCache = cache;
+    }
+    return _verificationCoordinator;
+}
+
+/** Tracks the periods of the auto-renewable subscriptions found in the verified receipts, and reports when they lapse.
+ */
+- (DYFStoreSubscriptionTimeline *)subscriptionTimeline
+{
+    if (!_subscriptionTimeline) {
+        _subscriptionTimeline = [[DYFStoreSubscriptionTimeline alloc] init];
+        // Covers the billing retry of a failed renewal.
+        //_subscriptionTimeline.gracePeriod = 16 * 24 * 3600;
+        _subscriptionTimeline.delegate = self;
+    }
+    return _subscriptionTimeline;
+}
+
+- (void)subscriptionTimeline:(DYFStoreSubscriptionTimeline *)timeline didChangeStatus:(DYFStoreSubscriptionStatus)status forGroup:(NSString *)group
+{
+    DYFStoreLog(@"subscription group: %@, status: %zi", group, status);
+    if (status == DYFStoreSubscriptionStatusLapsed) {
+        [self sk_showTipsMessage:@"Your subscription has expired."];
+    }
+}
+
+/** Retries the unresolved transactions and the failed receipt refreshes with backoff, also after a relaunch.
+ */
+- (DYFStoreRetryScheduler *)retryScheduler
+{
+    if (!_retryScheduler) {
+        _retryScheduler = [[DYFStoreRetryScheduler alloc] initWithCoordinator:self.verificationCoordinator clock:[[DYFStoreSystemClock alloc] init]];
+        _retryScheduler.delegate = self;
+    }
+    return _retryScheduler;
+}
+
+// It is better to use your own server to obtain the parameters uploaded from the client to verify the receipt from the app store server (C -> Uploaded Parameters -> S -> App Store S -> S -> Receive And Parse Data -> C).
 // If the receipts are verified by your own server, the client needs to upload these parameters, such as: "transaction identifier, bundle identifier, product identifier, user identifier, shared sceret(Subscription), receipt(Safe URL Base64), original transaction identifier(Optional), original transaction time(Optional) and the device information, etc.".
-- (void)verifyReceipt:(NSData *)receiptData
+- (void)verifyPendingTransactions
 {
     DYFStoreLog();
     [self sk_hideLoading];
     [self sk_showLoading:@"Verify receipt..."];
     
-    if (!_receiptVerifier) {
-        _receiptVerifier = [[DYFStoreReceiptVerifier alloc] init];
-        _receiptVerifier.delegate = self;
-    }
-    
-    NSData *data = receiptData ?: [NSData dataWithContentsOfURL:DYFStore.receiptURL];
-    DYFStoreLog(@"data: %@", data);
-    
-    [_receiptVerifier verifyReceipt:data];
-    // Only used for receipts that contain auto-renewable subscriptions.
-    //[_receiptVerifier verifyReceipt:data sharedSecret:@"A43512564ACBEF687924646CAFEFBDCAEDF4155125657"];
+    // Going through the scheduler makes sure it tracks the attempts.
+    [self.retryScheduler.coordinator setNeedsVerification];
 }
 
 - (void)retryToVerifyReceipt {
-    DYFStoreNotificationInfo *info = self.purchaseInfo;
-    DYFStoreUserDefaultsPersistence *persister = [[DYFStoreUserDefaultsPersistence alloc] init];
-    
-    NSString *identifier = info.transactionIdentifier;
-    DYFStoreTransaction *transaction = [persister retrieveTransaction:identifier];
-    NSData *receiptData = transaction.transactionReceipt.base64DecodedData;
-    [self verifyReceipt:receiptData];
+    [self sk_showLoading:@"Verify receipt..."];
+    [self.retryScheduler retryNow];
 }
 
-- (void)verifyReceiptDidFinish:(nonnull DYFStoreReceiptVerifier *)verifier didReceiveData:(nullable NSDictionary *)data
+// The verified and rejected transactions have been finished and removed by the coordinator. The transaction can be finished only after the client and server adopt secure communication and data encryption and the receipt verification is passed. In this way, we can avoid refreshing orders and cracking in-app purchase. If we were unable to complete the verification, we want `StoreKit` to keep reminding us that there are still outstanding transactions.
+- (void)verificationCoordinator:(DYFStoreVerificationCoordinator *)coordinator didFinishWithResult:(DYFStoreVerificationResult *)result
 {
-    DYFStoreLog(@"data: %@", data);
+    DYFStoreLog(@"requests: %zi, cache hits: %zi, verified: %zi, rejected: %zi, unresolved: %zi", result.requestCount, result.cacheHitCount, result.verifiedTransactions.count, result.rejectedTransactions.count, result.unresolvedTransactions.count);
     [self sk_hideLoading];
-    [self sk_showTipsMessage:@"Purchase Successfully"];
     
-    dispatch_time_t time = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(1.0 * NSEC_PER_SEC));
-    dispatch_after(time, dispatch_get_main_queue(), ^{
-        DYFStoreNotificationInfo *info = self.purchaseInfo;
-        DYFStore *store = DYFStore.defaultStore;
-        DYFStoreUserDefaultsPersistence *persister = [[DYFStoreUserDefaultsPersistence alloc] init];
-        
-        if (info.state == DYFStorePurchaseStateRestored) {
-            SKPaymentTransaction *transaction = [store extractRestoredTransaction:info.transactionIdentifier];
-            [store finishTransaction:transaction];
-        } else {
-            SKPaymentTransaction *transaction = [store extractPurchasedTransaction:info.transactionIdentifier];
-            // The transaction can be finished only after the client and server adopt secure communication and data encryption and the receipt verification is passed. In this way, we can avoid refreshing orders and cracking in-app purchase. If we were unable to complete the verification, we want `StoreKit` to keep reminding us that there are still outstanding transactions.
-            [store finishTransaction:transaction];
-        }
-        
-        [persister removeTransaction:info.transactionIdentifier];
-        
-        if (info.originalTransactionIdentifier) {
-            [persister removeTransaction:info.originalTransactionIdentifier];
-        }
-    });
-}
-
-- (void)verifyReceipt:(nonnull DYFStoreReceiptVerifier *)verifier didFailWithError:(nonnull NSError *)error
-{
-    // Prints the reason of the error.
-    DYFStoreLog(@"error: %zi, %@", error.code, error.localizedDescription);
-    [self sk_hideLoading];
+    // The products were granted as the transactions finished. Takes back the ones the App Store rejected, unless the user still owns them another way.
+    [self revokeProductsOfRejectedTransactions:result];
     
-    // An error occurs that has nothing to do with in-app purchase. Maybe it's the internet.
-    if (error.code < 21000) {
-        // After several attempts, you can cancel refreshing receipt.
-        [self sk_showAlertWithTitle:NSLocalizedStringFromTable(@"Notification", nil, @"")
-                            message:@"Fail to verify receipt! Please check if your device can access the internet."
-                  cancelButtonTitle:@"Cancel"
-                             cancel:NULL
-                 confirmButtonTitle:NSLocalizedStringFromTable(@"Retry", nil, @"")
-                            execute:^(UIAlertAction *action) {
-            [self verifyReceipt:nil];
-        }];
+    // Entries without an expiration date are not subscriptions and are skipped.
+    [self.subscriptionTimeline addReceiptEntries:result.receiptEntries.allValues];
+    
+    // An error occurs that has nothing to do with in-app purchase. Maybe it's the internet. The retry scheduler tries again later.
+    if (result.error) {
+        [self sk_showTipsMessage:@"Fail to verify receipt! It will be retried automatically."];
         return;
     }
     
-    [self sk_showTipsMessage:@"Fail to purchase product!"];
+    if (result.verifiedTransactions.count > 0) {
+        [self sk_showTipsMessage:@"Purchase Successfully"];
+    } else if (result.rejectedTransactions.count > 0) {
+        [self sk_showTipsMessage:@"Fail to purchase product!"];
+    }
+}
+
+/** Revokes the products of the rejected transactions from their users, once per product and user. A product is kept if the pass found the user entitled to it, e.g. by a restore or an earlier purchase in a valid receipt, or if another transaction of it is still waiting to be verified.
+ */
+- (void)revokeProductsOfRejectedTransactions:(DYFStoreVerificationResult *)result
+{
+    if (result.rejectedTransactions.count == 0) { return; }
     
-    dispatch_time_t time = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(1.0 * NSEC_PER_SEC));
-    dispatch_after(time, dispatch_get_main_queue(), ^{
-        DYFStoreNotificationInfo *info = self.purchaseInfo;
-        DYFStore *store = DYFStore.defaultStore;
-        DYFStoreUserDefaultsPersistence *persister = [[DYFStoreUserDefaultsPersistence alloc] init];
+    DYFStoreEntitlements *entitlements = DYFStore.defaultStore.entitlements;
+    id<DYFStoreTransactionPersistence> persister = self.verificationCoordinator.persister;
+    NSMutableSet<NSString *> *checked = [NSMutableSet set];
+    
+    for (DYFStoreTransaction *transaction in result.rejectedTransactions) {
+        NSString *productIdentifier = transaction.productIdentifier;
+        NSString *userIdentifier = transaction.userIdentifier;
+        NSString *pair = [NSString stringWithFormat:@"%@\n%@", productIdentifier ?: @"", userIdentifier ?: @""];
+        if (!productIdentifier || [checked containsObject:pair]) { continue; }
+        [checked addObject:pair];
         
-        if (info.state == DYFStorePurchaseStateRestored) {
-            SKPaymentTransaction *transaction = [store extractRestoredTransaction:info.transactionIdentifier];
-            [store finishTransaction:transaction];
-        } else {
-            SKPaymentTransaction *transaction = [store extractPurchasedTransaction:info.transactionIdentifier];
-            // The transaction can be finished only after the client and server adopt secure communication and data encryption and the receipt verification is passed. In this way, we can avoid refreshing orders and cracking in-app purchase. If we were unable to complete the verification, we want `StoreKit` to keep reminding us that there are still outstanding transactions.
-            [store finishTransaction:transaction];
-        }
+        if ([result entitlesProduct:productIdentifier toUser:userIdentifier]) { continue; }
         
-        [persister removeTransaction:info.transactionIdentifier];
+        DYFStoreTransactionQuery *query = [DYFStoreTransactionQuery queryWithUserIdentifier:userIdentifier];
+        query.productIdentifier = productIdentifier;
+        query.limit = 1;
+        if ([persister retrieveTransactionHeadersMatchingQuery:query].count > 0) { continue; }
         
-        if (info.originalTransactionIdentifier) {
-            [persister removeTransaction:info.originalTransactionIdentifier];
-        }
-    });
+        [entitlements revokeProduct:productIdentifier fromUser:userIdentifier];
+    }
+    [entitlements synchronize];
 }
 
 - (void)sendNotice:(NSString *)message
@@ -0,0 +1,98 @@
+//
+//  SKReceiptVerifierAdapter.m
+//
+//  Created by Tenfay on 2014/11/4.
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "SKReceiptVerifierAdapter.h"
+#import "DYFStore.h"
+#import "DYFStoreReceiptVerifier.h"
+
+/** Turns the delegate callbacks of one verifier into a completion.
+ */
+@interface SKReceiptVerification : NSObject <DYFStoreReceiptVerifierDelegate>
+@property (nonatomic, strong) DYFStoreReceiptVerifier *verifier;
+@property (nonatomic, copy) DYFStoreReceiptVerificationCompletion completion;
+@property (nonatomic, copy) void (^cleanup)(SKReceiptVerification *verification);
+@end
+
+@implementation SKReceiptVerification
+
+- (void)verifyReceiptDidFinish:(nonnull DYFStoreReceiptVerifier *)verifier didReceiveData:(nullable NSDictionary *)data
+{
+    DYFStoreMetricsEnd(verifier, DYFStoreMetricVerification);
+    self.completion(data, nil);
+    self.cleanup(self);
+}
+
+- (void)verifyReceipt:(nonnull DYFStoreReceiptVerifier *)verifier didFailWithError:(nonnull NSError *)error
+{
+    DYFStoreLog(@"error: %zi, %@", error.code, error.localizedDescription);
+    DYFStoreMetricsEnd(verifier, DYFStoreMetricVerification);
+    self.completion(nil, error);
+    self.cleanup(self);
+}
+
+@end
+
+@interface SKReceiptVerifierAdapter ()
+@property (nonatomic, strong) NSMutableSet<SKReceiptVerification *> *verifications;
+@end
+
+@implementation SKReceiptVerifierAdapter
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _verifications = [NSMutableSet set];
+    }
+    return self;
+}
+
+- (void)verifyReceipt:(NSData *)receiptData completion:(DYFStoreReceiptVerificationCompletion)completion
+{
+    SKReceiptVerification *verification = [[SKReceiptVerification alloc] init];
+    verification.verifier = [[DYFStoreReceiptVerifier alloc] init];
+    verification.verifier.delegate = verification;
+    verification.completion = completion;
+    
+    // The verification keeps itself alive until one of its callbacks.
+    __weak typeof(self) weakSelf = self;
+    verification.cleanup = ^(SKReceiptVerification *v) {
+        @synchronized (weakSelf.verifications) {
+            [weakSelf.verifications removeObject:v];
+        }
+    };
+    @synchronized (self.verifications) {
+        [self.verifications addObject:verification];
+    }
+    
+    DYFStoreMetricsBegin(verification.verifier, DYFStoreMetricVerification);
+    if (self.sharedSecret) {
+        [verification.verifier verifyReceipt:receiptData sharedSecret:self.sharedSecret];
+    } else {
+        [verification.verifier verifyReceipt:receiptData];
+    }
+}
+
+@end
@@ -115,13 +115,7 @@
 {
     NSMutableArray *modelArray = [NSMutableArray arrayWithCapacity:0];
     for (SKProduct *product in products) {
-        SKStoreProduct *p = [[SKStoreProduct alloc] init];
-        p.identifier = product.productIdentifier;
-        p.name = product.localizedTitle;
-        p.price = [product.price stringValue];
-        p.localePrice = [DYFStore.defaultStore localizedPriceOfProduct:product];
-        p.localizedDescription = product.localizedDescription;
-        [modelArray addObject:p];
+        [modelArray addObject:[SKStoreProduct productWithProduct:product]];
     }
     [self displayStoreUI:modelArray];
 }
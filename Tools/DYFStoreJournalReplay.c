@@ -0,0 +1,348 @@
+//
+//  DYFStoreJournalReplay.c
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Rebuilds the lifecycle of every transaction from a journal written by `DYFStoreJournal`, e.g. one copied from a device, and reports the transactions that are stuck or were processed twice, and the time spent in every step.
+//
+//     cc -O2 -Wall -o DYFStoreJournalReplay Tools/DYFStoreJournalReplay.c Classes/DYFStoreJournal.c
+//     ./DYFStoreJournalReplay [-v] DYFStoreKit.journal
+//
+// With -v, every transaction is printed, not only the anomalous ones.
+//
+#include "../Classes/DYFStoreJournal.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The values of SKPaymentTransactionState and SKDownloadState, which the events record.
+static const char *const DYFReplayTransactionStates[] = {"purchasing", "purchased", "failed", "restored", "deferred"};
+static const char *const DYFReplayDownloadStates[] = {"waiting", "active", "paused", "finished", "failed", "cancelled"};
+
+enum {
+    DYFReplayStatePurchasing = 0,
+    DYFReplayStatePurchased = 1,
+    DYFReplayStateFailed = 2,
+    DYFReplayStateRestored = 3,
+    DYFReplayStateDeferred = 4,
+    DYFReplayStateNone = 0xFFFF
+};
+
+// The anomalies of a transaction.
+enum {
+    /** Purchased or restored again before it was finished, e.g. after a relaunch. */
+    DYFReplayRedelivered = 1 << 0,
+    /** Finished more than once. */
+    DYFReplayFinishedTwice = 1 << 1,
+    /** Updated after it was finished. */
+    DYFReplayUpdatedAfterFinish = 1 << 2,
+    /** Finished while purchasing or deferred. */
+    DYFReplayFinishedEarly = 1 << 3,
+    /** Purchased, restored or failed, and never finished. */
+    DYFReplayUnfinished = 1 << 4,
+    /** Its first events were overwritten in the ring, so its timing is partial. */
+    DYFReplayTruncated = 1 << 5
+};
+
+/** The state machine of a transaction, rebuilt from its events.
+ */
+typedef struct {
+    uint64_t hash;
+    uint32_t productHash;
+    uint16_t state;
+    uint16_t finishes;
+    uint32_t deliveries;
+    uint32_t downloads;
+    uint32_t flags;
+    int32_t errorCode;
+    uint64_t purchasingAt;
+    uint64_t firstAt;
+    uint64_t completedAt;
+    uint64_t finishedAt;
+    /** The kind of the first event seen. */
+    uint16_t firstKind;
+} DYFReplayTransaction;
+
+/** A payment that is purchasing, which has no transaction identifier yet.
+ */
+typedef struct {
+    uint32_t productHash;
+    int taken;
+    uint64_t timestamp;
+} DYFReplayPurchasing;
+
+typedef struct {
+    DYFReplayTransaction *slots;
+    size_t mask;
+    size_t count;
+} DYFReplayTable;
+
+typedef struct {
+    uint64_t *values;
+    size_t count;
+} DYFReplaySamples;
+
+static const char *DYFReplayStateName(uint16_t state)
+{
+    if (state < sizeof(DYFReplayTransactionStates) / sizeof(*DYFReplayTransactionStates)) {
+        return DYFReplayTransactionStates[state];
+    }
+    return "none";
+}
+
+static const char *DYFReplayDownloadStateName(uint16_t state)
+{
+    if (state < sizeof(DYFReplayDownloadStates) / sizeof(*DYFReplayDownloadStates)) {
+        return DYFReplayDownloadStates[state];
+    }
+    return "unknown";
+}
+
+static DYFReplayTransaction *DYFReplayLookUp(DYFReplayTable *table, uint64_t hash)
+{
+    for (size_t idx = (size_t)hash & table->mask;; idx = (idx + 1) & table->mask) {
+        DYFReplayTransaction *transaction = &table->slots[idx];
+        if (transaction->hash == hash) { return transaction; }
+        if (transaction->hash != 0) { continue; }
+        
+        transaction->hash = hash;
+        transaction->state = DYFReplayStateNone;
+        table->count++;
+        return transaction;
+    }
+}
+
+/** Takes the earliest purchasing payment of a product, which became the transaction.
+ */
+static uint64_t DYFReplayTakePurchasing(DYFReplayPurchasing *purchasing, size_t count, uint32_t productHash, uint64_t timestamp)
+{
+    for (size_t idx = 0; idx < count; idx++) {
+        if (purchasing[idx].taken || purchasing[idx].productHash != productHash || purchasing[idx].timestamp > timestamp) { continue; }
+        purchasing[idx].taken = 1;
+        return purchasing[idx].timestamp;
+    }
+    return 0;
+}
+
+static void DYFReplayAddSample(DYFReplaySamples *samples, uint64_t value)
+{
+    samples->values[samples->count++] = value;
+}
+
+static int DYFReplayCompareValues(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void DYFReplayPrintSamples(const char *name, DYFReplaySamples *samples)
+{
+    if (samples->count == 0) {
+        printf("  %-24s no samples\n", name);
+        return;
+    }
+    qsort(samples->values, samples->count, sizeof(uint64_t), DYFReplayCompareValues);
+    size_t last = samples->count - 1;
+    printf("  %-24s n=%zu p50=%.3fms p90=%.3fms p99=%.3fms max=%.3fms\n", name, samples->count,
+           samples->values[last * 50 / 100] / 1e3, samples->values[last * 90 / 100] / 1e3,
+           samples->values[last * 99 / 100] / 1e3, samples->values[last] / 1e3);
+}
+
+static void DYFReplayPrintTransaction(const DYFReplayTransaction *transaction)
+{
+    printf("%016llx product=%08x state=%s deliveries=%u downloads=%u finishes=%u",
+           (unsigned long long)transaction->hash, transaction->productHash, DYFReplayStateName(transaction->state),
+           transaction->deliveries, transaction->downloads, transaction->finishes);
+    if (transaction->errorCode != 0) {
+        printf(" error=%d", transaction->errorCode);
+    }
+    if (transaction->completedAt && transaction->finishedAt) {
+        printf(" finished_after=%.3fms", (transaction->finishedAt - transaction->completedAt) / 1e3);
+    }
+    
+    static const char *const names[] = {"redelivered", "finished-twice", "updated-after-finish", "finished-early", "unfinished", "truncated"};
+    for (size_t bit = 0; bit < sizeof(names) / sizeof(*names); bit++) {
+        if (transaction->flags & (1u << bit)) {
+            printf(" [%s]", names[bit]);
+        }
+    }
+    printf("\n");
+}
+
+/** Applies an event of a transaction to its state machine.
+ */
+static void DYFReplayApply(DYFReplayTransaction *transaction, const DYFStoreJournalEvent *event, DYFReplayPurchasing *purchasing, size_t purchasingCount, int verbose)
+{
+    if (transaction->firstAt == 0) {
+        transaction->firstAt = event->timestamp;
+        transaction->firstKind = event->kind;
+    }
+    if (event->productHash != 0) {
+        transaction->productHash = event->productHash;
+    }
+    
+    switch (event->kind) {
+        case DYFStoreJournalEventUpdated: {
+            uint16_t state = event->state;
+            if (transaction->finishes > 0) {
+                transaction->flags |= DYFReplayUpdatedAfterFinish;
+            }
+            if (state == DYFReplayStatePurchased || state == DYFReplayStateRestored || state == DYFReplayStateFailed) {
+                if (transaction->completedAt == 0) {
+                    transaction->completedAt = event->timestamp;
+                    transaction->purchasingAt = DYFReplayTakePurchasing(purchasing, purchasingCount, transaction->productHash, event->timestamp);
+                } else if (transaction->finishes == 0) {
+                    transaction->flags |= DYFReplayRedelivered;
+                }
+                transaction->deliveries++;
+            }
+            if (state == DYFReplayStateFailed) {
+                transaction->errorCode = event->errorCode;
+            }
+            transaction->state = state;
+            break;
+        }
+        case DYFStoreJournalEventDownload:
+            transaction->downloads++;
+            if (verbose) {
+                printf("  %016llx download %s\n", (unsigned long long)transaction->hash, DYFReplayDownloadStateName(event->state));
+            }
+            break;
+        case DYFStoreJournalEventFinished:
+            if (transaction->finishes > 0) {
+                transaction->flags |= DYFReplayFinishedTwice;
+            }
+            if (transaction->state == DYFReplayStatePurchasing || transaction->state == DYFReplayStateDeferred) {
+                transaction->flags |= DYFReplayFinishedEarly;
+            }
+            transaction->finishes++;
+            transaction->finishedAt = event->timestamp;
+            break;
+        default:
+            break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int verbose = argc > 2 && strcmp(argv[1], "-v") == 0;
+    if (argc != 2 + verbose) {
+        fprintf(stderr, "usage: %s [-v] journal\n", argv[0]);
+        return 2;
+    }
+    
+    DYFStoreJournalEvent *events = NULL;
+    long count = DYFStoreJournalCopyEvents(argv[1 + verbose], &events);
+    if (count < 0) {
+        fprintf(stderr, "%s: %s\n", argv[1 + verbose], strerror(errno));
+        return 1;
+    }
+    if (count == 0) {
+        printf("The journal is empty.\n");
+        return 0;
+    }
+    
+    size_t capacity = 16;
+    while (capacity < (size_t)count * 2) {
+        capacity <<= 1;
+    }
+    DYFReplayTable table = {calloc(capacity, sizeof(DYFReplayTransaction)), capacity - 1, 0};
+    DYFReplayPurchasing *purchasing = calloc((size_t)count, sizeof(DYFReplayPurchasing));
+    DYFReplaySamples toCompleted = {calloc((size_t)count, sizeof(uint64_t)), 0};
+    DYFReplaySamples toFinished = {calloc((size_t)count, sizeof(uint64_t)), 0};
+    if (!table.slots || !purchasing || !toCompleted.values || !toFinished.values) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    
+    // The events are replayed in the order they were appended.
+    size_t purchasingCount = 0, paymentsAdded = 0, restores = 0, failedRestores = 0;
+    for (long idx = 0; idx < count; idx++) {
+        const DYFStoreJournalEvent *event = &events[idx];
+        if (event->kind == DYFStoreJournalEventPaymentAdded) {
+            paymentsAdded++;
+            continue;
+        }
+        if (event->kind == DYFStoreJournalEventRestoreFinished) {
+            restores++;
+            failedRestores += event->errorCode != 0;
+            continue;
+        }
+        if (event->transactionHash == 0) {
+            // A transaction is purchasing before it has an identifier.
+            if (event->kind == DYFStoreJournalEventUpdated && event->state == DYFReplayStatePurchasing) {
+                purchasing[purchasingCount++] = (DYFReplayPurchasing){event->productHash, 0, event->timestamp};
+            }
+            continue;
+        }
+        DYFReplayTransaction *transaction = DYFReplayLookUp(&table, event->transactionHash);
+        DYFReplayApply(transaction, event, purchasing, purchasingCount, verbose);
+    }
+    
+    // Once the ring has wrapped, a transaction that is first seen downloading or finishing lost its first events.
+    int wrapped = events[0].sequence > 1;
+    size_t unfinished = 0, redelivered = 0, anomalous = 0, finished = 0;
+    for (size_t idx = 0; idx < capacity; idx++) {
+        DYFReplayTransaction *transaction = &table.slots[idx];
+        if (transaction->hash == 0) { continue; }
+        
+        if (transaction->finishes == 0 && transaction->completedAt != 0) {
+            transaction->flags |= DYFReplayUnfinished;
+            unfinished++;
+        }
+        if (wrapped && transaction->firstKind != DYFStoreJournalEventUpdated) {
+            transaction->flags |= DYFReplayTruncated;
+        }
+        finished += transaction->finishes > 0;
+        redelivered += (transaction->flags & DYFReplayRedelivered) != 0;
+        
+        if (transaction->purchasingAt && transaction->completedAt >= transaction->purchasingAt) {
+            DYFReplayAddSample(&toCompleted, transaction->completedAt - transaction->purchasingAt);
+        }
+        if (transaction->completedAt && transaction->finishedAt >= transaction->completedAt) {
+            DYFReplayAddSample(&toFinished, transaction->finishedAt - transaction->completedAt);
+        }
+        
+        uint32_t anomalies = transaction->flags & ~(uint32_t)DYFReplayTruncated;
+        anomalous += anomalies != 0;
+        if (verbose || anomalies != 0) {
+            DYFReplayPrintTransaction(transaction);
+        }
+    }
+    
+    printf("\nevents %ld (#%llu to #%llu) over %.3fs\n", count,
+           (unsigned long long)events[0].sequence, (unsigned long long)events[count - 1].sequence,
+           (events[count - 1].timestamp - events[0].timestamp) / 1e6);
+    printf("payments added %zu, restores %zu (%zu failed)\n", paymentsAdded, restores, failedRestores);
+    printf("transactions %zu: finished %zu, unfinished %zu, redelivered %zu, anomalous %zu\n",
+           table.count, finished, unfinished, redelivered, anomalous);
+    DYFReplayPrintSamples("purchasing to completed", &toCompleted);
+    DYFReplayPrintSamples("completed to finished", &toFinished);
+    
+    free(events);
+    free(table.slots);
+    free(purchasing);
+    free(toCompleted.values);
+    free(toFinished.values);
+    return 0;
+}
@@ -0,0 +1,308 @@
+//
+//  DYFStoreSharedFileStress.c
+//
+//  Created by Tenfay on 2014/11/4. ( https://github.com/itenfay/DYFStoreKit )
+//  Copyright © 2014 Tenfay. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// Stresses one `DYFStoreSharedFile` store with several processes at once: forked writers store, replace and remove records, which grows the index and compacts the log, while forked readers look up, enumerate and follow the changes without a lock. Every record read is checked against its identifier, and the store is checked in full at the end. It exits with 1 if a check fails or a process dies, e.g. of SIGBUS.
+//
+//     cc -O2 -Wall -o DYFStoreSharedFileStress Tools/DYFStoreSharedFileStress.c Classes/DYFStoreSharedFile.c -lpthread
+//     ./DYFStoreSharedFileStress [writers] [readers] [records per writer]
+//
+#include "../Classes/DYFStoreSharedFile.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// The writers store their records in batches of this size.
+#define DYFStressBatch 16
+
+// Every identifier is stored this many times, so that the log collects garbage and is compacted.
+#define DYFStressVersions 3
+
+typedef struct {
+    /** Set by the parent once all the writers exited. */
+    volatile int writersDone;
+} DYFStressShared;
+
+static void DYFStressIdentifier(char *buffer, size_t size, int writer, int record)
+{
+    snprintf(buffer, size, "%d%09d", 1 + writer, record);
+}
+
+/** Formats a record that tells its identifier and version. Its length varies, so that the records are not aligned alike.
+ */
+static size_t DYFStressRecord(char *buffer, size_t size, const char *identifier, int version)
+{
+    int length = snprintf(buffer, size, "{\"identifier\":\"%s\",\"version\":%d,\"padding\":\"", identifier, version);
+    size_t padding = (size_t)(identifier[strlen(identifier) - 1] - '0') * 23 + (size_t)version * 7;
+    for (size_t idx = 0; idx < padding && (size_t)length + 3 < size; idx++) {
+        buffer[length++] = 'x';
+    }
+    length += snprintf(buffer + length, size - (size_t)length, "\"}");
+    return (size_t)length;
+}
+
+/** Returns whether a record is one written for the identifier, and receives its version.
+ */
+static int DYFStressCheckRecord(const char *identifier, size_t identifierLength, const void *record, size_t length, int *version)
+{
+    char name[32];
+    char expected[512];
+    if (identifierLength >= sizeof(name)) { return 0; }
+    memcpy(name, identifier, identifierLength);
+    name[identifierLength] = '\0';
+    
+    for (*version = 0; *version < DYFStressVersions; (*version)++) {
+        size_t expectedLength = DYFStressRecord(expected, sizeof(expected), name, *version);
+        if (expectedLength == length && memcmp(expected, record, length) == 0) { return 1; }
+    }
+    return 0;
+}
+
+static int DYFStressWriter(const char *directory, int writer, int count)
+{
+    DYFStoreSharedFile *file = DYFStoreSharedFileOpen(directory);
+    if (!file) {
+        fprintf(stderr, "writer %d: open: %s\n", writer, strerror(errno));
+        return 1;
+    }
+    
+    char identifiers[DYFStressBatch][32];
+    char records[DYFStressBatch][512];
+    const char *identifierPointers[DYFStressBatch];
+    size_t identifierLengths[DYFStressBatch];
+    const void *recordPointers[DYFStressBatch];
+    size_t lengths[DYFStressBatch];
+    
+    for (int version = 0; version < DYFStressVersions; version++) {
+        for (int first = 0; first < count; first += DYFStressBatch) {
+            size_t batch = 0;
+            for (int record = first; record < count && batch < DYFStressBatch; record++, batch++) {
+                DYFStressIdentifier(identifiers[batch], sizeof(identifiers[batch]), writer, record);
+                identifierPointers[batch] = identifiers[batch];
+                identifierLengths[batch] = strlen(identifiers[batch]);
+                lengths[batch] = DYFStressRecord(records[batch], sizeof(records[batch]), identifiers[batch], version);
+                recordPointers[batch] = records[batch];
+            }
+            
+            // The batches are stored under one lock and one record at a time in turn.
+            int status = 0;
+            if ((first / DYFStressBatch) % 2 == 0) {
+                status = DYFStoreSharedFileStoreAll(file, identifierPointers, identifierLengths, recordPointers, lengths, batch);
+            }
+            for (size_t idx = 0; (first / DYFStressBatch) % 2 == 1 && status == 0 && idx < batch; idx++) {
+                status = DYFStoreSharedFileStore(file, identifierPointers[idx], identifierLengths[idx], recordPointers[idx], lengths[idx]);
+            }
+            // Removes a record and stores it again, which leaves a tombstone in the table.
+            if (status == 0) {
+                status = DYFStoreSharedFileRemove(file, &identifierPointers[0], &identifierLengths[0], 1) == 1 ? 0 : -1;
+            }
+            if (status == 0) {
+                status = DYFStoreSharedFileStore(file, identifierPointers[0], identifierLengths[0], recordPointers[0], lengths[0]);
+            }
+            if (status != 0) {
+                fprintf(stderr, "writer %d: store: %s\n", writer, strerror(errno));
+                DYFStoreSharedFileClose(file);
+                return 1;
+            }
+        }
+    }
+    
+    DYFStoreSharedFileClose(file);
+    return 0;
+}
+
+typedef struct {
+    long records;
+    long failures;
+} DYFStressEnumeration;
+
+static void DYFStressEnumerate(const char *identifier, size_t identifierLength, const void *record, size_t length, void *context)
+{
+    DYFStressEnumeration *enumeration = context;
+    int version = 0;
+    enumeration->records++;
+    if (!DYFStressCheckRecord(identifier, identifierLength, record, length, &version)) {
+        enumeration->failures++;
+    }
+}
+
+static int DYFStressReader(const char *directory, int reader, int writers, int count, DYFStressShared *shared)
+{
+    DYFStoreSharedFile *file = DYFStoreSharedFileOpen(directory);
+    if (!file) {
+        fprintf(stderr, "reader %d: open: %s\n", reader, strerror(errno));
+        return 1;
+    }
+    
+    unsigned int seed = (unsigned int)(reader + 1) * 2654435761u;
+    uint64_t changeNumber = 0;
+    long lookups = 0;
+    long enumerations = 0;
+    long failures = 0;
+    int done = 0;
+    
+    // One more round runs after the writers exited, against the final store.
+    while (!done) {
+        done = shared->writersDone;
+        
+        for (int idx = 0; idx < 256; idx++) {
+            char identifier[32];
+            DYFStressIdentifier(identifier, sizeof(identifier), rand_r(&seed) % writers, rand_r(&seed) % count);
+            size_t length = 0;
+            void *record = DYFStoreSharedFileCopyRecord(file, identifier, strlen(identifier), &length);
+            int version = 0;
+            if (record && !DYFStressCheckRecord(identifier, strlen(identifier), record, length, &version)) {
+                fprintf(stderr, "reader %d: record of %s is damaged\n", reader, identifier);
+                failures++;
+            }
+            free(record);
+            lookups++;
+        }
+        
+        DYFStressEnumeration enumeration = {0, 0};
+        long listed = DYFStoreSharedFileEnumerate(file, DYFStressEnumerate, &enumeration);
+        if (listed < 0 || enumeration.failures > 0 || listed != enumeration.records) {
+            fprintf(stderr, "reader %d: enumeration failed (%ld, %ld damaged)\n", reader, listed, enumeration.failures);
+            failures++;
+        }
+        enumerations++;
+        
+        DYFStoreSharedChange *changes = NULL;
+        int reset = 0;
+        uint64_t current = 0;
+        long changed = DYFStoreSharedFileCopyChanges(file, changeNumber, &changes, &reset, &current);
+        if (changed < 0) {
+            fprintf(stderr, "reader %d: changes: %s\n", reader, strerror(errno));
+            failures++;
+        } else {
+            for (long idx = 0; idx < changed; idx++) {
+                if (changes[idx].changeNumber != changeNumber + (uint64_t)idx + 1) {
+                    fprintf(stderr, "reader %d: change %llu out of order\n", reader, (unsigned long long)changes[idx].changeNumber);
+                    failures++;
+                    break;
+                }
+            }
+            DYFStoreSharedFileFreeChanges(changes, (size_t)changed);
+            changeNumber = current;
+        }
+    }
+    
+    printf("reader %d: %ld lookups, %ld enumerations, %ld failures\n", reader, lookups, enumerations, failures);
+    fflush(stdout);
+    DYFStoreSharedFileClose(file);
+    return failures > 0;
+}
+
+/** Checks that the store holds the last version of every record.
+ */
+static int DYFStressVerify(const char *directory, int writers, int count)
+{
+    DYFStoreSharedFile *file = DYFStoreSharedFileOpen(directory);
+    if (!file) { return 1; }
+    
+    int failures = 0;
+    for (int writer = 0; writer < writers; writer++) {
+        for (int record = 0; record < count; record++) {
+            char identifier[32];
+            DYFStressIdentifier(identifier, sizeof(identifier), writer, record);
+            size_t length = 0;
+            void *bytes = DYFStoreSharedFileCopyRecord(file, identifier, strlen(identifier), &length);
+            int version = -1;
+            if (!bytes || !DYFStressCheckRecord(identifier, strlen(identifier), bytes, length, &version) || version != DYFStressVersions - 1) {
+                if (failures++ < 10) { fprintf(stderr, "verify: %s is missing or stale\n", identifier); }
+            }
+            free(bytes);
+        }
+    }
+    
+    DYFStressEnumeration enumeration = {0, 0};
+    long listed = DYFStoreSharedFileEnumerate(file, DYFStressEnumerate, &enumeration);
+    if (listed != (long)writers * count || enumeration.failures > 0) {
+        fprintf(stderr, "verify: %ld records listed, %d expected\n", listed, writers * count);
+        failures++;
+    }
+    printf("verify: %ld records, change number %llu\n", listed, (unsigned long long)DYFStoreSharedFileChangeNumber(file));
+    DYFStoreSharedFileClose(file);
+    return failures > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int writers = argc > 1 ? atoi(argv[1]) : 4;
+    int readers = argc > 2 ? atoi(argv[2]) : 4;
+    int count = argc > 3 ? atoi(argv[3]) : 5000;
+    if (writers < 1 || readers < 0 || count < 1) {
+        fprintf(stderr, "usage: %s [writers] [readers] [records per writer]\n", argv[0]);
+        return 2;
+    }
+    
+    char directory[] = "/tmp/DYFStoreSharedFileStress.XXXXXX";
+    if (!mkdtemp(directory)) {
+        fprintf(stderr, "mkdtemp: %s\n", strerror(errno));
+        return 1;
+    }
+    DYFStressShared *shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+    if (shared == MAP_FAILED) { return 1; }
+    shared->writersDone = 0;
+    
+    // Creates the store before the processes race to open it.
+    DYFStoreSharedFileClose(DYFStoreSharedFileOpen(directory));
+    
+    pid_t *pids = calloc((size_t)(writers + readers), sizeof(pid_t));
+    for (int idx = 0; idx < writers + readers; idx++) {
+        pids[idx] = fork();
+        if (pids[idx] == 0) {
+            _exit(idx < writers ? DYFStressWriter(directory, idx, count) : DYFStressReader(directory, idx - writers, writers, count, shared));
+        }
+        if (pids[idx] < 0) {
+            fprintf(stderr, "fork: %s\n", strerror(errno));
+            return 1;
+        }
+    }
+    
+    int failed = 0;
+    for (int idx = 0; idx < writers + readers; idx++) {
+        if (idx == writers) { __atomic_store_n(&shared->writersDone, 1, __ATOMIC_RELEASE); }
+        int status = 0;
+        waitpid(pids[idx], &status, 0);
+        if (WIFSIGNALED(status)) {
+            fprintf(stderr, "%s %d died of signal %d\n", idx < writers ? "writer" : "reader", idx < writers ? idx : idx - writers, WTERMSIG(status));
+            failed = 1;
+        } else if (WEXITSTATUS(status) != 0) {
+            failed = 1;
+        }
+    }
+    if (readers == 0) { shared->writersDone = 1; }
+    
+    failed |= DYFStressVerify(directory, writers, count);
+    printf("%s\n", failed ? "FAILED" : "OK");
+    
+    char command[128];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    if (system(command) != 0) { fprintf(stderr, "could not remove %s\n", directory); }
+    free(pids);
+    return failed;
+}